@@ -0,0 +1,246 @@
+## @file
+# process DISPATCH_ORDER data and generate PEI/DXE dispatch order file
+#
+#  Copyright (c) 2021, Intel Corporation. All rights reserved.<BR>
+#
+#  SPDX-License-Identifier: BSD-2-Clause-Patent
+#
+
+##
+# Import Modules
+#
+from __future__ import absolute_import
+from uuid import UUID
+import Common.LongFilePathOs as os
+from io import BytesIO
+from .FfsFileStatement import FileStatement
+from .FfsInfStatement import FfsInfStatement
+from .GenFdsGlobalVariable import GenFdsGlobalVariable
+from Common.StringUtils import NormPath
+from Common.Misc import SaveFileOnChange, PathClass, GuidStructureStringToGuidString
+from Common.LongFilePathSupport import OpenLongFilePath as open
+from Common.DataType import *
+
+PEI_DISPATCH_ORDER_GUID = "C6EB7052-D916-4F76-8367-24E47E431D47"
+DXE_DISPATCH_ORDER_GUID = "36957274-1E29-4A96-B06D-BA4767F148EC"
+
+PEI_DISPATCH_ORDER_MODULE_TYPES = (SUP_MODULE_PEIM,)
+DXE_DISPATCH_ORDER_MODULE_TYPES = (SUP_MODULE_DXE_DRIVER, SUP_MODULE_DXE_RUNTIME_DRIVER,
+                                   SUP_MODULE_DXE_SAL_DRIVER, SUP_MODULE_UEFI_DRIVER)
+
+DEPEX_OPCODE_BEFORE = 0x00
+DEPEX_OPCODE_AFTER = 0x01
+DEPEX_OPCODE_PUSH = 0x02
+DEPEX_OPCODE_AND = 0x03
+DEPEX_OPCODE_OR = 0x04
+DEPEX_OPCODE_NOT = 0x05
+DEPEX_OPCODE_TRUE = 0x06
+DEPEX_OPCODE_FALSE = 0x07
+DEPEX_OPCODE_END = 0x08
+DEPEX_OPCODE_SOR = 0x09
+
+## process DISPATCH_ORDER data and generate PEI/DXE dispatch order file
+#
+#   The dispatch order file lists the file names of the modules of a FV in the
+#   order the PEI or DXE dispatcher is expected to dispatch them. The order is
+#   either given in the FDF, e.g. recorded from the performance records of a
+#   previous boot, or computed from the DEPEX of the modules and the PPIs or
+#   protocols their INF files declare as produced.
+#
+class DispatchOrderSection (object):
+    ## The constructor
+    #
+    #   @param  self        The object pointer
+    #
+    def __init__(self):
+        self.DefineVarDict = {}
+        self.FfsList = []
+        self.DispatchOrderType = ""
+
+    ## GenFfs() method
+    #
+    #   Generate FFS for dispatch order file
+    #
+    #   @param  self        The object pointer
+    #   @param  FvName      for whom dispatch order file generated
+    #   @param  FvFfsList   FFS statements of the FV
+    #   @param  Dict        dictionary contains macro and its value
+    #   @retval string      Generated file name
+    #
+    def GenFfs (self, FvName, FvFfsList, Dict = None, IsMakefile = False):
+        if IsMakefile:
+            #
+            # The DEPEX of the modules are only available once they are built.
+            #
+            return None
+        if Dict is None:
+            Dict = {}
+        if self.DispatchOrderType == "PEI":
+            OrderFileGuid = PEI_DISPATCH_ORDER_GUID
+        else:
+            OrderFileGuid = DXE_DISPATCH_ORDER_GUID
+
+        OutputOrderFilePath = os.path.join (GenFdsGlobalVariable.WorkSpaceDir, \
+                                   GenFdsGlobalVariable.FfsDir,\
+                                   OrderFileGuid + FvName)
+        if not os.path.exists(OutputOrderFilePath):
+            os.makedirs(OutputOrderFilePath)
+
+        OutputOrderFileName = os.path.join(OutputOrderFilePath, OrderFileGuid + FvName + '.Order')
+        OrderFfsFileName = os.path.join(OutputOrderFilePath, OrderFileGuid + FvName + '.Ffs')
+
+        Dict.update(self.DefineVarDict)
+        if self.FfsList:
+            GuidList = self._GetListedOrder(Dict)
+        else:
+            GuidList = self._GetDepexOrder(FvFfsList)
+
+        Buffer = BytesIO()
+        for Guid in GuidList:
+            Buffer.write(UUID(Guid).bytes_le)
+        SaveFileOnChange(OutputOrderFileName, Buffer.getvalue())
+
+        RawSectionFileName = os.path.join(OutputOrderFilePath, OrderFileGuid + FvName + '.raw')
+        GenFdsGlobalVariable.GenerateSection(RawSectionFileName, [OutputOrderFileName], 'EFI_SECTION_RAW')
+        GenFdsGlobalVariable.GenerateFfs(OrderFfsFileName, [RawSectionFileName],
+                                        'EFI_FV_FILETYPE_FREEFORM', OrderFileGuid)
+
+        return OrderFfsFileName
+
+    ## _GetListedOrder() method
+    #
+    #   Get the file names of the modules listed in the FDF
+    #
+    #   @param  self        The object pointer
+    #   @param  Dict        dictionary contains macro and its value
+    #   @retval list        File name GUIDs in dispatch order
+    #
+    def _GetListedOrder(self, Dict):
+        GuidList = []
+        for FfsObj in self.FfsList:
+            if isinstance(FfsObj, FileStatement):
+                GuidList.append(FfsObj.NameGuid)
+                continue
+            InfFileName = NormPath(FfsObj.InfFileName)
+            Arch = FfsObj.GetCurrentArch()
+            if Arch:
+                Dict['$(ARCH)'] = Arch
+            else:
+                Arch = TAB_COMMON
+            InfFileName = GenFdsGlobalVariable.MacroExtend(InfFileName, Dict, Arch)
+            Inf = GenFdsGlobalVariable.WorkSpace.BuildObject[PathClass(InfFileName, GenFdsGlobalVariable.WorkSpaceDir), Arch, GenFdsGlobalVariable.TargetName, GenFdsGlobalVariable.ToolChainTag]
+            GuidList.append(Inf.Guid)
+        return GuidList
+
+    ## _GetDepexOrder() method
+    #
+    #   Compute the dispatch order of the modules of a FV from their DEPEX.
+    #   The modules are taken in FV order as soon as their DEPEX is satisfied
+    #   by the GUIDs produced by the modules taken before them. GUIDs that no
+    #   module of the FV produces are assumed to be installed before the FV is
+    #   dispatched. Modules whose DEPEX can not be satisfied are kept at the end
+    #   in FV order, the dispatcher evaluates their DEPEX anyway.
+    #
+    #   @param  self        The object pointer
+    #   @param  FvFfsList   FFS statements of the FV
+    #   @retval list        File name GUIDs in dispatch order
+    #
+    def _GetDepexOrder(self, FvFfsList):
+        if self.DispatchOrderType == "PEI":
+            ModuleTypes = PEI_DISPATCH_ORDER_MODULE_TYPES
+        else:
+            ModuleTypes = DXE_DISPATCH_ORDER_MODULE_TYPES
+
+        Modules = []
+        for FfsObj in FvFfsList:
+            if not isinstance(FfsObj, FfsInfStatement) or FfsObj.InfModule is None:
+                continue
+            if FfsObj.ModuleType not in ModuleTypes:
+                continue
+            Inf = FfsObj.InfModule
+            if self.DispatchOrderType == "PEI":
+                Guids, Comments = Inf.Ppis, Inf.PpiComments
+            else:
+                Guids, Comments = Inf.Protocols, Inf.ProtocolComments
+            Produced = set()
+            for CName in Guids:
+                if any('PRODUCES' in Comment.upper() for Comment in Comments.get(CName, [])):
+                    Produced.add(GuidStructureStringToGuidString(Guids[CName]).upper())
+            Depex = None
+            DepexFileName = os.path.join(FfsObj.EfiOutputPath, FfsObj.BaseName + '.depex')
+            if os.path.exists(DepexFileName):
+                with open(DepexFileName, 'rb') as DepexFile:
+                    Depex = bytearray(DepexFile.read())
+            Modules.append((FfsObj.ModuleGuid.upper(), Depex, Produced))
+
+        KnownGuids = set()
+        for Module in Modules:
+            KnownGuids |= Module[2]
+
+        Installed = set()
+        GuidList = []
+        Pending = Modules
+        while Pending:
+            Remaining = []
+            for Module in Pending:
+                if self._EvaluateDepex(Module[1], Installed, KnownGuids):
+                    GuidList.append(Module[0])
+                    Installed |= Module[2]
+                else:
+                    Remaining.append(Module)
+            if len(Remaining) == len(Pending):
+                GuidList.extend(Module[0] for Module in Remaining)
+                break
+            Pending = Remaining
+        return GuidList
+
+    ## _EvaluateDepex() method
+    #
+    #   Evaluate a binary DEPEX against the GUIDs produced so far
+    #
+    #   @param  self        The object pointer
+    #   @param  Depex       The binary DEPEX, or None if the module has none
+    #   @param  Installed   GUIDs produced by the modules already dispatched
+    #   @param  KnownGuids  GUIDs produced by any module of the FV
+    #   @retval bool        Whether the DEPEX is satisfied
+    #
+    @staticmethod
+    def _EvaluateDepex(Depex, Installed, KnownGuids):
+        if not Depex:
+            return True
+        Stack = []
+        Index = 0
+        while Index < len(Depex):
+            OpCode = Depex[Index]
+            if OpCode in (DEPEX_OPCODE_BEFORE, DEPEX_OPCODE_AFTER):
+                #
+                # The dispatcher schedules these modules around their target.
+                #
+                return True
+            elif OpCode == DEPEX_OPCODE_PUSH:
+                Guid = str(UUID(bytes_le=bytes(Depex[Index + 1:Index + 17]))).upper()
+                Stack.append(Guid in Installed or Guid not in KnownGuids)
+                Index += 16
+            elif OpCode in (DEPEX_OPCODE_AND, DEPEX_OPCODE_OR):
+                if len(Stack) < 2:
+                    return False
+                Operand1 = Stack.pop()
+                Operand2 = Stack.pop()
+                if OpCode == DEPEX_OPCODE_AND:
+                    Stack.append(Operand1 and Operand2)
+                else:
+                    Stack.append(Operand1 or Operand2)
+            elif OpCode == DEPEX_OPCODE_NOT:
+                if not Stack:
+                    return False
+                Stack.append(not Stack.pop())
+            elif OpCode == DEPEX_OPCODE_TRUE:
+                Stack.append(True)
+            elif OpCode == DEPEX_OPCODE_FALSE:
+                Stack.append(False)
+            elif OpCode == DEPEX_OPCODE_END:
+                return bool(Stack) and Stack.pop()
+            elif OpCode != DEPEX_OPCODE_SOR:
+                return False
+            Index += 1
+        return False
@@ -33,6 +33,7 @@ from .Fd import FD
 from .Region import Region
 from .Fv import FV
 from .AprioriSection import AprioriSection
+from .DispatchOrderSection import DispatchOrderSection
 from .FfsInfStatement import FfsInfStatement
 from .FfsFileStatement import FileStatement
 from .VerSection import VerSection
@@ -2109,6 +2110,8 @@ class FdfParser:
 
         self._GetAprioriSection(FvObj)
         self._GetAprioriSection(FvObj)
+        self._GetDispatchOrderSection(FvObj)
+        self._GetDispatchOrderSection(FvObj)
 
         while True:
             isInf = self._GetInfStatement(FvObj)
@@ -2378,6 +2381,42 @@ class FdfParser:
         FvObj.AprioriSectionList.append(AprSectionObj)
         return True
 
+    ## _GetDispatchOrderSection() method
+    #
+    #   Get dispatch order statement. Without a module list, the order is
+    #   computed from the DEPEX of the modules in the FV.
+    #
+    #   @param  self        The object pointer
+    #   @param  FvObj       for whom dispatch order is got
+    #   @retval True        Successfully find dispatch order statement
+    #   @retval False       Not able to find dispatch order statement
+    #
+    def _GetDispatchOrderSection(self, FvObj):
+        if not self._IsKeyword("DISPATCH_ORDER"):
+            return False
+
+        if not self._IsKeyword("PEI") and not self._IsKeyword("DXE"):
+            raise Warning.Expected("Dispatch order file type", self.FileName, self.CurrentLineNumber)
+        OrderType = self._Token
+
+        OrderSectionObj = DispatchOrderSection()
+        OrderSectionObj.DispatchOrderType = OrderType
+
+        if self._IsToken("{"):
+            self._GetDefineStatements(OrderSectionObj)
+
+            while True:
+                IsInf = self._GetInfStatement(OrderSectionObj)
+                IsFile = self._GetFileStatement(OrderSectionObj)
+                if not IsInf and not IsFile:
+                    break
+
+            if not self._IsToken(T_CHAR_BRACE_R):
+                raise Warning.ExpectedCurlyClose(self.FileName, self.CurrentLineNumber)
+
+        FvObj.DispatchOrderSectionList.append(OrderSectionObj)
+        return True
+
     def _ParseInfStatement(self):
         if not self._IsKeyword("INF"):
             return None
@@ -3796,6 +3835,8 @@ class FdfParser:
                 self._GetFvAttributes(FvObj)
                 self._GetAprioriSection(FvObj)
                 self._GetAprioriSection(FvObj)
+                self._GetDispatchOrderSection(FvObj)
+                self._GetDispatchOrderSection(FvObj)
 
                 while True:
                     IsInf = self._GetInfStatement(FvObj)
@@ -42,6 +42,7 @@ class FV (object):
         self.FvNameGuid = None
         self.FvNameString = None
         self.AprioriSectionList = []
+        self.DispatchOrderSectionList = []
         self.FfsList = []
         self.BsBaseAddress = None
         self.RtBaseAddress = None
@@ -130,6 +131,18 @@ class FV (object):
                 self.FvInfFile.append("EFI_FILE_NAME = " + \
                                             FileName          + \
                                             TAB_LINE_BREAK)
+
+        #
+        # Process the dispatch order sections once the modules are generated
+        #
+        for OrderSection in self.DispatchOrderSectionList:
+            FileName = OrderSection.GenFfs (self.UiFvName, self.FfsList, MacroDict, IsMakefile=Flag)
+            if FileName:
+                FfsFileList.append(FileName)
+                if not Flag:
+                    self.FvInfFile.append("EFI_FILE_NAME = " + \
+                                                FileName          + \
+                                                TAB_LINE_BREAK)
         if not Flag:
             FvInfFile = ''.join(self.FvInfFile)
             SaveFileOnChange(self.InfFileName, FvInfFile, False)
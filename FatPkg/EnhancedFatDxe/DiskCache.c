@@ -10,7 +10,121 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 
 /**
 
-  This function is used by the Data Cache.
+  Get the cache tag of the specified way in the specified group.
+
+  @param  DiskCache             - The disk cache.
+  @param  GroupNo               - The group number.
+  @param  Way                   - The way in the group.
+
+  @return The cache tag.
+
+**/
+STATIC
+CACHE_TAG *
+FatGetCacheTag (
+  IN DISK_CACHE         *DiskCache,
+  IN UINTN              GroupNo,
+  IN UINTN              Way
+  )
+{
+  return &DiskCache->CacheTag[Way * (DiskCache->GroupMask + 1) + GroupNo];
+}
+
+/**
+
+  Get the address of the cache page described by the cache tag.
+
+  @param  DiskCache             - The disk cache.
+  @param  CacheTag              - The Cache Tag for the cache page.
+
+  @return The address of the cache page.
+
+**/
+STATIC
+UINT8 *
+FatGetCachePageAddress (
+  IN DISK_CACHE         *DiskCache,
+  IN CACHE_TAG          *CacheTag
+  )
+{
+  return DiskCache->CacheBase + ((UINTN) (CacheTag - DiskCache->CacheTag) << DiskCache->PageAlignment);
+}
+
+/**
+
+  Look up the cache page which holds the specified PageNo.
+
+  @param  DiskCache             - The disk cache.
+  @param  PageNo                - PageNo to match with the cache.
+
+  @return The cache tag of the page, or NULL if the page is not in the cache.
+
+**/
+STATIC
+CACHE_TAG *
+FatFindCachePage (
+  IN DISK_CACHE         *DiskCache,
+  IN UINTN              PageNo
+  )
+{
+  UINTN       GroupNo;
+  UINTN       Way;
+  CACHE_TAG   *CacheTag;
+
+  GroupNo = PageNo & DiskCache->GroupMask;
+  for (Way = 0; Way < DiskCache->WayCount; Way++) {
+    CacheTag = FatGetCacheTag (DiskCache, GroupNo, Way);
+    if (CacheTag->RealSize > 0 && CacheTag->PageNo == PageNo) {
+      return CacheTag;
+    }
+  }
+
+  return NULL;
+}
+
+/**
+
+  Select the way to be replaced in the specified group: an unused way if there
+  is one, otherwise the least recently used way.
+
+  @param  DiskCache             - The disk cache.
+  @param  GroupNo               - The group number.
+
+  @return The way to be replaced.
+
+**/
+STATIC
+UINTN
+FatGetVictimWay (
+  IN DISK_CACHE         *DiskCache,
+  IN UINTN              GroupNo
+  )
+{
+  UINTN       Way;
+  UINTN       Victim;
+  CACHE_TAG   *CacheTag;
+  UINTN       Oldest;
+
+  Victim = 0;
+  Oldest = MAX_UINTN;
+  for (Way = 0; Way < DiskCache->WayCount; Way++) {
+    CacheTag = FatGetCacheTag (DiskCache, GroupNo, Way);
+    if (CacheTag->RealSize == 0) {
+      return Way;
+    }
+
+    if (CacheTag->LastAccess < Oldest) {
+      Oldest = CacheTag->LastAccess;
+      Victim = Way;
+    }
+  }
+
+  return Victim;
+}
+
+/**
+
+  This function is used by the accesses which bypass the cache.
 
   When this function is called by write command, all entries in this range
   are older than the contents in disk, so they are invalid; just mark them invalid.
@@ -20,6 +134,7 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
   than the info in the cache; So need to update the relative info in the Buffer.
 
   @param  Volume                - FAT file system volume.
+  @param  CacheDataType         - The type of cache: CACHE_DATA or CACHE_FAT.
   @param  IoMode                - This function is called by read command or write command
   @param  StartPageNo           - First PageNo to be checked in the cache.
   @param  EndPageNo             - Last PageNo to be checked in the cache.
@@ -29,8 +144,9 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 **/
 STATIC
 VOID
-FatFlushDataCacheRange (
+FatFlushCacheRange (
   IN  FAT_VOLUME         *Volume,
+  IN  CACHE_DATA_TYPE    CacheDataType,
   IN  IO_MODE            IoMode,
   IN  UINTN              StartPageNo,
   IN  UINTN              EndPageNo,
@@ -38,24 +154,18 @@ FatFlushDataCacheRange (
   )
 {
   UINTN       PageNo;
-  UINTN       GroupNo;
-  UINTN       GroupMask;
   UINTN       PageSize;
   UINT8       PageAlignment;
   DISK_CACHE  *DiskCache;
   CACHE_TAG   *CacheTag;
-  UINT8       *BaseAddress;
 
-  DiskCache     = &Volume->DiskCache[CacheData];
-  BaseAddress   = DiskCache->CacheBase;
-  GroupMask     = DiskCache->GroupMask;
+  DiskCache     = &Volume->DiskCache[CacheDataType];
   PageAlignment = DiskCache->PageAlignment;
   PageSize      = (UINTN)1 << PageAlignment;
 
   for (PageNo = StartPageNo; PageNo < EndPageNo; PageNo++) {
-    GroupNo   = PageNo & GroupMask;
-    CacheTag  = &DiskCache->CacheTag[GroupNo];
-    if (CacheTag->RealSize > 0 && CacheTag->PageNo == PageNo) {
+    CacheTag = FatFindCachePage (DiskCache, PageNo);
+    if (CacheTag != NULL) {
       //
       // When reading data form disk directly, if some dirty data
       // in cache is in this rang, this data in the Buffer need to
@@ -65,7 +175,7 @@ FatFlushDataCacheRange (
         if (CacheTag->Dirty) {
           CopyMem (
             Buffer + ((PageNo - StartPageNo) << PageAlignment),
-            BaseAddress + (GroupNo << PageAlignment),
+            FatGetCachePageAddress (DiskCache, CacheTag),
             PageSize
             );
         }
@@ -81,12 +191,17 @@ FatFlushDataCacheRange (
 
 /**
 
-  Exchange the cache page with the image on the disk
+  Exchange a run of cache pages with the image on the disk.
+
+  The cache pages of the run must hold consecutive page numbers, and must be
+  in the same way of consecutive groups, so they are contiguous in memory and
+  can be transferred with one disk access.
 
   @param  Volume                - FAT file system volume.
   @param  DataType              - Indicate the cache type.
   @param  IoMode                - Indicate whether to load this page from disk or store this page to disk.
-  @param  CacheTag              - The Cache Tag for the current cache page.
+  @param  CacheTag              - The Cache Tag for the first cache page of the run.
+  @param  PageCount             - The number of cache pages in the run.
   @param  Task                    point to task instance.
 
   @retval EFI_SUCCESS           - Cache page exchanged successfully.
@@ -100,12 +215,14 @@ FatExchangeCachePage (
   IN CACHE_DATA_TYPE    DataType,
   IN IO_MODE            IoMode,
   IN CACHE_TAG          *CacheTag,
+  IN UINTN              PageCount,
   IN FAT_TASK           *Task
   )
 {
   EFI_STATUS  Status;
-  UINTN       GroupNo;
+  UINTN       Index;
   UINTN       PageNo;
+  UINTN       PageSize;
   UINTN       WriteCount;
   UINTN       RealSize;
   UINT64      EntryPos;
@@ -116,13 +233,13 @@ FatExchangeCachePage (
 
   DiskCache     = &Volume->DiskCache[DataType];
   PageNo        = CacheTag->PageNo;
-  GroupNo       = PageNo & DiskCache->GroupMask;
   PageAlignment = DiskCache->PageAlignment;
-  PageAddress   = DiskCache->CacheBase + (GroupNo << PageAlignment);
+  PageSize      = (UINTN)1 << PageAlignment;
+  PageAddress   = FatGetCachePageAddress (DiskCache, CacheTag);
   EntryPos      = DiskCache->BaseAddress + LShiftU64 (PageNo, PageAlignment);
-  RealSize      = CacheTag->RealSize;
+  RealSize      = ((PageCount - 1) << PageAlignment) + CacheTag[PageCount - 1].RealSize;
   if (IoMode == ReadDisk) {
-    RealSize  = (UINTN)1 << PageAlignment;
+    RealSize  = PageCount << PageAlignment;
     MaxSize   = DiskCache->LimitAddress - EntryPos;
     if (MaxSize < RealSize) {
       DEBUG ((EFI_D_INFO, "FatDiskIo: Cache Page OutBound occurred! \n"));
@@ -147,8 +264,12 @@ FatExchangeCachePage (
     EntryPos += Volume->FatSize;
   } while (--WriteCount > 0);
 
-  CacheTag->Dirty     = FALSE;
-  CacheTag->RealSize  = RealSize;
+  for (Index = 0; Index < PageCount; Index++) {
+    ASSERT (CacheTag[Index].PageNo == PageNo + Index);
+    CacheTag[Index].Dirty    = FALSE;
+    CacheTag[Index].RealSize = MIN (RealSize - (Index << PageAlignment), PageSize);
+  }
+
   return EFI_SUCCESS;
 }
 
@@ -156,8 +277,14 @@ FatExchangeCachePage (
 
   Get one cache page by specified PageNo.
 
+  When a read misses the cache and continues a sequential stream, the
+  following pages are read ahead in the same disk access. The read-ahead
+  window doubles with each sequential miss, up to
+  FAT_CACHE_READ_AHEAD_MAX_PAGES pages, and a random access closes it.
+
   @param  Volume                - FAT file system volume.
   @param  CacheDataType         - The cache type: CACHE_FAT or CACHE_DATA.
+  @param  IoMode                - Indicate the type of disk access.
   @param  PageNo                - PageNo to match with the cache.
   @param  CacheTag              - The Cache Tag for the current cache page.
 
@@ -168,39 +295,104 @@ FatExchangeCachePage (
 STATIC
 EFI_STATUS
 FatGetCachePage (
-  IN FAT_VOLUME         *Volume,
-  IN CACHE_DATA_TYPE    CacheDataType,
-  IN UINTN              PageNo,
-  IN CACHE_TAG          *CacheTag
+  IN  FAT_VOLUME         *Volume,
+  IN  CACHE_DATA_TYPE    CacheDataType,
+  IN  IO_MODE            IoMode,
+  IN  UINTN              PageNo,
+  OUT CACHE_TAG          **CacheTag
   )
 {
   EFI_STATUS  Status;
-  UINTN       OldPageNo;
+  DISK_CACHE  *DiskCache;
+  CACHE_TAG   *Tag;
+  CACHE_TAG   *NextTag;
+  UINTN       GroupNo;
+  UINTN       Way;
+  UINTN       PageCount;
+  UINTN       Index;
+  BOOLEAN     Sequential;
 
-  OldPageNo = CacheTag->PageNo;
-  if (CacheTag->RealSize > 0 && OldPageNo == PageNo) {
+  DiskCache  = &Volume->DiskCache[CacheDataType];
+  Sequential = (BOOLEAN) (PageNo == DiskCache->NextPageNo);
+  DiskCache->NextPageNo = PageNo + 1;
+
+  Tag = FatFindCachePage (DiskCache, PageNo);
+  if (Tag != NULL) {
     //
     // Cache Hit occurred
     //
+    DiskCache->HitCount++;
+    Tag->LastAccess = ++DiskCache->AccessClock;
+    *CacheTag       = Tag;
     return EFI_SUCCESS;
   }
 
+  DiskCache->MissCount++;
+  GroupNo = PageNo & DiskCache->GroupMask;
+  Way     = FatGetVictimWay (DiskCache, GroupNo);
+  Tag     = FatGetCacheTag (DiskCache, GroupNo, Way);
+
   //
   // Write dirty cache page back to disk
   //
-  if (CacheTag->RealSize > 0 && CacheTag->Dirty) {
-    Status = FatExchangeCachePage (Volume, CacheDataType, WriteDisk, CacheTag, NULL);
+  if (Tag->RealSize > 0 && Tag->Dirty) {
+    Status = FatExchangeCachePage (Volume, CacheDataType, WriteDisk, Tag, 1, NULL);
     if (EFI_ERROR (Status)) {
       return Status;
     }
   }
+
+  //
+  // Size the read-ahead window.
+  //
+  if (IoMode == ReadDisk && Sequential) {
+    DiskCache->ReadAheadPages = MIN (
+                                  MAX (DiskCache->ReadAheadPages * 2, 1),
+                                  FAT_CACHE_READ_AHEAD_MAX_PAGES
+                                  );
+  } else {
+    DiskCache->ReadAheadPages = 0;
+  }
+
+  //
+  // Extend the run over the following pages while they are not cached, they
+  // are complete pages, and the LRU victims of their groups are clean pages of
+  // the same way, so the whole run stays contiguous in memory.
+  //
+  PageCount = 1;
+  while (PageCount <= DiskCache->ReadAheadPages) {
+    if (GroupNo + PageCount > DiskCache->GroupMask ||
+        DiskCache->BaseAddress + LShiftU64 (PageNo + PageCount + 1, DiskCache->PageAlignment) > DiskCache->LimitAddress ||
+        FatFindCachePage (DiskCache, PageNo + PageCount) != NULL ||
+        FatGetVictimWay (DiskCache, GroupNo + PageCount) != Way) {
+      break;
+    }
+
+    NextTag = Tag + PageCount;
+    if (NextTag->RealSize > 0 && NextTag->Dirty) {
+      break;
+    }
+
+    PageCount++;
+  }
+
   //
   // Load new data from disk;
   //
-  CacheTag->PageNo  = PageNo;
-  Status            = FatExchangeCachePage (Volume, CacheDataType, ReadDisk, CacheTag, NULL);
+  for (Index = 0; Index < PageCount; Index++) {
+    Tag[Index].PageNo     = PageNo + Index;
+    Tag[Index].RealSize   = 0;
+    Tag[Index].LastAccess = ++DiskCache->AccessClock;
+  }
 
-  return Status;
+  Status = FatExchangeCachePage (Volume, CacheDataType, ReadDisk, Tag, PageCount, NULL);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  DiskCache->ReadAheadCount += PageCount - 1;
+  *CacheTag = Tag;
+  return EFI_SUCCESS;
 }
 
 /**
@@ -237,14 +429,11 @@ FatAccessUnalignedCachePage (
   VOID        *Destination;
   DISK_CACHE  *DiskCache;
   CACHE_TAG   *CacheTag;
-  UINTN       GroupNo;
 
   DiskCache = &Volume->DiskCache[CacheDataType];
-  GroupNo   = PageNo & DiskCache->GroupMask;
-  CacheTag  = &DiskCache->CacheTag[GroupNo];
-  Status    = FatGetCachePage (Volume, CacheDataType, PageNo, CacheTag);
+  Status    = FatGetCachePage (Volume, CacheDataType, IoMode, PageNo, &CacheTag);
   if (!EFI_ERROR (Status)) {
-    Source      = DiskCache->CacheBase + (GroupNo << DiskCache->PageAlignment) + Offset;
+    Source      = FatGetCachePageAddress (DiskCache, CacheTag) + Offset;
     Destination = Buffer;
     if (IoMode != ReadDisk) {
       CacheTag->Dirty   = TRUE;
@@ -270,9 +459,9 @@ FatAccessUnalignedCachePage (
   1. Access of FAT cache (CACHE_FAT): Access the data in the FAT cache, if there is cache
      page hit, just return the cache page; else update the related cache page and return
      the right cache page.
-  2. Access of Data cache (CACHE_DATA):
+  2. Access of Data cache (CACHE_DATA), or read of a large range of the FAT cache:
      The access data will be divided into UnderRun data, Aligned data and OverRun data;
-     The UnderRun data and OverRun data will be accessed by the Data cache,
+     The UnderRun data and OverRun data will be accessed by the cache,
      but the Aligned data will be accessed with disk directly.
 
   @param  Volume                - FAT file system volume.
@@ -345,11 +534,12 @@ FatAccessCache (
   //
   if (AlignedPageCount > 0) {
     //
-    // Accessing fat table cannot have alignment data
+    // Writing fat table cannot have alignment data, as every fat copy
+    // has to be updated
     //
-    ASSERT (CacheDataType == CacheData);
+    ASSERT (CacheDataType == CacheData || IoMode == ReadDisk);
 
-    EntryPos    = Volume->RootPos + LShiftU64 (PageNo, PageAlignment);
+    EntryPos    = DiskCache->BaseAddress + LShiftU64 (PageNo, PageAlignment);
     AlignedSize = AlignedPageCount << PageAlignment;
     Status      = FatDiskIo (Volume, IoMode, EntryPos, AlignedSize, Buffer, Task);
     if (EFI_ERROR (Status)) {
@@ -359,7 +549,7 @@ FatAccessCache (
     // If these access data over laps the relative cache range, these cache pages need
     // to be updated.
     //
-    FatFlushDataCacheRange (Volume, IoMode, PageNo, OverRunPageNo, Buffer);
+    FatFlushCacheRange (Volume, CacheDataType, IoMode, PageNo, OverRunPageNo, Buffer);
     Buffer      += AlignedSize;
     BufferSize  -= AlignedSize;
   }
@@ -381,6 +571,10 @@ FatAccessCache (
 
   Flush all the dirty cache back, include the FAT cache and the Data cache.
 
+  Dirty pages which hold consecutive page numbers in the same way of
+  consecutive groups are contiguous in memory, so they are written back
+  with one disk access.
+
   @param  Volume                - FAT file system volume.
   @param  Task                    point to task instance.
 
@@ -398,6 +592,9 @@ FatVolumeFlushCache (
   CACHE_DATA_TYPE CacheDataType;
   UINTN           GroupIndex;
   UINTN           GroupMask;
+  UINTN           Way;
+  UINTN           PageCount;
+  UINTN           PageSize;
   DISK_CACHE      *DiskCache;
   CACHE_TAG       *CacheTag;
 
@@ -408,13 +605,27 @@ FatVolumeFlushCache (
       // Data cache or fat cache is dirty, write the dirty data back
       //
       GroupMask = DiskCache->GroupMask;
-      for (GroupIndex = 0; GroupIndex <= GroupMask; GroupIndex++) {
-        CacheTag = &DiskCache->CacheTag[GroupIndex];
-        if (CacheTag->RealSize > 0 && CacheTag->Dirty) {
+      PageSize  = (UINTN)1 << DiskCache->PageAlignment;
+      for (Way = 0; Way < DiskCache->WayCount; Way++) {
+        for (GroupIndex = 0; GroupIndex <= GroupMask; GroupIndex += PageCount) {
+          CacheTag  = FatGetCacheTag (DiskCache, GroupIndex, Way);
+          PageCount = 1;
+          if (CacheTag->RealSize == 0 || !CacheTag->Dirty) {
+            continue;
+          }
+
+          while (GroupIndex + PageCount <= GroupMask &&
+                 CacheTag[PageCount - 1].RealSize == PageSize &&
+                 CacheTag[PageCount].RealSize > 0 &&
+                 CacheTag[PageCount].Dirty &&
+                 CacheTag[PageCount].PageNo == CacheTag->PageNo + PageCount) {
+            PageCount++;
+          }
+
           //
           // Write back all Dirty Data Cache Page to disk
           //
-          Status = FatExchangeCachePage (Volume, CacheDataType, WriteDisk, CacheTag, Task);
+          Status = FatExchangeCachePage (Volume, CacheDataType, WriteDisk, CacheTag, PageCount, Task);
           if (EFI_ERROR (Status)) {
             return Status;
           }
@@ -435,6 +646,10 @@ FatVolumeFlushCache (
 
   Initialize the disk cache according to Volume's FatType.
 
+  The data cache is sized by the volume size, up to PcdFatDataCacheMaxSize
+  bytes, and is shrunk down to FAT_DATACACHE_GROUP_MIN_COUNT groups if there
+  is not enough free memory.
+
   @param  Volume                - FAT file system volume.
 
   @retval EFI_SUCCESS           - The disk cache is successfully initialized.
@@ -448,8 +663,11 @@ FatInitializeDiskCache (
 {
   DISK_CACHE  *DiskCache;
   UINTN       FatCacheGroupCount;
+  UINTN       DataCacheGroupCount;
   UINTN       DataCacheSize;
   UINTN       FatCacheSize;
+  UINTN       FatTagCount;
+  UINTN       DataTagCount;
   UINT8       *CacheBuffer;
 
   DiskCache = Volume->DiskCache;
@@ -458,32 +676,55 @@ FatInitializeDiskCache (
   //
   if (Volume->FatType == Fat12) {
     FatCacheGroupCount                  = FAT_FATCACHE_GROUP_MIN_COUNT;
+    DiskCache[CacheFat].WayCount       = FAT_FATCACHE_WAY_MIN_COUNT;
     DiskCache[CacheFat].PageAlignment  = FAT_FATCACHE_PAGE_MIN_ALIGNMENT;
     DiskCache[CacheData].PageAlignment = FAT_DATACACHE_PAGE_MIN_ALIGNMENT;
   } else {
     FatCacheGroupCount                  = FAT_FATCACHE_GROUP_MAX_COUNT;
+    DiskCache[CacheFat].WayCount       = FAT_FATCACHE_WAY_MAX_COUNT;
     DiskCache[CacheFat].PageAlignment  = FAT_FATCACHE_PAGE_MAX_ALIGNMENT;
     DiskCache[CacheData].PageAlignment = FAT_DATACACHE_PAGE_MAX_ALIGNMENT;
   }
 
-  DiskCache[CacheData].GroupMask     = FAT_DATACACHE_GROUP_COUNT - 1;
+  DataCacheGroupCount = FAT_DATACACHE_GROUP_MIN_COUNT;
+  while (DataCacheGroupCount < FAT_DATACACHE_GROUP_MAX_COUNT &&
+         RShiftU64 (Volume->VolumeSize, FAT_DATACACHE_GROUP_SIZE_SHIFT) > DataCacheGroupCount &&
+         ((DataCacheGroupCount * 2 * FAT_DATACACHE_WAY_COUNT) << DiskCache[CacheData].PageAlignment) <= PcdGet32 (PcdFatDataCacheMaxSize)) {
+    DataCacheGroupCount <<= 1;
+  }
+
+  DiskCache[CacheData].WayCount      = FAT_DATACACHE_WAY_COUNT;
   DiskCache[CacheData].BaseAddress   = Volume->RootPos;
   DiskCache[CacheData].LimitAddress  = Volume->VolumeSize;
   DiskCache[CacheFat].GroupMask      = FatCacheGroupCount - 1;
   DiskCache[CacheFat].BaseAddress    = Volume->FatPos;
   DiskCache[CacheFat].LimitAddress   = Volume->FatPos + Volume->FatSize;
-  FatCacheSize                        = FatCacheGroupCount << DiskCache[CacheFat].PageAlignment;
-  DataCacheSize                       = FAT_DATACACHE_GROUP_COUNT << DiskCache[CacheData].PageAlignment;
+  FatTagCount                         = FatCacheGroupCount * DiskCache[CacheFat].WayCount;
+  FatCacheSize                        = FatTagCount << DiskCache[CacheFat].PageAlignment;
+
   //
-  // Allocate the Fat Cache buffer
+  // Allocate the Fat Cache buffer, the Data Cache buffer and their tags.
   //
-  CacheBuffer = AllocateZeroPool (FatCacheSize + DataCacheSize);
+  do {
+    DataTagCount  = DataCacheGroupCount * DiskCache[CacheData].WayCount;
+    DataCacheSize = DataTagCount << DiskCache[CacheData].PageAlignment;
+    CacheBuffer   = AllocateZeroPool (FatCacheSize + DataCacheSize + (FatTagCount + DataTagCount) * sizeof (CACHE_TAG));
+    if (CacheBuffer != NULL) {
+      break;
+    }
+
+    DataCacheGroupCount >>= 1;
+  } while (DataCacheGroupCount >= FAT_DATACACHE_GROUP_MIN_COUNT);
+
   if (CacheBuffer == NULL) {
     return EFI_OUT_OF_RESOURCES;
   }
 
+  DiskCache[CacheData].GroupMask = DataCacheGroupCount - 1;
   Volume->CacheBuffer             = CacheBuffer;
   DiskCache[CacheFat].CacheBase  = CacheBuffer;
   DiskCache[CacheData].CacheBase = CacheBuffer + FatCacheSize;
+  DiskCache[CacheFat].CacheTag   = (CACHE_TAG *) (CacheBuffer + FatCacheSize + DataCacheSize);
+  DiskCache[CacheData].CacheTag  = DiskCache[CacheFat].CacheTag + FatTagCount;
   return EFI_SUCCESS;
 }
@@ -80,9 +80,26 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #define FAT_FATCACHE_PAGE_MAX_ALIGNMENT   15
 #define FAT_DATACACHE_PAGE_MIN_ALIGNMENT  13
 #define FAT_DATACACHE_PAGE_MAX_ALIGNMENT  16
-#define FAT_DATACACHE_GROUP_COUNT         64
+//
+// The disk caches are set associative, a page lives in one of the ways of
+// the group selected by its page number. The data cache starts with
+// FAT_DATACACHE_GROUP_MIN_COUNT groups and doubles the group count while it
+// is below the volume size in 64M units, up to FAT_DATACACHE_GROUP_MAX_COUNT
+// and as long as the cache fits in PcdFatDataCacheMaxSize. The count is
+// halved again when the memory for it cannot be allocated.
+//
+#define FAT_DATACACHE_WAY_COUNT           4
+#define FAT_DATACACHE_GROUP_MIN_COUNT     16
+#define FAT_DATACACHE_GROUP_MAX_COUNT     64
+#define FAT_DATACACHE_GROUP_SIZE_SHIFT    26
+#define FAT_FATCACHE_WAY_MIN_COUNT        1
+#define FAT_FATCACHE_WAY_MAX_COUNT        4
 #define FAT_FATCACHE_GROUP_MIN_COUNT      1
-#define FAT_FATCACHE_GROUP_MAX_COUNT      16
+#define FAT_FATCACHE_GROUP_MAX_COUNT      4
+//
+// Maximum number of pages read ahead when a sequential stream is detected
+//
+#define FAT_CACHE_READ_AHEAD_MAX_PAGES    8
 
 //
 // Used in 8.3 generation algorithm
@@ -105,6 +122,10 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #define MAX_LANG_CODE_SIZE      100
 
 #define FAT_MAX_DIR_CACHE_COUNT 8
+//
+// The FAT is read in chunks of this size to build the free cluster bitmap
+//
+#define FAT_FREE_BITMAP_CHUNK_SIZE  0x10000
 #define FAT_MAX_DIRENTRY_COUNT  0xFFFF
 typedef CHAR8                   LC_ISO_639_2;
 
@@ -147,8 +168,13 @@ typedef struct {
   UINTN   PageNo;
   UINTN   RealSize;
   BOOLEAN Dirty;
+  UINTN   LastAccess;     // Access stamp for the LRU replacement in a group
 } CACHE_TAG;
 
+//
+// The cache pages (and the cache tags) are laid out way by way, so the pages
+// of consecutive groups in the same way are contiguous in memory.
+//
 typedef struct {
   UINT64    BaseAddress;
   UINT64    LimitAddress;
@@ -156,7 +182,20 @@ typedef struct {
   BOOLEAN   Dirty;
   UINT8     PageAlignment;
   UINTN     GroupMask;
-  CACHE_TAG CacheTag[FAT_DATACACHE_GROUP_COUNT];
+  UINTN     WayCount;
+  CACHE_TAG *CacheTag;    // (GroupMask + 1) * WayCount tags
+  UINTN     AccessClock;
+  //
+  // Sequential stream detection for read-ahead
+  //
+  UINTN     NextPageNo;
+  UINTN     ReadAheadPages;
+  //
+  // Statistics
+  //
+  UINT64    HitCount;
+  UINT64    MissCount;
+  UINT64    ReadAheadCount;
 } DISK_CACHE;
 
 //
@@ -335,6 +374,8 @@ struct _FAT_VOLUME {
   FAT_INFO_SECTOR                 FatInfoSector;  // Free cluster info
   UINTN                           FreeInfoPos;    // Pos with the free cluster info
   BOOLEAN                         FreeInfoValid;  // If free cluster info is valid
+  UINT64                          *FreeBitmap;    // One bit per cluster, set if the cluster is free
+  BOOLEAN                         FreeBitmapFailed; // If the bitmap could not be built, don't try again
   //
   // Unpacked Fat BPB info
   //
@@ -722,9 +763,9 @@ FatInitializeDiskCache (
   1. Access of FAT cache (CACHE_FAT): Access the data in the FAT cache, if there is cache
      page hit, just return the cache page; else update the related cache page and return
      the right cache page.
-  2. Access of Data cache (CACHE_DATA):
+  2. Access of Data cache (CACHE_DATA), or read of a large range of the FAT cache:
      The access data will be divided into UnderRun data, Aligned data and OverRun data;
-     The UnderRun data and OverRun data will be accessed by the Data cache,
+     The UnderRun data and OverRun data will be accessed by the cache,
      but the Aligned data will be accessed with disk directly.
 
   @param  Volume                - FAT file system volume.
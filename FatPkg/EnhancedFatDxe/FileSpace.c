@@ -121,6 +121,222 @@ FatGetFatEntry (
   return Accum;
 }
 
+/**
+
+  Mark a cluster free or in use in the free cluster bitmap of the volume.
+
+  @param  Volume                - FAT file system volume.
+  @param  Index                 - The index of the cluster.
+  @param  Free                  - TRUE if the cluster becomes free.
+
+**/
+STATIC
+VOID
+FatMarkFreeCluster (
+  IN FAT_VOLUME       *Volume,
+  IN UINTN            Index,
+  IN BOOLEAN          Free
+  )
+{
+  UINT64  Mask;
+
+  Mask = LShiftU64 (1, Index % 64);
+  if (Free) {
+    Volume->FreeBitmap[Index / 64] |= Mask;
+  } else {
+    Volume->FreeBitmap[Index / 64] &= ~Mask;
+  }
+}
+
+/**
+
+  Find the first cluster in [Start, End) which is free, or which is in use,
+  in the free cluster bitmap of the volume.
+
+  @param  Volume                - FAT file system volume.
+  @param  Start                 - The first cluster to check.
+  @param  End                   - The cluster after the last cluster to check.
+  @param  Free                  - TRUE to find a free cluster, FALSE to find a cluster in use.
+
+  @return The index of the cluster found, or End if there is no such cluster.
+
+**/
+STATIC
+UINTN
+FatScanFreeBitmap (
+  IN FAT_VOLUME       *Volume,
+  IN UINTN            Start,
+  IN UINTN            End,
+  IN BOOLEAN          Free
+  )
+{
+  UINTN   Index;
+  UINT64  Word;
+
+  Index = Start;
+  while (Index < End) {
+    Word = Volume->FreeBitmap[Index / 64];
+    if (!Free) {
+      Word = ~Word;
+    }
+
+    Word = RShiftU64 (Word, Index % 64);
+    if (Word != 0) {
+      Index += (UINTN) LowBitSet64 (Word);
+      return MIN (Index, End);
+    }
+    //
+    // Skip to the next word
+    //
+    Index = (Index | 63) + 1;
+  }
+
+  return End;
+}
+
+/**
+
+  Build the free cluster bitmap of the volume, and update the free cluster
+  info of FatInfoSector of the volume by the way.
+
+  The FAT is read through the FAT cache in chunks of FAT_FREE_BITMAP_CHUNK_SIZE
+  bytes, rather than entry by entry.
+
+  @param  Volume                - FAT file system volume.
+
+  If the bitmap cannot be built, the failure is remembered and the allocator
+  keeps walking the FAT for the life of the volume, instead of trying again on
+  every allocation.
+
+  @retval EFI_SUCCESS           - The bitmap is built successfully.
+  @retval EFI_OUT_OF_RESOURCES  - Not enough memory for the bitmap.
+  @retval EFI_UNSUPPORTED       - An earlier attempt to build the bitmap failed.
+  @return other                 - An error occurred when reading the FAT.
+
+**/
+STATIC
+EFI_STATUS
+FatBuildFreeBitmap (
+  IN FAT_VOLUME       *Volume
+  )
+{
+  EFI_STATUS  Status;
+  UINTN       ClusterCount;
+  UINTN       ChunkEntries;
+  UINTN       Start;
+  UINTN       Count;
+  UINTN       Index;
+  UINTN       Pos;
+  UINTN       Size;
+  UINTN       Value;
+  UINT8       *Buffer;
+  UINT8       *En12;
+
+  if (Volume->FreeBitmapFailed) {
+    return EFI_UNSUPPORTED;
+  }
+
+  ClusterCount = Volume->MaxCluster + 2;
+  switch (Volume->FatType) {
+  case Fat12:
+    //
+    // FAT12 entries straddle bytes, and the whole FAT is small, so read it
+    // in one chunk.
+    //
+    ChunkEntries = ClusterCount;
+    Size         = FAT_POS_FAT12 (ClusterCount) + 1;
+    break;
+
+  case Fat16:
+    ChunkEntries = FAT_FREE_BITMAP_CHUNK_SIZE / sizeof (UINT16);
+    Size         = FAT_FREE_BITMAP_CHUNK_SIZE;
+    break;
+
+  default:
+    ChunkEntries = FAT_FREE_BITMAP_CHUNK_SIZE / sizeof (UINT32);
+    Size         = FAT_FREE_BITMAP_CHUNK_SIZE;
+  }
+
+  Volume->FreeBitmap = AllocateZeroPool (((ClusterCount + 63) / 64) * sizeof (UINT64));
+  Buffer             = AllocatePool (Size);
+  if (Volume->FreeBitmap == NULL || Buffer == NULL) {
+    Status = EFI_OUT_OF_RESOURCES;
+    goto Done;
+  }
+
+  Volume->FatInfoSector.FreeInfo.ClusterCount = 0;
+  Volume->FatInfoSector.FreeInfo.NextCluster  = (UINT32) ClusterCount;
+  for (Start = 0; Start < ClusterCount; Start += ChunkEntries) {
+    Count = MIN (ChunkEntries, ClusterCount - Start);
+    switch (Volume->FatType) {
+    case Fat12:
+      Pos  = 0;
+      Size = FAT_POS_FAT12 (Count - 1) + 2;
+      break;
+
+    case Fat16:
+      Pos  = FAT_POS_FAT16 (Start);
+      Size = Count * sizeof (UINT16);
+      break;
+
+    default:
+      Pos  = FAT_POS_FAT32 (Start);
+      Size = Count * sizeof (UINT32);
+    }
+
+    Status = FatDiskIo (Volume, ReadFat, Volume->FatPos + Pos, Size, Buffer, NULL);
+    if (EFI_ERROR (Status)) {
+      goto Done;
+    }
+
+    for (Index = MAX (Start, FAT_MIN_CLUSTER); Index < Start + Count; Index++) {
+      switch (Volume->FatType) {
+      case Fat12:
+        En12  = Buffer + FAT_POS_FAT12 (Index);
+        Value = En12[0] | (En12[1] << 8);
+        Value = FAT_ODD_CLUSTER_FAT12 (Index) ? (Value >> 4) : (Value & FAT_CLUSTER_MASK_FAT12);
+        break;
+
+      case Fat16:
+        Value = ((UINT16 *) Buffer)[Index - Start];
+        break;
+
+      default:
+        Value = ((UINT32 *) Buffer)[Index - Start] & FAT_CLUSTER_MASK_FAT32;
+      }
+
+      if (Value == FAT_CLUSTER_FREE) {
+        FatMarkFreeCluster (Volume, Index, TRUE);
+        Volume->FatInfoSector.FreeInfo.ClusterCount += 1;
+        if (Index < Volume->FatInfoSector.FreeInfo.NextCluster) {
+          Volume->FatInfoSector.FreeInfo.NextCluster = (UINT32) Index;
+        }
+      }
+    }
+  }
+
+  Volume->FreeInfoValid                    = TRUE;
+  Volume->FatInfoSector.Signature          = FAT_INFO_SIGNATURE;
+  Volume->FatInfoSector.InfoBeginSignature = FAT_INFO_BEGIN_SIGNATURE;
+  Volume->FatInfoSector.InfoEndSignature   = FAT_INFO_END_SIGNATURE;
+  Status = EFI_SUCCESS;
+
+Done:
+  if (Buffer != NULL) {
+    FreePool (Buffer);
+  }
+
+  if (EFI_ERROR (Status)) {
+    Volume->FreeBitmapFailed = TRUE;
+    if (Volume->FreeBitmap != NULL) {
+      FreePool (Volume->FreeBitmap);
+      Volume->FreeBitmap = NULL;
+    }
+  }
+
+  return Status;
+}
+
 /**
 
   Set the FAT entry value of the volume, which is identified with the Index.
@@ -165,6 +381,10 @@ FatSetFatEntry (
       Volume->FatInfoSector.FreeInfo.ClusterCount -= 1;
     }
   }
+
+  if (Volume->FreeBitmap != NULL && Index <= Volume->MaxCluster + 1) {
+    FatMarkFreeCluster (Volume, Index, (BOOLEAN) (Value == FAT_CLUSTER_FREE));
+  }
   //
   // Make sure the entry is in memory
   //
@@ -310,6 +530,72 @@ FatAllocateCluster (
   return Cluster;
 }
 
+/**
+
+  Allocate a run of contiguous free clusters.
+
+  The free cluster bitmap is built from the FAT on the first call. The first
+  free run from FreeInfo.NextCluster on, wrapping around to the start of the
+  volume once, is returned, up to Desired clusters long. If the bitmap cannot
+  be built, a single cluster is allocated by FatAllocateCluster().
+
+  The caller must chain the clusters of the run in the FAT before allocating
+  another run.
+
+  @param  Volume                - FAT file system volume.
+  @param  Desired               - The desired number of clusters.
+  @param  RunLength             - The number of clusters allocated.
+
+  @return The index of the first cluster of the run, or FAT_CLUSTER_LAST if
+          there is no free cluster.
+
+**/
+STATIC
+UINTN
+FatAllocateClusterRun (
+  IN  FAT_VOLUME      *Volume,
+  IN  UINTN           Desired,
+  OUT UINTN           *RunLength
+  )
+{
+  UINTN   End;
+  UINTN   Index;
+  UINTN   RunEnd;
+  UINTN   Next;
+
+  *RunLength = 1;
+  if (Volume->DiskError) {
+    return (UINTN) FAT_CLUSTER_LAST;
+  }
+
+  if (Volume->FreeBitmap == NULL && EFI_ERROR (FatBuildFreeBitmap (Volume))) {
+    return FatAllocateCluster (Volume);
+  }
+
+  End  = Volume->MaxCluster + 2;
+  Next = Volume->FatInfoSector.FreeInfo.NextCluster;
+  if (Next < FAT_MIN_CLUSTER || Next >= End) {
+    Next = FAT_MIN_CLUSTER;
+  }
+
+  //
+  // Search from NextCluster to the end, then wrap around to the start.
+  //
+  Index = FatScanFreeBitmap (Volume, Next, End, TRUE);
+  if (Index >= End) {
+    Index = FatScanFreeBitmap (Volume, FAT_MIN_CLUSTER, Next, TRUE);
+    if (Index >= Next) {
+      return (UINTN) FAT_CLUSTER_LAST;
+    }
+  }
+
+  RunEnd = FatScanFreeBitmap (Volume, Index, MIN (End, Index + Desired), FALSE);
+
+  Volume->FatInfoSector.FreeInfo.NextCluster = (UINT32) RunEnd;
+  *RunLength = RunEnd - Index;
+  return Index;
+}
+
 /**
 
   Count the number of clusters given a size.
@@ -436,6 +722,8 @@ FatGrowEof (
   UINTN       LastCluster;
   UINTN       NewCluster;
   UINTN       ClusterCount;
+  UINTN       RunLength;
+  UINTN       Index;
 
   //
   // For FAT file system, the max file is 4GB.
@@ -492,7 +780,7 @@ FatGrowEof (
     LastCluster = OFile->FileLastCluster;
 
     while (CurSize < NewSize) {
-      NewCluster = FatAllocateCluster (Volume);
+      NewCluster = FatAllocateClusterRun (Volume, NewSize - CurSize, &RunLength);
       if (FAT_END_OF_FAT_CHAIN (NewCluster)) {
         if (LastCluster != FAT_CLUSTER_FREE) {
           FatSetFatEntry (Volume, LastCluster, (UINTN) FAT_CLUSTER_LAST);
@@ -503,7 +791,7 @@ FatGrowEof (
         goto Done;
       }
 
-      if (NewCluster < FAT_MIN_CLUSTER || NewCluster > Volume->MaxCluster + 1) {
+      if (NewCluster < FAT_MIN_CLUSTER || NewCluster + RunLength - 1 > Volume->MaxCluster + 1) {
         Status = EFI_VOLUME_CORRUPTED;
         goto Done;
       }
@@ -515,19 +803,26 @@ FatGrowEof (
         OFile->FileCurrentCluster = NewCluster;
       }
 
-      LastCluster = NewCluster;
-      CurSize += 1;
+      //
+      // Chain the clusters of the run
+      //
+      for (Index = 1; Index < RunLength; Index++) {
+        FatSetFatEntry (Volume, NewCluster + Index - 1, NewCluster + Index);
+      }
+
+      LastCluster = NewCluster + RunLength - 1;
+      CurSize += RunLength;
 
       //
       // Terminate the cluster list
       //
-      // Note that we must do this EVERY time we allocate a cluster, because
-      // FatAllocateCluster scans the FAT looking for a free cluster and
-      // "LastCluster" is no longer free!  Usually, FatAllocateCluster will
-      // start looking with the cluster after "LastCluster"; however, when
-      // there is only one free cluster left, it will find "LastCluster"
-      // a second time.  There are other, less predictable scenarios
-      // where this could happen, as well.
+      // Note that we must do this EVERY time we allocate a run, because
+      // FatAllocateClusterRun looks for free clusters and "LastCluster" is
+      // no longer free!  Usually, FatAllocateClusterRun will start looking
+      // with the cluster after "LastCluster"; however, when there is only
+      // one free cluster left, it will find "LastCluster" a second time.
+      // There are other, less predictable scenarios where this could
+      // happen, as well.
       //
       FatSetFatEntry (Volume, LastCluster, (UINTN) FAT_CLUSTER_LAST);
       OFile->FileLastCluster = LastCluster;
@@ -723,6 +1018,30 @@ FatComputeFreeInfo (
   // If we don't have valid info, compute it now
   //
   if (!Volume->FreeInfoValid) {
+    //
+    // Count the free clusters in the bitmap, or build the bitmap which also
+    // computes the info. Only fall back to walking the FAT entry by entry if
+    // the bitmap cannot be built.
+    //
+    if (Volume->FreeBitmap != NULL) {
+      Volume->FreeInfoValid                        = TRUE;
+      Volume->FatInfoSector.FreeInfo.ClusterCount  = 0;
+      for (Index = 0; Index < (Volume->MaxCluster + 2 + 63) / 64; Index++) {
+        Volume->FatInfoSector.FreeInfo.ClusterCount += BitFieldCountOnes64 (Volume->FreeBitmap[Index], 0, 63);
+      }
+
+      Volume->FatInfoSector.FreeInfo.NextCluster = (UINT32) FatScanFreeBitmap (
+                                                              Volume,
+                                                              FAT_MIN_CLUSTER,
+                                                              Volume->MaxCluster + 2,
+                                                              TRUE
+                                                              );
+      return;
+    }
+
+    if (!EFI_ERROR (FatBuildFreeBitmap (Volume))) {
+      return;
+    }
 
     Volume->FreeInfoValid                        = TRUE;
     Volume->FatInfoSector.FreeInfo.ClusterCount  = 0;
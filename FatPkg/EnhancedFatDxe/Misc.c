@@ -462,9 +462,24 @@ FatFreeVolume (
   // Free disk cache
   //
   if (Volume->CacheBuffer != NULL) {
+    DEBUG ((
+      DEBUG_INFO,
+      "FatFreeVolume: FAT cache hit %Ld miss %Ld, data cache hit %Ld miss %Ld read-ahead %Ld\n",
+      Volume->DiskCache[CacheFat].HitCount,
+      Volume->DiskCache[CacheFat].MissCount,
+      Volume->DiskCache[CacheData].HitCount,
+      Volume->DiskCache[CacheData].MissCount,
+      Volume->DiskCache[CacheData].ReadAheadCount
+      ));
     FreePool (Volume->CacheBuffer);
   }
   //
+  // Free the free cluster bitmap
+  //
+  if (Volume->FreeBitmap != NULL) {
+    FreePool (Volume->FreeBitmap);
+  }
+  //
   // Free directory cache
   //
   FatCleanupODirCache (Volume);
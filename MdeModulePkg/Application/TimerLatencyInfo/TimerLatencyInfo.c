@@ -0,0 +1,98 @@
+/** @file
+  A shell application that dumps the timer latency histogram recorded by the
+  DXE core when PcdDxeTimerLatencyHistogram is TRUE.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Uefi.h>
+#include <Library/UefiLib.h>
+#include <Library/UefiApplicationEntryPoint.h>
+#include <Library/BaseLib.h>
+
+#include <Guid/TimerLatencyHistogram.h>
+
+/**
+  Print the latency range counted by one bucket of the histogram.
+
+  @param[in] Index        Index of the bucket.
+  @param[in] BucketCount  Number of buckets of the histogram.
+
+**/
+VOID
+PrintBucketRange (
+  IN UINTN   Index,
+  IN UINTN   BucketCount
+  )
+{
+  if (Index == 0) {
+    Print (L"  %9lu            ", (UINT64) 0);
+  } else if (Index == BucketCount - 1) {
+    Print (L"  %9lu - ...      ", LShiftU64 (1, Index - 1));
+  } else {
+    Print (
+      L"  %9lu - %-9lu",
+      LShiftU64 (1, Index - 1),
+      LShiftU64 (1, Index) - 1
+      );
+  }
+}
+
+/**
+  The user Entry Point for Application. The user code starts with this function
+  as the real entry point for the application.
+
+  @param[in] ImageHandle    The firmware allocated handle for the EFI image.
+  @param[in] SystemTable    A pointer to the EFI System Table.
+
+  @retval EFI_SUCCESS       The entry point is executed successfully.
+  @retval EFI_NOT_FOUND     The DXE core does not record the histogram.
+  @retval EFI_UNSUPPORTED   The histogram has an unknown revision.
+
+**/
+EFI_STATUS
+EFIAPI
+UefiMain (
+  IN EFI_HANDLE        ImageHandle,
+  IN EFI_SYSTEM_TABLE  *SystemTable
+  )
+{
+  EFI_STATUS                     Status;
+  EDKII_TIMER_LATENCY_HISTOGRAM  *Histogram;
+  UINTN                          BucketCount;
+  UINTN                          Index;
+
+  Status = EfiGetSystemConfigurationTable (&gEdkiiTimerLatencyHistogramGuid, (VOID **) &Histogram);
+  if (EFI_ERROR (Status) || (Histogram == NULL)) {
+    Print (L"Warning: DXE core doesn't enable the feature of timer latency histogram!\n");
+    Print (L"If you want to see this info, please:\n");
+    Print (L"  1. Set PcdDxeTimerLatencyHistogram as TRUE\n");
+    Print (L"  2. Rebuild DXE core\n");
+    Print (L"  3. Run \"TimerLatencyInfo\" cmd again\n");
+
+    return EFI_NOT_FOUND;
+  }
+
+  if (Histogram->Revision != EDKII_TIMER_LATENCY_HISTOGRAM_REVISION) {
+    Print (L"Unsupported timer latency histogram revision 0x%x\n", Histogram->Revision);
+    return EFI_UNSUPPORTED;
+  }
+
+  BucketCount = MIN (Histogram->BucketCount, EDKII_TIMER_LATENCY_HISTOGRAM_BUCKETS);
+
+  Print (L"DXE Core Timer Latency Histogram:\n");
+  Print (L"  Samples:     %lu\n", Histogram->Samples);
+  Print (L"  Max Latency: %lu (100ns units)\n", Histogram->MaxLatency);
+  Print (L"  Latency (100ns units)  Count\n");
+  for (Index = 0; Index < BucketCount; Index++) {
+    if (Histogram->Bucket[Index] == 0) {
+      continue;
+    }
+
+    PrintBucketRange (Index, BucketCount);
+    Print (L"  %lu\n", Histogram->Bucket[Index]);
+  }
+
+  return EFI_SUCCESS;
+}
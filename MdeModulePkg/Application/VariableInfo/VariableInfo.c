@@ -19,6 +19,7 @@
 
 #include <Guid/VariableFormat.h>
 #include <Guid/SmmVariableCommon.h>
+#include <Guid/VariableReclaimStatistics.h>
 #include <Guid/PiSmmCommunicationRegionTable.h>
 #include <Protocol/MmCommunication2.h>
 #include <Protocol/SmmVariable.h>
@@ -64,6 +65,69 @@ GetVariableStatisticsData (
   return Status;
 }
 
+/**
+  This function prints the reclaim statistics of the non-volatile variable store.
+
+  @param[in] Statistics             The reclaim statistics to print.
+
+**/
+VOID
+PrintReclaimStatistics (
+  IN VARIABLE_RECLAIM_STATISTICS     *Statistics
+  )
+{
+  Print (
+    L"  Full reclaims:     %ld, latency total %ld us, max %ld us\n",
+    Statistics->FullReclaimCount,
+    DivU64x32 (Statistics->FullReclaimTotalLatency, 1000),
+    DivU64x32 (Statistics->FullReclaimMaxLatency, 1000)
+    );
+  Print (
+    L"  Incremental steps: %ld, latency total %ld us, max %ld us, passes %ld\n",
+    Statistics->IncrementalStepCount,
+    DivU64x32 (Statistics->IncrementalStepTotalLatency, 1000),
+    DivU64x32 (Statistics->IncrementalStepMaxLatency, 1000),
+    Statistics->IncrementalPassCount
+    );
+  Print (
+    L"  Bytes moved:       %ld, bytes reclaimed %ld\n",
+    Statistics->BytesMoved,
+    Statistics->BytesReclaimed
+    );
+}
+
+/**
+  This function get and print the reclaim statistics from SMM variable driver.
+
+  @param[in] CommBuffer             The SMM communication buffer to use.
+
+**/
+VOID
+PrintReclaimStatisticsFromSmm (
+  IN EFI_MM_COMMUNICATE_HEADER       *CommBuffer
+  )
+{
+  EFI_STATUS                         Status;
+  UINTN                              CommSize;
+  SMM_VARIABLE_COMMUNICATE_HEADER    *FunctionHeader;
+
+  CommSize = SMM_COMMUNICATE_HEADER_SIZE + SMM_VARIABLE_COMMUNICATE_HEADER_SIZE + sizeof (VARIABLE_RECLAIM_STATISTICS);
+  ZeroMem (CommBuffer, CommSize);
+  CopyGuid (&CommBuffer->HeaderGuid, &gEfiSmmVariableProtocolGuid);
+  CommBuffer->MessageLength = CommSize - OFFSET_OF (EFI_MM_COMMUNICATE_HEADER, Data);
+
+  FunctionHeader = (SMM_VARIABLE_COMMUNICATE_HEADER *) CommBuffer->Data;
+  FunctionHeader->Function = SMM_VARIABLE_FUNCTION_GET_RECLAIM_STATISTICS;
+
+  Status = mMmCommunication2->Communicate (mMmCommunication2, CommBuffer, CommBuffer, &CommSize);
+  if (EFI_ERROR (Status) || EFI_ERROR (FunctionHeader->ReturnStatus)) {
+    return;
+  }
+
+  Print (L"SMM Driver Non-Volatile Variable Store Reclaim:\n");
+  PrintReclaimStatistics ((VARIABLE_RECLAIM_STATISTICS *) FunctionHeader->Data);
+}
+
 /**
 
   This function get and print the variable statistics data from SMM variable driver.
@@ -188,6 +252,8 @@ PrintInfoFromSmm (
     }
   } while (TRUE);
 
+  PrintReclaimStatisticsFromSmm (CommBuffer);
+
   return Status;
 }
 
@@ -210,10 +276,11 @@ UefiMain (
   IN EFI_SYSTEM_TABLE  *SystemTable
   )
 {
-  EFI_STATUS            RuntimeDxeStatus;
-  EFI_STATUS            SmmStatus;
-  VARIABLE_INFO_ENTRY   *VariableInfo;
-  VARIABLE_INFO_ENTRY   *Entry;
+  EFI_STATUS                   RuntimeDxeStatus;
+  EFI_STATUS                   SmmStatus;
+  VARIABLE_INFO_ENTRY          *VariableInfo;
+  VARIABLE_INFO_ENTRY          *Entry;
+  VARIABLE_RECLAIM_STATISTICS  *ReclaimStatistics;
 
   RuntimeDxeStatus = EfiGetSystemConfigurationTable (&gEfiVariableGuid, (VOID **) &Entry);
   if (EFI_ERROR (RuntimeDxeStatus) || (Entry == NULL)) {
@@ -255,6 +322,12 @@ UefiMain (
       }
       VariableInfo = VariableInfo->Next;
     } while (VariableInfo != NULL);
+
+    if (!EFI_ERROR (EfiGetSystemConfigurationTable (&gEdkiiVariableReclaimStatisticsGuid, (VOID **) &ReclaimStatistics)) &&
+        (ReclaimStatistics != NULL)) {
+      Print (L"Runtime DXE Driver Non-Volatile Variable Store Reclaim:\n");
+      PrintReclaimStatistics (ReclaimStatistics);
+    }
   }
 
   SmmStatus = PrintInfoFromSmm ();
@@ -510,39 +510,33 @@ UnregisterNvmeNamespace (
 }
 
 /**
-  Call back function when the timer event is signaled.
+  Submit the queued BlockIo2 subtasks to the asynchronous I/O submission queues.
 
-  @param[in]  Event     The Event this notify function registered to.
-  @param[in]  Context   Pointer to the context data registered to the
-                        Event.
+  The submission queue doorbells are written once per queue after all the
+  subtasks which fit in the queues have been placed. The caller must hold
+  TPL_NOTIFY.
+
+  @param[in]  Private     The pointer to the NVME_CONTROLLER_PRIVATE_DATA
+                          data structure.
 
 **/
 VOID
-EFIAPI
-ProcessAsyncTaskList (
-  IN EFI_EVENT                    Event,
-  IN VOID*                        Context
+NvmeSubmitAsyncSubtasks (
+  IN NVME_CONTROLLER_PRIVATE_DATA    *Private
   )
 {
-  NVME_CONTROLLER_PRIVATE_DATA         *Private;
   EFI_PCI_IO_PROTOCOL                  *PciIo;
-  NVME_CQ                              *Cq;
   UINT16                               QueueId;
   UINT32                               Data;
   LIST_ENTRY                           *Link;
   LIST_ENTRY                           *NextLink;
-  NVME_PASS_THRU_ASYNC_REQ             *AsyncRequest;
   NVME_BLKIO2_SUBTASK                  *Subtask;
   NVME_BLKIO2_REQUEST                  *BlkIo2Request;
   EFI_BLOCK_IO2_TOKEN                  *Token;
-  BOOLEAN                              HasNewItem;
   EFI_STATUS                           Status;
 
-  Private    = (NVME_CONTROLLER_PRIVATE_DATA*)Context;
-  QueueId    = 2;
-  Cq         = Private->CqBuffer[QueueId] + Private->CqHdbl[QueueId].Cqh;
-  HasNewItem = FALSE;
-  PciIo      = Private->PciIo;
+  PciIo = Private->PciIo;
+  Private->DeferSqDoorbell = TRUE;
 
   //
   // Submit asynchronous subtasks to the NVMe Submission Queue
@@ -615,84 +609,147 @@ ProcessAsyncTaskList (
     }
   }
 
-  while (Cq->Pt != Private->Pt[QueueId]) {
-    ASSERT (Cq->Sqid == QueueId);
-
-    HasNewItem = TRUE;
-
-    //
-    // Find the command with given Command Id.
-    //
-    for (Link = GetFirstNode (&Private->AsyncPassThruQueue);
-         !IsNull (&Private->AsyncPassThruQueue, Link);
-         Link = NextLink) {
-      NextLink = GetNextNode (&Private->AsyncPassThruQueue, Link);
-      AsyncRequest = NVME_PASS_THRU_ASYNC_REQ_FROM_THIS (Link);
-      if (AsyncRequest->CommandId == Cq->Cid) {
-        //
-        // Copy the Respose Queue entry for this command to the callers
-        // response buffer.
-        //
-        CopyMem (
-          AsyncRequest->Packet->NvmeCompletion,
-          Cq,
-          sizeof(EFI_NVM_EXPRESS_COMPLETION)
-          );
+  Private->DeferSqDoorbell = FALSE;
 
-        //
-        // Free the resources allocated before cmd submission
-        //
-        if (AsyncRequest->MapData != NULL) {
-          PciIo->Unmap (PciIo, AsyncRequest->MapData);
-        }
-        if (AsyncRequest->MapMeta != NULL) {
-          PciIo->Unmap (PciIo, AsyncRequest->MapMeta);
-        }
-        if (AsyncRequest->MapPrpList != NULL) {
-          PciIo->Unmap (PciIo, AsyncRequest->MapPrpList);
-        }
-        if (AsyncRequest->PrpListHost != NULL) {
-          PciIo->FreeBuffer (
-                   PciIo,
-                   AsyncRequest->PrpListNo,
-                   AsyncRequest->PrpListHost
-                   );
-        }
-
-        RemoveEntryList (Link);
-        gBS->SignalEvent (AsyncRequest->CallerEvent);
-        FreePool (AsyncRequest);
-
-        //
-        // Update submission queue head.
-        //
-        Private->AsyncSqHead = Cq->Sqhd;
-        break;
-      }
-    }
-
-    Private->CqHdbl[QueueId].Cqh++;
-    if (Private->CqHdbl[QueueId].Cqh > MIN (NVME_ASYNC_CCQ_SIZE, Private->Cap.Mqes)) {
-      Private->CqHdbl[QueueId].Cqh = 0;
-      Private->Pt[QueueId] ^= 1;
+  //
+  // Ring the doorbell of each submission queue which has new commands once.
+  //
+  for (QueueId = NVME_ASYNC_QUEUE_BASE; QueueId < NVME_MAX_QUEUES; QueueId++) {
+    if (!Private->SqDoorbellPending[QueueId]) {
+      continue;
     }
 
-    Cq = Private->CqBuffer[QueueId] + Private->CqHdbl[QueueId].Cqh;
-  }
-
-  if (HasNewItem) {
-    Data  = ReadUnaligned32 ((UINT32*)&Private->CqHdbl[QueueId]);
+    Private->SqDoorbellPending[QueueId] = FALSE;
+    Data = ReadUnaligned32 ((UINT32*)&Private->SqTdbl[QueueId]);
     PciIo->Mem.Write (
                  PciIo,
                  EfiPciIoWidthUint32,
                  NVME_BAR,
-                 NVME_CQHDBL_OFFSET(QueueId, Private->Cap.Dstrd),
+                 NVME_SQTDBL_OFFSET(QueueId, Private->Cap.Dstrd),
                  1,
                  &Data
                  );
   }
 }
 
+/**
+  Call back function when the timer event is signaled.
+
+  @param[in]  Event     The Event this notify function registered to.
+  @param[in]  Context   Pointer to the context data registered to the
+                        Event.
+
+**/
+VOID
+EFIAPI
+ProcessAsyncTaskList (
+  IN EFI_EVENT                    Event,
+  IN VOID*                        Context
+  )
+{
+  NVME_CONTROLLER_PRIVATE_DATA         *Private;
+  EFI_PCI_IO_PROTOCOL                  *PciIo;
+  NVME_CQ                              *Cq;
+  UINT16                               QueueId;
+  UINT32                               Data;
+  LIST_ENTRY                           *Link;
+  LIST_ENTRY                           *NextLink;
+  NVME_PASS_THRU_ASYNC_REQ             *AsyncRequest;
+  BOOLEAN                              HasNewItem;
+
+  Private    = (NVME_CONTROLLER_PRIVATE_DATA*)Context;
+  PciIo      = Private->PciIo;
+
+  NvmeSubmitAsyncSubtasks (Private);
+
+  //
+  // Drain each asynchronous I/O completion queue, and update its head
+  // doorbell once for all the entries consumed.
+  //
+  for (QueueId = NVME_ASYNC_QUEUE_BASE;
+       QueueId < NVME_ASYNC_QUEUE_BASE + Private->AsyncQueueCount;
+       QueueId++) {
+    Cq         = Private->CqBuffer[QueueId] + Private->CqHdbl[QueueId].Cqh;
+    HasNewItem = FALSE;
+
+    while (Cq->Pt != Private->Pt[QueueId]) {
+      ASSERT (Cq->Sqid == QueueId);
+
+      HasNewItem = TRUE;
+      if (Private->AsyncInFlight[QueueId] > 0) {
+        Private->AsyncInFlight[QueueId]--;
+      }
+
+      //
+      // Find the command with given Command Id.
+      //
+      for (Link = GetFirstNode (&Private->AsyncPassThruQueue);
+           !IsNull (&Private->AsyncPassThruQueue, Link);
+           Link = NextLink) {
+        NextLink = GetNextNode (&Private->AsyncPassThruQueue, Link);
+        AsyncRequest = NVME_PASS_THRU_ASYNC_REQ_FROM_THIS (Link);
+        if ((AsyncRequest->QueueId == QueueId) &&
+            (AsyncRequest->CommandId == Cq->Cid)) {
+          //
+          // Copy the Respose Queue entry for this command to the callers
+          // response buffer.
+          //
+          CopyMem (
+            AsyncRequest->Packet->NvmeCompletion,
+            Cq,
+            sizeof(EFI_NVM_EXPRESS_COMPLETION)
+            );
+
+          //
+          // Free the resources allocated before cmd submission
+          //
+          if (AsyncRequest->MapData != NULL) {
+            PciIo->Unmap (PciIo, AsyncRequest->MapData);
+          }
+          if (AsyncRequest->MapMeta != NULL) {
+            PciIo->Unmap (PciIo, AsyncRequest->MapMeta);
+          }
+          if (AsyncRequest->MapPrpList != NULL) {
+            PciIo->Unmap (PciIo, AsyncRequest->MapPrpList);
+          }
+          if (AsyncRequest->PrpListHost != NULL) {
+            PciIo->FreeBuffer (
+                     PciIo,
+                     AsyncRequest->PrpListNo,
+                     AsyncRequest->PrpListHost
+                     );
+          }
+
+          RemoveEntryList (Link);
+          gBS->SignalEvent (AsyncRequest->CallerEvent);
+          FreePool (AsyncRequest);
+          break;
+        }
+      }
+
+      Private->CqHdbl[QueueId].Cqh++;
+      if (Private->CqHdbl[QueueId].Cqh > MIN (NVME_ASYNC_CCQ_SIZE, Private->Cap.Mqes)) {
+        Private->CqHdbl[QueueId].Cqh = 0;
+        Private->Pt[QueueId] ^= 1;
+      }
+
+      Cq = Private->CqBuffer[QueueId] + Private->CqHdbl[QueueId].Cqh;
+    }
+
+    if (HasNewItem) {
+      Data  = ReadUnaligned32 ((UINT32*)&Private->CqHdbl[QueueId]);
+      PciIo->Mem.Write (
+                   PciIo,
+                   EfiPciIoWidthUint32,
+                   NVME_BAR,
+                   NVME_CQHDBL_OFFSET(QueueId, Private->Cap.Dstrd),
+                   1,
+                   &Data
+                   );
+    }
+  }
+}
+
 /**
   Tests to see if this driver supports a given controller. If a child device is provided,
   it further tests to see if this driver supports creating a handle for the specified child device.
@@ -950,21 +1007,21 @@ NvmExpressDriverBindingStart (
     }
 
     //
-    // 6 x 4kB aligned buffers will be carved out of this buffer.
+    // NVME_QUEUE_BUFFER_PAGES of 4kB aligned buffers will be carved out of this buffer.
     // 1st 4kB boundary is the start of the admin submission queue.
     // 2nd 4kB boundary is the start of the admin completion queue.
     // 3rd 4kB boundary is the start of I/O submission queue #1.
     // 4th 4kB boundary is the start of I/O completion queue #1.
-    // 5th 4kB boundary is the start of I/O submission queue #2.
-    // 6th 4kB boundary is the start of I/O completion queue #2.
+    // The asynchronous I/O submission & completion queues #2 ~ #N follow.
     //
-    // Allocate 6 pages of memory, then map it for bus master read and write.
+    // Allocate NVME_QUEUE_BUFFER_PAGES pages of memory, then map it for bus
+    // master read and write.
     //
     Status = PciIo->AllocateBuffer (
                       PciIo,
                       AllocateAnyPages,
                       EfiBootServicesData,
-                      6,
+                      NVME_QUEUE_BUFFER_PAGES,
                       (VOID**)&Private->Buffer,
                       0
                       );
@@ -972,7 +1029,7 @@ NvmExpressDriverBindingStart (
       goto Exit;
     }
 
-    Bytes = EFI_PAGES_TO_SIZE (6);
+    Bytes = EFI_PAGES_TO_SIZE (NVME_QUEUE_BUFFER_PAGES);
     Status = PciIo->Map (
                       PciIo,
                       EfiPciIoOperationBusMasterCommonBuffer,
@@ -982,7 +1039,7 @@ NvmExpressDriverBindingStart (
                       &Private->Mapping
                       );
 
-    if (EFI_ERROR (Status) || (Bytes != EFI_PAGES_TO_SIZE (6))) {
+    if (EFI_ERROR (Status) || (Bytes != EFI_PAGES_TO_SIZE (NVME_QUEUE_BUFFER_PAGES))) {
       goto Exit;
     }
 
@@ -1093,7 +1150,7 @@ Exit:
   }
 
   if ((Private != NULL) && (Private->Buffer != NULL)) {
-    PciIo->FreeBuffer (PciIo, 6, Private->Buffer);
+    PciIo->FreeBuffer (PciIo, NVME_QUEUE_BUFFER_PAGES, Private->Buffer);
   }
 
   if ((Private != NULL) && (Private->ControllerData != NULL)) {
@@ -1216,7 +1273,7 @@ NvmExpressDriverBindingStop (
       }
 
       if (Private->Buffer != NULL) {
-        Private->PciIo->FreeBuffer (Private->PciIo, 6, Private->Buffer);
+        Private->PciIo->FreeBuffer (Private->PciIo, NVME_QUEUE_BUFFER_PAGES, Private->Buffer);
       }
 
       FreePool (Private->ControllerData);
@@ -64,16 +64,31 @@ extern EFI_DRIVER_SUPPORTED_EFI_VERSION_PROTOCOL  gNvmExpressDriverSupportedEfiV
 
 //
 // Number of asynchronous I/O submission queue entries, which is 0-based.
-// The asynchronous I/O submission queue size is 4kB in total.
+// The asynchronous I/O submission queue size is 16kB in total.
 //
-#define NVME_ASYNC_CSQ_SIZE                       63
+#define NVME_ASYNC_CSQ_SIZE                       255
 //
 // Number of asynchronous I/O completion queue entries, which is 0-based.
 // The asynchronous I/O completion queue size is 4kB in total.
 //
 #define NVME_ASYNC_CCQ_SIZE                       255
 
-#define NVME_MAX_QUEUES                           3     // Number of queues supported by the driver
+#define NVME_ASYNC_CSQ_PAGES                      EFI_SIZE_TO_PAGES ((NVME_ASYNC_CSQ_SIZE + 1) * sizeof (NVME_SQ))
+#define NVME_ASYNC_CCQ_PAGES                      EFI_SIZE_TO_PAGES ((NVME_ASYNC_CCQ_SIZE + 1) * sizeof (NVME_CQ))
+
+//
+// Maximum number of asynchronous I/O queue pairs. The non-blocking requests
+// are spread over the queue pairs granted by the controller.
+//
+#define NVME_MAX_ASYNC_QUEUES                     4
+#define NVME_ASYNC_QUEUE_BASE                     2     // Queue ID of the 1st asynchronous I/O queue pair
+
+#define NVME_MAX_QUEUES                           (NVME_ASYNC_QUEUE_BASE + NVME_MAX_ASYNC_QUEUES)
+
+//
+// Number of pages of the admin, blocking I/O and asynchronous I/O queues.
+//
+#define NVME_QUEUE_BUFFER_PAGES                   (4 + NVME_MAX_ASYNC_QUEUES * (NVME_ASYNC_CSQ_PAGES + NVME_ASYNC_CCQ_PAGES))
 
 #define NVME_CONTROLLER_ID                        0
 
@@ -116,13 +131,13 @@ struct _NVME_CONTROLLER_PRIVATE_DATA {
   NVME_ADMIN_CONTROLLER_DATA          *ControllerData;
 
   //
-  // 6 x 4kB aligned buffers will be carved out of this buffer.
+  // NVME_QUEUE_BUFFER_PAGES of 4kB aligned buffers will be carved out of this buffer.
   // 1st 4kB boundary is the start of the admin submission queue.
   // 2nd 4kB boundary is the start of the admin completion queue.
   // 3rd 4kB boundary is the start of I/O submission queue #1.
   // 4th 4kB boundary is the start of I/O completion queue #1.
-  // 5th 4kB boundary is the start of I/O submission queue #2.
-  // 6th 4kB boundary is the start of I/O completion queue #2.
+  // The asynchronous I/O submission & completion queues #2 ~ #N follow,
+  // NVME_ASYNC_CSQ_PAGES + NVME_ASYNC_CCQ_PAGES pages for each pair.
   //
   UINT8                               *Buffer;
   UINT8                               *BufferPciAddr;
@@ -140,7 +155,21 @@ struct _NVME_CONTROLLER_PRIVATE_DATA {
   //
   NVME_SQTDBL                         SqTdbl[NVME_MAX_QUEUES];
   NVME_CQHDBL                         CqHdbl[NVME_MAX_QUEUES];
-  UINT16                              AsyncSqHead;
+
+  //
+  // Asynchronous I/O queue pairs granted by the controller, the round-robin
+  // cursor, and the number of outstanding commands in each queue pair.
+  //
+  UINT16                              AsyncQueueCount;
+  UINT16                              NextAsyncQueue;
+  UINT16                              AsyncInFlight[NVME_MAX_QUEUES];
+
+  //
+  // Submission queue doorbells are batched while the queued subtasks are
+  // submitted, and rung once per queue afterwards.
+  //
+  BOOLEAN                             DeferSqDoorbell;
+  BOOLEAN                             SqDoorbellPending[NVME_MAX_QUEUES];
 
   //
   // Flag to indicate internal IO queue creation.
@@ -292,6 +321,7 @@ typedef struct {
   LIST_ENTRY                               Link;
 
   EFI_NVM_EXPRESS_PASS_THRU_COMMAND_PACKET *Packet;
+  UINT16                                   QueueId;
   UINT16                                   CommandId;
   VOID                                     *MapPrpList;
   UINTN                                    PrpListNo;
@@ -308,6 +338,26 @@ typedef struct {
       NVME_PASS_THRU_ASYNC_REQ_SIG                       \
       )
 
+//
+// SGL descriptor, which is placed in the data pointer of a command.
+//
+#pragma pack(1)
+typedef struct {
+  UINT64                                   Address;
+  UINT32                                   Length;
+  UINT8                                    Reserved[3];
+  UINT8                                    Identifier;  // SGL descriptor type (bits 7:4) and sub type (bits 3:0)
+} NVME_SGL_DESCRIPTOR;
+#pragma pack()
+
+#define NVME_SGL_DATA_BLOCK_DESCRIPTOR     0x00
+
+//
+// PSDT value of a command whose data pointer holds an SGL descriptor, and
+// whose metadata pointer, if any, points to a contiguous buffer.
+//
+#define NVME_PSDT_SGL_CONTIGUOUS           1
+
 /**
   Retrieves a Unicode string that is the user readable name of the driver.
 
@@ -711,6 +761,22 @@ NvmExpressBuildDevicePath (
   IN OUT EFI_DEVICE_PATH_PROTOCOL                    **DevicePath
   );
 
+/**
+  Submit the queued BlockIo2 subtasks to the asynchronous I/O submission queues.
+
+  The submission queue doorbells are written once per queue after all the
+  subtasks which fit in the queues have been placed. The caller must hold
+  TPL_NOTIFY.
+
+  @param[in]  Private     The pointer to the NVME_CONTROLLER_PRIVATE_DATA
+                          data structure.
+
+**/
+VOID
+NvmeSubmitAsyncSubtasks (
+  IN NVME_CONTROLLER_PRIVATE_DATA    *Private
+  );
+
 /**
   Dump the execution status from a given completion queue entry.
 
@@ -796,6 +796,14 @@ NvmeAsyncRead (
     }
   }
 
+  //
+  // Submit the subtasks right away instead of waiting for the next timer
+  // tick, so that back-to-back BlockIo2 requests keep the device busy.
+  //
+  OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
+  NvmeSubmitAsyncSubtasks (Private);
+  gBS->RestoreTPL (OldTpl);
+
   DEBUG ((DEBUG_BLKIO, "%a: Lba = 0x%08Lx, Original = 0x%08Lx, "
     "Remaining = 0x%08Lx, BlockSize = 0x%x, Status = %r\n", __FUNCTION__, Lba,
     (UINT64)OrginalBlocks, (UINT64)Blocks, BlockSize, Status));
@@ -916,6 +924,14 @@ NvmeAsyncWrite (
     }
   }
 
+  //
+  // Submit the subtasks right away instead of waiting for the next timer
+  // tick, so that back-to-back BlockIo2 requests keep the device busy.
+  //
+  OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
+  NvmeSubmitAsyncSubtasks (Private);
+  gBS->RestoreTPL (OldTpl);
+
   DEBUG ((DEBUG_BLKIO, "%a: Lba = 0x%08Lx, Original = 0x%08Lx, "
     "Remaining = 0x%08Lx, BlockSize = 0x%x, Status = %r\n", __FUNCTION__, Lba,
     (UINT64)OrginalBlocks, (UINT64)Blocks, BlockSize, Status));
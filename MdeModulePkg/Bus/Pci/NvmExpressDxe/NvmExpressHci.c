@@ -563,6 +563,67 @@ NvmeIdentifyNamespace (
   return Status;
 }
 
+/**
+  Request the number of I/O queues from the controller, and figure out how
+  many asynchronous I/O queue pairs can be used.
+
+  One I/O queue pair is reserved for the blocking I/O, the others are used for
+  the non-blocking I/O. If the controller does not accept the Set Features
+  command, a single asynchronous I/O queue pair is used.
+
+  @param  Private          The pointer to the NVME_CONTROLLER_PRIVATE_DATA data structure.
+
+**/
+VOID
+NvmeSetNumberOfQueues (
+  IN NVME_CONTROLLER_PRIVATE_DATA      *Private
+  )
+{
+  EFI_NVM_EXPRESS_PASS_THRU_COMMAND_PACKET CommandPacket;
+  EFI_NVM_EXPRESS_COMMAND                  Command;
+  EFI_NVM_EXPRESS_COMPLETION               Completion;
+  EFI_STATUS                               Status;
+  UINT32                                   Granted;
+
+  ZeroMem (&CommandPacket, sizeof(EFI_NVM_EXPRESS_PASS_THRU_COMMAND_PACKET));
+  ZeroMem (&Command, sizeof(EFI_NVM_EXPRESS_COMMAND));
+  ZeroMem (&Completion, sizeof(EFI_NVM_EXPRESS_COMPLETION));
+
+  CommandPacket.NvmeCmd        = &Command;
+  CommandPacket.NvmeCompletion = &Completion;
+
+  Command.Cdw0.Opcode = NVME_ADMIN_SET_FEATURES_CMD;
+  Command.Nsid        = 0;
+  CommandPacket.CommandTimeout = NVME_GENERIC_TIMEOUT;
+  CommandPacket.QueueType      = NVME_ADMIN_QUEUE;
+  //
+  // Both the number of I/O submission queues requested (bits 15:0) and the
+  // number of I/O completion queues requested (bits 31:16) are 0-based.
+  //
+  Command.Cdw10       = NVME_FEATURE_NUMBER_OF_QUEUES;
+  Command.Cdw11       = ((NVME_MAX_QUEUES - 2) << 16) | (NVME_MAX_QUEUES - 2);
+  Command.Flags       = CDW10_VALID | CDW11_VALID;
+
+  Status = Private->Passthru.PassThru (
+                               &Private->Passthru,
+                               NVME_CONTROLLER_ID,
+                               &CommandPacket,
+                               NULL
+                               );
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_WARN, "NvmeSetNumberOfQueues: Set Features failed (%r)\n", Status));
+    Private->AsyncQueueCount = 1;
+    return;
+  }
+
+  //
+  // Dword 0 of the completion holds the 0-based numbers of I/O submission
+  // and completion queues allocated.
+  //
+  Granted = MIN (Completion.DW0 & 0xFFFF, Completion.DW0 >> 16);
+  Private->AsyncQueueCount = (UINT16)MAX (1, MIN (Granted, NVME_MAX_ASYNC_QUEUES));
+}
+
 /**
   Create io completion queue.
 
@@ -588,7 +649,7 @@ NvmeCreateIoCompletionQueue (
   Status = EFI_SUCCESS;
   Private->CreateIoQueue = TRUE;
 
-  for (Index = 1; Index < NVME_MAX_QUEUES; Index++) {
+  for (Index = 1; Index < NVME_ASYNC_QUEUE_BASE + Private->AsyncQueueCount; Index++) {
     ZeroMem (&CommandPacket, sizeof(EFI_NVM_EXPRESS_PASS_THRU_COMMAND_PACKET));
     ZeroMem (&Command, sizeof(EFI_NVM_EXPRESS_COMMAND));
     ZeroMem (&Completion, sizeof(EFI_NVM_EXPRESS_COMPLETION));
@@ -603,7 +664,7 @@ NvmeCreateIoCompletionQueue (
     CommandPacket.CommandTimeout = NVME_GENERIC_TIMEOUT;
     CommandPacket.QueueType      = NVME_ADMIN_QUEUE;
 
-    if (Index == 1) {
+    if (Index < NVME_ASYNC_QUEUE_BASE) {
       QueueSize = NVME_CCQ_SIZE;
     } else {
       if (Private->Cap.Mqes > NVME_ASYNC_CCQ_SIZE) {
@@ -660,7 +721,7 @@ NvmeCreateIoSubmissionQueue (
   Status = EFI_SUCCESS;
   Private->CreateIoQueue = TRUE;
 
-  for (Index = 1; Index < NVME_MAX_QUEUES; Index++) {
+  for (Index = 1; Index < NVME_ASYNC_QUEUE_BASE + Private->AsyncQueueCount; Index++) {
     ZeroMem (&CommandPacket, sizeof(EFI_NVM_EXPRESS_PASS_THRU_COMMAND_PACKET));
     ZeroMem (&Command, sizeof(EFI_NVM_EXPRESS_COMMAND));
     ZeroMem (&Completion, sizeof(EFI_NVM_EXPRESS_COMPLETION));
@@ -675,7 +736,7 @@ NvmeCreateIoSubmissionQueue (
     CommandPacket.CommandTimeout = NVME_GENERIC_TIMEOUT;
     CommandPacket.QueueType      = NVME_ADMIN_QUEUE;
 
-    if (Index == 1) {
+    if (Index < NVME_ASYNC_QUEUE_BASE) {
       QueueSize = NVME_CSQ_SIZE;
     } else {
       if (Private->Cap.Mqes > NVME_ASYNC_CSQ_SIZE) {
@@ -731,6 +792,8 @@ NvmeControllerInit (
   NVME_ACQ                        Acq;
   UINT8                           Sn[21];
   UINT8                           Mn[41];
+  UINT32                          Index;
+  UINTN                           Offset;
   //
   // Save original PCI attributes and enable this controller.
   //
@@ -799,19 +862,17 @@ NvmeControllerInit (
   //
   ASSERT ((Private->Cap.Mpsmin + 12) <= EFI_PAGE_SHIFT);
 
-  Private->Cid[0] = 0;
-  Private->Cid[1] = 0;
-  Private->Cid[2] = 0;
-  Private->Pt[0]  = 0;
-  Private->Pt[1]  = 0;
-  Private->Pt[2]  = 0;
-  Private->SqTdbl[0].Sqt = 0;
-  Private->SqTdbl[1].Sqt = 0;
-  Private->SqTdbl[2].Sqt = 0;
-  Private->CqHdbl[0].Cqh = 0;
-  Private->CqHdbl[1].Cqh = 0;
-  Private->CqHdbl[2].Cqh = 0;
-  Private->AsyncSqHead   = 0;
+  for (Index = 0; Index < NVME_MAX_QUEUES; Index++) {
+    Private->Cid[Index]               = 0;
+    Private->Pt[Index]                = 0;
+    Private->SqTdbl[Index].Sqt        = 0;
+    Private->CqHdbl[Index].Cqh        = 0;
+    Private->AsyncInFlight[Index]     = 0;
+    Private->SqDoorbellPending[Index] = FALSE;
+  }
+  Private->AsyncQueueCount = 1;
+  Private->NextAsyncQueue  = 0;
+  Private->DeferSqDoorbell = FALSE;
 
   Status = NvmeDisableController (Private);
 
@@ -840,19 +901,17 @@ NvmeControllerInit (
   //
   // Address of I/O submission & completion queue.
   //
-  ZeroMem (Private->Buffer, EFI_PAGES_TO_SIZE (6));
-  Private->SqBuffer[0]        = (NVME_SQ *)(UINTN)(Private->Buffer);
-  Private->SqBufferPciAddr[0] = (NVME_SQ *)(UINTN)(Private->BufferPciAddr);
-  Private->CqBuffer[0]        = (NVME_CQ *)(UINTN)(Private->Buffer + 1 * EFI_PAGE_SIZE);
-  Private->CqBufferPciAddr[0] = (NVME_CQ *)(UINTN)(Private->BufferPciAddr + 1 * EFI_PAGE_SIZE);
-  Private->SqBuffer[1]        = (NVME_SQ *)(UINTN)(Private->Buffer + 2 * EFI_PAGE_SIZE);
-  Private->SqBufferPciAddr[1] = (NVME_SQ *)(UINTN)(Private->BufferPciAddr + 2 * EFI_PAGE_SIZE);
-  Private->CqBuffer[1]        = (NVME_CQ *)(UINTN)(Private->Buffer + 3 * EFI_PAGE_SIZE);
-  Private->CqBufferPciAddr[1] = (NVME_CQ *)(UINTN)(Private->BufferPciAddr + 3 * EFI_PAGE_SIZE);
-  Private->SqBuffer[2]        = (NVME_SQ *)(UINTN)(Private->Buffer + 4 * EFI_PAGE_SIZE);
-  Private->SqBufferPciAddr[2] = (NVME_SQ *)(UINTN)(Private->BufferPciAddr + 4 * EFI_PAGE_SIZE);
-  Private->CqBuffer[2]        = (NVME_CQ *)(UINTN)(Private->Buffer + 5 * EFI_PAGE_SIZE);
-  Private->CqBufferPciAddr[2] = (NVME_CQ *)(UINTN)(Private->BufferPciAddr + 5 * EFI_PAGE_SIZE);
+  ZeroMem (Private->Buffer, EFI_PAGES_TO_SIZE (NVME_QUEUE_BUFFER_PAGES));
+  Offset = 0;
+  for (Index = 0; Index < NVME_MAX_QUEUES; Index++) {
+    Private->SqBuffer[Index]        = (NVME_SQ *)(UINTN)(Private->Buffer + Offset);
+    Private->SqBufferPciAddr[Index] = (NVME_SQ *)(UINTN)(Private->BufferPciAddr + Offset);
+    Offset += (Index < NVME_ASYNC_QUEUE_BASE) ? EFI_PAGE_SIZE : EFI_PAGES_TO_SIZE (NVME_ASYNC_CSQ_PAGES);
+    Private->CqBuffer[Index]        = (NVME_CQ *)(UINTN)(Private->Buffer + Offset);
+    Private->CqBufferPciAddr[Index] = (NVME_CQ *)(UINTN)(Private->BufferPciAddr + Offset);
+    Offset += (Index < NVME_ASYNC_QUEUE_BASE) ? EFI_PAGE_SIZE : EFI_PAGES_TO_SIZE (NVME_ASYNC_CCQ_PAGES);
+  }
+  ASSERT (Offset == EFI_PAGES_TO_SIZE (NVME_QUEUE_BUFFER_PAGES));
 
   DEBUG ((EFI_D_INFO, "Private->Buffer = [%016X]\n", (UINT64)(UINTN)Private->Buffer));
   DEBUG ((EFI_D_INFO, "Admin     Submission Queue size (Aqa.Asqs) = [%08X]\n", Aqa.Asqs));
@@ -861,8 +920,10 @@ NvmeControllerInit (
   DEBUG ((EFI_D_INFO, "Admin     Completion Queue (CqBuffer[0]) = [%016X]\n", Private->CqBuffer[0]));
   DEBUG ((EFI_D_INFO, "Sync  I/O Submission Queue (SqBuffer[1]) = [%016X]\n", Private->SqBuffer[1]));
   DEBUG ((EFI_D_INFO, "Sync  I/O Completion Queue (CqBuffer[1]) = [%016X]\n", Private->CqBuffer[1]));
-  DEBUG ((EFI_D_INFO, "Async I/O Submission Queue (SqBuffer[2]) = [%016X]\n", Private->SqBuffer[2]));
-  DEBUG ((EFI_D_INFO, "Async I/O Completion Queue (CqBuffer[2]) = [%016X]\n", Private->CqBuffer[2]));
+  for (Index = NVME_ASYNC_QUEUE_BASE; Index < NVME_MAX_QUEUES; Index++) {
+    DEBUG ((EFI_D_INFO, "Async I/O Submission Queue (SqBuffer[%d]) = [%016X]\n", Index, Private->SqBuffer[Index]));
+    DEBUG ((EFI_D_INFO, "Async I/O Completion Queue (CqBuffer[%d]) = [%016X]\n", Index, Private->CqBuffer[Index]));
+  }
 
   //
   // Program admin queue attributes.
@@ -937,10 +998,17 @@ NvmeControllerInit (
   DEBUG ((EFI_D_INFO, "    SQES      : 0x%x\n", Private->ControllerData->Sqes));
   DEBUG ((EFI_D_INFO, "    CQES      : 0x%x\n", Private->ControllerData->Cqes));
   DEBUG ((EFI_D_INFO, "    NN        : 0x%x\n", Private->ControllerData->Nn));
+  DEBUG ((EFI_D_INFO, "    SGLS      : 0x%x\n", Private->ControllerData->Sgls));
+
+  //
+  // Negotiate the number of asynchronous I/O queue pairs.
+  //
+  NvmeSetNumberOfQueues (Private);
+  DEBUG ((EFI_D_INFO, "NvmeControllerInit: %d asynchronous I/O queue pair(s)\n", Private->AsyncQueueCount));
 
   //
-  // Create two I/O completion queues.
-  // One for blocking I/O, one for non-blocking I/O.
+  // Create the I/O completion queues.
+  // One for blocking I/O, the others for non-blocking I/O.
   //
   Status = NvmeCreateIoCompletionQueue (Private);
   if (EFI_ERROR(Status)) {
@@ -948,8 +1016,8 @@ NvmeControllerInit (
   }
 
   //
-  // Create two I/O Submission queues.
-  // One for blocking I/O, one for non-blocking I/O.
+  // Create the I/O Submission queues.
+  // One for blocking I/O, the others for non-blocking I/O.
   //
   Status = NvmeCreateIoSubmissionQueue (Private);
 
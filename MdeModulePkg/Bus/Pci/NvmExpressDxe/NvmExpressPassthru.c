@@ -309,6 +309,42 @@ EXIT:
   return NULL;
 }
 
+/**
+  Check whether a mapped data buffer can be described by a single SGL Data
+  Block descriptor.
+
+  @param[in] Private        The pointer to the NVME_CONTROLLER_PRIVATE_DATA
+                            data structure.
+  @param[in] PhyAddr        The device address of the data buffer.
+  @param[in] Bytes          The length of the data buffer in bytes.
+
+  @retval TRUE              The controller supports SGLs for the NVM command
+                            set, and the buffer meets the alignment
+                            requirement.
+  @retval FALSE             PRP shall be used for the data buffer.
+
+**/
+BOOLEAN
+NvmeSglSupported (
+  IN NVME_CONTROLLER_PRIVATE_DATA    *Private,
+  IN UINT64                          PhyAddr,
+  IN UINT32                          Bytes
+  )
+{
+  //
+  // SGLS bits 1:0: 00b SGLs are not supported, 01b SGLs are supported without
+  // alignment requirement, 10b SGLs are supported with a Dword alignment and
+  // granularity requirement.
+  //
+  switch (Private->ControllerData->Sgls & (BIT0 | BIT1)) {
+  case BIT0:
+    return TRUE;
+  case BIT1:
+    return (BOOLEAN)(((PhyAddr | Bytes) & (sizeof (UINT32) - 1)) == 0);
+  default:
+    return FALSE;
+  }
+}
 
 /**
   Aborts the asynchronous PassThru requests.
@@ -453,6 +489,8 @@ NvmExpressPassThru (
   NVME_CQ                        *Cq;
   UINT16                         QueueId;
   UINT16                         QueueSize;
+  UINT16                         MaxInFlight;
+  UINT16                         Index;
   UINT32                         Bytes;
   UINT16                         Offset;
   EFI_EVENT                      TimerEvent;
@@ -470,6 +508,7 @@ NvmExpressPassThru (
   UINT32                         MaxTransLen;
   UINT32                         Data;
   NVME_PASS_THRU_ASYNC_REQ       *AsyncRequest;
+  NVME_SGL_DESCRIPTOR            *Sgl;
   EFI_TPL                        OldTpl;
 
   //
@@ -542,6 +581,7 @@ NvmExpressPassThru (
   TimerEvent  = NULL;
   Status      = EFI_SUCCESS;
   QueueSize   = MIN (NVME_ASYNC_CSQ_SIZE, Private->Cap.Mqes) + 1;
+  MaxInFlight = (UINT16)MIN (NVME_ASYNC_CCQ_SIZE, QueueSize - 1);
 
   if (Packet->QueueType == NVME_ADMIN_QUEUE) {
     QueueId = 0;
@@ -549,13 +589,21 @@ NvmExpressPassThru (
     if (Event == NULL) {
       QueueId = 1;
     } else {
-      QueueId = 2;
-
       //
-      // Submission queue full check.
+      // Pick the asynchronous I/O queue pairs in a round-robin manner. A queue
+      // pair is full when the outstanding commands would overflow either its
+      // submission queue or its completion queue.
       //
-      if ((Private->SqTdbl[QueueId].Sqt + 1) % QueueSize ==
-          Private->AsyncSqHead) {
+      QueueId = NVME_ASYNC_QUEUE_BASE;
+      for (Index = 0; Index < Private->AsyncQueueCount; Index++) {
+        QueueId = (UINT16)(NVME_ASYNC_QUEUE_BASE +
+                           (Private->NextAsyncQueue + Index) % Private->AsyncQueueCount);
+        if (Private->AsyncInFlight[QueueId] < MaxInFlight) {
+          break;
+        }
+      }
+
+      if (Index == Private->AsyncQueueCount) {
         return EFI_NOT_READY;
       }
     }
@@ -573,15 +621,6 @@ NvmExpressPassThru (
   Sq->Cid  = Private->Cid[QueueId]++;
   Sq->Nsid = Packet->NvmeCmd->Nsid;
 
-  //
-  // Currently we only support PRP for data transfer, SGL is NOT supported.
-  //
-  ASSERT (Sq->Psdt == 0);
-  if (Sq->Psdt != 0) {
-    DEBUG ((EFI_D_ERROR, "NvmExpressPassThru: doesn't support SGL mechanism\n"));
-    return EFI_UNSUPPORTED;
-  }
-
   Sq->Prp[0] = (UINT64)(UINTN)Packet->TransferBuffer;
   if ((Packet->QueueType == NVME_ADMIN_QUEUE) &&
       ((Sq->Opc == NVME_ADMIN_CRIOCQ_CMD) || (Sq->Opc == NVME_ADMIN_CRIOSQ_CMD))) {
@@ -651,13 +690,26 @@ NvmExpressPassThru (
     }
   }
   //
-  // If the buffer size spans more than two memory pages (page size as defined in CC.Mps),
-  // then build a PRP list in the second PRP submission queue entry.
+  // If the controller supports SGLs, describe the mapped data buffer of a NVM
+  // read or write command with a single SGL Data Block descriptor, so no PRP
+  // list has to be built for a large transfer.
+  //
+  // Otherwise, if the buffer size spans more than two memory pages (page size
+  // as defined in CC.Mps), then build a PRP list in the second PRP submission
+  // queue entry.
   //
   Offset = ((UINT16)Sq->Prp[0]) & (EFI_PAGE_SIZE - 1);
   Bytes  = Packet->TransferLength;
 
-  if ((Offset + Bytes) > (EFI_PAGE_SIZE * 2)) {
+  if ((MapData != NULL) && (MapMeta == NULL) &&
+      (Packet->QueueType == NVME_IO_QUEUE) &&
+      ((Sq->Opc == NVME_IO_READ_OPC) || (Sq->Opc == NVME_IO_WRITE_OPC)) &&
+      NvmeSglSupported (Private, Sq->Prp[0], Bytes)) {
+    Sgl             = (NVME_SGL_DESCRIPTOR *)&Sq->Prp[0];
+    Sgl->Length     = Bytes;
+    Sgl->Identifier = NVME_SGL_DATA_BLOCK_DESCRIPTOR << 4;
+    Sq->Psdt        = NVME_PSDT_SGL_CONTIGUOUS;
+  } else if ((Offset + Bytes) > (EFI_PAGE_SIZE * 2)) {
     //
     // Create PrpList for remaining data buffer.
     //
@@ -699,26 +751,34 @@ NvmExpressPassThru (
   }
 
   //
-  // Ring the submission queue doorbell.
+  // Ring the submission queue doorbell. The doorbell of an asynchronous I/O
+  // queue is left to NvmeSubmitAsyncSubtasks() if it is batching submissions.
   //
   if ((Event != NULL) && (QueueId != 0)) {
     Private->SqTdbl[QueueId].Sqt =
       (Private->SqTdbl[QueueId].Sqt + 1) % QueueSize;
+    Private->AsyncInFlight[QueueId]++;
+    Private->NextAsyncQueue = (UINT16)((QueueId - NVME_ASYNC_QUEUE_BASE + 1) % Private->AsyncQueueCount);
   } else {
     Private->SqTdbl[QueueId].Sqt ^= 1;
   }
-  Data = ReadUnaligned32 ((UINT32*)&Private->SqTdbl[QueueId]);
-  Status = PciIo->Mem.Write (
-               PciIo,
-               EfiPciIoWidthUint32,
-               NVME_BAR,
-               NVME_SQTDBL_OFFSET(QueueId, Private->Cap.Dstrd),
-               1,
-               &Data
-               );
 
-  if (EFI_ERROR (Status)) {
-    goto EXIT;
+  if (Private->DeferSqDoorbell && (Event != NULL) && (QueueId != 0)) {
+    Private->SqDoorbellPending[QueueId] = TRUE;
+  } else {
+    Data = ReadUnaligned32 ((UINT32*)&Private->SqTdbl[QueueId]);
+    Status = PciIo->Mem.Write (
+                 PciIo,
+                 EfiPciIoWidthUint32,
+                 NVME_BAR,
+                 NVME_SQTDBL_OFFSET(QueueId, Private->Cap.Dstrd),
+                 1,
+                 &Data
+                 );
+
+    if (EFI_ERROR (Status)) {
+      goto EXIT;
+    }
   }
 
   //
@@ -734,6 +794,7 @@ NvmExpressPassThru (
 
     AsyncRequest->Signature     = NVME_PASS_THRU_ASYNC_REQ_SIG;
     AsyncRequest->Packet        = Packet;
+    AsyncRequest->QueueId       = QueueId;
     AsyncRequest->CommandId     = Sq->Cid;
     AsyncRequest->CallerEvent   = Event;
     AsyncRequest->MapData       = MapData;
@@ -0,0 +1,230 @@
+/** @file
+  DXE Dispatcher AP assistance.
+
+  When PcdDxeApAssistedDispatch is TRUE, the compressed sections of the drivers
+  of a newly discovered firmware volume are decoded on the APs through the MP
+  Services protocol. The driver images are still loaded and started on the BSP
+  in the dispatch order.
+
+Copyright (c) 2021, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "DxeMain.h"
+
+//
+// The file types of the drivers whose sections are decoded ahead of time.
+//
+EFI_FV_FILETYPE mApAssistFileTypes[] = {
+  EFI_FV_FILETYPE_DRIVER,
+  EFI_FV_FILETYPE_COMBINED_SMM_DXE,
+  EFI_FV_FILETYPE_COMBINED_PEIM_DRIVER
+};
+
+typedef struct {
+  EFI_AP_PROCEDURE                  Procedure;
+  UINT8                             *Jobs;
+  UINTN                             JobSize;
+  UINTN                             JobCount;
+  volatile UINT32                   NextJob;
+} AP_JOB_QUEUE;
+
+EFI_MP_SERVICES_PROTOCOL            *mApAssistMpServices = NULL;
+
+
+/**
+  Get the MP Services protocol if there is at least one enabled AP.
+
+  @return The MP Services protocol, or NULL if no AP can be used.
+
+**/
+EFI_MP_SERVICES_PROTOCOL *
+CoreGetApAssistMpServices (
+  VOID
+  )
+{
+  EFI_STATUS                        Status;
+  UINTN                             NumberOfProcessors;
+  UINTN                             NumberOfEnabledProcessors;
+
+  if (mApAssistMpServices == NULL) {
+    Status = CoreLocateProtocol (&gEfiMpServiceProtocolGuid, NULL, (VOID **) &mApAssistMpServices);
+    if (EFI_ERROR (Status)) {
+      mApAssistMpServices = NULL;
+      return NULL;
+    }
+  }
+
+  Status = mApAssistMpServices->GetNumberOfProcessors (
+                                  mApAssistMpServices,
+                                  &NumberOfProcessors,
+                                  &NumberOfEnabledProcessors
+                                  );
+  if (EFI_ERROR (Status) || NumberOfEnabledProcessors < 2) {
+    return NULL;
+  }
+
+  return mApAssistMpServices;
+}
+
+
+/**
+  Take the jobs from the queue one at a time and run them until the queue is
+  empty. It runs on all the APs at the same time, then on the BSP.
+
+  @param  Buffer                 The AP_JOB_QUEUE.
+
+**/
+VOID
+EFIAPI
+CoreApJobWorker (
+  IN OUT VOID                       *Buffer
+  )
+{
+  AP_JOB_QUEUE                      *Queue;
+  UINTN                             Index;
+
+  Queue = (AP_JOB_QUEUE *) Buffer;
+  while (TRUE) {
+    Index = (UINTN) InterlockedIncrement (&Queue->NextJob) - 1;
+    if (Index >= Queue->JobCount) {
+      break;
+    }
+    Queue->Procedure (Queue->Jobs + Index * Queue->JobSize);
+  }
+}
+
+
+/**
+  Run a set of independent jobs on the APs. The BSP waits for the APs and then
+  runs the jobs left, or all the jobs if there is no AP available.
+
+  Procedure must not call any boot service, as it may run on an AP.
+
+  @param  Procedure              The function to run on each job.
+  @param  Jobs                   The array of jobs.
+  @param  JobSize                The size in bytes of a job.
+  @param  JobCount               The number of jobs.
+
+**/
+VOID
+CoreRunApJobs (
+  IN EFI_AP_PROCEDURE               Procedure,
+  IN VOID                           *Jobs,
+  IN UINTN                          JobSize,
+  IN UINTN                          JobCount
+  )
+{
+  EFI_MP_SERVICES_PROTOCOL          *MpServices;
+  AP_JOB_QUEUE                      Queue;
+
+  Queue.Procedure = Procedure;
+  Queue.Jobs      = (UINT8 *) Jobs;
+  Queue.JobSize   = JobSize;
+  Queue.JobCount  = JobCount;
+  Queue.NextJob   = 0;
+
+  if (JobCount > 1) {
+    MpServices = CoreGetApAssistMpServices ();
+    if (MpServices != NULL) {
+      //
+      // Blocking mode, the BSP only takes the jobs left if some AP failed to
+      // start.
+      //
+      MpServices->StartupAllAPs (
+                    MpServices,
+                    CoreApJobWorker,
+                    FALSE,
+                    NULL,
+                    0,
+                    &Queue,
+                    NULL
+                    );
+    }
+  }
+
+  CoreApJobWorker (&Queue);
+}
+
+
+/**
+  Decode on the APs the compressed sections of the drivers in a firmware
+  volume which has just been discovered, before the dispatcher reads them.
+
+  Nothing is done if there is no AP available, as decoding the sections ahead
+  of time on the BSP alone would only decode the sections of the drivers that
+  are never dispatched.
+
+  @param  Fv                     The firmware volume.
+
+**/
+VOID
+CorePrefetchFvDriverSections (
+  IN EFI_FIRMWARE_VOLUME2_PROTOCOL  *Fv
+  )
+{
+  EFI_STATUS                        Status;
+  EFI_FV_FILETYPE                   Type;
+  EFI_FV_FILE_ATTRIBUTES            Attributes;
+  EFI_GUID                          NameGuid;
+  EFI_GUID                          *NameGuids;
+  UINTN                             Key;
+  UINTN                             Size;
+  UINTN                             FileCount;
+  UINTN                             MaxFileCount;
+  UINTN                             Pass;
+  UINTN                             Index;
+
+  if (CoreGetApAssistMpServices () == NULL) {
+    return;
+  }
+
+  PERF_INMODULE_BEGIN ("DxeApPrefetch");
+
+  //
+  // Count the driver files on the first pass, and collect their names on the
+  // second one.
+  //
+  NameGuids    = NULL;
+  FileCount    = 0;
+  MaxFileCount = 0;
+  for (Pass = 0; Pass < 2; Pass++) {
+    if (Pass == 1) {
+      if (FileCount == 0) {
+        break;
+      }
+      NameGuids = AllocatePool (FileCount * sizeof (EFI_GUID));
+      if (NameGuids == NULL) {
+        break;
+      }
+      MaxFileCount = FileCount;
+      FileCount    = 0;
+    }
+
+    for (Index = 0; Index < sizeof (mApAssistFileTypes) / sizeof (EFI_FV_FILETYPE); Index++) {
+      Key = 0;
+      while (TRUE) {
+        Type = mApAssistFileTypes[Index];
+        Status = Fv->GetNextFile (Fv, &Key, &Type, &NameGuid, &Attributes, &Size);
+        if (EFI_ERROR (Status)) {
+          break;
+        }
+        if (NameGuids != NULL) {
+          if (FileCount == MaxFileCount) {
+            break;
+          }
+          CopyGuid (&NameGuids[FileCount], &NameGuid);
+        }
+        FileCount++;
+      }
+    }
+  }
+
+  if (NameGuids != NULL) {
+    FvPrefetchFileSections (Fv, NameGuids, FileCount);
+    CoreFreePool (NameGuids);
+  }
+
+  PERF_INMODULE_END ("DxeApPrefetch");
+}
@@ -0,0 +1,94 @@
+/** @file
+  Find the protocols a dependency expression waits for.
+
+  The DXE Dispatcher does not evaluate the dependency expression of a driver
+  again until one of the protocols it pushes is installed. This file only
+  depends on the PI definitions so that it can be built in a host-based unit
+  test.
+
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <PiDxe.h>
+
+#include "DepexWait.h"
+
+/**
+  Get the protocol GUIDs whose installation may make a dependency expression,
+  that was found FALSE, become TRUE.
+
+  A dependency expression using EFI_DEP_NOT can also become TRUE when a
+  protocol is uninstalled, so it must be evaluated on every pass of the
+  DXE Dispatcher. The GUIDs already replaced by EFI_DEP_REPLACE_TRUE are
+  skipped, as their value can not change any more.
+
+  @param  Depex                 The dependency expression.
+  @param  DepexSize             The size of Depex in bytes.
+  @param  Protocols             Optional array receiving pointers to the GUIDs
+                                in Depex.
+  @param  Count                 On input, the number of entries of Protocols.
+                                On output, the number of GUIDs found.
+
+  @retval TRUE                  The dependency expression only needs to be
+                                evaluated again when one of the GUIDs is
+                                installed.
+  @retval FALSE                 The dependency expression uses EFI_DEP_NOT, or
+                                it is malformed, and must be evaluated on every
+                                pass.
+
+**/
+BOOLEAN
+CoreGetDepexWaitProtocols (
+  IN     UINT8                    *Depex,
+  IN     UINTN                    DepexSize,
+  OUT    EFI_GUID                 **Protocols OPTIONAL,
+  IN OUT UINTN                    *Count
+  )
+{
+  UINT8  *Iterator;
+  UINT8  *End;
+  UINTN  Found;
+
+  End   = Depex + DepexSize;
+  Found = 0;
+  for (Iterator = Depex; Iterator < End; Iterator++) {
+    switch (*Iterator) {
+    case EFI_DEP_PUSH:
+    case EFI_DEP_REPLACE_TRUE:
+      if (Iterator + sizeof (EFI_GUID) >= End) {
+        return FALSE;
+      }
+      if (*Iterator == EFI_DEP_PUSH) {
+        if ((Protocols != NULL) && (Found < *Count)) {
+          Protocols[Found] = (EFI_GUID *) (Iterator + 1);
+        }
+        Found++;
+      }
+      Iterator += sizeof (EFI_GUID);
+      break;
+
+    case EFI_DEP_AND:
+    case EFI_DEP_OR:
+    case EFI_DEP_TRUE:
+    case EFI_DEP_FALSE:
+    case EFI_DEP_SOR:
+      break;
+
+    case EFI_DEP_END:
+      *Count = Found;
+      return TRUE;
+
+    default:
+      //
+      // EFI_DEP_NOT, or an opcode the evaluator would reject
+      //
+      return FALSE;
+    }
+  }
+
+  //
+  // No EFI_DEP_END
+  //
+  return FALSE;
+}
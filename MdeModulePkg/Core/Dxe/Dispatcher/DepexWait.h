@@ -0,0 +1,56 @@
+/** @file
+  Find the protocols a dependency expression waits for.
+
+  This file only depends on the PI definitions so that it can be built in a
+  host-based unit test.
+
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef _DEPEX_WAIT_H_
+#define _DEPEX_WAIT_H_
+
+///
+/// EFI_DEP_REPLACE_TRUE - Used to dynamically patch the dependency expression
+///                        to save time.  A EFI_DEP_PUSH is evaluated one an
+///                        replaced with EFI_DEP_REPLACE_TRUE. If PI spec's Vol 2
+///                        Driver Execution Environment Core Interface use 0xff
+///                        as new DEPEX opcode. EFI_DEP_REPLACE_TRUE should be
+///                        defined to a new value that is not conflicting with PI spec.
+///
+#define EFI_DEP_REPLACE_TRUE  0xff
+
+/**
+  Get the protocol GUIDs whose installation may make a dependency expression,
+  that was found FALSE, become TRUE.
+
+  A dependency expression using EFI_DEP_NOT can also become TRUE when a
+  protocol is uninstalled, so it must be evaluated on every pass of the
+  DXE Dispatcher. The GUIDs already replaced by EFI_DEP_REPLACE_TRUE are
+  skipped, as their value can not change any more.
+
+  @param  Depex                 The dependency expression.
+  @param  DepexSize             The size of Depex in bytes.
+  @param  Protocols             Optional array receiving pointers to the GUIDs
+                                in Depex.
+  @param  Count                 On input, the number of entries of Protocols.
+                                On output, the number of GUIDs found.
+
+  @retval TRUE                  The dependency expression only needs to be
+                                evaluated again when one of the GUIDs is
+                                installed.
+  @retval FALSE                 The dependency expression uses EFI_DEP_NOT, or
+                                it is malformed, and must be evaluated on every
+                                pass.
+
+**/
+BOOLEAN
+CoreGetDepexWaitProtocols (
+  IN     UINT8                    *Depex,
+  IN     UINTN                    DepexSize,
+  OUT    EFI_GUID                 **Protocols OPTIONAL,
+  IN OUT UINTN                    *Count
+  );
+
+#endif
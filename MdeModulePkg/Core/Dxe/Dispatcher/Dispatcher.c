@@ -51,7 +51,32 @@ LIST_ENTRY  mScheduledQueue = INITIALIZE_LIST_HEAD_VARIABLE (mScheduledQueue);
 LIST_ENTRY  mFvHandleList = INITIALIZE_LIST_HEAD_VARIABLE (mFvHandleList);           // list of KNOWN_HANDLE
 
 //
-// Lock for mDiscoveredList, mScheduledQueue, gDispatcherRunning.
+// Index from protocol GUID to the drivers whose Depex was found unsatisfied
+// while the protocol was not installed. List of EFI_CORE_DEPEX_WAITER.
+//
+LIST_ENTRY  mDepexWaiterIndex[DEPEX_WAITER_INDEX_SIZE];
+UINTN       mDepexWaiterCount = 0;
+
+//
+// Number of protocol installations, used to detect an installation that
+// happens while a Depex is being evaluated.
+//
+UINTN       mDepexInstallCount = 0;
+
+//
+// TRUE if a protocol was installed while mDepexWaiterIndex could not be
+// searched, so all the waiting drivers have to be evaluated again.
+//
+BOOLEAN     mDepexWaiterIndexStale = FALSE;
+
+//
+// Number of passes and Depex evaluations made by the DXE Dispatcher.
+//
+UINTN       mDispatchPassCount = 0;
+UINTN       mDepexEvaluationCount = 0;
+
+//
+// Lock for mDiscoveredList, mScheduledQueue, gDispatcherRunning, mDepexWaiterIndex.
 //
 EFI_LOCK  mDispatcherLock = EFI_INITIALIZE_LOCK_VARIABLE (TPL_HIGH_LEVEL);
 
@@ -222,6 +247,198 @@ CoreReleaseDispatcherLock (
 }
 
 
+/**
+  Get the bucket of mDepexWaiterIndex for a protocol GUID.
+
+  @param  Protocol              The GUID of the protocol.
+
+  @return The index of the bucket.
+
+**/
+UINTN
+CoreDepexWaiterBucket (
+  IN  CONST EFI_GUID          *Protocol
+  )
+{
+  UINT32  Hash;
+
+  Hash = ReadUnaligned32 ((CONST UINT32 *) Protocol) ^
+         ReadUnaligned32 ((CONST UINT32 *) Protocol + 1) ^
+         ReadUnaligned32 ((CONST UINT32 *) Protocol + 2) ^
+         ReadUnaligned32 ((CONST UINT32 *) Protocol + 3);
+  Hash ^= Hash >> 16;
+  Hash ^= Hash >> 8;
+
+  return Hash & (DEPEX_WAITER_INDEX_SIZE - 1);
+}
+
+
+/**
+  Remove a driver from mDepexWaiterIndex.
+
+  @param  DriverEntry           The driver to remove.
+
+**/
+VOID
+CoreUnregisterDepexWaiters (
+  IN  EFI_CORE_DRIVER_ENTRY   *DriverEntry
+  )
+{
+  EFI_CORE_DEPEX_WAITER  *Waiters;
+  UINTN                  Index;
+
+  if (!DriverEntry->DepexWaiting && DriverEntry->DepexWaiters == NULL) {
+    return;
+  }
+
+  CoreAcquireDispatcherLock ();
+
+  Waiters = DriverEntry->DepexWaiters;
+  for (Index = 0; Index < DriverEntry->DepexWaiterCount; Index++) {
+    RemoveEntryList (&Waiters[Index].Link);
+  }
+  mDepexWaiterCount -= DriverEntry->DepexWaiterCount;
+
+  DriverEntry->DepexWaiting     = FALSE;
+  DriverEntry->DepexWaiters     = NULL;
+  DriverEntry->DepexWaiterCount = 0;
+
+  CoreReleaseDispatcherLock ();
+
+  if (Waiters != NULL) {
+    CoreFreePool (Waiters);
+  }
+}
+
+
+/**
+  Add a driver whose Depex was found unsatisfied to mDepexWaiterIndex, once
+  for each protocol GUID the Depex pushes that was not installed. The driver
+  is not evaluated again by the DXE Dispatcher until one of them is installed.
+
+  The GUIDs already replaced by EFI_DEP_REPLACE_TRUE are skipped, as their
+  value can not change any more. If a protocol was installed since the Depex
+  was evaluated, the driver is not made to wait so it is evaluated again.
+  A Depex using EFI_DEP_NOT may become TRUE when a protocol is uninstalled,
+  so such a driver never waits.
+
+  @param  DriverEntry           The driver to add.
+  @param  InstallCount          mDepexInstallCount before the Depex was evaluated.
+
+**/
+VOID
+CoreRegisterDepexWaiters (
+  IN  EFI_CORE_DRIVER_ENTRY   *DriverEntry,
+  IN  UINTN                   InstallCount
+  )
+{
+  EFI_CORE_DEPEX_WAITER  *Waiters;
+  EFI_GUID               **Protocols;
+  UINTN                  Count;
+  UINTN                  Index;
+
+  CoreUnregisterDepexWaiters (DriverEntry);
+
+  if ((DriverEntry->Depex == NULL) || DriverEntry->Before || DriverEntry->After ||
+      DriverEntry->DepexProtocolError) {
+    return;
+  }
+
+  //
+  // Count the GUIDs pushed by the Depex. A Depex that can not wait is
+  // evaluated on every pass.
+  //
+  Count = 0;
+  if (!CoreGetDepexWaitProtocols (DriverEntry->Depex, DriverEntry->DepexSize, NULL, &Count)) {
+    return;
+  }
+
+  Waiters = NULL;
+  if (Count != 0) {
+    //
+    // The GUID pointers are gathered after the waiters, in the same buffer.
+    //
+    Waiters = AllocatePool (Count * (sizeof (EFI_CORE_DEPEX_WAITER) + sizeof (EFI_GUID *)));
+    if (Waiters == NULL) {
+      //
+      // Keep evaluating the Depex on every pass.
+      //
+      return;
+    }
+    Protocols = (EFI_GUID **) (Waiters + Count);
+
+    CoreGetDepexWaitProtocols (DriverEntry->Depex, DriverEntry->DepexSize, Protocols, &Count);
+    for (Index = 0; Index < Count; Index++) {
+      Waiters[Index].Protocol    = Protocols[Index];
+      Waiters[Index].DriverEntry = DriverEntry;
+    }
+  }
+
+  CoreAcquireDispatcherLock ();
+
+  if (InstallCount != mDepexInstallCount) {
+    //
+    // A protocol was installed after the Depex was evaluated.
+    //
+    CoreReleaseDispatcherLock ();
+    if (Waiters != NULL) {
+      CoreFreePool (Waiters);
+    }
+    return;
+  }
+
+  for (Index = 0; Index < Count; Index++) {
+    InsertTailList (&mDepexWaiterIndex[CoreDepexWaiterBucket (Waiters[Index].Protocol)], &Waiters[Index].Link);
+  }
+  mDepexWaiterCount += Count;
+
+  DriverEntry->DepexWaiting     = TRUE;
+  DriverEntry->DepexWaiters     = Waiters;
+  DriverEntry->DepexWaiterCount = Count;
+
+  CoreReleaseDispatcherLock ();
+}
+
+
+/**
+  Wake up the drivers whose dependency expression is waiting for a protocol,
+  so the DXE Dispatcher evaluates them again on its next pass.
+
+  @param  Protocol              The GUID of the protocol that was installed.
+
+**/
+VOID
+CoreNotifyDepexWaiters (
+  IN  EFI_GUID                *Protocol
+  )
+{
+  LIST_ENTRY             *Bucket;
+  LIST_ENTRY             *Link;
+  EFI_CORE_DEPEX_WAITER  *Waiter;
+
+  mDepexInstallCount++;
+
+  if (mDepexWaiterCount == 0) {
+    return;
+  }
+
+  if (EFI_ERROR (CoreAcquireLockOrFail (&mDispatcherLock))) {
+    mDepexWaiterIndexStale = TRUE;
+    return;
+  }
+
+  Bucket = &mDepexWaiterIndex[CoreDepexWaiterBucket (Protocol)];
+  for (Link = Bucket->ForwardLink; Link != Bucket; Link = Link->ForwardLink) {
+    Waiter = BASE_CR (Link, EFI_CORE_DEPEX_WAITER, Link);
+    if (CompareGuid (Waiter->Protocol, Protocol)) {
+      Waiter->DriverEntry->DepexWaiting = FALSE;
+    }
+  }
+
+  CoreReleaseDispatcherLock ();
+}
+
+
 /**
   Read Depex and pre-process the Depex for Before and After. If Section Extraction
   protocol returns an error via ReadSection defer the reading of the Depex.
@@ -410,6 +627,8 @@ CoreDispatcher (
   LIST_ENTRY                      *Link;
   EFI_CORE_DRIVER_ENTRY           *DriverEntry;
   BOOLEAN                         ReadyToRun;
+  BOOLEAN                         EvaluateAll;
+  UINTN                           InstallCount;
   EFI_EVENT                       DxeDispatchEvent;
 
   PERF_FUNCTION_BEGIN ();
@@ -543,9 +762,13 @@ CoreDispatcher (
     }
 
     //
-    // Search DriverList for items to place on Scheduled Queue
+    // Search DriverList for items to place on Scheduled Queue. Only the drivers
+    // whose Depex may have changed since the last evaluation are evaluated.
     //
-    ReadyToRun = FALSE;
+    ReadyToRun  = FALSE;
+    EvaluateAll = mDepexWaiterIndexStale;
+    mDepexWaiterIndexStale = FALSE;
+    mDispatchPassCount++;
     for (Link = mDiscoveredList.ForwardLink; Link != &mDiscoveredList; Link = Link->ForwardLink) {
       DriverEntry = CR (Link, EFI_CORE_DRIVER_ENTRY, Link, EFI_CORE_DRIVER_ENTRY_SIGNATURE);
 
@@ -557,9 +780,18 @@ CoreDispatcher (
       }
 
       if (DriverEntry->Dependent) {
+        if (DriverEntry->DepexWaiting && !EvaluateAll) {
+          continue;
+        }
+
+        InstallCount = mDepexInstallCount;
+        mDepexEvaluationCount++;
         if (CoreIsSchedulable (DriverEntry)) {
+          CoreUnregisterDepexWaiters (DriverEntry);
           CoreInsertOnScheduledQueueWhileProcessingBeforeAndAfter (DriverEntry);
           ReadyToRun = TRUE;
+        } else {
+          CoreRegisterDepexWaiters (DriverEntry, InstallCount);
         }
       } else {
         if (DriverEntry->Unrequested) {
@@ -571,6 +803,13 @@ CoreDispatcher (
     }
   } while (ReadyToRun);
 
+  DEBUG ((
+    DEBUG_INFO,
+    "DXE Dispatcher: %d passes, %d Depex evaluations\n",
+    (UINT32) mDispatchPassCount,
+    (UINT32) mDepexEvaluationCount
+    ));
+
   //
   // Close DXE dispatch Event
   //
@@ -1180,6 +1419,81 @@ CoreProcessFvImageFile (
 }
 
 
+/**
+  Reorder the drivers of a FV in the mDiscoveredList as listed in the dispatch
+  order file of the FV, if there is one. The drivers that are not listed keep
+  their order after the listed ones. The Depex of the drivers is evaluated as
+  usual, so a stale dispatch order file only costs more dispatch passes.
+
+  @param  Fv                    The firmware volume of the drivers.
+  @param  FvHandle              The handle of the firmware volume.
+
+**/
+VOID
+CoreOrderDriversWithDispatchOrder (
+  IN  EFI_FIRMWARE_VOLUME2_PROTOCOL   *Fv,
+  IN  EFI_HANDLE                      FvHandle
+  )
+{
+  EFI_STATUS                    Status;
+  EFI_GUID                      *OrderFile;
+  UINTN                         OrderEntryCount;
+  UINTN                         SizeOfBuffer;
+  UINT32                        AuthenticationStatus;
+  UINTN                         Index;
+  LIST_ENTRY                    *Anchor;
+  LIST_ENTRY                    *Link;
+  EFI_CORE_DRIVER_ENTRY         *DriverEntry;
+
+  OrderFile = NULL;
+  Status = Fv->ReadSection (
+                Fv,
+                &gEdkiiDxeDispatchOrderFileGuid,
+                EFI_SECTION_RAW,
+                0,
+                (VOID **)&OrderFile,
+                &SizeOfBuffer,
+                &AuthenticationStatus
+                );
+  if (EFI_ERROR (Status)) {
+    return;
+  }
+  OrderEntryCount = SizeOfBuffer / sizeof (EFI_GUID);
+
+  CoreAcquireDispatcherLock ();
+
+  //
+  // The drivers of the FV have just been added to the end of the list. The
+  // listed drivers are moved in front of the first one that was not moved yet.
+  //
+  for (Anchor = mDiscoveredList.ForwardLink; Anchor != &mDiscoveredList; Anchor = Anchor->ForwardLink) {
+    DriverEntry = CR (Anchor, EFI_CORE_DRIVER_ENTRY, Link, EFI_CORE_DRIVER_ENTRY_SIGNATURE);
+    if (DriverEntry->FvHandle == FvHandle) {
+      break;
+    }
+  }
+
+  for (Index = 0; (Index < OrderEntryCount) && (Anchor != &mDiscoveredList); Index++) {
+    for (Link = Anchor; Link != &mDiscoveredList; Link = Link->ForwardLink) {
+      DriverEntry = CR (Link, EFI_CORE_DRIVER_ENTRY, Link, EFI_CORE_DRIVER_ENTRY_SIGNATURE);
+      if ((DriverEntry->FvHandle == FvHandle) && CompareGuid (&DriverEntry->FileName, &OrderFile[Index])) {
+        if (Link == Anchor) {
+          Anchor = Anchor->ForwardLink;
+        } else {
+          RemoveEntryList (Link);
+          InsertTailList (Anchor, Link);
+        }
+        break;
+      }
+    }
+  }
+
+  CoreReleaseDispatcherLock ();
+
+  CoreFreePool (OrderFile);
+}
+
+
 /**
   Event notification that is fired every time a FV dispatch protocol is added.
   More than one protocol may have been added when this event is fired, so you
@@ -1279,6 +1593,14 @@ CoreFwVolEventProtocolNotify (
       continue;
     }
 
+    //
+    // Decode the compressed sections of the drivers on the APs first, so that
+    // the depex and image reads below find them already decoded.
+    //
+    if (FeaturePcdGet (PcdDxeApAssistedDispatch)) {
+      CorePrefetchFvDriverSections (Fv);
+    }
+
     //
     // Discover Drivers in FV and add them to the Discovered Driver List.
     // Process EFI_FV_FILETYPE_DRIVER type and then EFI_FV_FILETYPE_COMBINED_PEIM_DRIVER
@@ -1434,6 +1756,11 @@ CoreFwVolEventProtocolNotify (
     // Free data allocated by Fv->ReadSection ()
     //
     CoreFreePool (AprioriFile);
+
+    //
+    // Order the drivers of the FV as its dispatch order file lists them.
+    //
+    CoreOrderDriversWithDispatchOrder (Fv, FvHandle);
   }
 }
 
@@ -1449,8 +1776,14 @@ CoreInitializeDispatcher (
   VOID
   )
 {
+  UINTN  Index;
+
   PERF_FUNCTION_BEGIN ();
 
+  for (Index = 0; Index < DEPEX_WAITER_INDEX_SIZE; Index++) {
+    InitializeListHead (&mDepexWaiterIndex[Index]);
+  }
+
   mFwVolEvent = EfiCreateProtocolNotifyEvent (
                   &gEfiFirmwareVolume2ProtocolGuid,
                   TPL_CALLBACK,
@@ -47,6 +47,7 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <Protocol/HiiPackageList.h>
 #include <Protocol/SmmBase2.h>
 #include <Protocol/PeCoffImageEmulator.h>
+#include <Protocol/MpService.h>
 #include <Guid/MemoryTypeInformation.h>
 #include <Guid/FirmwareFileSystem2.h>
 #include <Guid/FirmwareFileSystem3.h>
@@ -64,6 +65,8 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <Guid/VectorHandoffTable.h>
 #include <Ppi/VectorHandoffInfo.h>
 #include <Guid/MemoryProfile.h>
+#include <Guid/TimerLatencyHistogram.h>
+#include <Guid/DispatchOrderFile.h>
 
 #include <Library/DxeCoreEntryPoint.h>
 #include <Library/DebugLib.h>
@@ -86,7 +89,11 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <Library/DxeServicesLib.h>
 #include <Library/DebugAgentLib.h>
 #include <Library/CpuExceptionHandlerLib.h>
+#include <Library/SynchronizationLib.h>
+#include <Library/TimerLib.h>
 
+#include "Library/AddressTree.h"
+#include "Dispatcher/DepexWait.h"
 
 //
 // attributes for reserved memory before it is promoted to system memory
@@ -102,19 +109,15 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 
 
 ///
-/// EFI_DEP_REPLACE_TRUE - Used to dynamically patch the dependency expression
-///                        to save time.  A EFI_DEP_PUSH is evaluated one an
-///                        replaced with EFI_DEP_REPLACE_TRUE. If PI spec's Vol 2
-///                        Driver Execution Environment Core Interface use 0xff
-///                        as new DEPEX opcode. EFI_DEP_REPLACE_TRUE should be
-///                        defined to a new value that is not conflicting with PI spec.
+/// Define the initial size of the dependency expression evaluation stack
 ///
-#define EFI_DEP_REPLACE_TRUE  0xff
+#define DEPEX_STACK_SIZE_INCREMENT  0x1000
 
 ///
-/// Define the initial size of the dependency expression evaluation stack
+/// Define the number of buckets of the index from protocol GUID to the drivers
+/// whose dependency expression is waiting for it. It must be a power of 2.
 ///
-#define DEPEX_STACK_SIZE_INCREMENT  0x1000
+#define DEPEX_WAITER_INDEX_SIZE     0x40
 
 typedef struct {
   EFI_GUID                    *ProtocolGuid;
@@ -137,6 +140,8 @@ typedef struct {
 } KNOWN_HANDLE;
 
 
+typedef struct _EFI_CORE_DEPEX_WAITER EFI_CORE_DEPEX_WAITER;
+
 #define EFI_CORE_DRIVER_ENTRY_SIGNATURE SIGNATURE_32('d','r','v','r')
 typedef struct {
   UINTN                           Signature;
@@ -166,13 +171,31 @@ typedef struct {
   EFI_HANDLE                      ImageHandle;
   BOOLEAN                         IsFvImage;
 
+  //
+  // TRUE if the Depex was found unsatisfied and none of the protocols it
+  // pushes has been installed since.
+  //
+  BOOLEAN                         DepexWaiting;
+  EFI_CORE_DEPEX_WAITER           *DepexWaiters;
+  UINTN                           DepexWaiterCount;
+
 } EFI_CORE_DRIVER_ENTRY;
 
+//
+// Entry of the index from protocol GUID to the drivers waiting for it.
+//
+struct _EFI_CORE_DEPEX_WAITER {
+  LIST_ENTRY                      Link;             // mDepexWaiterIndex
+  EFI_GUID                        *Protocol;
+  EFI_CORE_DRIVER_ENTRY           *DriverEntry;
+};
+
 //
 //The data structure of GCD memory map entry
 //
 #define EFI_GCD_MAP_SIGNATURE  SIGNATURE_32('g','c','d','m')
-typedef struct {
+typedef struct _EFI_GCD_MAP_ENTRY EFI_GCD_MAP_ENTRY;
+struct _EFI_GCD_MAP_ENTRY {
   UINTN                 Signature;
   LIST_ENTRY            Link;
   EFI_PHYSICAL_ADDRESS  BaseAddress;
@@ -183,7 +206,11 @@ typedef struct {
   EFI_GCD_IO_TYPE       GcdIoType;
   EFI_HANDLE            ImageHandle;
   EFI_HANDLE            DeviceHandle;
-} EFI_GCD_MAP_ENTRY;
+  ///
+  /// Node of the balanced tree indexing the entries of the map by address.
+  ///
+  ADDRESS_TREE_NODE     TreeNode;
+};
 
 
 #define LOADED_IMAGE_PRIVATE_DATA_SIGNATURE   SIGNATURE_32('l','d','r','i')
@@ -395,6 +422,17 @@ CoreInitializeGcdServices (
   );
 
 
+/**
+  Dump the number of GCD operations of each kind and the time spent in them
+  using DEBUG() macros when PcdDebugPrintErrorLevel has the DEBUG_GCD bit set.
+
+**/
+VOID
+CoreDumpGcdStatistics (
+  VOID
+  );
+
+
 /**
   Initializes "event" support.
 
@@ -520,6 +558,19 @@ CorePreProcessDepex (
   );
 
 
+/**
+  Wake up the drivers whose dependency expression is waiting for a protocol,
+  so the DXE Dispatcher evaluates them again on its next pass.
+
+  @param  Protocol              The GUID of the protocol that was installed.
+
+**/
+VOID
+CoreNotifyDepexWaiters (
+  IN  EFI_GUID                *Protocol
+  );
+
+
 
 /**
   Terminates all boot services.
@@ -2171,6 +2222,58 @@ CoreDisplayDiscoveredNotDispatched (
   );
 
 
+/**
+  Run a set of independent jobs on the APs. The BSP waits for the APs and then
+  runs the jobs left, or all the jobs if there is no AP available.
+
+  Procedure must not call any boot service, as it may run on an AP.
+
+  @param  Procedure              The function to run on each job.
+  @param  Jobs                   The array of jobs.
+  @param  JobSize                The size in bytes of a job.
+  @param  JobCount               The number of jobs.
+
+**/
+VOID
+CoreRunApJobs (
+  IN EFI_AP_PROCEDURE               Procedure,
+  IN VOID                           *Jobs,
+  IN UINTN                          JobSize,
+  IN UINTN                          JobCount
+  );
+
+
+/**
+  Decode on the APs the compressed sections of the drivers in a firmware
+  volume which has just been discovered, before the dispatcher reads them.
+
+  @param  Fv                     The firmware volume.
+
+**/
+VOID
+CorePrefetchFvDriverSections (
+  IN EFI_FIRMWARE_VOLUME2_PROTOCOL  *Fv
+  );
+
+
+/**
+  Open the section streams of a set of files and decode their encapsulation
+  sections ahead of time, so that the later ReadSection() calls find them
+  already decoded.
+
+  @param  Fv                     The firmware volume holding the files.
+  @param  NameGuids              The names of the files.
+  @param  FileCount              The number of files.
+
+**/
+VOID
+FvPrefetchFileSections (
+  IN EFI_FIRMWARE_VOLUME2_PROTOCOL  *Fv,
+  IN EFI_GUID                       *NameGuids,
+  IN UINTN                          FileCount
+  );
+
+
 
 /**
   Place holder function until all the Boot Services and Runtime Services are
@@ -2481,6 +2584,37 @@ CloseSectionStream (
   IN  BOOLEAN                                   FreeStreamBuffer
   );
 
+/**
+  Get the memory held by a section stream for the encapsulation sections that
+  have been expanded so far, e.g. the decompressed data of compression
+  sections. The memory is freed when the stream is closed.
+
+  @param  SectionStreamHandle    Indicates the section stream.
+
+  @return The total size in bytes of the buffers of the encapsulated streams,
+          or 0 if the stream does not exist.
+
+**/
+UINTN
+GetSectionStreamCacheSize (
+  IN  UINTN                                     SectionStreamHandle
+  );
+
+/**
+  Decode the compression and GUIDed sections of a set of section streams in
+  parallel, and parse the streams with the results, so that the sections can
+  be got later without decoding them again.
+
+  @param  StreamHandles          The section streams.
+  @param  StreamCount            The number of section streams.
+
+**/
+VOID
+PrefetchSectionStreams (
+  IN  UINTN                                     *StreamHandles,
+  IN  UINTN                                     StreamCount
+  );
+
 /**
   Creates and initializes the DebugImageInfo Table.  Also creates the configuration
   table and registers it into the system table.
@@ -767,6 +767,8 @@ CoreExitBootServices (
 
   gMemoryMapTerminated = TRUE;
 
+  CoreDumpGcdStatistics ();
+
   //
   // Notify other drivers that we are exiting boot services.
   //
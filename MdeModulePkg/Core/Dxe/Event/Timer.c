@@ -10,20 +10,60 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include "DxeMain.h"
 #include "Event.h"
 
+//
+// The timer events are kept in a hierarchical timing wheel. The system time is
+// divided in slots of 2^TIMER_WHEEL_SLOT_SHIFT 100ns units. Level 0 holds the
+// timers expiring in the next TIMER_WHEEL_SLOTS slots, one list per slot, and
+// each upper level holds TIMER_WHEEL_SLOTS times longer ranges. The lists of
+// an upper level are moved down to the lower levels when the level below
+// wraps around. The timers beyond the last level are kept in an overflow list.
+//
+#define TIMER_WHEEL_SLOT_SHIFT   16
+#define TIMER_WHEEL_LEVEL_BITS   6
+#define TIMER_WHEEL_SLOTS        (1 << TIMER_WHEEL_LEVEL_BITS)
+#define TIMER_WHEEL_SLOT_MASK    (TIMER_WHEEL_SLOTS - 1)
+#define TIMER_WHEEL_LEVELS       4
+
 //
 // Internal data
 //
 
-LIST_ENTRY       mEfiTimerList = INITIALIZE_LIST_HEAD_VARIABLE (mEfiTimerList);
+LIST_ENTRY       mEfiTimerWheel[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+LIST_ENTRY       mEfiTimerOverflowList = INITIALIZE_LIST_HEAD_VARIABLE (mEfiTimerOverflowList);
+UINT64           mEfiTimerWheelSlot = 0;
+UINTN            mEfiTimerCount = 0;
+UINT64           mEfiTimerNextCheck = MAX_UINT64;
 EFI_LOCK         mEfiTimerLock = EFI_INITIALIZE_LOCK_VARIABLE (TPL_HIGH_LEVEL - 1);
 EFI_EVENT        mEfiCheckTimerEvent = NULL;
 
 EFI_LOCK         mEfiSystemTimeLock = EFI_INITIALIZE_LOCK_VARIABLE (TPL_HIGH_LEVEL);
 UINT64           mEfiSystemTime = 0;
 
+EDKII_TIMER_LATENCY_HISTOGRAM  *mEfiTimerLatencyHistogram = NULL;
+
 //
 // Timer functions
 //
+/**
+  Returns the current system time.
+
+  @return The current system time
+
+**/
+UINT64
+CoreCurrentSystemTime (
+  VOID
+  )
+{
+  UINT64          SystemTime;
+
+  CoreAcquireLock (&mEfiSystemTimeLock);
+  SystemTime = mEfiSystemTime;
+  CoreReleaseLock (&mEfiSystemTimeLock);
+
+  return SystemTime;
+}
+
 /**
   Inserts the timer event.
 
@@ -36,91 +76,209 @@ CoreInsertEventTimer (
   IN IEVENT   *Event
   )
 {
-  UINT64          TriggerTime;
-  LIST_ENTRY      *Link;
-  IEVENT          *Event2;
+  UINT64          Expires;
+  UINT64          Delta;
+  UINTN           Level;
+  UINTN           Index;
 
   ASSERT_LOCKED (&mEfiTimerLock);
 
   //
-  // Get the timer's trigger time
+  // The wheel is not advanced while it is empty, so bring it to the current
+  // slot before it is used again.
   //
-  TriggerTime = Event->Timer.TriggerTime;
+  if (mEfiTimerCount == 0) {
+    mEfiTimerWheelSlot = RShiftU64 (CoreCurrentSystemTime (), TIMER_WHEEL_SLOT_SHIFT);
+  }
 
   //
-  // Insert the timer into the timer database in assending sorted order
+  // Get the slot of the timer's trigger time
   //
-  for (Link = mEfiTimerList.ForwardLink; Link != &mEfiTimerList; Link = Link->ForwardLink) {
-    Event2 = CR (Link, IEVENT, Timer.Link, EVENT_SIGNATURE);
+  Expires = RShiftU64 (Event->Timer.TriggerTime, TIMER_WHEEL_SLOT_SHIFT);
+  if (Expires < mEfiTimerWheelSlot) {
+    Expires = mEfiTimerWheelSlot;
+  }
+  Delta = Expires - mEfiTimerWheelSlot;
 
-    if (Event2->Timer.TriggerTime > TriggerTime) {
+  //
+  // Insert the timer into the lowest level covering its trigger time
+  //
+  for (Level = 0; Level < TIMER_WHEEL_LEVELS; Level++) {
+    if (Delta < LShiftU64 (1, (Level + 1) * TIMER_WHEEL_LEVEL_BITS)) {
+      Index = (UINTN) RShiftU64 (Expires, Level * TIMER_WHEEL_LEVEL_BITS) & TIMER_WHEEL_SLOT_MASK;
+      InsertTailList (&mEfiTimerWheel[Level][Index], &Event->Timer.Link);
       break;
     }
   }
+  if (Level == TIMER_WHEEL_LEVELS) {
+    InsertTailList (&mEfiTimerOverflowList, &Event->Timer.Link);
+  }
+
+  mEfiTimerCount++;
 
-  InsertTailList (Link, &Event->Timer.Link);
+  //
+  // CoreTimerTick() reads the next check time at TPL_HIGH_LEVEL, so update it
+  // under the system time lock to keep the 64-bit value from tearing
+  //
+  CoreAcquireLock (&mEfiSystemTimeLock);
+  mEfiTimerNextCheck = MIN (mEfiTimerNextCheck, Event->Timer.TriggerTime);
+  CoreReleaseLock (&mEfiSystemTimeLock);
 }
 
 /**
-  Returns the current system time.
+  Removes the timer event from the timer database.
 
-  @return The current system time
+  @param  Event                  Points to the internal structure of timer event
+                                 to be removed
 
 **/
-UINT64
-CoreCurrentSystemTime (
+VOID
+CoreRemoveEventTimer (
+  IN IEVENT   *Event
+  )
+{
+  ASSERT_LOCKED (&mEfiTimerLock);
+  ASSERT (mEfiTimerCount > 0);
+
+  RemoveEntryList (&Event->Timer.Link);
+  Event->Timer.Link.ForwardLink = NULL;
+  mEfiTimerCount--;
+}
+
+/**
+  Moves all the timer events of a list to another, empty, list.
+
+  @param  Destination            The empty list receiving the timer events
+  @param  Source                 The list the timer events are moved from
+
+**/
+VOID
+CoreMoveTimerList (
+  OUT LIST_ENTRY  *Destination,
+  IN  LIST_ENTRY  *Source
+  )
+{
+  if (IsListEmpty (Source)) {
+    InitializeListHead (Destination);
+    return;
+  }
+
+  Destination->ForwardLink = Source->ForwardLink;
+  Destination->BackLink    = Source->BackLink;
+  Destination->ForwardLink->BackLink = Destination;
+  Destination->BackLink->ForwardLink = Destination;
+  InitializeListHead (Source);
+}
+
+/**
+  Re-inserts all the timer events of a list into the timer database,
+  relative to the current slot of the wheel.
+
+  @param  List                   The list of timer events
+
+**/
+VOID
+CoreRequeueTimerList (
+  IN LIST_ENTRY   *List
+  )
+{
+  LIST_ENTRY      Pending;
+  IEVENT          *Event;
+
+  CoreMoveTimerList (&Pending, List);
+  while (!IsListEmpty (&Pending)) {
+    Event = CR (Pending.ForwardLink, IEVENT, Timer.Link, EVENT_SIGNATURE);
+    CoreRemoveEventTimer (Event);
+    CoreInsertEventTimer (Event);
+  }
+}
+
+/**
+  Moves the timer events of the upper levels down the wheel when level 0 has
+  wrapped around.
+
+**/
+VOID
+CoreCascadeTimers (
   VOID
   )
 {
-  UINT64          SystemTime;
+  UINTN           Level;
+  UINTN           Index;
+
+  for (Level = 1; Level < TIMER_WHEEL_LEVELS; Level++) {
+    Index = (UINTN) RShiftU64 (mEfiTimerWheelSlot, Level * TIMER_WHEEL_LEVEL_BITS) & TIMER_WHEEL_SLOT_MASK;
+    CoreRequeueTimerList (&mEfiTimerWheel[Level][Index]);
+    if (Index != 0) {
+      return;
+    }
+  }
 
-  CoreAcquireLock (&mEfiSystemTimeLock);
-  SystemTime = mEfiSystemTime;
-  CoreReleaseLock (&mEfiSystemTimeLock);
+  CoreRequeueTimerList (&mEfiTimerOverflowList);
+}
 
-  return SystemTime;
+/**
+  Records how late a timer event is signaled in the timer latency histogram.
+
+  @param  Latency                The number of 100ns units elapsed since the
+                                 trigger time of the timer
+
+**/
+VOID
+CoreRecordTimerLatency (
+  IN UINT64   Latency
+  )
+{
+  UINTN       Bucket;
+
+  if (mEfiTimerLatencyHistogram == NULL) {
+    return;
+  }
+
+  Bucket = 0;
+  if (Latency != 0) {
+    Bucket = MIN ((UINTN) HighBitSet64 (Latency) + 1, EDKII_TIMER_LATENCY_HISTOGRAM_BUCKETS - 1);
+  }
+  mEfiTimerLatencyHistogram->Bucket[Bucket]++;
+  mEfiTimerLatencyHistogram->Samples++;
+  mEfiTimerLatencyHistogram->MaxLatency = MAX (mEfiTimerLatencyHistogram->MaxLatency, Latency);
 }
 
 /**
-  Checks the sorted timer list against the current system time.
-  Signals any expired event timer.
+  Signals the expired timer events of the current level 0 slot of the wheel.
 
-  @param  CheckEvent             Not used
-  @param  Context                Not used
+  @param  SystemTime             The current system time
 
 **/
 VOID
-EFIAPI
-CoreCheckTimers (
-  IN EFI_EVENT            CheckEvent,
-  IN VOID                 *Context
+CoreExpireTimerSlot (
+  IN UINT64   SystemTime
   )
 {
-  UINT64                  SystemTime;
-  IEVENT                  *Event;
+  LIST_ENTRY      *Slot;
+  LIST_ENTRY      Pending;
+  IEVENT          *Event;
 
-  //
-  // Check the timer database for expired timers
-  //
-  CoreAcquireLock (&mEfiTimerLock);
-  SystemTime = CoreCurrentSystemTime ();
+  Slot = &mEfiTimerWheel[0][(UINTN) mEfiTimerWheelSlot & TIMER_WHEEL_SLOT_MASK];
+  CoreMoveTimerList (&Pending, Slot);
 
-  while (!IsListEmpty (&mEfiTimerList)) {
-    Event = CR (mEfiTimerList.ForwardLink, IEVENT, Timer.Link, EVENT_SIGNATURE);
+  while (!IsListEmpty (&Pending)) {
+    Event = CR (Pending.ForwardLink, IEVENT, Timer.Link, EVENT_SIGNATURE);
 
     //
-    // If this timer is not expired, then we're done
+    // If this timer is not expired, then put it back in its slot
     //
     if (Event->Timer.TriggerTime > SystemTime) {
-      break;
+      RemoveEntryList (&Event->Timer.Link);
+      InsertTailList (Slot, &Event->Timer.Link);
+      continue;
     }
 
     //
     // Remove this timer from the timer queue
     //
-
-    RemoveEntryList (&Event->Timer.Link);
-    Event->Timer.Link.ForwardLink = NULL;
+    CoreRemoveEventTimer (Event);
+    CoreRecordTimerLatency (SystemTime - Event->Timer.TriggerTime);
 
     //
     // Signal it
@@ -150,6 +308,128 @@ CoreCheckTimers (
       CoreInsertEventTimer (Event);
     }
   }
+}
+
+/**
+  Advances the wheel towards a slot, skipping the empty level 0 slots, and
+  cascades the upper levels when level 0 wraps around.
+
+  @param  TargetSlot             The slot of the current system time
+
+**/
+VOID
+CoreAdvanceTimerWheel (
+  IN UINT64   TargetSlot
+  )
+{
+  UINTN       Index;
+  UINTN       Next;
+  UINT64      Slot;
+
+  if (mEfiTimerCount == 0) {
+    mEfiTimerWheelSlot = TargetSlot;
+    return;
+  }
+
+  Index = (UINTN) mEfiTimerWheelSlot & TIMER_WHEEL_SLOT_MASK;
+  Slot  = mEfiTimerWheelSlot + (TIMER_WHEEL_SLOTS - Index);
+  for (Next = Index + 1; Next < TIMER_WHEEL_SLOTS; Next++) {
+    if (!IsListEmpty (&mEfiTimerWheel[0][Next])) {
+      Slot = mEfiTimerWheelSlot + (Next - Index);
+      break;
+    }
+  }
+
+  mEfiTimerWheelSlot = MIN (Slot, TargetSlot);
+  if (((UINTN) mEfiTimerWheelSlot & TIMER_WHEEL_SLOT_MASK) == 0) {
+    CoreCascadeTimers ();
+  }
+}
+
+/**
+  Computes the earliest system time at which CoreTimerTick() needs to signal
+  the timer check event.
+
+**/
+VOID
+CoreUpdateNextTimerCheck (
+  VOID
+  )
+{
+  UINTN           Index;
+  UINTN           Next;
+  UINT64          NextCheck;
+  LIST_ENTRY      *Link;
+  IEVENT          *Event;
+
+  if (mEfiTimerCount == 0) {
+    CoreAcquireLock (&mEfiSystemTimeLock);
+    mEfiTimerNextCheck = MAX_UINT64;
+    CoreReleaseLock (&mEfiSystemTimeLock);
+    return;
+  }
+
+  //
+  // The upper levels may move timers down when level 0 wraps around
+  //
+  Index     = (UINTN) mEfiTimerWheelSlot & TIMER_WHEEL_SLOT_MASK;
+  NextCheck = LShiftU64 (mEfiTimerWheelSlot + (TIMER_WHEEL_SLOTS - Index), TIMER_WHEEL_SLOT_SHIFT);
+
+  for (Link = mEfiTimerWheel[0][Index].ForwardLink; Link != &mEfiTimerWheel[0][Index]; Link = Link->ForwardLink) {
+    Event     = CR (Link, IEVENT, Timer.Link, EVENT_SIGNATURE);
+    NextCheck = MIN (NextCheck, Event->Timer.TriggerTime);
+  }
+
+  for (Next = Index + 1; Next < TIMER_WHEEL_SLOTS; Next++) {
+    if (!IsListEmpty (&mEfiTimerWheel[0][Next])) {
+      NextCheck = MIN (NextCheck, LShiftU64 (mEfiTimerWheelSlot + (Next - Index), TIMER_WHEEL_SLOT_SHIFT));
+      break;
+    }
+  }
+
+  CoreAcquireLock (&mEfiSystemTimeLock);
+  mEfiTimerNextCheck = NextCheck;
+  CoreReleaseLock (&mEfiSystemTimeLock);
+}
+
+/**
+  Checks the timer wheel against the current system time.
+  Signals any expired event timer.
+
+  @param  CheckEvent             Not used
+  @param  Context                Not used
+
+**/
+VOID
+EFIAPI
+CoreCheckTimers (
+  IN EFI_EVENT            CheckEvent,
+  IN VOID                 *Context
+  )
+{
+  UINT64                  SystemTime;
+  UINT64                  SystemSlot;
+
+  //
+  // Check the timer database for expired timers
+  //
+  CoreAcquireLock (&mEfiTimerLock);
+  SystemTime = CoreCurrentSystemTime ();
+  SystemSlot = RShiftU64 (SystemTime, TIMER_WHEEL_SLOT_SHIFT);
+
+  //
+  // Process the slots up to the one of the current system time. The timers of
+  // the slots left behind all have a trigger time before SystemTime.
+  //
+  for (;;) {
+    CoreExpireTimerSlot (SystemTime);
+    if (mEfiTimerWheelSlot >= SystemSlot) {
+      break;
+    }
+    CoreAdvanceTimerWheel (SystemSlot);
+  }
+
+  CoreUpdateNextTimerCheck ();
 
   CoreReleaseLock (&mEfiTimerLock);
 }
@@ -165,6 +445,14 @@ CoreInitializeTimer (
   )
 {
   EFI_STATUS  Status;
+  UINTN       Level;
+  UINTN       Index;
+
+  for (Level = 0; Level < TIMER_WHEEL_LEVELS; Level++) {
+    for (Index = 0; Index < TIMER_WHEEL_SLOTS; Index++) {
+      InitializeListHead (&mEfiTimerWheel[Level][Index]);
+    }
+  }
 
   Status = CoreCreateEventInternal (
              EVT_NOTIFY_SIGNAL,
@@ -175,6 +463,16 @@ CoreInitializeTimer (
              &mEfiCheckTimerEvent
              );
   ASSERT_EFI_ERROR (Status);
+
+  if (FeaturePcdGet (PcdDxeTimerLatencyHistogram)) {
+    mEfiTimerLatencyHistogram = AllocateZeroPool (sizeof (EDKII_TIMER_LATENCY_HISTOGRAM));
+    if (mEfiTimerLatencyHistogram != NULL) {
+      mEfiTimerLatencyHistogram->Revision    = EDKII_TIMER_LATENCY_HISTOGRAM_REVISION;
+      mEfiTimerLatencyHistogram->BucketCount = EDKII_TIMER_LATENCY_HISTOGRAM_BUCKETS;
+      Status = CoreInstallConfigurationTable (&gEdkiiTimerLatencyHistogramGuid, mEfiTimerLatencyHistogram);
+      ASSERT_EFI_ERROR (Status);
+    }
+  }
 }
 
 
@@ -191,8 +489,6 @@ CoreTimerTick (
   IN UINT64   Duration
   )
 {
-  IEVENT          *Event;
-
   //
   // Check runtiem flag in case there are ticks while exiting boot services
   //
@@ -204,15 +500,11 @@ CoreTimerTick (
   mEfiSystemTime += Duration;
 
   //
-  // If the head of the list is expired, fire the timer event
+  // If a timer may have expired, fire the timer event
   // to process it
   //
-  if (!IsListEmpty (&mEfiTimerList)) {
-    Event = CR (mEfiTimerList.ForwardLink, IEVENT, Timer.Link, EVENT_SIGNATURE);
-
-    if (Event->Timer.TriggerTime <= mEfiSystemTime) {
-      CoreSignalEvent (mEfiCheckTimerEvent);
-    }
+  if (mEfiTimerNextCheck <= mEfiSystemTime) {
+    CoreSignalEvent (mEfiCheckTimerEvent);
   }
 
   CoreReleaseLock (&mEfiSystemTimeLock);
@@ -265,8 +557,7 @@ CoreSetTimer (
   // If the timer is queued to the timer database, remove it
   //
   if (Event->Timer.Link.ForwardLink != NULL) {
-    RemoveEntryList (&Event->Timer.Link);
-    Event->Timer.Link.ForwardLink = NULL;
+    CoreRemoveEventTimer (Event);
   }
 
   Event->Timer.TriggerTime = 0;
@@ -267,7 +267,7 @@ FreeFvDeviceResource (
       //
       // Close stream and free resources from SEP
       //
-      CloseSectionStream (FfsFileEntry->StreamHandle, FALSE);
+      FvCloseFileSectionStream (FfsFileEntry);
     }
 
     if (FfsFileEntry->FileCached) {
@@ -21,6 +21,12 @@ typedef struct {
   EFI_FFS_FILE_HEADER             *FfsHeader;
   UINTN                           StreamHandle;
   BOOLEAN                         FileCached;
+  //
+  // Memory held by the stream for the encapsulation sections extracted so
+  // far. The entry is in mFvStreamCacheList only if it is not 0.
+  //
+  UINTN                           StreamCacheSize;
+  LIST_ENTRY                      StreamCacheLink;
 } FFS_FILE_LIST_ENTRY;
 
 typedef struct {
@@ -399,4 +405,16 @@ IsValidFfsFile (
   IN EFI_FFS_FILE_HEADER  *FfsHeader
   );
 
+/**
+  Close the section stream of a file, and remove the file from the stream
+  cache.
+
+  @param  FfsEntry       The file whose section stream is closed.
+
+**/
+VOID
+FvCloseFileSectionStream (
+  IN FFS_FILE_LIST_ENTRY  *FfsEntry
+  );
+
 #endif
@@ -32,6 +32,18 @@ Required Alignment   Alignment Value in FFS   FFS_ATTRIB_DATA_ALIGNMENT2   Align
 UINT8 mFvAttributes[] = {0, 4, 7, 9, 10, 12, 15, 16};
 UINT8 mFvAttributes2[] = {17, 18, 19, 20, 21, 22, 23, 24};
 
+//
+// The section stream of a file is kept open after it is read, so that the
+// dispatcher and the image loader reading the depex, UI and PE32 sections
+// of the same file only decompress it once. The files whose streams hold
+// extracted encapsulation sections are kept in mFvStreamCacheList in least
+// recently used order, and their streams are closed when the total memory
+// they hold is over PcdFwVolDxeSectionStreamCacheSize. Streams that only
+// refer to the firmware volume itself hold no memory and stay open.
+//
+LIST_ENTRY  mFvStreamCacheList = INITIALIZE_LIST_HEAD_VARIABLE (mFvStreamCacheList);
+UINTN       mFvStreamCacheSize = 0;
+
 /**
   Convert the FFS File Attributes to FV File Attributes
 
@@ -64,6 +76,90 @@ FfsAttributes2FvFileAttributes (
   return FileAttribute;
 }
 
+/**
+  Remove a file from the stream cache list.
+
+  @param  FfsEntry       The file to be removed.
+
+**/
+VOID
+FvStreamCacheRemove (
+  IN FFS_FILE_LIST_ENTRY  *FfsEntry
+  )
+{
+  if (FfsEntry->StreamCacheSize != 0) {
+    RemoveEntryList (&FfsEntry->StreamCacheLink);
+    mFvStreamCacheSize -= FfsEntry->StreamCacheSize;
+    FfsEntry->StreamCacheSize = 0;
+  }
+}
+
+/**
+  Close the section stream of a file, and remove the file from the stream
+  cache.
+
+  @param  FfsEntry       The file whose section stream is closed.
+
+**/
+VOID
+FvCloseFileSectionStream (
+  IN FFS_FILE_LIST_ENTRY  *FfsEntry
+  )
+{
+  EFI_TPL  OldTpl;
+
+  OldTpl = CoreRaiseTpl (TPL_NOTIFY);
+  FvStreamCacheRemove (FfsEntry);
+  if (FfsEntry->StreamHandle != 0) {
+    CloseSectionStream (FfsEntry->StreamHandle, FALSE);
+    FfsEntry->StreamHandle = 0;
+  }
+  CoreRestoreTpl (OldTpl);
+}
+
+/**
+  Update the memory held by the section stream of a file which has just been
+  read, make it the most recently used file, and close the streams of the
+  least recently used files until the stream cache fits in MaxSize.
+
+  @param  FfsEntry       The file which has just been read.
+  @param  MaxSize        The maximum memory held by the stream cache.
+
+**/
+VOID
+FvStreamCacheUpdate (
+  IN FFS_FILE_LIST_ENTRY  *FfsEntry,
+  IN UINTN                MaxSize
+  )
+{
+  EFI_TPL              OldTpl;
+  FFS_FILE_LIST_ENTRY  *Victim;
+
+  OldTpl = CoreRaiseTpl (TPL_NOTIFY);
+
+  FvStreamCacheRemove (FfsEntry);
+  if (FfsEntry->StreamHandle != 0) {
+    FfsEntry->StreamCacheSize = GetSectionStreamCacheSize (FfsEntry->StreamHandle);
+    if (FfsEntry->StreamCacheSize != 0) {
+      InsertTailList (&mFvStreamCacheList, &FfsEntry->StreamCacheLink);
+      mFvStreamCacheSize += FfsEntry->StreamCacheSize;
+    }
+  }
+
+  while (mFvStreamCacheSize > MaxSize) {
+    Victim = BASE_CR (GetFirstNode (&mFvStreamCacheList), FFS_FILE_LIST_ENTRY, StreamCacheLink);
+    DEBUG ((
+      DEBUG_VERBOSE,
+      "FwVol: Close section stream of %g (0x%x bytes)\n",
+      &Victim->FfsHeader->Name,
+      Victim->StreamCacheSize
+      ));
+    FvCloseFileSectionStream (Victim);
+  }
+
+  CoreRestoreTpl (OldTpl);
+}
+
 /**
   Given the input key, search for the next matching file in the volume.
 
@@ -450,6 +546,7 @@ FvReadFileSection (
   UINTN                             FileSize;
   UINT8                             *FileBuffer;
   FFS_FILE_LIST_ENTRY               *FfsEntry;
+  UINTN                             Attempt;
 
   if (NameGuid == NULL || Buffer == NULL) {
     return EFI_INVALID_PARAMETER;
@@ -491,32 +588,51 @@ FvReadFileSection (
   }
 
   //
-  // Use FfsEntry to cache Section Extraction Protocol Information
+  // Use FfsEntry to cache Section Extraction Protocol Information. If the
+  // memory runs out, close the section streams of all the files and try once
+  // more.
   //
-  if (FfsEntry->StreamHandle == 0) {
-    Status = OpenSectionStream (
-               FileSize,
-               FileBuffer,
-               &FfsEntry->StreamHandle
+  for (Attempt = 0; Attempt < 2; Attempt++) {
+    if (Attempt > 0) {
+      if (Status != EFI_OUT_OF_RESOURCES || IsListEmpty (&mFvStreamCacheList)) {
+        break;
+      }
+      FvStreamCacheUpdate (FfsEntry, 0);
+    }
+
+    if (FfsEntry->StreamHandle == 0) {
+      Status = OpenSectionStream (
+                 FileSize,
+                 FileBuffer,
+                 &FfsEntry->StreamHandle
+                 );
+      if (EFI_ERROR (Status)) {
+        continue;
+      }
+    }
+
+    //
+    // If SectionType == 0 We need the whole section stream
+    //
+    Status = GetSection (
+               FfsEntry->StreamHandle,
+               (SectionType == 0) ? NULL : &SectionType,
+               NULL,
+               (SectionType == 0) ? 0 : SectionInstance,
+               Buffer,
+               BufferSize,
+               AuthenticationStatus,
+               FvDevice->IsFfs3Fv
                );
-    if (EFI_ERROR (Status)) {
-      goto Done;
+    if (Status != EFI_OUT_OF_RESOURCES) {
+      break;
     }
   }
 
   //
-  // If SectionType == 0 We need the whole section stream
+  // Account the sections extracted by this read in the stream cache.
   //
-  Status = GetSection (
-             FfsEntry->StreamHandle,
-             (SectionType == 0) ? NULL : &SectionType,
-             NULL,
-             (SectionType == 0) ? 0 : SectionInstance,
-             Buffer,
-             BufferSize,
-             AuthenticationStatus,
-             FvDevice->IsFfs3Fv
-             );
+  FvStreamCacheUpdate (FfsEntry, PcdGet32 (PcdFwVolDxeSectionStreamCacheSize));
 
   if (!EFI_ERROR (Status)) {
     //
@@ -526,7 +642,8 @@ FvReadFileSection (
   }
 
   //
-  // Close of stream defered to close of FfsHeader list to allow SEP to cache data
+  // Close of stream defered to close of FfsHeader list or eviction from the
+  // stream cache to allow SEP to cache data
   //
 
 Done:
@@ -534,3 +651,96 @@ Done:
 }
 
 
+/**
+  Open the section streams of a set of files and decode their encapsulation
+  sections ahead of time with PrefetchSectionStreams(), so that the later
+  ReadSection() calls of the dispatcher find them already decoded. The
+  streams are then accounted in the stream cache like the ones read by
+  FvReadFileSection().
+
+  Nothing is done for the firmware volumes not produced by this driver.
+
+  @param  Fv                     The firmware volume holding the files.
+  @param  NameGuids              The names of the files.
+  @param  FileCount              The number of files.
+
+**/
+VOID
+FvPrefetchFileSections (
+  IN EFI_FIRMWARE_VOLUME2_PROTOCOL  *Fv,
+  IN EFI_GUID                       *NameGuids,
+  IN UINTN                          FileCount
+  )
+{
+  EFI_STATUS                        Status;
+  FV_DEVICE                         *FvDevice;
+  EFI_FV_FILETYPE                   FileType;
+  EFI_FV_FILE_ATTRIBUTES            FileAttributes;
+  UINTN                             FileSize;
+  UINT8                             *FileBuffer;
+  UINT32                            AuthenticationStatus;
+  FFS_FILE_LIST_ENTRY               **FfsEntries;
+  UINTN                             *StreamHandles;
+  UINTN                             StreamCount;
+  UINTN                             Index;
+
+  if (Fv->ReadSection != FvReadFileSection || FileCount == 0) {
+    return;
+  }
+
+  FvDevice      = FV_DEVICE_FROM_THIS (Fv);
+  FfsEntries    = AllocatePool (FileCount * sizeof (FFS_FILE_LIST_ENTRY *));
+  StreamHandles = AllocatePool (FileCount * sizeof (UINTN));
+  if (FfsEntries == NULL || StreamHandles == NULL) {
+    goto Done;
+  }
+
+  StreamCount = 0;
+  for (Index = 0; Index < FileCount; Index++) {
+    Status = FvReadFile (
+              Fv,
+              &NameGuids[Index],
+              NULL,
+              &FileSize,
+              &FileType,
+              &FileAttributes,
+              &AuthenticationStatus
+              );
+    if (EFI_ERROR (Status) || FileType == EFI_FV_FILETYPE_RAW) {
+      continue;
+    }
+
+    FfsEntries[StreamCount] = (FFS_FILE_LIST_ENTRY *) FvDevice->LastKey;
+    if (FfsEntries[StreamCount]->StreamHandle == 0) {
+      if (IS_FFS_FILE2 (FfsEntries[StreamCount]->FfsHeader)) {
+        FileBuffer = ((UINT8 *) FfsEntries[StreamCount]->FfsHeader) + sizeof (EFI_FFS_FILE_HEADER2);
+      } else {
+        FileBuffer = ((UINT8 *) FfsEntries[StreamCount]->FfsHeader) + sizeof (EFI_FFS_FILE_HEADER);
+      }
+      Status = OpenSectionStream (
+                 FileSize,
+                 FileBuffer,
+                 &FfsEntries[StreamCount]->StreamHandle
+                 );
+      if (EFI_ERROR (Status)) {
+        continue;
+      }
+    }
+    StreamHandles[StreamCount] = FfsEntries[StreamCount]->StreamHandle;
+    StreamCount++;
+  }
+
+  PrefetchSectionStreams (StreamHandles, StreamCount);
+
+  for (Index = 0; Index < StreamCount; Index++) {
+    FvStreamCacheUpdate (FfsEntries[Index], PcdGet32 (PcdFwVolDxeSectionStreamCacheSize));
+  }
+
+Done:
+  if (FfsEntries != NULL) {
+    CoreFreePool (FfsEntries);
+  }
+  if (StreamHandles != NULL) {
+    CoreFreePool (StreamHandles);
+  }
+}
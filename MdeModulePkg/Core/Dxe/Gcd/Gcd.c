@@ -42,6 +42,10 @@ EFI_LOCK           mGcdMemorySpaceLock = EFI_INITIALIZE_LOCK_VARIABLE (TPL_NOTIF
 EFI_LOCK           mGcdIoSpaceLock     = EFI_INITIALIZE_LOCK_VARIABLE (TPL_NOTIFY);
 LIST_ENTRY         mGcdMemorySpaceMap  = INITIALIZE_LIST_HEAD_VARIABLE (mGcdMemorySpaceMap);
 LIST_ENTRY         mGcdIoSpaceMap      = INITIALIZE_LIST_HEAD_VARIABLE (mGcdIoSpaceMap);
+ADDRESS_TREE_NODE  *mGcdMemorySpaceMapTree = NULL;
+ADDRESS_TREE_NODE  *mGcdIoSpaceMapTree     = NULL;
+
+GCD_OPERATION_STATISTICS  mGcdOperationStatistics[GCD_OPERATION_STATISTICS_COUNT];
 
 EFI_GCD_MAP_ENTRY mGcdMemorySpaceMapEntryTemplate = {
   EFI_GCD_MAP_SIGNATURE,
@@ -56,7 +60,13 @@ EFI_GCD_MAP_ENTRY mGcdMemorySpaceMapEntryTemplate = {
   EfiGcdMemoryTypeNonExistent,
   (EFI_GCD_IO_TYPE) 0,
   NULL,
-  NULL
+  NULL,
+  {
+    NULL,
+    NULL,
+    NULL,
+    0
+  }
 };
 
 EFI_GCD_MAP_ENTRY mGcdIoSpaceMapEntryTemplate = {
@@ -72,7 +82,13 @@ EFI_GCD_MAP_ENTRY mGcdIoSpaceMapEntryTemplate = {
   (EFI_GCD_MEMORY_TYPE) 0,
   EfiGcdIoTypeNonExistent,
   NULL,
-  NULL
+  NULL,
+  {
+    NULL,
+    NULL,
+    NULL,
+    0
+  }
 };
 
 GCD_ATTRIBUTE_CONVERSION_ENTRY mAttributeConversionTable[] = {
@@ -128,6 +144,22 @@ GLOBAL_REMOVE_IF_UNREFERENCED CONST CHAR8 *mGcdAllocationTypeNames[] = {
   "Unknown                  "   // EfiGcdMaxAllocateType
 };
 
+///
+/// Lookup table used to print GCD Operations, indexed by GCD_OPERATION_INDEX()
+///
+GLOBAL_REMOVE_IF_UNREFERENCED CONST CHAR8 *mGcdOperationNames[] = {
+  "AddMemory            ",  // GCD_ADD_MEMORY_OPERATION
+  "AllocateMemory       ",  // GCD_ALLOCATE_MEMORY_OPERATION
+  "FreeMemory           ",  // GCD_FREE_MEMORY_OPERATION
+  "RemoveMemory         ",  // GCD_REMOVE_MEMORY_OPERATION
+  "SetMemoryAttributes  ",  // GCD_SET_ATTRIBUTES_MEMORY_OPERATION
+  "SetMemoryCapabilities",  // GCD_SET_CAPABILITIES_MEMORY_OPERATION
+  "AddIo                ",  // GCD_ADD_IO_OPERATION
+  "AllocateIo           ",  // GCD_ALLOCATE_IO_OPERATION
+  "FreeIo               ",  // GCD_FREE_IO_OPERATION
+  "RemoveIo             "   // GCD_REMOVE_IO_OPERATION
+};
+
 /**
   Dump the entire contents if the GCD Memory Space Map using DEBUG() macros when
   PcdDebugPrintErrorLevel has the DEBUG_GCD bit set.
@@ -361,6 +393,54 @@ PageAlignLength (
 // GCD Memory Space Worker Functions
 //
 
+/**
+  Get the root of the tree indexing a GCD map.
+
+  @param  Map                    The GCD map.
+
+  @return A pointer to the root of the tree of Map.
+
+**/
+ADDRESS_TREE_NODE **
+CoreGetGcdMapTree (
+  IN LIST_ENTRY  *Map
+  )
+{
+  if (Map == &mGcdIoSpaceMap) {
+    return &mGcdIoSpaceMapTree;
+  }
+  ASSERT (Map == &mGcdMemorySpaceMap);
+  return &mGcdMemorySpaceMapTree;
+}
+
+/**
+  Record a GCD operation in the GCD operation statistics.
+
+  The time spent is only measured when performance measurement is enabled, as
+  the platform may not provide a performance counter otherwise.
+
+  @param  Operation              The type of the operation.
+  @param  StartTicks             The performance counter at the start of the
+                                 operation.
+
+**/
+VOID
+CoreRecordGcdOperation (
+  IN UINTN   Operation,
+  IN UINT64  StartTicks
+  )
+{
+  GCD_OPERATION_STATISTICS  *Statistics;
+
+  ASSERT (GCD_OPERATION_INDEX (Operation) < GCD_OPERATION_STATISTICS_COUNT);
+
+  Statistics = &mGcdOperationStatistics[GCD_OPERATION_INDEX (Operation)];
+  Statistics->Count++;
+  if (PerformanceMeasurementEnabled ()) {
+    Statistics->Ticks += GetPerformanceCounter () - StartTicks;
+  }
+}
+
 /**
   Allocate pool for two entries.
 
@@ -411,6 +491,7 @@ CoreAllocateGcdMapEntry (
   @param  Length                 The length of the new range in bytes
   @param  TopEntry               Top pad entry to insert if needed.
   @param  BottomEntry            Bottom pad entry to insert if needed.
+  @param  Map                    The GCD map Link belongs to.
 
   @retval EFI_SUCCESS            The new range was inserted into the linked list
 
@@ -422,11 +503,16 @@ CoreInsertGcdMapEntry (
   IN EFI_PHYSICAL_ADDRESS  BaseAddress,
   IN UINT64                Length,
   IN EFI_GCD_MAP_ENTRY     *TopEntry,
-  IN EFI_GCD_MAP_ENTRY     *BottomEntry
+  IN EFI_GCD_MAP_ENTRY     *BottomEntry,
+  IN LIST_ENTRY            *Map
   )
 {
   ASSERT (Length != 0);
 
+  //
+  // Entry keeps its place in the tree, as its base address only moves up to
+  // the base address of the pad entry inserted above it.
+  //
   if (BaseAddress > Entry->BaseAddress) {
     ASSERT (BottomEntry->Signature == 0);
 
@@ -434,6 +520,7 @@ CoreInsertGcdMapEntry (
     Entry->BaseAddress      = BaseAddress;
     BottomEntry->EndAddress = BaseAddress - 1;
     InsertTailList (Link, &BottomEntry->Link);
+    CoreGcdMapTreeInsert (CoreGetGcdMapTree (Map), BottomEntry);
   }
 
   if ((BaseAddress + Length - 1) < Entry->EndAddress) {
@@ -443,6 +530,7 @@ CoreInsertGcdMapEntry (
     TopEntry->BaseAddress = BaseAddress + Length;
     Entry->EndAddress     = BaseAddress + Length - 1;
     InsertHeadList (Link, &TopEntry->Link);
+    CoreGcdMapTreeInsert (CoreGetGcdMapTree (Map), TopEntry);
   }
 
   return EFI_SUCCESS;
@@ -510,6 +598,7 @@ CoreMergeGcdMapEntry (
     return EFI_UNSUPPORTED;
   }
 
+  CoreGcdMapTreeRemove (CoreGetGcdMapTree (Map), AdjacentEntry);
   if (Forward) {
     Entry->EndAddress  = AdjacentEntry->EndAddress;
   } else {
@@ -587,31 +676,35 @@ CoreSearchGcdMapEntry (
   IN  LIST_ENTRY            *Map
   )
 {
-  LIST_ENTRY         *Link;
-  EFI_GCD_MAP_ENTRY  *Entry;
+  ADDRESS_TREE_NODE  *Root;
+  EFI_GCD_MAP_ENTRY  *StartEntry;
+  EFI_GCD_MAP_ENTRY  *EndEntry;
 
   ASSERT (Length != 0);
 
   *StartLink = NULL;
   *EndLink   = NULL;
 
-  Link = Map->ForwardLink;
-  while (Link != Map) {
-    Entry = CR (Link, EFI_GCD_MAP_ENTRY, Link, EFI_GCD_MAP_SIGNATURE);
-    if (BaseAddress >= Entry->BaseAddress && BaseAddress <= Entry->EndAddress) {
-      *StartLink = Link;
-    }
-    if (*StartLink != NULL) {
-      if ((BaseAddress + Length - 1) >= Entry->BaseAddress &&
-          (BaseAddress + Length - 1) <= Entry->EndAddress     ) {
-        *EndLink = Link;
-        return EFI_SUCCESS;
-      }
-    }
-    Link = Link->ForwardLink;
+  //
+  // A range wrapping around the end of the address space is never covered.
+  //
+  if ((BaseAddress + Length - 1) < BaseAddress) {
+    return EFI_NOT_FOUND;
   }
 
-  return EFI_NOT_FOUND;
+  Root       = *CoreGetGcdMapTree (Map);
+  StartEntry = CoreGcdMapTreeFind (Root, BaseAddress);
+  if (StartEntry == NULL) {
+    return EFI_NOT_FOUND;
+  }
+  EndEntry = CoreGcdMapTreeFind (Root, BaseAddress + Length - 1);
+  if (EndEntry == NULL) {
+    return EFI_NOT_FOUND;
+  }
+
+  *StartLink = &StartEntry->Link;
+  *EndLink   = &EndEntry->Link;
+  return EFI_SUCCESS;
 }
 
 
@@ -642,6 +735,56 @@ CoreCountGcdMapEntry (
 }
 
 
+/**
+  Dump the number of GCD operations of each kind and the time spent in them
+  using DEBUG() macros when PcdDebugPrintErrorLevel has the DEBUG_GCD bit set.
+
+**/
+VOID
+CoreDumpGcdStatistics (
+  VOID
+  )
+{
+  DEBUG_CODE (
+    UINT64  CounterStart;
+    UINT64  CounterEnd;
+    UINT64  Ticks;
+    UINTN   Index;
+
+    CounterStart = 0;
+    CounterEnd   = 0;
+    if (PerformanceMeasurementEnabled ()) {
+      GetPerformanceCounterProperties (&CounterStart, &CounterEnd);
+    }
+
+    DEBUG ((DEBUG_GCD, "GCD:Operation Statistics\n"));
+    DEBUG ((DEBUG_GCD, "Operation             Count            Time (us)       \n"));
+    DEBUG ((DEBUG_GCD, "===================== ================ ================\n"));
+    for (Index = 0; Index < GCD_OPERATION_STATISTICS_COUNT; Index++) {
+      //
+      // The ticks are accumulated as counter differences, so they are negated
+      // when the performance counter counts down.
+      //
+      Ticks = mGcdOperationStatistics[Index].Ticks;
+      if (CounterStart > CounterEnd) {
+        Ticks = 0 - Ticks;
+      }
+      DEBUG ((DEBUG_GCD, "%a %16ld %16ld\n",
+        mGcdOperationNames[Index],
+        mGcdOperationStatistics[Index].Count,
+        (Ticks == 0) ? 0 : DivU64x32 (GetTimeInNanoSecond (Ticks), 1000)
+        ));
+    }
+    CoreAcquireGcdMemoryLock ();
+    DEBUG ((DEBUG_GCD, "GCD:Memory Space Map Entries %ld\n", (UINT64) CoreCountGcdMapEntry (&mGcdMemorySpaceMap)));
+    CoreReleaseGcdMemoryLock ();
+    CoreAcquireGcdIoLock ();
+    DEBUG ((DEBUG_GCD, "GCD:I/O Space Map Entries    %ld\n\n", (UINT64) CoreCountGcdMapEntry (&mGcdIoSpaceMap)));
+    CoreReleaseGcdIoLock ();
+  );
+}
+
+
 
 /**
   Return the memory attribute specified by Attributes
@@ -722,12 +865,15 @@ CoreConvertSpace (
   LIST_ENTRY         *StartLink;
   LIST_ENTRY         *EndLink;
   UINT64             CpuArchAttributes;
+  UINT64             StartTicks;
 
   if (Length == 0) {
     DEBUG ((DEBUG_GCD, "  Status = %r\n", EFI_INVALID_PARAMETER));
     return EFI_INVALID_PARAMETER;
   }
 
+  StartTicks = PerformanceMeasurementEnabled () ? GetPerformanceCounter () : 0;
+
   Map = NULL;
   if ((Operation & GCD_MEMORY_SPACE_OPERATION) != 0) {
     CoreAcquireGcdMemoryLock ();
@@ -901,7 +1047,7 @@ CoreConvertSpace (
   Link = StartLink;
   while (Link != EndLink->ForwardLink) {
     Entry = CR (Link, EFI_GCD_MAP_ENTRY, Link, EFI_GCD_MAP_SIGNATURE);
-    CoreInsertGcdMapEntry (Link, Entry, BaseAddress, Length, TopEntry, BottomEntry);
+    CoreInsertGcdMapEntry (Link, Entry, BaseAddress, Length, TopEntry, BottomEntry, Map);
     switch (Operation) {
     //
     // Add operations
@@ -966,6 +1112,8 @@ CoreConvertSpace (
 Done:
   DEBUG ((DEBUG_GCD, "  Status = %r\n", Status));
 
+  CoreRecordGcdOperation (Operation, StartTicks);
+
   if ((Operation & GCD_MEMORY_SPACE_OPERATION) != 0) {
     CoreReleaseGcdMemoryLock ();
     CoreDumpGcdMemorySpaceMap (FALSE);
@@ -1066,6 +1214,7 @@ CoreAllocateSpace (
   LIST_ENTRY            *StartLink;
   LIST_ENTRY            *EndLink;
   BOOLEAN               Found;
+  UINT64                StartTicks;
 
   //
   // Make sure parameters are valid
@@ -1099,6 +1248,8 @@ CoreAllocateSpace (
     return EFI_INVALID_PARAMETER;
   }
 
+  StartTicks = PerformanceMeasurementEnabled () ? GetPerformanceCounter () : 0;
+
   Map = NULL;
   if ((Operation & GCD_MEMORY_SPACE_OPERATION) != 0) {
     CoreAcquireGcdMemoryLock ();
@@ -1263,7 +1414,7 @@ CoreAllocateSpace (
   Link = StartLink;
   while (Link != EndLink->ForwardLink) {
     Entry = CR (Link, EFI_GCD_MAP_ENTRY, Link, EFI_GCD_MAP_SIGNATURE);
-    CoreInsertGcdMapEntry (Link, Entry, *BaseAddress, Length, TopEntry, BottomEntry);
+    CoreInsertGcdMapEntry (Link, Entry, *BaseAddress, Length, TopEntry, BottomEntry, Map);
     Entry->ImageHandle  = ImageHandle;
     Entry->DeviceHandle = DeviceHandle;
     Link = Link->ForwardLink;
@@ -1281,6 +1432,8 @@ Done:
   }
   DEBUG ((DEBUG_GCD, "\n"));
 
+  CoreRecordGcdOperation (Operation, StartTicks);
+
   if ((Operation & GCD_MEMORY_SPACE_OPERATION) != 0) {
     CoreReleaseGcdMemoryLock ();
     CoreDumpGcdMemorySpaceMap (FALSE);
@@ -2483,6 +2636,7 @@ CoreInitializeGcdServices (
   Entry->EndAddress = LShiftU64 (1, SizeOfMemorySpace) - 1;
 
   InsertHeadList (&mGcdMemorySpaceMap, &Entry->Link);
+  CoreGcdMapTreeInsert (&mGcdMemorySpaceMapTree, Entry);
 
   CoreDumpGcdMemorySpaceMap (TRUE);
 
@@ -2495,6 +2649,7 @@ CoreInitializeGcdServices (
   Entry->EndAddress = LShiftU64 (1, SizeOfIoSpace) - 1;
 
   InsertHeadList (&mGcdIoSpaceMap, &Entry->Link);
+  CoreGcdMapTreeInsert (&mGcdIoSpaceMapTree, Entry);
 
   CoreDumpGcdIoSpaceMap (TRUE);
 
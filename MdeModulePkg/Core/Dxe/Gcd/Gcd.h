@@ -28,6 +28,23 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #define GCD_FREE_IO_OPERATION                  (GCD_IO_SPACE_OPERATION | 2)
 #define GCD_REMOVE_IO_OPERATION                (GCD_IO_SPACE_OPERATION | 3)
 
+//
+// Index of a GCD operation in the GCD operation statistics
+//
+#define GCD_OPERATION_INDEX(Operation)  \
+  ((((Operation) & GCD_IO_SPACE_OPERATION) != 0 ? 6 : 0) + ((Operation) & 0x0F))
+
+#define GCD_OPERATION_STATISTICS_COUNT         10
+
+//
+// The number of times a GCD operation was performed and the performance
+// counter ticks spent in it
+//
+typedef struct {
+  UINT64   Count;
+  UINT64   Ticks;
+} GCD_OPERATION_STATISTICS;
+
 //
 // The data structure used to convert from GCD attributes to EFI Memory Map attributes
 //
@@ -37,4 +54,46 @@ typedef struct {
   BOOLEAN  Memory;
 } GCD_ATTRIBUTE_CONVERSION_ENTRY;
 
+/**
+  Insert an entry in the tree of a GCD map.
+
+  @param  Root                   The root of the tree.
+  @param  Entry                  The entry to insert. It must not overlap any
+                                 entry of the tree.
+
+**/
+VOID
+CoreGcdMapTreeInsert (
+  IN OUT ADDRESS_TREE_NODE  **Root,
+  IN OUT EFI_GCD_MAP_ENTRY  *Entry
+  );
+
+/**
+  Remove an entry from the tree of a GCD map.
+
+  @param  Root                   The root of the tree.
+  @param  Entry                  The entry to remove.
+
+**/
+VOID
+CoreGcdMapTreeRemove (
+  IN OUT ADDRESS_TREE_NODE  **Root,
+  IN OUT EFI_GCD_MAP_ENTRY  *Entry
+  );
+
+/**
+  Find the entry of a GCD map which covers an address.
+
+  @param  Root                   The root of the tree.
+  @param  Address                The address.
+
+  @return The entry covering Address, or NULL if there is none.
+
+**/
+EFI_GCD_MAP_ENTRY *
+CoreGcdMapTreeFind (
+  IN ADDRESS_TREE_NODE     *Root,
+  IN EFI_PHYSICAL_ADDRESS  Address
+  );
+
 #endif
@@ -0,0 +1,79 @@
+/** @file
+  Balanced tree index of the GCD memory and I/O space maps.
+
+  The entries of a GCD map cover the whole address space without overlapping,
+  and are linked in the map list in the address order. They are also linked in
+  an AVL tree ordered by their base address, so that the entry covering an
+  address is found in O(log n) instead of walking the list. The balancing is
+  done by AddressTree.c, which is shared with the memory map.
+
+Copyright (c) 2021, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "DxeMain.h"
+#include "Gcd.h"
+
+CONST ADDRESS_TREE_LAYOUT  mGcdMapTreeLayout = ADDRESS_TREE_LAYOUT_INIT (
+                                                 EFI_GCD_MAP_ENTRY,
+                                                 TreeNode,
+                                                 BaseAddress,
+                                                 EndAddress,
+                                                 NULL
+                                                 );
+
+/**
+  Insert an entry in the tree of a GCD map.
+
+  @param  Root                   The root of the tree.
+  @param  Entry                  The entry to insert. It must not overlap any
+                                 entry of the tree.
+
+**/
+VOID
+CoreGcdMapTreeInsert (
+  IN OUT ADDRESS_TREE_NODE  **Root,
+  IN OUT EFI_GCD_MAP_ENTRY  *Entry
+  )
+{
+  AddressTreeInsert (&mGcdMapTreeLayout, Root, &Entry->TreeNode);
+}
+
+/**
+  Remove an entry from the tree of a GCD map.
+
+  @param  Root                   The root of the tree.
+  @param  Entry                  The entry to remove.
+
+**/
+VOID
+CoreGcdMapTreeRemove (
+  IN OUT ADDRESS_TREE_NODE  **Root,
+  IN OUT EFI_GCD_MAP_ENTRY  *Entry
+  )
+{
+  AddressTreeRemove (&mGcdMapTreeLayout, Root, &Entry->TreeNode);
+}
+
+/**
+  Find the entry of a GCD map which covers an address.
+
+  @param  Root                   The root of the tree.
+  @param  Address                The address.
+
+  @return The entry covering Address, or NULL if there is none.
+
+**/
+EFI_GCD_MAP_ENTRY *
+CoreGcdMapTreeFind (
+  IN ADDRESS_TREE_NODE     *Root,
+  IN EFI_PHYSICAL_ADDRESS  Address
+  )
+{
+  return ADDRESS_TREE_ENTRY (
+           AddressTreeFind (&mGcdMapTreeLayout, Root, Address),
+           EFI_GCD_MAP_ENTRY,
+           TreeNode
+           );
+}
@@ -21,6 +21,97 @@ LIST_ENTRY      gHandleList           = INITIALIZE_LIST_HEAD_VARIABLE (gHandleLi
 EFI_LOCK        gProtocolDatabaseLock = EFI_INITIALIZE_LOCK_VARIABLE (TPL_NOTIFY);
 UINT64          gHandleDatabaseKey    = 0;
 
+//
+// mHandleHashTable   - Buckets of IHANDLE hashed by handle address, used to
+//                      validate a handle without walking gHandleList.
+// mProtocolHashTable - Buckets of PROTOCOL_ENTRY hashed by protocol GUID, used
+//                      to find a protocol entry without walking mProtocolDatabase.
+// Both tables are protected by gProtocolDatabaseLock.
+//
+LIST_ENTRY      mHandleHashTable[HANDLE_HASH_BUCKET_COUNT];
+LIST_ENTRY      mProtocolHashTable[PROTOCOL_HASH_BUCKET_COUNT];
+BOOLEAN         mHandleDatabaseHashInitialized = FALSE;
+
+
+/**
+  Initialize the handle and protocol hash tables the first time they are used.
+
+**/
+VOID
+CoreInitializeHandleDatabaseHash (
+  VOID
+  )
+{
+  UINTN   Index;
+
+  if (mHandleDatabaseHashInitialized) {
+    return;
+  }
+
+  for (Index = 0; Index < HANDLE_HASH_BUCKET_COUNT; Index++) {
+    InitializeListHead (&mHandleHashTable[Index]);
+  }
+  for (Index = 0; Index < PROTOCOL_HASH_BUCKET_COUNT; Index++) {
+    InitializeListHead (&mProtocolHashTable[Index]);
+  }
+  mHandleDatabaseHashInitialized = TRUE;
+}
+
+
+/**
+  Get the hash bucket of a handle. The handle is never dereferenced, so any
+  pointer value may be passed in.
+
+  @param  UserHandle             The handle to hash.
+
+  @return The bucket in mHandleHashTable that UserHandle belongs to.
+
+**/
+LIST_ENTRY *
+CoreGetHandleHashBucket (
+  IN  EFI_HANDLE                UserHandle
+  )
+{
+  UINTN   Address;
+
+  CoreInitializeHandleDatabaseHash ();
+
+  //
+  // IHANDLE structures come from pool, so the low bits of the address carry
+  // no information. Fold the higher bits in to spread consecutive allocations.
+  //
+  Address = (UINTN) UserHandle >> 3;
+  Address ^= Address >> 10;
+  return &mHandleHashTable[Address & (HANDLE_HASH_BUCKET_COUNT - 1)];
+}
+
+
+/**
+  Get the hash bucket of a protocol GUID.
+
+  @param  Protocol               The ID of the protocol.
+
+  @return The bucket in mProtocolHashTable that Protocol belongs to.
+
+**/
+LIST_ENTRY *
+CoreGetProtocolHashBucket (
+  IN EFI_GUID   *Protocol
+  )
+{
+  UINT32  Hash;
+
+  CoreInitializeHandleDatabaseHash ();
+
+  Hash = ReadUnaligned32 ((UINT32 *) Protocol) ^
+         ReadUnaligned32 ((UINT32 *) Protocol + 1) ^
+         ReadUnaligned32 ((UINT32 *) Protocol + 2) ^
+         ReadUnaligned32 ((UINT32 *) Protocol + 3);
+  Hash ^= Hash >> 16;
+  Hash ^= Hash >> 8;
+  return &mProtocolHashTable[Hash & (PROTOCOL_HASH_BUCKET_COUNT - 1)];
+}
+
 
 
 /**
@@ -66,14 +157,20 @@ CoreValidateHandle (
   )
 {
   IHANDLE             *Handle;
+  LIST_ENTRY          *Bucket;
   LIST_ENTRY          *Link;
 
   if (UserHandle == NULL) {
     return EFI_INVALID_PARAMETER;
   }
 
-  for (Link = gHandleList.BackLink; Link != &gHandleList; Link = Link->BackLink) {
-    Handle = CR (Link, IHANDLE, AllHandles, EFI_HANDLE_SIGNATURE);
+  //
+  // Only the bucket that UserHandle hashes to is searched. UserHandle itself
+  // is not dereferenced until it is known to be in the handle database.
+  //
+  Bucket = CoreGetHandleHashBucket (UserHandle);
+  for (Link = Bucket->ForwardLink; Link != Bucket; Link = Link->ForwardLink) {
+    Handle = CR (Link, IHANDLE, HashLink, EFI_HANDLE_SIGNATURE);
     if (Handle == (IHANDLE *) UserHandle) {
       return EFI_SUCCESS;
     }
@@ -100,6 +197,7 @@ CoreFindProtocolEntry (
   IN BOOLEAN    Create
   )
 {
+  LIST_ENTRY          *Bucket;
   LIST_ENTRY          *Link;
   PROTOCOL_ENTRY      *Item;
   PROTOCOL_ENTRY      *ProtEntry;
@@ -107,15 +205,16 @@ CoreFindProtocolEntry (
   ASSERT_LOCKED(&gProtocolDatabaseLock);
 
   //
-  // Search the database for the matching GUID
+  // Search the hash bucket of the GUID for the matching GUID
   //
 
   ProtEntry = NULL;
-  for (Link = mProtocolDatabase.ForwardLink;
-       Link != &mProtocolDatabase;
+  Bucket    = CoreGetProtocolHashBucket (Protocol);
+  for (Link = Bucket->ForwardLink;
+       Link != Bucket;
        Link = Link->ForwardLink) {
 
-    Item = CR(Link, PROTOCOL_ENTRY, AllEntries, PROTOCOL_ENTRY_SIGNATURE);
+    Item = CR(Link, PROTOCOL_ENTRY, HashLink, PROTOCOL_ENTRY_SIGNATURE);
     if (CompareGuid (&Item->ProtocolID, Protocol)) {
 
       //
@@ -147,6 +246,7 @@ CoreFindProtocolEntry (
       // Add it to protocol database
       //
       InsertTailList (&mProtocolDatabase, &ProtEntry->AllEntries);
+      InsertHeadList (Bucket, &ProtEntry->HashLink);
     }
   }
 
@@ -427,6 +527,7 @@ CoreInstallProtocolInterfaceNotify (
     // in the system
     //
     InsertTailList (&gHandleList, &Handle->AllHandles);
+    InsertHeadList (CoreGetHandleHashBucket (Handle), &Handle->HashLink);
   } else {
     Status = CoreValidateHandle (Handle);
     if (EFI_ERROR (Status)) {
@@ -484,6 +585,10 @@ Done:
     // Return the new handle back to the caller
     //
     *UserHandle = Handle;
+
+    if (Notify) {
+      CoreNotifyDepexWaiters (Protocol);
+    }
   } else {
     //
     // There was an error, clean up
@@ -789,6 +894,7 @@ CoreUninstallProtocolInterface (
   if (IsListEmpty (&Handle->Protocols)) {
     Handle->Signature = 0;
     RemoveEntryList (&Handle->AllHandles);
+    RemoveEntryList (&Handle->HashLink);
     CoreFreePool (Handle);
   }
 
@@ -0,0 +1,389 @@
+/** @file
+  Balanced tree index of address ranges, shared by the memory map and the GCD
+  maps.
+
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Base.h>
+
+#include "AddressTree.h"
+
+/**
+  Get the start address of the entry of a node.
+
+  @param  Layout                 The layout of the entries of the tree.
+  @param  Node                   The node.
+
+  @return The start address of the entry.
+
+**/
+UINT64
+AddressTreeStart (
+  IN CONST ADDRESS_TREE_LAYOUT  *Layout,
+  IN ADDRESS_TREE_NODE          *Node
+  )
+{
+  return *(UINT64 *) ((UINT8 *) Node - Layout->NodeOffset + Layout->StartOffset);
+}
+
+/**
+  Get the end address of the entry of a node.
+
+  @param  Layout                 The layout of the entries of the tree.
+  @param  Node                   The node.
+
+  @return The end address of the entry.
+
+**/
+UINT64
+AddressTreeEnd (
+  IN CONST ADDRESS_TREE_LAYOUT  *Layout,
+  IN ADDRESS_TREE_NODE          *Node
+  )
+{
+  return *(UINT64 *) ((UINT8 *) Node - Layout->NodeOffset + Layout->EndOffset);
+}
+
+/**
+  Get the height of a subtree.
+
+  @param  Node                   The root of the subtree, or NULL.
+
+  @return The height of the subtree.
+
+**/
+UINTN
+AddressTreeHeight (
+  IN ADDRESS_TREE_NODE  *Node
+  )
+{
+  return (Node == NULL) ? 0 : Node->Height;
+}
+
+/**
+  Recompute the height and the data of the entry of a node from its children.
+
+  @param  Layout                 The layout of the entries of the tree.
+  @param  Node                   The node to update.
+
+**/
+VOID
+AddressTreeFixup (
+  IN     CONST ADDRESS_TREE_LAYOUT  *Layout,
+  IN OUT ADDRESS_TREE_NODE          *Node
+  )
+{
+  Node->Height = 1 + MAX (AddressTreeHeight (Node->Left), AddressTreeHeight (Node->Right));
+  if (Layout->Augment != NULL) {
+    Layout->Augment (Node);
+  }
+}
+
+/**
+  Replace a child of a node, or the root.
+
+  @param  Root                   The root of the tree.
+  @param  Parent                 The parent of the child, or NULL for the root.
+  @param  OldChild               The child to replace.
+  @param  NewChild               The new child, or NULL.
+
+**/
+VOID
+AddressTreeReplaceChild (
+  IN OUT ADDRESS_TREE_NODE  **Root,
+  IN     ADDRESS_TREE_NODE  *Parent,
+  IN     ADDRESS_TREE_NODE  *OldChild,
+  IN     ADDRESS_TREE_NODE  *NewChild
+  )
+{
+  if (Parent == NULL) {
+    *Root = NewChild;
+  } else if (Parent->Left == OldChild) {
+    Parent->Left = NewChild;
+  } else {
+    Parent->Right = NewChild;
+  }
+  if (NewChild != NULL) {
+    NewChild->Parent = Parent;
+  }
+}
+
+/**
+  Rotate a subtree to the left.
+
+  @param  Layout                 The layout of the entries of the tree.
+  @param  Root                   The root of the tree.
+  @param  Node                   The root of the subtree.
+
+  @return The new root of the subtree.
+
+**/
+ADDRESS_TREE_NODE *
+AddressTreeRotateLeft (
+  IN     CONST ADDRESS_TREE_LAYOUT  *Layout,
+  IN OUT ADDRESS_TREE_NODE          **Root,
+  IN     ADDRESS_TREE_NODE          *Node
+  )
+{
+  ADDRESS_TREE_NODE  *Pivot;
+
+  Pivot = Node->Right;
+  Node->Right = Pivot->Left;
+  if (Pivot->Left != NULL) {
+    Pivot->Left->Parent = Node;
+  }
+  AddressTreeReplaceChild (Root, Node->Parent, Node, Pivot);
+  Pivot->Left  = Node;
+  Node->Parent = Pivot;
+
+  AddressTreeFixup (Layout, Node);
+  AddressTreeFixup (Layout, Pivot);
+  return Pivot;
+}
+
+/**
+  Rotate a subtree to the right.
+
+  @param  Layout                 The layout of the entries of the tree.
+  @param  Root                   The root of the tree.
+  @param  Node                   The root of the subtree.
+
+  @return The new root of the subtree.
+
+**/
+ADDRESS_TREE_NODE *
+AddressTreeRotateRight (
+  IN     CONST ADDRESS_TREE_LAYOUT  *Layout,
+  IN OUT ADDRESS_TREE_NODE          **Root,
+  IN     ADDRESS_TREE_NODE          *Node
+  )
+{
+  ADDRESS_TREE_NODE  *Pivot;
+
+  Pivot = Node->Left;
+  Node->Left = Pivot->Right;
+  if (Pivot->Right != NULL) {
+    Pivot->Right->Parent = Node;
+  }
+  AddressTreeReplaceChild (Root, Node->Parent, Node, Pivot);
+  Pivot->Right = Node;
+  Node->Parent = Pivot;
+
+  AddressTreeFixup (Layout, Node);
+  AddressTreeFixup (Layout, Pivot);
+  return Pivot;
+}
+
+/**
+  Walk from a node up to the root, updating the nodes and rebalancing the
+  tree on the way.
+
+  @param  Layout                 The layout of the entries of the tree.
+  @param  Root                   The root of the tree.
+  @param  Node                   The lowest node that has changed, or NULL.
+
+**/
+VOID
+AddressTreeRebalance (
+  IN     CONST ADDRESS_TREE_LAYOUT  *Layout,
+  IN OUT ADDRESS_TREE_NODE          **Root,
+  IN     ADDRESS_TREE_NODE          *Node
+  )
+{
+  INTN  Balance;
+
+  while (Node != NULL) {
+    AddressTreeFixup (Layout, Node);
+    Balance = (INTN) AddressTreeHeight (Node->Left) - (INTN) AddressTreeHeight (Node->Right);
+    if (Balance > 1) {
+      if (AddressTreeHeight (Node->Left->Left) < AddressTreeHeight (Node->Left->Right)) {
+        AddressTreeRotateLeft (Layout, Root, Node->Left);
+      }
+      Node = AddressTreeRotateRight (Layout, Root, Node);
+    } else if (Balance < -1) {
+      if (AddressTreeHeight (Node->Right->Right) < AddressTreeHeight (Node->Right->Left)) {
+        AddressTreeRotateRight (Layout, Root, Node->Right);
+      }
+      Node = AddressTreeRotateLeft (Layout, Root, Node);
+    }
+    Node = Node->Parent;
+  }
+}
+
+/**
+  Insert a node in a tree.
+
+  @param  Layout                 The layout of the entries of the tree.
+  @param  Root                   The root of the tree.
+  @param  Node                   The node to insert. The range of its entry
+                                 must not overlap any entry of the tree.
+
+**/
+VOID
+AddressTreeInsert (
+  IN     CONST ADDRESS_TREE_LAYOUT  *Layout,
+  IN OUT ADDRESS_TREE_NODE          **Root,
+  IN OUT ADDRESS_TREE_NODE          *Node
+  )
+{
+  ADDRESS_TREE_NODE  *Parent;
+  ADDRESS_TREE_NODE  **Link;
+  UINT64             Start;
+
+  Start  = AddressTreeStart (Layout, Node);
+  Parent = NULL;
+  Link   = Root;
+  while (*Link != NULL) {
+    Parent = *Link;
+    Link   = (Start < AddressTreeStart (Layout, Parent)) ? &Parent->Left : &Parent->Right;
+  }
+
+  Node->Parent = Parent;
+  Node->Left   = NULL;
+  Node->Right  = NULL;
+  *Link = Node;
+
+  AddressTreeRebalance (Layout, Root, Node);
+}
+
+/**
+  Remove a node from a tree.
+
+  @param  Layout                 The layout of the entries of the tree.
+  @param  Root                   The root of the tree.
+  @param  Node                   The node to remove.
+
+**/
+VOID
+AddressTreeRemove (
+  IN     CONST ADDRESS_TREE_LAYOUT  *Layout,
+  IN OUT ADDRESS_TREE_NODE          **Root,
+  IN OUT ADDRESS_TREE_NODE          *Node
+  )
+{
+  ADDRESS_TREE_NODE  *Successor;
+  ADDRESS_TREE_NODE  *Changed;
+
+  if (Node->Left != NULL && Node->Right != NULL) {
+    //
+    // Move the successor of the node to its place.
+    //
+    Successor = Node->Right;
+    while (Successor->Left != NULL) {
+      Successor = Successor->Left;
+    }
+
+    if (Successor->Parent != Node) {
+      Changed = Successor->Parent;
+      AddressTreeReplaceChild (Root, Successor->Parent, Successor, Successor->Right);
+      Successor->Right = Node->Right;
+      Successor->Right->Parent = Successor;
+    } else {
+      Changed = Successor;
+    }
+    Successor->Left = Node->Left;
+    Successor->Left->Parent = Successor;
+    AddressTreeReplaceChild (Root, Node->Parent, Node, Successor);
+  } else {
+    Changed = Node->Parent;
+    AddressTreeReplaceChild (
+      Root,
+      Node->Parent,
+      Node,
+      (Node->Left != NULL) ? Node->Left : Node->Right
+      );
+  }
+
+  Node->Parent = NULL;
+  Node->Left   = NULL;
+  Node->Right  = NULL;
+
+  AddressTreeRebalance (Layout, Root, Changed);
+}
+
+/**
+  Update the tree after an entry has been changed in place. The entry must
+  keep its place in the address order, e.g. when it is clipped.
+
+  @param  Layout                 The layout of the entries of the tree.
+  @param  Node                   The node of the entry which has changed.
+
+**/
+VOID
+AddressTreeUpdate (
+  IN     CONST ADDRESS_TREE_LAYOUT  *Layout,
+  IN OUT ADDRESS_TREE_NODE          *Node
+  )
+{
+  if (Layout->Augment == NULL) {
+    return;
+  }
+
+  for (; Node != NULL; Node = Node->Parent) {
+    Layout->Augment (Node);
+  }
+}
+
+/**
+  Find the node whose entry covers an address.
+
+  @param  Layout                 The layout of the entries of the tree.
+  @param  Root                   The root of the tree.
+  @param  Address                The address.
+
+  @return The node covering Address, or NULL if there is none.
+
+**/
+ADDRESS_TREE_NODE *
+AddressTreeFind (
+  IN CONST ADDRESS_TREE_LAYOUT  *Layout,
+  IN ADDRESS_TREE_NODE          *Root,
+  IN UINT64                     Address
+  )
+{
+  ADDRESS_TREE_NODE  *Node;
+
+  Node = Root;
+  while (Node != NULL) {
+    if (Address < AddressTreeStart (Layout, Node)) {
+      Node = Node->Left;
+    } else if (Address > AddressTreeEnd (Layout, Node)) {
+      Node = Node->Right;
+    } else {
+      return Node;
+    }
+  }
+  return NULL;
+}
+
+/**
+  Get the node following a node in the address order.
+
+  @param  Node                   The node.
+
+  @return The next node, or NULL if Node is the last one.
+
+**/
+ADDRESS_TREE_NODE *
+AddressTreeNext (
+  IN ADDRESS_TREE_NODE  *Node
+  )
+{
+  ADDRESS_TREE_NODE  *Next;
+
+  if (Node->Right != NULL) {
+    Next = Node->Right;
+    while (Next->Left != NULL) {
+      Next = Next->Left;
+    }
+    return Next;
+  }
+
+  Next = Node;
+  while (Next->Parent != NULL && Next->Parent->Right == Next) {
+    Next = Next->Parent;
+  }
+  return Next->Parent;
+}
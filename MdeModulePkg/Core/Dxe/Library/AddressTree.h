@@ -0,0 +1,139 @@
+/** @file
+  Balanced tree index of address ranges.
+
+  The memory map and the GCD maps are lists of entries covering address ranges
+  which never overlap. Both also link their entries in an AVL tree ordered by
+  the start address, so that the entry covering an address is found in
+  O(log n). The tree nodes are embedded in the entries, as the maps cannot
+  allocate memory while they are being updated, and the start and end
+  addresses of a node are read from its entry at the offsets given by an
+  ADDRESS_TREE_LAYOUT.
+
+  This file only depends on the base types so that it can be built in a
+  host-based unit test.
+
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef _ADDRESS_TREE_H_
+#define _ADDRESS_TREE_H_
+
+typedef struct _ADDRESS_TREE_NODE ADDRESS_TREE_NODE;
+
+struct _ADDRESS_TREE_NODE {
+  ADDRESS_TREE_NODE   *Parent;
+  ADDRESS_TREE_NODE   *Left;
+  ADDRESS_TREE_NODE   *Right;
+  UINTN               Height;
+};
+
+/**
+  Recompute the data an entry keeps about its subtree, after the children of
+  its node or the entry itself have changed.
+
+  @param  Node                   The node of the entry.
+
+**/
+typedef
+VOID
+(*ADDRESS_TREE_AUGMENT) (
+  IN OUT ADDRESS_TREE_NODE  *Node
+  );
+
+///
+/// Where the node and the inclusive address range are in the entries of a
+/// tree.
+///
+typedef struct {
+  UINTN                 NodeOffset;
+  UINTN                 StartOffset;
+  UINTN                 EndOffset;
+  ///
+  /// Optional, called on every node whose subtree has changed.
+  ///
+  ADDRESS_TREE_AUGMENT  Augment;
+} ADDRESS_TREE_LAYOUT;
+
+#define ADDRESS_TREE_LAYOUT_INIT(Type, NodeField, StartField, EndField, Augment) \
+  { OFFSET_OF (Type, NodeField), OFFSET_OF (Type, StartField), OFFSET_OF (Type, EndField), Augment }
+
+#define ADDRESS_TREE_ENTRY(Node, Type, NodeField) \
+  (((Node) == NULL) ? NULL : BASE_CR (Node, Type, NodeField))
+
+/**
+  Insert a node in a tree.
+
+  @param  Layout                 The layout of the entries of the tree.
+  @param  Root                   The root of the tree.
+  @param  Node                   The node to insert. The range of its entry
+                                 must not overlap any entry of the tree.
+
+**/
+VOID
+AddressTreeInsert (
+  IN     CONST ADDRESS_TREE_LAYOUT  *Layout,
+  IN OUT ADDRESS_TREE_NODE          **Root,
+  IN OUT ADDRESS_TREE_NODE          *Node
+  );
+
+/**
+  Remove a node from a tree.
+
+  @param  Layout                 The layout of the entries of the tree.
+  @param  Root                   The root of the tree.
+  @param  Node                   The node to remove.
+
+**/
+VOID
+AddressTreeRemove (
+  IN     CONST ADDRESS_TREE_LAYOUT  *Layout,
+  IN OUT ADDRESS_TREE_NODE          **Root,
+  IN OUT ADDRESS_TREE_NODE          *Node
+  );
+
+/**
+  Update the tree after an entry has been changed in place. The entry must
+  keep its place in the address order, e.g. when it is clipped.
+
+  @param  Layout                 The layout of the entries of the tree.
+  @param  Node                   The node of the entry which has changed.
+
+**/
+VOID
+AddressTreeUpdate (
+  IN     CONST ADDRESS_TREE_LAYOUT  *Layout,
+  IN OUT ADDRESS_TREE_NODE          *Node
+  );
+
+/**
+  Find the node whose entry covers an address.
+
+  @param  Layout                 The layout of the entries of the tree.
+  @param  Root                   The root of the tree.
+  @param  Address                The address.
+
+  @return The node covering Address, or NULL if there is none.
+
+**/
+ADDRESS_TREE_NODE *
+AddressTreeFind (
+  IN CONST ADDRESS_TREE_LAYOUT  *Layout,
+  IN ADDRESS_TREE_NODE          *Root,
+  IN UINT64                     Address
+  );
+
+/**
+  Get the node following a node in the address order.
+
+  @param  Node                   The node.
+
+  @return The next node, or NULL if Node is the last one.
+
+**/
+ADDRESS_TREE_NODE *
+AddressTreeNext (
+  IN ADDRESS_TREE_NODE  *Node
+  );
+
+#endif
@@ -9,6 +9,8 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #ifndef _IMEM_H_
 #define _IMEM_H_
 
+#include "../Library/AddressTree.h"
+
 //
 // +---------------------------------------------------+
 // | 0..(EfiMaxMemoryType - 1)    - Normal memory type |
@@ -30,7 +32,7 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 //
 
 #define MEMORY_MAP_SIGNATURE   SIGNATURE_32('m','m','a','p')
-typedef struct {
+typedef struct _MEMORY_MAP {
   UINTN           Signature;
   LIST_ENTRY      Link;
   BOOLEAN         FromPages;
@@ -41,8 +43,17 @@ typedef struct {
 
   UINT64          VirtualStart;
   UINT64          Attribute;
+
+  //
+  // Node in gMemoryMapTree, ordered by Start, and the size of the largest
+  // free descriptor in its subtree
+  //
+  ADDRESS_TREE_NODE   TreeNode;
+  UINT64              TreeMaxFreeBytes;
 } MEMORY_MAP;
 
+#define MEMORY_MAP_FROM_TREE_NODE(Node)  ADDRESS_TREE_ENTRY (Node, MEMORY_MAP, TreeNode)
+
 //
 // Internal prototypes
 //
@@ -172,11 +183,98 @@ CoreInternalAllocatePages (
   IN BOOLEAN                NeedGuard
   );
 
+/**
+  Insert a descriptor in the tree.
+
+  @param  Root                   The root of the tree.
+  @param  Entry                  The descriptor to insert. It must not overlap
+                                 any descriptor of the tree.
+
+**/
+VOID
+MemoryMapTreeInsert (
+  IN OUT ADDRESS_TREE_NODE  **Root,
+  IN OUT MEMORY_MAP         *Entry
+  );
+
+/**
+  Remove a descriptor from the tree.
+
+  @param  Root                   The root of the tree.
+  @param  Entry                  The descriptor to remove.
+
+**/
+VOID
+MemoryMapTreeRemove (
+  IN OUT ADDRESS_TREE_NODE  **Root,
+  IN OUT MEMORY_MAP         *Entry
+  );
+
+/**
+  Update the tree after the type or the bounds of a descriptor have been
+  changed in place. The descriptor must keep its place in the address order,
+  e.g. when it is clipped.
+
+  @param  Entry                  The descriptor which has changed.
+
+**/
+VOID
+MemoryMapTreeUpdate (
+  IN OUT MEMORY_MAP   *Entry
+  );
+
+/**
+  Find the descriptor which covers an address.
+
+  @param  Root                   The root of the tree.
+  @param  Address                The address.
+
+  @return The descriptor covering Address, or NULL if there is none.
+
+**/
+MEMORY_MAP *
+MemoryMapTreeFind (
+  IN ADDRESS_TREE_NODE      *Root,
+  IN EFI_PHYSICAL_ADDRESS   Address
+  );
+
+/**
+  Get the descriptor following a descriptor in the address order.
+
+  @param  Entry                  The descriptor.
+
+  @return The next descriptor, or NULL if Entry is the last one.
+
+**/
+MEMORY_MAP *
+MemoryMapTreeNext (
+  IN MEMORY_MAP   *Entry
+  );
+
+/**
+  Find the free descriptor with the highest start address not above a limit,
+  among the free descriptors of at least a given size.
+
+  @param  Root                   The root of the tree.
+  @param  MaxStart               The highest start address accepted.
+  @param  MinBytes               The smallest size accepted.
+
+  @return The free descriptor found, or NULL if there is none.
+
+**/
+MEMORY_MAP *
+MemoryMapTreeFindLastFree (
+  IN ADDRESS_TREE_NODE      *Root,
+  IN EFI_PHYSICAL_ADDRESS   MaxStart,
+  IN UINT64                 MinBytes
+  );
+
 //
 // Internal Global data
 //
 
 extern EFI_LOCK           gMemoryLock;
 extern LIST_ENTRY         gMemoryMap;
+extern ADDRESS_TREE_NODE  *gMemoryMapTree;
 extern LIST_ENTRY         mGcdMemorySpaceMap;
 #endif
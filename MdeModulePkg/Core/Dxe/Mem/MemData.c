@@ -7,6 +7,7 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 **/
 
 #include "DxeMain.h"
+#include "Imem.h"
 
 
 //
@@ -18,3 +19,8 @@ EFI_LOCK          gMemoryLock = EFI_INITIALIZE_LOCK_VARIABLE (TPL_NOTIFY);
 // MemoryMap - the current memory map
 //
 LIST_ENTRY        gMemoryMap  = INITIALIZE_LIST_HEAD_VARIABLE (gMemoryMap);
+
+//
+// MemoryMapTree - the descriptors of gMemoryMap indexed by address
+//
+ADDRESS_TREE_NODE *gMemoryMapTree = NULL;
@@ -0,0 +1,217 @@
+/** @file
+  Balanced tree index of the memory map descriptors.
+
+  The descriptors of gMemoryMap are also linked in an AVL tree ordered by
+  their start address. The descriptors never overlap, so the tree gives the
+  descriptor covering an address, and the neighbours of a descriptor, in
+  O(log n). Each node also records the size of the largest free descriptor in
+  its subtree, so that the search for free pages skips the subtrees which
+  cannot satisfy the request.
+
+  The balancing is done by AddressTree.c, which is shared with the GCD maps.
+  This file only depends on Imem.h so that it can be built in a host-based
+  unit test.
+
+Copyright (c) 2021, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Uefi.h>
+#include <Library/BaseLib.h>
+#include <Library/UefiLib.h>
+
+#include "Imem.h"
+
+/**
+  Get the number of free bytes of a descriptor.
+
+  @param  Entry                  The descriptor.
+
+  @return The size of the descriptor if it is EfiConventionalMemory, or 0.
+
+**/
+UINT64
+MemoryMapTreeFreeBytes (
+  IN MEMORY_MAP   *Entry
+  )
+{
+  if (Entry->Type != EfiConventionalMemory || Entry->End < Entry->Start) {
+    return 0;
+  }
+  return Entry->End - Entry->Start + 1;
+}
+
+/**
+  Get the size of the largest free descriptor of a subtree.
+
+  @param  Node                   The root of the subtree, or NULL.
+
+  @return The size of the largest free descriptor of the subtree.
+
+**/
+UINT64
+MemoryMapTreeMaxFreeBytes (
+  IN ADDRESS_TREE_NODE  *Node
+  )
+{
+  return (Node == NULL) ? 0 : MEMORY_MAP_FROM_TREE_NODE (Node)->TreeMaxFreeBytes;
+}
+
+/**
+  Recompute the largest free size of a node from its children.
+
+  @param  Node                   The node to update.
+
+**/
+VOID
+MemoryMapTreeAugment (
+  IN OUT ADDRESS_TREE_NODE  *Node
+  )
+{
+  MEMORY_MAP  *Entry;
+
+  Entry = MEMORY_MAP_FROM_TREE_NODE (Node);
+  Entry->TreeMaxFreeBytes = MAX (
+                              MemoryMapTreeFreeBytes (Entry),
+                              MAX (
+                                MemoryMapTreeMaxFreeBytes (Node->Left),
+                                MemoryMapTreeMaxFreeBytes (Node->Right)
+                                )
+                              );
+}
+
+CONST ADDRESS_TREE_LAYOUT  mMemoryMapTreeLayout = ADDRESS_TREE_LAYOUT_INIT (
+                                                    MEMORY_MAP,
+                                                    TreeNode,
+                                                    Start,
+                                                    End,
+                                                    MemoryMapTreeAugment
+                                                    );
+
+/**
+  Insert a descriptor in the tree.
+
+  @param  Root                   The root of the tree.
+  @param  Entry                  The descriptor to insert. It must not overlap
+                                 any descriptor of the tree.
+
+**/
+VOID
+MemoryMapTreeInsert (
+  IN OUT ADDRESS_TREE_NODE  **Root,
+  IN OUT MEMORY_MAP         *Entry
+  )
+{
+  AddressTreeInsert (&mMemoryMapTreeLayout, Root, &Entry->TreeNode);
+}
+
+/**
+  Remove a descriptor from the tree.
+
+  @param  Root                   The root of the tree.
+  @param  Entry                  The descriptor to remove.
+
+**/
+VOID
+MemoryMapTreeRemove (
+  IN OUT ADDRESS_TREE_NODE  **Root,
+  IN OUT MEMORY_MAP         *Entry
+  )
+{
+  AddressTreeRemove (&mMemoryMapTreeLayout, Root, &Entry->TreeNode);
+}
+
+/**
+  Update the tree after the type or the bounds of a descriptor have been
+  changed in place. The descriptor must keep its place in the address order,
+  e.g. when it is clipped.
+
+  @param  Entry                  The descriptor which has changed.
+
+**/
+VOID
+MemoryMapTreeUpdate (
+  IN OUT MEMORY_MAP   *Entry
+  )
+{
+  AddressTreeUpdate (&mMemoryMapTreeLayout, &Entry->TreeNode);
+}
+
+/**
+  Find the descriptor which covers an address.
+
+  @param  Root                   The root of the tree.
+  @param  Address                The address.
+
+  @return The descriptor covering Address, or NULL if there is none.
+
+**/
+MEMORY_MAP *
+MemoryMapTreeFind (
+  IN ADDRESS_TREE_NODE      *Root,
+  IN EFI_PHYSICAL_ADDRESS   Address
+  )
+{
+  return MEMORY_MAP_FROM_TREE_NODE (AddressTreeFind (&mMemoryMapTreeLayout, Root, Address));
+}
+
+/**
+  Get the descriptor following a descriptor in the address order.
+
+  @param  Entry                  The descriptor.
+
+  @return The next descriptor, or NULL if Entry is the last one.
+
+**/
+MEMORY_MAP *
+MemoryMapTreeNext (
+  IN MEMORY_MAP   *Entry
+  )
+{
+  return MEMORY_MAP_FROM_TREE_NODE (AddressTreeNext (&Entry->TreeNode));
+}
+
+/**
+  Find the free descriptor with the highest start address not above a limit,
+  among the free descriptors of at least a given size.
+
+  @param  Root                   The root of the tree.
+  @param  MaxStart               The highest start address accepted.
+  @param  MinBytes               The smallest size accepted.
+
+  @return The free descriptor found, or NULL if there is none.
+
+**/
+MEMORY_MAP *
+MemoryMapTreeFindLastFree (
+  IN ADDRESS_TREE_NODE      *Root,
+  IN EFI_PHYSICAL_ADDRESS   MaxStart,
+  IN UINT64                 MinBytes
+  )
+{
+  MEMORY_MAP  *Entry;
+  MEMORY_MAP  *Found;
+
+  if (MemoryMapTreeMaxFreeBytes (Root) < MinBytes || MinBytes == 0) {
+    return NULL;
+  }
+
+  Entry = MEMORY_MAP_FROM_TREE_NODE (Root);
+  if (Entry->Start > MaxStart) {
+    return MemoryMapTreeFindLastFree (Root->Left, MaxStart, MinBytes);
+  }
+
+  //
+  // The subtrees left of a node below MaxStart only need to be pruned by size,
+  // so the search does not backtrack more than once per level.
+  //
+  Found = MemoryMapTreeFindLastFree (Root->Right, MaxStart, MinBytes);
+  if (Found != NULL) {
+    return Found;
+  }
+  if (MemoryMapTreeFreeBytes (Entry) >= MinBytes) {
+    return Entry;
+  }
+  return MemoryMapTreeFindLastFree (Root->Left, MaxStart, MinBytes);
+}
@@ -132,6 +132,7 @@ RemoveMemoryMapEntry (
   IN OUT MEMORY_MAP      *Entry
   )
 {
+  MemoryMapTreeRemove (&gMemoryMapTree, Entry);
   RemoveEntryList (&Entry->Link);
   Entry->Link.ForwardLink = NULL;
 
@@ -163,7 +164,6 @@ CoreAddRange (
   IN UINT64                   Attribute
   )
 {
-  LIST_ENTRY        *Link;
   MEMORY_MAP        *Entry;
 
   ASSERT ((Start & EFI_PAGE_MASK) == 0);
@@ -212,29 +212,16 @@ CoreAddRange (
   // and the same Attribute
   //
 
-  Link = gMemoryMap.ForwardLink;
-  while (Link != &gMemoryMap) {
-    Entry = CR (Link, MEMORY_MAP, Link, MEMORY_MAP_SIGNATURE);
-    Link  = Link->ForwardLink;
-
-    if (Entry->Type != Type) {
-      continue;
-    }
-
-    if (Entry->Attribute != Attribute) {
-      continue;
-    }
-
-    if (Entry->End + 1 == Start) {
-
-      Start = Entry->Start;
-      RemoveMemoryMapEntry (Entry);
-
-    } else if (Entry->Start == End + 1) {
+  Entry = (Start == 0) ? NULL : MemoryMapTreeFind (gMemoryMapTree, Start - 1);
+  if (Entry != NULL && Entry->Type == Type && Entry->Attribute == Attribute && Entry->End + 1 == Start) {
+    Start = Entry->Start;
+    RemoveMemoryMapEntry (Entry);
+  }
 
-      End = Entry->End;
-      RemoveMemoryMapEntry (Entry);
-    }
+  Entry = (End == MAX_UINT64) ? NULL : MemoryMapTreeFind (gMemoryMapTree, End + 1);
+  if (Entry != NULL && Entry->Type == Type && Entry->Attribute == Attribute && Entry->Start == End + 1) {
+    End = Entry->End;
+    RemoveMemoryMapEntry (Entry);
   }
 
   //
@@ -249,6 +236,7 @@ CoreAddRange (
   mMapStack[mMapDepth].VirtualStart  = 0;
   mMapStack[mMapDepth].Attribute     = Attribute;
   InsertTailList (&gMemoryMap, &mMapStack[mMapDepth].Link);
+  MemoryMapTreeInsert (&gMemoryMapTree, &mMapStack[mMapDepth]);
 
   mMapDepth += 1;
   ASSERT (mMapDepth < MAX_MAP_DEPTH);
@@ -322,7 +310,6 @@ CoreFreeMemoryMapStack (
 {
   MEMORY_MAP      *Entry;
   MEMORY_MAP      *Entry2;
-  LIST_ENTRY      *Link2;
 
   ASSERT_LOCKED (&gMemoryLock);
 
@@ -356,23 +343,24 @@ CoreFreeMemoryMapStack (
       //
       // Move this entry to general memory
       //
+      MemoryMapTreeRemove (&gMemoryMapTree, &mMapStack[mMapDepth]);
       RemoveEntryList (&mMapStack[mMapDepth].Link);
       mMapStack[mMapDepth].Link.ForwardLink = NULL;
 
       CopyMem (Entry , &mMapStack[mMapDepth], sizeof (MEMORY_MAP));
       Entry->FromPages = TRUE;
+      MemoryMapTreeInsert (&gMemoryMapTree, Entry);
 
       //
-      // Find insertion location
+      // Find insertion location. The entries from pages are kept sorted in the
+      // list, so it is in front of the next one of them in the address order.
       //
-      for (Link2 = gMemoryMap.ForwardLink; Link2 != &gMemoryMap; Link2 = Link2->ForwardLink) {
-        Entry2 = CR (Link2, MEMORY_MAP, Link, MEMORY_MAP_SIGNATURE);
-        if (Entry2->FromPages && Entry2->Start > Entry->Start) {
-          break;
-        }
+      Entry2 = MemoryMapTreeNext (Entry);
+      while (Entry2 != NULL && !Entry2->FromPages) {
+        Entry2 = MemoryMapTreeNext (Entry2);
       }
 
-      InsertTailList (Link2, &Entry->Link);
+      InsertTailList ((Entry2 != NULL) ? &Entry2->Link : &gMemoryMap, &Entry->Link);
 
     } else {
       //
@@ -736,7 +724,6 @@ CoreConvertPagesEx (
   UINT64          RangeEnd;
   UINT64          Attribute;
   EFI_MEMORY_TYPE MemType;
-  LIST_ENTRY      *Link;
   MEMORY_MAP      *Entry;
 
   Entry = NULL;
@@ -762,15 +749,8 @@ CoreConvertPagesEx (
     //
     // Find the entry that the covers the range
     //
-    for (Link = gMemoryMap.ForwardLink; Link != &gMemoryMap; Link = Link->ForwardLink) {
-      Entry = CR (Link, MEMORY_MAP, Link, MEMORY_MAP_SIGNATURE);
-
-      if (Entry->Start <= Start && Entry->End > Start) {
-        break;
-      }
-    }
-
-    if (Link == &gMemoryMap) {
+    Entry = MemoryMapTreeFind (gMemoryMapTree, Start);
+    if (Entry == NULL || Entry->End == Start) {
       DEBUG ((DEBUG_ERROR | DEBUG_PAGE, "ConvertPages: failed to find range %lx - %lx\n", Start, End));
       return EFI_NOT_FOUND;
     }
@@ -852,6 +832,7 @@ CoreConvertPagesEx (
       // Clip start
       //
       Entry->Start = RangeEnd + 1;
+      MemoryMapTreeUpdate (Entry);
 
     } else if (Entry->End == RangeEnd) {
 
@@ -859,6 +840,7 @@ CoreConvertPagesEx (
       // Clip end
       //
       Entry->End = Start - 1;
+      MemoryMapTreeUpdate (Entry);
 
     } else {
 
@@ -882,9 +864,11 @@ CoreConvertPagesEx (
 
       Entry->End = Start - 1;
       ASSERT (Entry->Start < Entry->End);
+      MemoryMapTreeUpdate (Entry);
 
       Entry = &mMapStack[mMapDepth];
       InsertTailList (&gMemoryMap, &Entry->Link);
+      MemoryMapTreeInsert (&gMemoryMapTree, Entry);
 
       mMapDepth += 1;
       ASSERT (mMapDepth < MAX_MAP_DEPTH);
@@ -1038,7 +1022,6 @@ CoreFindFreePagesI (
   UINT64          DescStart;
   UINT64          DescEnd;
   UINT64          DescNumberOfBytes;
-  LIST_ENTRY      *Link;
   MEMORY_MAP      *Entry;
 
   if ((MaxAddress < EFI_PAGE_MASK) ||(NumberOfPages == 0)) {
@@ -1070,24 +1053,23 @@ CoreFindFreePagesI (
   NumberOfBytes = LShiftU64 (NumberOfPages, EFI_PAGE_SHIFT);
   Target = 0;
 
-  for (Link = gMemoryMap.ForwardLink; Link != &gMemoryMap; Link = Link->ForwardLink) {
-    Entry = CR (Link, MEMORY_MAP, Link, MEMORY_MAP_SIGNATURE);
-
-    //
-    // If it's not a free entry, don't bother with it
-    //
-    if (Entry->Type != EfiConventionalMemory) {
-      continue;
-    }
+  //
+  // Walk the free entries large enough from the highest address down. The
+  // entries do not overlap, so the first one that fits gives the highest
+  // target.
+  //
+  for (Entry = MemoryMapTreeFindLastFree (gMemoryMapTree, MaxAddress - 1, NumberOfBytes);
+       Entry != NULL;
+       Entry = (Entry->Start == 0) ? NULL : MemoryMapTreeFindLastFree (gMemoryMapTree, Entry->Start - 1, NumberOfBytes)) {
 
     DescStart = Entry->Start;
     DescEnd = Entry->End;
 
     //
-    // If desc is past max allowed address or below min allowed address, skip it
+    // If desc is below min allowed address, so are all the next ones
     //
-    if ((DescStart >= MaxAddress) || (DescEnd < MinAddress)) {
-      continue;
+    if (DescEnd < MinAddress) {
+      break;
     }
 
     //
@@ -1134,6 +1116,7 @@ CoreFindFreePagesI (
         }
 
         Target = DescEnd;
+        break;
       }
     }
   }
@@ -1477,7 +1460,6 @@ CoreInternalFreePages (
   )
 {
   EFI_STATUS      Status;
-  LIST_ENTRY      *Link;
   MEMORY_MAP      *Entry;
   UINTN           Alignment;
   BOOLEAN         IsGuarded;
@@ -1491,14 +1473,8 @@ CoreInternalFreePages (
   // Find the entry that the covers the range
   //
   IsGuarded = FALSE;
-  Entry = NULL;
-  for (Link = gMemoryMap.ForwardLink; Link != &gMemoryMap; Link = Link->ForwardLink) {
-    Entry = CR(Link, MEMORY_MAP, Link, MEMORY_MAP_SIGNATURE);
-    if (Entry->Start <= Memory && Entry->End > Memory) {
-        break;
-    }
-  }
-  if (Link == &gMemoryMap) {
+  Entry = MemoryMapTreeFind (gMemoryMapTree, Memory);
+  if (Entry == NULL || Entry->End == Memory) {
     Status = EFI_NOT_FOUND;
     goto Done;
   }
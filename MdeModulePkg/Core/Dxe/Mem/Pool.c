@@ -49,8 +49,10 @@ typedef struct {
 // blocks between bins by splitting them up, while not wasting too much memory
 // as we would in a strict power-of-2 sequence
 //
+#define POOL_SIZE_CLASS_MAX   29824
+
 STATIC CONST UINT16 mPoolSizeTable[] = {
-  128, 256, 384, 640, 1024, 1664, 2688, 4352, 7040, 11392, 18432, 29824
+  128, 256, 384, 640, 1024, 1664, 2688, 4352, 7040, 11392, 18432, POOL_SIZE_CLASS_MAX
 };
 
 #define SIZE_TO_LIST(a)   (GetPoolIndexFromSize (a))
@@ -60,6 +62,33 @@ STATIC CONST UINT16 mPoolSizeTable[] = {
 
 #define MAX_POOL_SIZE     (MAX_ADDRESS - POOL_OVERHEAD)
 
+//
+// Every entry of mPoolSizeTable is a multiple of POOL_SIZE_CLASS_UNIT, so the
+// size class of any request can be looked up in mPoolIndexTable by the number
+// of units it spans instead of searching mPoolSizeTable. The table ends with
+// the last entry of mPoolSizeTable.
+//
+#define POOL_SIZE_CLASS_SHIFT   7
+#define POOL_SIZE_CLASS_UNIT    (1 << POOL_SIZE_CLASS_SHIFT)
+#define POOL_SIZE_CLASS_COUNT   (POOL_SIZE_CLASS_MAX / POOL_SIZE_CLASS_UNIT + 1)
+
+STATIC UINT8 mPoolIndexTable[POOL_SIZE_CLASS_COUNT];
+
+//
+// Maximum number of completely free pool pages kept per memory type. Such
+// pages are reused for the next pool page request of the same type instead
+// of being handed back to the page allocator right away, and are returned to
+// it in batches when the cache overflows.
+//
+#define MAX_POOL_EMPTY_PAGE_COUNT   8
+
+#define POOL_EMPTY_PAGE_SIGNATURE   SIGNATURE_32('p','e','p','0')
+typedef struct {
+  UINT32          Signature;
+  UINT32          Reserved;
+  LIST_ENTRY      Link;
+} POOL_EMPTY_PAGE;
+
 //
 // Globals
 //
@@ -71,6 +100,8 @@ typedef struct {
     EFI_MEMORY_TYPE  MemoryType;
     LIST_ENTRY       FreeList[MAX_POOL_LIST];
     LIST_ENTRY       Link;
+    LIST_ENTRY       EmptyPageList;
+    UINTN            EmptyPageCount;
 } POOL;
 
 //
@@ -97,14 +128,39 @@ GetPoolIndexFromSize (
   UINTN   Size
   )
 {
+  UINTN   Units;
+
+  Units = (Size + POOL_SIZE_CLASS_UNIT - 1) >> POOL_SIZE_CLASS_SHIFT;
+  if (Units >= POOL_SIZE_CLASS_COUNT) {
+    return MAX_POOL_LIST;
+  }
+  return mPoolIndexTable[Units];
+}
+
+/**
+  Build the table used by GetPoolIndexFromSize() to map a size to its pool
+  size class in constant time.
+
+**/
+STATIC
+VOID
+InitializePoolIndexTable (
+  VOID
+  )
+{
+  UINTN   Units;
   UINTN   Index;
 
-  for (Index = 0; Index < MAX_POOL_LIST; Index++) {
-    if (mPoolSizeTable [Index] >= Size) {
-      return Index;
+  ASSERT ((POOL_SIZE_CLASS_MAX % POOL_SIZE_CLASS_UNIT) == 0);
+
+  Index = 0;
+  for (Units = 0; Units < POOL_SIZE_CLASS_COUNT; Units++) {
+    while (mPoolSizeTable[Index] < Units * POOL_SIZE_CLASS_UNIT) {
+      Index++;
     }
+    ASSERT ((mPoolSizeTable[Index] % POOL_SIZE_CLASS_UNIT) == 0);
+    mPoolIndexTable[Units] = (UINT8) Index;
   }
-  return MAX_POOL_LIST;
 }
 
 /**
@@ -119,6 +175,8 @@ CoreInitializePool (
   UINTN  Type;
   UINTN  Index;
 
+  InitializePoolIndexTable ();
+
   for (Type=0; Type < EfiMaxMemoryType; Type++) {
     mPoolHead[Type].Signature  = 0;
     mPoolHead[Type].Used       = 0;
@@ -126,6 +184,8 @@ CoreInitializePool (
     for (Index=0; Index < MAX_POOL_LIST; Index++) {
       InitializeListHead (&mPoolHead[Type].FreeList[Index]);
     }
+    InitializeListHead (&mPoolHead[Type].EmptyPageList);
+    mPoolHead[Type].EmptyPageCount = 0;
   }
 }
 
@@ -176,6 +236,8 @@ LookupPoolHead (
     for (Index=0; Index < MAX_POOL_LIST; Index++) {
       InitializeListHead (&Pool->FreeList[Index]);
     }
+    InitializeListHead (&Pool->EmptyPageList);
+    Pool->EmptyPageCount = 0;
 
     InsertHeadList (&mPoolHeadList, &Pool->Link);
 
@@ -354,6 +416,7 @@ CoreAllocatePoolI (
   POOL_FREE   *Free;
   POOL_HEAD   *Head;
   POOL_TAIL   *Tail;
+  POOL_EMPTY_PAGE *EmptyPage;
   CHAR8       *NewPage;
   VOID        *Buffer;
   UINTN       Index;
@@ -438,8 +501,21 @@ CoreAllocatePoolI (
     }
 
     //
-    // Get another page
+    // Reuse a cached empty page if there is one, or get another page
     //
+    if (!IsListEmpty (&Pool->EmptyPageList)) {
+      EmptyPage = CR (
+                    Pool->EmptyPageList.ForwardLink,
+                    POOL_EMPTY_PAGE,
+                    Link,
+                    POOL_EMPTY_PAGE_SIGNATURE
+                    );
+      RemoveEntryList (&EmptyPage->Link);
+      Pool->EmptyPageCount--;
+      NewPage = (CHAR8 *) EmptyPage;
+      goto Carve;
+    }
+
     NewPage = CoreAllocatePoolPagesI (PoolType, EFI_SIZE_TO_PAGES (Granularity),
                                       Granularity, NeedGuard);
     if (NewPage == NULL) {
@@ -617,6 +693,66 @@ CoreFreePoolPagesI (
     (EFI_PHYSICAL_ADDRESS)(UINTN)Memory, EFI_PAGES_TO_SIZE (NoPages));
 }
 
+/**
+  Internal function.  Hands a pool page whose entries are all free back to the
+  empty page cache of its pool. If the cache is full, half of the cached pages
+  are returned to the page allocator in one batch.
+
+  Only pages of the EfiBootServicesData and EfiLoaderData types are cached.
+  Pages of the runtime, ACPI and reserved types would outlive ExitBootServices()
+  in the cache, and be reported in the memory map while not in use. The pool
+  head of the OS and OEM reserved types is also released once the last
+  allocation of that type is freed.
+
+  @param  Pool                   The pool the page belongs to
+  @param  Page                   The base address of the empty page
+  @param  Granularity            The size of the page
+
+**/
+STATIC
+VOID
+CoreReleaseEmptyPoolPage (
+  IN POOL                   *Pool,
+  IN CHAR8                  *Page,
+  IN UINTN                  Granularity
+  )
+{
+  POOL_EMPTY_PAGE   *EmptyPage;
+
+  if ((Pool->MemoryType != EfiBootServicesData) && (Pool->MemoryType != EfiLoaderData)) {
+    CoreFreePoolPagesI (Pool->MemoryType, (EFI_PHYSICAL_ADDRESS) (UINTN) Page,
+      EFI_SIZE_TO_PAGES (Granularity));
+    return;
+  }
+
+  EmptyPage = (POOL_EMPTY_PAGE *) Page;
+  EmptyPage->Signature = POOL_EMPTY_PAGE_SIGNATURE;
+  InsertHeadList (&Pool->EmptyPageList, &EmptyPage->Link);
+  Pool->EmptyPageCount++;
+
+  if (Pool->EmptyPageCount <= MAX_POOL_EMPTY_PAGE_COUNT) {
+    return;
+  }
+
+  //
+  // Return the least recently cached pages, keeping the most recent ones
+  // which are more likely to still be in the cache lines.
+  //
+  while (Pool->EmptyPageCount > MAX_POOL_EMPTY_PAGE_COUNT / 2) {
+    EmptyPage = CR (
+                  Pool->EmptyPageList.BackLink,
+                  POOL_EMPTY_PAGE,
+                  Link,
+                  POOL_EMPTY_PAGE_SIGNATURE
+                  );
+    RemoveEntryList (&EmptyPage->Link);
+    Pool->EmptyPageCount--;
+    EmptyPage->Signature = 0;
+    CoreFreePoolPagesI (Pool->MemoryType, (EFI_PHYSICAL_ADDRESS) (UINTN) EmptyPage,
+      EFI_SIZE_TO_PAGES (Granularity));
+  }
+}
+
 /**
   Internal function.  Frees guarded pool pages.
 
@@ -834,10 +970,9 @@ CoreFreePoolI (
         }
 
         //
-        // Free the page
+        // Cache the page for reuse, or free it
         //
-        CoreFreePoolPagesI (Pool->MemoryType, (EFI_PHYSICAL_ADDRESS) (UINTN)NewPage,
-          EFI_SIZE_TO_PAGES (Granularity));
+        CoreReleaseEmptyPoolPage (Pool, NewPage, Granularity);
       }
     }
   }
@@ -92,6 +92,22 @@ typedef struct {
   VOID                        *Registration;
 } RPN_EVENT_CONTEXT;
 
+//
+// An encapsulation section decoded ahead of time by PrefetchSectionStreams().
+//
+typedef struct {
+  EFI_COMMON_SECTION_HEADER   *Section;
+  VOID                        *Source;
+  UINT32                      SourceSize;
+  VOID                        *OutputBuffer;
+  UINT32                      OutputSize;
+  VOID                        *ScratchBuffer;
+  UINT32                      ScratchSize;
+  VOID                        *DecodedBuffer;
+  UINT32                      AuthenticationStatus;
+  EFI_STATUS                  Status;
+} SECTION_DECODE_JOB;
+
 
 /**
   The ExtractSection() function processes the input section and
@@ -1356,6 +1372,73 @@ GetSection_Done:
 }
 
 
+/**
+  Worker function.  Compute the size of the buffers allocated for the streams
+  encapsulated in a section stream, including the streams nested in them.
+
+  @param  Stream                 Indicates the section stream.
+
+  @return The total size in bytes of the encapsulated streams.
+
+**/
+UINTN
+GetEncapsulatedStreamSize (
+  IN  CORE_SECTION_STREAM_NODE                  *Stream
+  )
+{
+  LIST_ENTRY                                    *Link;
+  CORE_SECTION_CHILD_NODE                       *ChildNode;
+  CORE_SECTION_STREAM_NODE                      *ChildStream;
+  UINTN                                         Size;
+
+  Size = 0;
+  for (Link = GetFirstNode (&Stream->Children);
+       !IsNull (&Stream->Children, Link);
+       Link = GetNextNode (&Stream->Children, Link)) {
+    ChildNode = CHILD_SECTION_NODE_FROM_LINK (Link);
+    if (ChildNode->EncapsulatedStreamHandle == NULL_STREAM_HANDLE) {
+      continue;
+    }
+    if (!EFI_ERROR (FindStreamNode (ChildNode->EncapsulatedStreamHandle, &ChildStream))) {
+      Size += ChildStream->StreamLength + GetEncapsulatedStreamSize (ChildStream);
+    }
+  }
+
+  return Size;
+}
+
+
+/**
+  Get the memory held by a section stream for the encapsulation sections that
+  have been expanded so far, e.g. the decompressed data of compression
+  sections. The memory is freed when the stream is closed.
+
+  @param  SectionStreamHandle    Indicates the section stream.
+
+  @return The total size in bytes of the buffers of the encapsulated streams,
+          or 0 if the stream does not exist.
+
+**/
+UINTN
+GetSectionStreamCacheSize (
+  IN  UINTN                                     SectionStreamHandle
+  )
+{
+  CORE_SECTION_STREAM_NODE                      *StreamNode;
+  EFI_TPL                                       OldTpl;
+  UINTN                                         Size;
+
+  OldTpl = CoreRaiseTpl (TPL_NOTIFY);
+  Size   = 0;
+  if (!EFI_ERROR (FindStreamNode (SectionStreamHandle, &StreamNode))) {
+    Size = GetEncapsulatedStreamSize (StreamNode);
+  }
+  CoreRestoreTpl (OldTpl);
+
+  return Size;
+}
+
+
 /**
   Worker function.  Destructor for child nodes.
 
@@ -1639,3 +1722,440 @@ CustomGuidedSectionExtract (
 
   return EFI_SUCCESS;
 }
+
+/**
+  Worker function.  Decode one compression or GUIDed section prepared by
+  PrepareSectionDecodeJob().  It only touches the buffers of the job, so it
+  may run on an AP.
+
+  @param  Buffer                 The SECTION_DECODE_JOB to run.
+
+**/
+VOID
+EFIAPI
+RunSectionDecodeJob (
+  IN OUT VOID                                   *Buffer
+  )
+{
+  SECTION_DECODE_JOB                            *Job;
+
+  Job = (SECTION_DECODE_JOB *) Buffer;
+  if (Job->Section->Type == EFI_SECTION_COMPRESSION) {
+    Job->Status = gEfiDecompress.Decompress (
+                                   &gEfiDecompress,
+                                   Job->Source,
+                                   Job->SourceSize,
+                                   Job->OutputBuffer,
+                                   Job->OutputSize,
+                                   Job->ScratchBuffer,
+                                   Job->ScratchSize
+                                   );
+  } else {
+    Job->DecodedBuffer = Job->OutputBuffer;
+    Job->Status = ExtractGuidedSectionDecode (
+                    Job->Section,
+                    &Job->DecodedBuffer,
+                    Job->ScratchBuffer,
+                    &Job->AuthenticationStatus
+                    );
+  }
+}
+
+
+/**
+  Worker function.  Check whether a section can be decoded on an AP, and if
+  Job is not NULL, allocate the buffers to decode it into.
+
+  Only the standard compression of the DXE core EFI_DECOMPRESS_PROTOCOL and the
+  decompression GUIDed sections handled by the DXE core itself are decoded on
+  APs, as their decode functions use nothing but the given buffers.
+
+  @param  Section                The section to check.
+  @param  Job                    The job to prepare, or NULL to only check.
+
+  @retval EFI_SUCCESS            The section can be decoded on an AP.
+  @retval EFI_UNSUPPORTED        The section must be processed on the BSP.
+  @retval EFI_OUT_OF_RESOURCES   The buffers could not be allocated.
+
+**/
+EFI_STATUS
+PrepareSectionDecodeJob (
+  IN     EFI_COMMON_SECTION_HEADER              *Section,
+  IN OUT SECTION_DECODE_JOB                     *Job OPTIONAL
+  )
+{
+  EFI_STATUS                                    Status;
+  EFI_DECOMPRESS_PROTOCOL                       *Decompress;
+  EFI_GUIDED_SECTION_EXTRACTION_PROTOCOL        *GuidedExtraction;
+  EFI_GUID                                      *SectionDefinitionGuid;
+  VOID                                          *Source;
+  UINT32                                        SourceSize;
+  UINT32                                        OutputSize;
+  UINT32                                        ScratchSize;
+  UINT32                                        UncompressedLength;
+  UINT16                                        SectionAttribute;
+
+  if (Section->Type == EFI_SECTION_COMPRESSION) {
+    if (IS_SECTION2 (Section)) {
+      if (SECTION2_SIZE (Section) < sizeof (EFI_COMPRESSION_SECTION2) ||
+          ((EFI_COMPRESSION_SECTION2 *) Section)->CompressionType != EFI_STANDARD_COMPRESSION) {
+        return EFI_UNSUPPORTED;
+      }
+      Source             = (UINT8 *) Section + sizeof (EFI_COMPRESSION_SECTION2);
+      SourceSize         = (UINT32) (SECTION2_SIZE (Section) - sizeof (EFI_COMPRESSION_SECTION2));
+      UncompressedLength = ((EFI_COMPRESSION_SECTION2 *) Section)->UncompressedLength;
+    } else {
+      if (SECTION_SIZE (Section) < sizeof (EFI_COMPRESSION_SECTION) ||
+          ((EFI_COMPRESSION_SECTION *) Section)->CompressionType != EFI_STANDARD_COMPRESSION) {
+        return EFI_UNSUPPORTED;
+      }
+      Source             = (UINT8 *) Section + sizeof (EFI_COMPRESSION_SECTION);
+      SourceSize         = (UINT32) (SECTION_SIZE (Section) - sizeof (EFI_COMPRESSION_SECTION));
+      UncompressedLength = ((EFI_COMPRESSION_SECTION *) Section)->UncompressedLength;
+    }
+
+    Status = CoreLocateProtocol (&gEfiDecompressProtocolGuid, NULL, (VOID **) &Decompress);
+    if (EFI_ERROR (Status) || Decompress != &gEfiDecompress || UncompressedLength == 0) {
+      return EFI_UNSUPPORTED;
+    }
+
+    Status = Decompress->GetInfo (Decompress, Source, SourceSize, &OutputSize, &ScratchSize);
+    if (EFI_ERROR (Status) || OutputSize != UncompressedLength) {
+      //
+      // Leave the error to be reported by CreateChildNode().
+      //
+      return EFI_UNSUPPORTED;
+    }
+  } else if (Section->Type == EFI_SECTION_GUID_DEFINED) {
+    if (IS_SECTION2 (Section)) {
+      SectionDefinitionGuid = &((EFI_GUID_DEFINED_SECTION2 *) Section)->SectionDefinitionGuid;
+    } else {
+      SectionDefinitionGuid = &((EFI_GUID_DEFINED_SECTION *) Section)->SectionDefinitionGuid;
+    }
+    if (!CompareGuid (SectionDefinitionGuid, &gLzmaCustomDecompressGuid) &&
+        !CompareGuid (SectionDefinitionGuid, &gLzmaF86CustomDecompressGuid) &&
+        !CompareGuid (SectionDefinitionGuid, &gBrotliCustomDecompressGuid)) {
+      return EFI_UNSUPPORTED;
+    }
+    if (!VerifyGuidedSectionGuid (SectionDefinitionGuid, &GuidedExtraction) ||
+        GuidedExtraction != &mCustomGuidedSectionExtractionProtocol) {
+      return EFI_UNSUPPORTED;
+    }
+
+    Source     = NULL;
+    SourceSize = 0;
+    Status = ExtractGuidedSectionGetInfo (Section, &OutputSize, &ScratchSize, &SectionAttribute);
+    if (EFI_ERROR (Status) || OutputSize == 0) {
+      return EFI_UNSUPPORTED;
+    }
+  } else {
+    return EFI_UNSUPPORTED;
+  }
+
+  if (Job == NULL) {
+    return EFI_SUCCESS;
+  }
+
+  Job->Section              = Section;
+  Job->Source               = Source;
+  Job->SourceSize           = SourceSize;
+  Job->OutputSize           = OutputSize;
+  Job->ScratchSize          = ScratchSize;
+  Job->OutputBuffer         = AllocatePool (OutputSize);
+  Job->ScratchBuffer        = (ScratchSize > 0) ? AllocatePool (ScratchSize) : NULL;
+  Job->AuthenticationStatus = 0;
+  Job->Status               = EFI_NOT_STARTED;
+  if (Job->OutputBuffer == NULL || (ScratchSize > 0 && Job->ScratchBuffer == NULL)) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  return EFI_SUCCESS;
+}
+
+
+/**
+  Worker function.  Walk the sections of a section stream which has not been
+  parsed yet, and count the sections that can be decoded on an AP.
+
+  @param  Stream                 The section stream.
+
+  @return The number of sections to be decoded, or 0 if the stream has been
+          parsed, if it holds no such section, or if it holds another kind of
+          encapsulation section which must be processed on the BSP.
+
+**/
+UINTN
+CountSectionDecodeJobs (
+  IN  CORE_SECTION_STREAM_NODE                  *Stream
+  )
+{
+  EFI_COMMON_SECTION_HEADER                     *Section;
+  UINTN                                         Offset;
+  UINTN                                         Size;
+  UINTN                                         Count;
+
+  if (!IsListEmpty (&Stream->Children)) {
+    return 0;
+  }
+
+  Count = 0;
+  for (Offset = 0; Offset + sizeof (EFI_COMMON_SECTION_HEADER) <= Stream->StreamLength; Offset = ALIGN_VALUE (Offset + Size, 4)) {
+    Section = (EFI_COMMON_SECTION_HEADER *) (Stream->StreamBuffer + Offset);
+    if (IS_SECTION2 (Section)) {
+      if (Offset + sizeof (EFI_COMMON_SECTION_HEADER2) > Stream->StreamLength) {
+        return 0;
+      }
+      Size = SECTION2_SIZE (Section);
+    } else {
+      Size = SECTION_SIZE (Section);
+    }
+    if (Size < sizeof (EFI_COMMON_SECTION_HEADER) || Size > Stream->StreamLength - Offset) {
+      return 0;
+    }
+
+    if (PrepareSectionDecodeJob (Section, NULL) == EFI_SUCCESS) {
+      Count++;
+    } else if (Section->Type == EFI_SECTION_COMPRESSION || Section->Type == EFI_SECTION_GUID_DEFINED) {
+      return 0;
+    }
+  }
+
+  return Count;
+}
+
+
+/**
+  Worker function.  Parse all the sections of a section stream, using the
+  results of the decode jobs for its encapsulation sections.
+
+  @param  Stream                 The section stream.
+  @param  Jobs                   The decode jobs of the stream, in the order of
+                                 the sections.
+  @param  JobCount               The number of decode jobs of the stream.
+
+  @retval EFI_SUCCESS            All the child nodes have been created.
+  @return other                  A job failed or a child node could not be
+                                 created. The stream is left unparsed.
+
+**/
+EFI_STATUS
+CreatePrefetchedChildNodes (
+  IN  CORE_SECTION_STREAM_NODE                  *Stream,
+  IN  SECTION_DECODE_JOB                        *Jobs,
+  IN  UINTN                                     JobCount
+  )
+{
+  EFI_STATUS                                    Status;
+  EFI_COMMON_SECTION_HEADER                     *Section;
+  CORE_SECTION_CHILD_NODE                       *Node;
+  UINTN                                         Offset;
+  UINT32                                        AuthenticationStatus;
+  UINT16                                        GuidedSectionAttributes;
+
+  Status = EFI_SUCCESS;
+  for (Offset = 0; Offset + sizeof (EFI_COMMON_SECTION_HEADER) <= Stream->StreamLength; Offset = ALIGN_VALUE (Offset + Node->Size, 4)) {
+    Section = (EFI_COMMON_SECTION_HEADER *) (Stream->StreamBuffer + Offset);
+    if (JobCount == 0 || Section != Jobs->Section) {
+      //
+      // It's a leaf, nothing to decode.
+      //
+      Status = CreateChildNode (Stream, (UINT32) Offset, &Node);
+      if (EFI_ERROR (Status)) {
+        break;
+      }
+      continue;
+    }
+
+    Status = Jobs->Status;
+    if (EFI_ERROR (Status)) {
+      break;
+    }
+
+    Node = AllocateZeroPool (sizeof (CORE_SECTION_CHILD_NODE));
+    if (Node == NULL) {
+      Status = EFI_OUT_OF_RESOURCES;
+      break;
+    }
+    Node->Signature                = CORE_SECTION_CHILD_SIGNATURE;
+    Node->Type                     = Section->Type;
+    Node->Size                     = IS_SECTION2 (Section) ? SECTION2_SIZE (Section) : SECTION_SIZE (Section);
+    Node->OffsetInStream           = (UINT32) Offset;
+    Node->EncapsulatedStreamHandle = NULL_STREAM_HANDLE;
+
+    //
+    // Same authentication status as CreateChildNode() gives.
+    //
+    if (Section->Type == EFI_SECTION_COMPRESSION) {
+      AuthenticationStatus = Stream->AuthenticationStatus;
+    } else {
+      if (IS_SECTION2 (Section)) {
+        Node->EncapsulationGuid = &((EFI_GUID_DEFINED_SECTION2 *) Section)->SectionDefinitionGuid;
+        GuidedSectionAttributes = ((EFI_GUID_DEFINED_SECTION2 *) Section)->Attributes;
+      } else {
+        Node->EncapsulationGuid = &((EFI_GUID_DEFINED_SECTION *) Section)->SectionDefinitionGuid;
+        GuidedSectionAttributes = ((EFI_GUID_DEFINED_SECTION *) Section)->Attributes;
+      }
+      if (Jobs->DecodedBuffer != Jobs->OutputBuffer) {
+        CopyMem (Jobs->OutputBuffer, Jobs->DecodedBuffer, Jobs->OutputSize);
+      }
+      AuthenticationStatus = Jobs->AuthenticationStatus;
+      if ((GuidedSectionAttributes & EFI_GUIDED_SECTION_AUTH_STATUS_VALID) != 0) {
+        AuthenticationStatus |= Stream->AuthenticationStatus & EFI_AUTH_STATUS_ALL;
+      } else {
+        AuthenticationStatus = Stream->AuthenticationStatus;
+      }
+    }
+
+    Status = OpenSectionStreamEx (
+               Jobs->OutputSize,
+               Jobs->OutputBuffer,
+               FALSE,
+               AuthenticationStatus,
+               &Node->EncapsulatedStreamHandle
+               );
+    if (EFI_ERROR (Status)) {
+      CoreFreePool (Node);
+      break;
+    }
+
+    //
+    // The output buffer now belongs to the encapsulated stream.
+    //
+    Jobs->OutputBuffer = NULL;
+    InsertTailList (&Stream->Children, &Node->Link);
+    Jobs++;
+    JobCount--;
+  }
+
+  if (EFI_ERROR (Status)) {
+    while (!IsListEmpty (&Stream->Children)) {
+      FreeChildNode (CHILD_SECTION_NODE_FROM_LINK (GetFirstNode (&Stream->Children)));
+    }
+  }
+
+  return Status;
+}
+
+
+/**
+  Decode the compression and GUIDed sections of a set of section streams in
+  parallel, and parse the streams with the results, so that the sections can
+  be got later without decoding them again.
+
+  The buffers are allocated on the BSP, then only the decoding itself runs on
+  the APs through CoreRunApJobs(). Streams which have already been parsed, or
+  which hold encapsulation sections that cannot be decoded on an AP, are left
+  to be parsed on demand by GetSection().
+
+  @param  StreamHandles          The section streams.
+  @param  StreamCount            The number of section streams.
+
+**/
+VOID
+PrefetchSectionStreams (
+  IN  UINTN                                     *StreamHandles,
+  IN  UINTN                                     StreamCount
+  )
+{
+  EFI_STATUS                                    Status;
+  EFI_TPL                                       OldTpl;
+  CORE_SECTION_STREAM_NODE                      **Streams;
+  UINTN                                         *JobCounts;
+  SECTION_DECODE_JOB                            *Jobs;
+  SECTION_DECODE_JOB                            *Job;
+  EFI_COMMON_SECTION_HEADER                     *Section;
+  UINTN                                         JobCount;
+  UINTN                                         Index;
+  UINTN                                         Offset;
+
+  Streams   = AllocateZeroPool (StreamCount * sizeof (CORE_SECTION_STREAM_NODE *));
+  JobCounts = AllocateZeroPool (StreamCount * sizeof (UINTN));
+  Jobs      = NULL;
+  if (Streams == NULL || JobCounts == NULL) {
+    goto Done;
+  }
+
+  //
+  // Find the streams to prefetch and count their jobs.
+  //
+  OldTpl   = CoreRaiseTpl (TPL_NOTIFY);
+  JobCount = 0;
+  for (Index = 0; Index < StreamCount; Index++) {
+    if (!EFI_ERROR (FindStreamNode (StreamHandles[Index], &Streams[Index]))) {
+      JobCounts[Index] = CountSectionDecodeJobs (Streams[Index]);
+      JobCount        += JobCounts[Index];
+    }
+  }
+  CoreRestoreTpl (OldTpl);
+
+  if (JobCount == 0) {
+    goto Done;
+  }
+
+  Jobs = AllocateZeroPool (JobCount * sizeof (SECTION_DECODE_JOB));
+  if (Jobs == NULL) {
+    goto Done;
+  }
+
+  //
+  // Allocate the buffers on the BSP.
+  //
+  Job = Jobs;
+  for (Index = 0; Index < StreamCount; Index++) {
+    if (JobCounts[Index] == 0) {
+      continue;
+    }
+    for (Offset = 0; Offset + sizeof (EFI_COMMON_SECTION_HEADER) <= Streams[Index]->StreamLength; ) {
+      Section = (EFI_COMMON_SECTION_HEADER *) (Streams[Index]->StreamBuffer + Offset);
+      if (Section->Type == EFI_SECTION_COMPRESSION || Section->Type == EFI_SECTION_GUID_DEFINED) {
+        Status = PrepareSectionDecodeJob (Section, Job);
+        Job++;
+        if (EFI_ERROR (Status)) {
+          goto Done;
+        }
+      }
+      Offset = ALIGN_VALUE (Offset + (IS_SECTION2 (Section) ? SECTION2_SIZE (Section) : SECTION_SIZE (Section)), 4);
+    }
+  }
+
+  //
+  // Decode, then parse the streams with the results.
+  //
+  CoreRunApJobs (RunSectionDecodeJob, Jobs, sizeof (SECTION_DECODE_JOB), JobCount);
+
+  OldTpl = CoreRaiseTpl (TPL_NOTIFY);
+  Job    = Jobs;
+  for (Index = 0; Index < StreamCount; Index++) {
+    if (JobCounts[Index] == 0) {
+      continue;
+    }
+    //
+    // Skip the streams closed or parsed while the jobs were running.
+    //
+    if (!EFI_ERROR (FindStreamNode (StreamHandles[Index], &Streams[Index])) &&
+        IsListEmpty (&Streams[Index]->Children)) {
+      CreatePrefetchedChildNodes (Streams[Index], Job, JobCounts[Index]);
+    }
+    Job += JobCounts[Index];
+  }
+  CoreRestoreTpl (OldTpl);
+
+Done:
+  if (Jobs != NULL) {
+    for (Index = 0; Index < JobCount; Index++) {
+      if (Jobs[Index].OutputBuffer != NULL) {
+        CoreFreePool (Jobs[Index].OutputBuffer);
+      }
+      if (Jobs[Index].ScratchBuffer != NULL) {
+        CoreFreePool (Jobs[Index].ScratchBuffer);
+      }
+    }
+    CoreFreePool (Jobs);
+  }
+  if (Streams != NULL) {
+    CoreFreePool (Streams);
+  }
+  if (JobCounts != NULL) {
+    CoreFreePool (JobCounts);
+  }
+}
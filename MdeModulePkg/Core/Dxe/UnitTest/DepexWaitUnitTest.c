@@ -0,0 +1,380 @@
+/** @file
+  This is a host-based unit test for the scan of the dependency expressions
+  that the DXE Dispatcher parks until a protocol is installed.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <PiDxe.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/UnitTestLib.h>
+
+#include "../Dispatcher/DepexWait.h"
+
+#define UNIT_TEST_NAME        "DXE Core Depex Wait Unit Test"
+#define UNIT_TEST_VERSION     "1.0"
+
+#define TEST_DEPEX_MAX_SIZE   256
+
+///=== TEST DATA ==================================================================================
+
+EFI_GUID  mTestGuidA = { 0x0b2a6a6f, 0x4a1c, 0x4c2e, { 0x9d, 0x31, 0x61, 0x2e, 0x7b, 0x0c, 0x45, 0x18 } };
+EFI_GUID  mTestGuidB = { 0x6f3ad8c1, 0x27e4, 0x4b58, { 0xa0, 0x9e, 0x13, 0x5c, 0xd2, 0x77, 0x8b, 0x40 } };
+
+//
+// A GUID whose bytes hold the EFI_DEP_NOT and EFI_DEP_END opcodes, which the
+// scan must not take for opcodes.
+//
+EFI_GUID  mTestGuidOpcodes = { 0x05050505, 0x0808, 0x0505, { 0x05, 0x08, 0x05, 0x08, 0x05, 0x08, 0x05, 0x08 } };
+
+UINT8     mTestDepex[TEST_DEPEX_MAX_SIZE];
+UINTN     mTestDepexSize;
+
+///=== HELPER FUNCTIONS ===========================================================================
+
+/**
+  Append an opcode to the test dependency expression.
+
+  @param[in]  Opcode  The opcode.
+**/
+VOID
+AddOpcode (
+  IN UINT8  Opcode
+  )
+{
+  ASSERT (mTestDepexSize < TEST_DEPEX_MAX_SIZE);
+  mTestDepex[mTestDepexSize++] = Opcode;
+}
+
+/**
+  Append an opcode followed by a GUID to the test dependency expression.
+
+  @param[in]  Opcode  EFI_DEP_PUSH or EFI_DEP_REPLACE_TRUE.
+  @param[in]  Guid    The GUID.
+**/
+VOID
+AddGuid (
+  IN UINT8     Opcode,
+  IN EFI_GUID  *Guid
+  )
+{
+  AddOpcode (Opcode);
+  ASSERT (mTestDepexSize + sizeof (EFI_GUID) <= TEST_DEPEX_MAX_SIZE);
+  CopyMem (&mTestDepex[mTestDepexSize], Guid, sizeof (EFI_GUID));
+  mTestDepexSize += sizeof (EFI_GUID);
+}
+
+/**
+  Start a new test dependency expression.
+
+  @param[in]  Context  Unit test case context
+**/
+UNIT_TEST_STATUS
+EFIAPI
+ResetDepex (
+  IN UNIT_TEST_CONTEXT      Context
+  )
+{
+  SetMem (mTestDepex, sizeof (mTestDepex), EFI_DEP_END);
+  mTestDepexSize = 0;
+  return UNIT_TEST_PASSED;
+}
+
+///=== TEST CASES =================================================================================
+
+/**
+  A Depex made of PUSH, AND and OR waits for every GUID it pushes, and the
+  pointers returned point into the Depex.
+
+  @param[in]  Context  Unit test case context
+**/
+UNIT_TEST_STATUS
+EFIAPI
+PushedGuidsShouldBeReturned (
+  IN UNIT_TEST_CONTEXT      Context
+  )
+{
+  EFI_GUID  *Protocols[2];
+  UINTN     Count;
+
+  AddGuid (EFI_DEP_PUSH, &mTestGuidA);
+  AddGuid (EFI_DEP_PUSH, &mTestGuidB);
+  AddOpcode (EFI_DEP_OR);
+  AddOpcode (EFI_DEP_TRUE);
+  AddOpcode (EFI_DEP_AND);
+  AddOpcode (EFI_DEP_END);
+
+  Count = 0;
+  UT_ASSERT_TRUE (CoreGetDepexWaitProtocols (mTestDepex, mTestDepexSize, NULL, &Count));
+  UT_ASSERT_EQUAL (Count, 2);
+
+  UT_ASSERT_TRUE (CoreGetDepexWaitProtocols (mTestDepex, mTestDepexSize, Protocols, &Count));
+  UT_ASSERT_EQUAL (Count, 2);
+  UT_ASSERT_EQUAL ((UINTN) Protocols[0], (UINTN) &mTestDepex[1]);
+  UT_ASSERT_EQUAL ((UINTN) Protocols[1], (UINTN) &mTestDepex[2 + sizeof (EFI_GUID)]);
+  UT_ASSERT_TRUE (CompareGuid (Protocols[0], &mTestGuidA));
+  UT_ASSERT_TRUE (CompareGuid (Protocols[1], &mTestGuidB));
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  A driver with a NOT Depex becomes dispatchable when the protocol is
+  uninstalled, which wakes no waiter, so it must not be parked.
+
+  @param[in]  Context  Unit test case context
+**/
+UNIT_TEST_STATUS
+EFIAPI
+NotDepexShouldNotWait (
+  IN UNIT_TEST_CONTEXT      Context
+  )
+{
+  UINTN  Count;
+
+  AddGuid (EFI_DEP_PUSH, &mTestGuidA);
+  AddOpcode (EFI_DEP_NOT);
+  AddOpcode (EFI_DEP_END);
+
+  Count = 0;
+  UT_ASSERT_FALSE (CoreGetDepexWaitProtocols (mTestDepex, mTestDepexSize, NULL, &Count));
+
+  //
+  // The NOT may be anywhere in the expression.
+  //
+  ResetDepex (Context);
+  AddGuid (EFI_DEP_PUSH, &mTestGuidA);
+  AddGuid (EFI_DEP_PUSH, &mTestGuidB);
+  AddOpcode (EFI_DEP_NOT);
+  AddOpcode (EFI_DEP_AND);
+  AddOpcode (EFI_DEP_END);
+
+  Count = 0;
+  UT_ASSERT_FALSE (CoreGetDepexWaitProtocols (mTestDepex, mTestDepexSize, NULL, &Count));
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  The GUIDs already found installed by the evaluator can not change the
+  result any more, so they are not waited for.
+
+  @param[in]  Context  Unit test case context
+**/
+UNIT_TEST_STATUS
+EFIAPI
+ReplacedGuidsShouldBeSkipped (
+  IN UNIT_TEST_CONTEXT      Context
+  )
+{
+  EFI_GUID  *Protocols[1];
+  UINTN     Count;
+
+  AddGuid (EFI_DEP_REPLACE_TRUE, &mTestGuidA);
+  AddGuid (EFI_DEP_PUSH, &mTestGuidB);
+  AddOpcode (EFI_DEP_AND);
+  AddOpcode (EFI_DEP_END);
+
+  Count = 1;
+  UT_ASSERT_TRUE (CoreGetDepexWaitProtocols (mTestDepex, mTestDepexSize, Protocols, &Count));
+  UT_ASSERT_EQUAL (Count, 1);
+  UT_ASSERT_TRUE (CompareGuid (Protocols[0], &mTestGuidB));
+
+  //
+  // With every GUID replaced, the Depex can only be FALSE because of an
+  // EFI_DEP_FALSE, and nothing can wake it.
+  //
+  ResetDepex (Context);
+  AddGuid (EFI_DEP_REPLACE_TRUE, &mTestGuidA);
+  AddOpcode (EFI_DEP_FALSE);
+  AddOpcode (EFI_DEP_AND);
+  AddOpcode (EFI_DEP_END);
+
+  Count = 1;
+  UT_ASSERT_TRUE (CoreGetDepexWaitProtocols (mTestDepex, mTestDepexSize, NULL, &Count));
+  UT_ASSERT_EQUAL (Count, 0);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Opcode values inside a GUID are data, not opcodes.
+
+  @param[in]  Context  Unit test case context
+**/
+UNIT_TEST_STATUS
+EFIAPI
+OpcodesInGuidShouldBeIgnored (
+  IN UNIT_TEST_CONTEXT      Context
+  )
+{
+  EFI_GUID  *Protocols[2];
+  UINTN     Count;
+
+  AddGuid (EFI_DEP_PUSH, &mTestGuidOpcodes);
+  AddGuid (EFI_DEP_REPLACE_TRUE, &mTestGuidOpcodes);
+  AddOpcode (EFI_DEP_AND);
+  AddOpcode (EFI_DEP_END);
+
+  Count = 2;
+  UT_ASSERT_TRUE (CoreGetDepexWaitProtocols (mTestDepex, mTestDepexSize, Protocols, &Count));
+  UT_ASSERT_EQUAL (Count, 1);
+  UT_ASSERT_TRUE (CompareGuid (Protocols[0], &mTestGuidOpcodes));
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  A truncated GUID, a missing EFI_DEP_END or an unknown opcode make the
+  Depex be evaluated on every pass.
+
+  @param[in]  Context  Unit test case context
+**/
+UNIT_TEST_STATUS
+EFIAPI
+MalformedDepexShouldNotWait (
+  IN UNIT_TEST_CONTEXT      Context
+  )
+{
+  UINTN  Count;
+
+  AddGuid (EFI_DEP_PUSH, &mTestGuidA);
+  AddOpcode (EFI_DEP_END);
+
+  Count = 0;
+  UT_ASSERT_FALSE (CoreGetDepexWaitProtocols (mTestDepex, sizeof (EFI_GUID), NULL, &Count));
+  UT_ASSERT_FALSE (CoreGetDepexWaitProtocols (mTestDepex, mTestDepexSize - 1, NULL, &Count));
+  UT_ASSERT_TRUE (CoreGetDepexWaitProtocols (mTestDepex, mTestDepexSize, NULL, &Count));
+  UT_ASSERT_EQUAL (Count, 1);
+
+  ResetDepex (Context);
+  AddOpcode (0x42);
+  AddOpcode (EFI_DEP_END);
+  UT_ASSERT_FALSE (CoreGetDepexWaitProtocols (mTestDepex, mTestDepexSize, NULL, &Count));
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  When the array is smaller than the number of GUIDs, only its entries are
+  filled, and the number of GUIDs found is still returned.
+
+  @param[in]  Context  Unit test case context
+**/
+UNIT_TEST_STATUS
+EFIAPI
+ShortArrayShouldNotOverflow (
+  IN UNIT_TEST_CONTEXT      Context
+  )
+{
+  EFI_GUID  *Protocols[2];
+  UINTN     Count;
+
+  AddGuid (EFI_DEP_PUSH, &mTestGuidA);
+  AddGuid (EFI_DEP_PUSH, &mTestGuidB);
+  AddOpcode (EFI_DEP_AND);
+  AddOpcode (EFI_DEP_END);
+
+  Protocols[1] = NULL;
+  Count        = 1;
+  UT_ASSERT_TRUE (CoreGetDepexWaitProtocols (mTestDepex, mTestDepexSize, Protocols, &Count));
+  UT_ASSERT_EQUAL (Count, 2);
+  UT_ASSERT_TRUE (CompareGuid (Protocols[0], &mTestGuidA));
+  UT_ASSERT_EQUAL ((UINTN) Protocols[1], 0);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Main entry point to this unit test application.
+
+  Sets up and runs the test suites.
+**/
+VOID
+EFIAPI
+UnitTestMain (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      DepexTests;
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_NAME, UNIT_TEST_VERSION));
+
+  //
+  // Start setting up the test framework for running the tests.
+  //
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_NAME, gEfiCallerBaseName, UNIT_TEST_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  //
+  // Add all test suites and tests.
+  //
+  Status = CreateUnitTestSuite (
+             &DepexTests, Framework,
+             "Depex Wait Tests", "DxeCore.DepexWait", NULL, NULL
+             );
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for DepexTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+  AddTestCase (DepexTests, "Pushed GUIDs should be returned", "Push", PushedGuidsShouldBeReturned, ResetDepex, NULL, NULL);
+  AddTestCase (DepexTests, "A NOT Depex should not wait", "Not", NotDepexShouldNotWait, ResetDepex, NULL, NULL);
+  AddTestCase (DepexTests, "Replaced GUIDs should be skipped", "ReplaceTrue", ReplacedGuidsShouldBeSkipped, ResetDepex, NULL, NULL);
+  AddTestCase (DepexTests, "Opcode values in a GUID should be ignored", "GuidData", OpcodesInGuidShouldBeIgnored, ResetDepex, NULL, NULL);
+  AddTestCase (DepexTests, "A malformed Depex should not wait", "Malformed", MalformedDepexShouldNotWait, ResetDepex, NULL, NULL);
+  AddTestCase (DepexTests, "A short array should not overflow", "ShortArray", ShortArrayShouldNotOverflow, ResetDepex, NULL, NULL);
+
+  //
+  // Execute the tests.
+  //
+  Status = RunAllTestSuites (Framework);
+
+EXIT:
+  if (Framework != NULL) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return;
+}
+
+///
+/// Avoid ECC error for function name that starts with lower case letter
+///
+#define Main main
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+
+  @param[in] Argc  Number of arguments
+  @param[in] Argv  Array of pointers to arguments
+
+  @retval 0      Success
+  @retval other  Error
+**/
+INT32
+Main (
+  IN INT32  Argc,
+  IN CHAR8  *Argv[]
+  )
+{
+  UnitTestMain ();
+  return 0;
+}
@@ -0,0 +1,704 @@
+/** @file
+  This is a host-based unit test for the balanced tree index of the DXE core
+  memory map.
+
+  Copyright (c) 2021, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <Uefi.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/UefiLib.h>
+#include <Library/UnitTestLib.h>
+
+#include "../Mem/Imem.h"
+
+#define UNIT_TEST_NAME        "DXE Core Memory Map Tree Unit Test"
+#define UNIT_TEST_VERSION     "1.0"
+
+#define TEST_MAX_ENTRIES      8192
+#define TEST_MAP_PAGES        0x100000
+#define TEST_STRESS_ROUNDS    20000
+#define TEST_REINSERT_COUNT   200
+
+///=== TEST DATA ==================================================================================
+
+//
+// The test memory map: the descriptors in use cover [0, TEST_MAP_PAGES) pages
+// without holes, like the memory map of one memory resource.
+//
+MEMORY_MAP         mTestEntries[TEST_MAX_ENTRIES];
+BOOLEAN            mTestEntryInUse[TEST_MAX_ENTRIES];
+ADDRESS_TREE_NODE  *mTestRoot;
+UINT32             mTestSeed;
+
+///=== HELPER FUNCTIONS ===========================================================================
+
+/**
+  Get a pseudo random number.
+
+  @return A pseudo random number.
+**/
+UINT32
+TestRandom (
+  VOID
+  )
+{
+  mTestSeed = mTestSeed * 1103515245 + 12345;
+  return mTestSeed >> 8;
+}
+
+/**
+  Get a descriptor which is not in use.
+
+  @return The descriptor, or NULL if all are in use.
+**/
+MEMORY_MAP *
+TestNewEntry (
+  VOID
+  )
+{
+  UINTN   Index;
+
+  for (Index = 0; Index < TEST_MAX_ENTRIES; Index++) {
+    if (!mTestEntryInUse[Index]) {
+      mTestEntryInUse[Index] = TRUE;
+      ZeroMem (&mTestEntries[Index], sizeof (MEMORY_MAP));
+      return &mTestEntries[Index];
+    }
+  }
+  return NULL;
+}
+
+/**
+  Remove a descriptor from the tree and release it.
+
+  @param[in]  Entry  The descriptor.
+**/
+VOID
+TestRemoveEntry (
+  IN MEMORY_MAP   *Entry
+  )
+{
+  MemoryMapTreeRemove (&mTestRoot, Entry);
+  mTestEntryInUse[Entry - mTestEntries] = FALSE;
+}
+
+/**
+  Insert a new descriptor in the tree.
+
+  @param[in]  Type   The memory type.
+  @param[in]  Start  The first byte of the descriptor.
+  @param[in]  End    The last byte of the descriptor.
+
+  @return The descriptor.
+**/
+MEMORY_MAP *
+TestAddEntry (
+  IN EFI_MEMORY_TYPE        Type,
+  IN EFI_PHYSICAL_ADDRESS   Start,
+  IN EFI_PHYSICAL_ADDRESS   End
+  )
+{
+  MEMORY_MAP  *Entry;
+
+  Entry = TestNewEntry ();
+  ASSERT (Entry != NULL);
+  Entry->Type  = Type;
+  Entry->Start = Start;
+  Entry->End   = End;
+  MemoryMapTreeInsert (&mTestRoot, Entry);
+  return Entry;
+}
+
+/**
+  Find the descriptor covering an address by scanning all the descriptors, as
+  the memory map did with its list.
+
+  @param[in]  Address  The address.
+
+  @return The descriptor, or NULL if there is none.
+**/
+MEMORY_MAP *
+LinearFind (
+  IN EFI_PHYSICAL_ADDRESS   Address
+  )
+{
+  UINTN   Index;
+
+  for (Index = 0; Index < TEST_MAX_ENTRIES; Index++) {
+    if (mTestEntryInUse[Index] &&
+        mTestEntries[Index].Start <= Address && mTestEntries[Index].End >= Address) {
+      return &mTestEntries[Index];
+    }
+  }
+  return NULL;
+}
+
+/**
+  Find the free descriptor with the highest start address not above MaxStart,
+  among the ones of at least MinBytes, by scanning all the descriptors.
+
+  @param[in]  MaxStart  The highest start address accepted.
+  @param[in]  MinBytes  The smallest size accepted.
+
+  @return The descriptor, or NULL if there is none.
+**/
+MEMORY_MAP *
+LinearFindLastFree (
+  IN EFI_PHYSICAL_ADDRESS   MaxStart,
+  IN UINT64                 MinBytes
+  )
+{
+  UINTN       Index;
+  MEMORY_MAP  *Found;
+  MEMORY_MAP  *Entry;
+
+  Found = NULL;
+  for (Index = 0; Index < TEST_MAX_ENTRIES; Index++) {
+    Entry = &mTestEntries[Index];
+    if (mTestEntryInUse[Index] && Entry->Type == EfiConventionalMemory &&
+        Entry->Start <= MaxStart && Entry->End - Entry->Start + 1 >= MinBytes &&
+        (Found == NULL || Entry->Start > Found->Start)) {
+      Found = Entry;
+    }
+  }
+  return Found;
+}
+
+/**
+  Check the order, the balance and the free size records of a subtree.
+
+  @param[in]   Node      The root of the subtree.
+  @param[out]  Height    The height of the subtree.
+  @param[out]  MaxFree   The size of the largest free descriptor of the subtree.
+
+  @return The number of descriptors in the subtree, or MAX_UINTN if the
+          subtree is not valid.
+**/
+UINTN
+CheckSubtree (
+  IN  ADDRESS_TREE_NODE   *Node,
+  OUT UINTN               *Height,
+  OUT UINT64              *MaxFree
+  )
+{
+  UINTN       LeftCount;
+  UINTN       RightCount;
+  UINTN       LeftHeight;
+  UINTN       RightHeight;
+  UINT64      LeftMaxFree;
+  UINT64      RightMaxFree;
+  MEMORY_MAP  *Entry;
+  MEMORY_MAP  *Left;
+  MEMORY_MAP  *Right;
+
+  *Height  = 0;
+  *MaxFree = 0;
+  if (Node == NULL) {
+    return 0;
+  }
+
+  Entry = MEMORY_MAP_FROM_TREE_NODE (Node);
+  Left  = MEMORY_MAP_FROM_TREE_NODE (Node->Left);
+  Right = MEMORY_MAP_FROM_TREE_NODE (Node->Right);
+
+  LeftCount  = CheckSubtree (Node->Left, &LeftHeight, &LeftMaxFree);
+  RightCount = CheckSubtree (Node->Right, &RightHeight, &RightMaxFree);
+  if (LeftCount == MAX_UINTN || RightCount == MAX_UINTN ||
+      (Left != NULL && (Node->Left->Parent != Node || Left->End >= Entry->Start)) ||
+      (Right != NULL && (Node->Right->Parent != Node || Right->Start <= Entry->End)) ||
+      LeftHeight > RightHeight + 1 || RightHeight > LeftHeight + 1) {
+    return MAX_UINTN;
+  }
+
+  *Height  = MAX (LeftHeight, RightHeight) + 1;
+  *MaxFree = MAX (LeftMaxFree, RightMaxFree);
+  if (Entry->Type == EfiConventionalMemory) {
+    *MaxFree = MAX (*MaxFree, Entry->End - Entry->Start + 1);
+  }
+  if (*Height != Node->Height || *MaxFree != Entry->TreeMaxFreeBytes) {
+    return MAX_UINTN;
+  }
+
+  return LeftCount + RightCount + 1;
+}
+
+/**
+  Merge a descriptor with its neighbours of the same type, as CoreAddRange()
+  does.
+
+  @param[in]  Entry  The descriptor.
+**/
+VOID
+TestMergeEntry (
+  IN MEMORY_MAP   *Entry
+  )
+{
+  MEMORY_MAP  *Neighbour;
+
+  Neighbour = (Entry->Start == 0) ? NULL : MemoryMapTreeFind (mTestRoot, Entry->Start - 1);
+  if (Neighbour != NULL && Neighbour->Type == Entry->Type) {
+    TestRemoveEntry (Neighbour);
+    Entry->Start = Neighbour->Start;
+    MemoryMapTreeUpdate (Entry);
+  }
+
+  Neighbour = MemoryMapTreeFind (mTestRoot, Entry->End + 1);
+  if (Neighbour != NULL && Neighbour->Type == Entry->Type) {
+    TestRemoveEntry (Neighbour);
+    Entry->End = Neighbour->End;
+    MemoryMapTreeUpdate (Entry);
+  }
+}
+
+/**
+  Allocate pages from the top of the highest free descriptor large enough.
+
+  @param[in]  Bytes  The size to allocate.
+
+  @return The allocated address, or 0 if there is no free descriptor large
+          enough or no descriptor left.
+**/
+EFI_PHYSICAL_ADDRESS
+TestAllocate (
+  IN UINT64   Bytes
+  )
+{
+  MEMORY_MAP            *Entry;
+  MEMORY_MAP            *NewEntry;
+  EFI_PHYSICAL_ADDRESS  Address;
+
+  Entry = MemoryMapTreeFindLastFree (mTestRoot, MAX_UINT64, Bytes);
+  if (Entry == NULL) {
+    return 0;
+  }
+
+  if (Entry->End - Entry->Start + 1 == Bytes) {
+    Address     = Entry->Start;
+    Entry->Type = EfiBootServicesData;
+    MemoryMapTreeUpdate (Entry);
+    TestMergeEntry (Entry);
+    return Address;
+  }
+
+  NewEntry = TestNewEntry ();
+  if (NewEntry == NULL) {
+    return 0;
+  }
+  Entry->End -= Bytes;
+  MemoryMapTreeUpdate (Entry);
+
+  NewEntry->Type  = EfiBootServicesData;
+  NewEntry->Start = Entry->End + 1;
+  NewEntry->End   = Entry->End + Bytes;
+  MemoryMapTreeInsert (&mTestRoot, NewEntry);
+  TestMergeEntry (NewEntry);
+  return Entry->End + 1;
+}
+
+/**
+  Start from an empty memory map.
+
+  @param[in]  Context  Unit test case context
+**/
+UNIT_TEST_STATUS
+EFIAPI
+ClearTestMap (
+  IN UNIT_TEST_CONTEXT      Context
+  )
+{
+  ZeroMem (mTestEntryInUse, sizeof (mTestEntryInUse));
+  mTestRoot = NULL;
+  mTestSeed = 0x1234;
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Build a memory map made of one free descriptor covering the test range.
+
+  @param[in]  Context  Unit test case context
+**/
+UNIT_TEST_STATUS
+EFIAPI
+BuildTestMap (
+  IN UNIT_TEST_CONTEXT      Context
+  )
+{
+  MEMORY_MAP  *Entry;
+
+  ZeroMem (mTestEntryInUse, sizeof (mTestEntryInUse));
+  mTestRoot = NULL;
+  mTestSeed = 0x1234;
+
+  Entry = TestNewEntry ();
+  Entry->Type  = EfiConventionalMemory;
+  Entry->Start = 0;
+  Entry->End   = LShiftU64 (TEST_MAP_PAGES, EFI_PAGE_SHIFT) - 1;
+  MemoryMapTreeInsert (&mTestRoot, Entry);
+  return UNIT_TEST_PASSED;
+}
+
+///=== TEST CASES =================================================================================
+
+/**
+  Allocate and free pages at random, and check after each operation that the
+  tree is balanced, that it holds every descriptor in address order, and that
+  its lookups give the same descriptors as a scan of all the descriptors.
+
+  @param[in]  Context  Unit test case context
+**/
+UNIT_TEST_STATUS
+EFIAPI
+TreeShouldMatchLinearSearch (
+  IN UNIT_TEST_CONTEXT      Context
+  )
+{
+  UINTN                 Round;
+  UINTN                 Index;
+  UINTN                 Count;
+  UINTN                 Height;
+  UINT64                MaxFree;
+  UINT64                Bytes;
+  EFI_PHYSICAL_ADDRESS  Address;
+  MEMORY_MAP            *Entry;
+
+  for (Round = 0; Round < TEST_STRESS_ROUNDS; Round++) {
+    if ((TestRandom () % 3) != 0) {
+      Bytes = LShiftU64 ((TestRandom () % 64) + 1, EFI_PAGE_SHIFT);
+      UT_ASSERT_EQUAL (
+        (UINTN) MemoryMapTreeFindLastFree (mTestRoot, MAX_UINT64, Bytes),
+        (UINTN) LinearFindLastFree (MAX_UINT64, Bytes)
+        );
+      TestAllocate (Bytes);
+    } else {
+      Index = TestRandom () % TEST_MAX_ENTRIES;
+      if (mTestEntryInUse[Index] && mTestEntries[Index].Type != EfiConventionalMemory) {
+        mTestEntries[Index].Type = EfiConventionalMemory;
+        MemoryMapTreeUpdate (&mTestEntries[Index]);
+        TestMergeEntry (&mTestEntries[Index]);
+      }
+    }
+
+    Count = 0;
+    for (Index = 0; Index < TEST_MAX_ENTRIES; Index++) {
+      Count += mTestEntryInUse[Index] ? 1 : 0;
+    }
+    UT_ASSERT_EQUAL (CheckSubtree (mTestRoot, &Height, &MaxFree), Count);
+
+    Address = LShiftU64 (TestRandom () % TEST_MAP_PAGES, EFI_PAGE_SHIFT) + (TestRandom () % EFI_PAGE_SIZE);
+    UT_ASSERT_EQUAL ((UINTN) MemoryMapTreeFind (mTestRoot, Address), (UINTN) LinearFind (Address));
+    Bytes = LShiftU64 ((TestRandom () % 128) + 1, EFI_PAGE_SHIFT);
+    UT_ASSERT_EQUAL (
+      (UINTN) MemoryMapTreeFindLastFree (mTestRoot, Address, Bytes),
+      (UINTN) LinearFindLastFree (Address, Bytes)
+      );
+  }
+
+  //
+  // The descriptors must be walked in address order without holes.
+  //
+  Entry   = MemoryMapTreeFind (mTestRoot, 0);
+  Address = 0;
+  while (Entry != NULL) {
+    UT_ASSERT_EQUAL (Entry->Start, Address);
+    Address = Entry->End + 1;
+    Entry   = MemoryMapTreeNext (Entry);
+  }
+  UT_ASSERT_EQUAL (Address, LShiftU64 (TEST_MAP_PAGES, EFI_PAGE_SHIFT));
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Lookups at the first and last byte of each descriptor, in the holes between
+  them and at both ends of the address space must find the right descriptor.
+
+  @param[in]  Context  Unit test case context
+**/
+UNIT_TEST_STATUS
+EFIAPI
+BoundaryAddressesShouldBeFound (
+  IN UNIT_TEST_CONTEXT      Context
+  )
+{
+  MEMORY_MAP  *Low;
+  MEMORY_MAP  *Middle;
+  MEMORY_MAP  *High;
+  UINTN       Height;
+  UINT64      MaxFree;
+
+  //
+  // [0, 0xFFF] free, a hole, [0x2000, 0x3FFF] allocated, then free memory up
+  // to the end of the address space.
+  //
+  High   = TestAddEntry (EfiConventionalMemory, 0x4000, MAX_UINT64);
+  Low    = TestAddEntry (EfiConventionalMemory, 0, 0xFFF);
+  Middle = TestAddEntry (EfiBootServicesData, 0x2000, 0x3FFF);
+  UT_ASSERT_EQUAL (CheckSubtree (mTestRoot, &Height, &MaxFree), 3);
+  UT_ASSERT_EQUAL (MaxFree, MAX_UINT64 - 0x4000 + 1);
+
+  UT_ASSERT_EQUAL ((UINTN) MemoryMapTreeFind (mTestRoot, 0), (UINTN) Low);
+  UT_ASSERT_EQUAL ((UINTN) MemoryMapTreeFind (mTestRoot, 0xFFF), (UINTN) Low);
+  UT_ASSERT_EQUAL ((UINTN) MemoryMapTreeFind (mTestRoot, 0x1000), 0);
+  UT_ASSERT_EQUAL ((UINTN) MemoryMapTreeFind (mTestRoot, 0x1FFF), 0);
+  UT_ASSERT_EQUAL ((UINTN) MemoryMapTreeFind (mTestRoot, 0x2000), (UINTN) Middle);
+  UT_ASSERT_EQUAL ((UINTN) MemoryMapTreeFind (mTestRoot, 0x3FFF), (UINTN) Middle);
+  UT_ASSERT_EQUAL ((UINTN) MemoryMapTreeFind (mTestRoot, 0x4000), (UINTN) High);
+  UT_ASSERT_EQUAL ((UINTN) MemoryMapTreeFind (mTestRoot, MAX_UINT64), (UINTN) High);
+
+  UT_ASSERT_EQUAL ((UINTN) MemoryMapTreeNext (Low), (UINTN) Middle);
+  UT_ASSERT_EQUAL ((UINTN) MemoryMapTreeNext (Middle), (UINTN) High);
+  UT_ASSERT_EQUAL ((UINTN) MemoryMapTreeNext (High), 0);
+
+  //
+  // MaxStart is inclusive, and MinBytes may be the exact size of a descriptor.
+  //
+  UT_ASSERT_EQUAL ((UINTN) MemoryMapTreeFindLastFree (mTestRoot, MAX_UINT64, EFI_PAGE_SIZE), (UINTN) High);
+  UT_ASSERT_EQUAL ((UINTN) MemoryMapTreeFindLastFree (mTestRoot, 0x4000, EFI_PAGE_SIZE), (UINTN) High);
+  UT_ASSERT_EQUAL ((UINTN) MemoryMapTreeFindLastFree (mTestRoot, 0x3FFF, EFI_PAGE_SIZE), (UINTN) Low);
+  UT_ASSERT_EQUAL ((UINTN) MemoryMapTreeFindLastFree (mTestRoot, 0, EFI_PAGE_SIZE), (UINTN) Low);
+  UT_ASSERT_EQUAL ((UINTN) MemoryMapTreeFindLastFree (mTestRoot, 0x3FFF, EFI_PAGE_SIZE + 1), 0);
+  UT_ASSERT_EQUAL ((UINTN) MemoryMapTreeFindLastFree (mTestRoot, MAX_UINT64, MAX_UINT64 - 0x4000 + 1), (UINTN) High);
+  UT_ASSERT_EQUAL ((UINTN) MemoryMapTreeFindLastFree (mTestRoot, MAX_UINT64, MAX_UINT64 - 0x4000 + 2), 0);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Split a free descriptor in three and merge it back, as CoreAddRange() and
+  CoreConvertPages() do. The clipped descriptors keep their node, so the free
+  size records must follow the bounds changed in place.
+
+  @param[in]  Context  Unit test case context
+**/
+UNIT_TEST_STATUS
+EFIAPI
+ClippedDescriptorsShouldBeFound (
+  IN UNIT_TEST_CONTEXT      Context
+  )
+{
+  MEMORY_MAP            *Whole;
+  MEMORY_MAP            *Middle;
+  MEMORY_MAP            *Top;
+  EFI_PHYSICAL_ADDRESS  MapEnd;
+  UINTN                 Height;
+  UINT64                MaxFree;
+
+  MapEnd = LShiftU64 (TEST_MAP_PAGES, EFI_PAGE_SHIFT) - 1;
+  Whole  = MemoryMapTreeFind (mTestRoot, 0);
+  UT_ASSERT_NOT_NULL (Whole);
+
+  //
+  // Allocate [0x10000, 0x1FFFF]: clip the free descriptor below it, then add
+  // the allocated range and the free remainder above it.
+  //
+  Whole->End = 0xFFFF;
+  MemoryMapTreeUpdate (Whole);
+  Middle = TestAddEntry (EfiBootServicesData, 0x10000, 0x1FFFF);
+  Top    = TestAddEntry (EfiConventionalMemory, 0x20000, MapEnd);
+  UT_ASSERT_EQUAL (CheckSubtree (mTestRoot, &Height, &MaxFree), 3);
+  UT_ASSERT_EQUAL (MaxFree, MapEnd - 0x20000 + 1);
+
+  UT_ASSERT_EQUAL ((UINTN) MemoryMapTreeFind (mTestRoot, 0xFFFF), (UINTN) Whole);
+  UT_ASSERT_EQUAL ((UINTN) MemoryMapTreeFind (mTestRoot, 0x10000), (UINTN) Middle);
+  UT_ASSERT_EQUAL ((UINTN) MemoryMapTreeFind (mTestRoot, 0x1FFFF), (UINTN) Middle);
+  UT_ASSERT_EQUAL ((UINTN) MemoryMapTreeFind (mTestRoot, 0x20000), (UINTN) Top);
+  UT_ASSERT_EQUAL ((UINTN) MemoryMapTreeFindLastFree (mTestRoot, 0x1FFFF, 0x10000), (UINTN) Whole);
+  UT_ASSERT_EQUAL ((UINTN) MemoryMapTreeFindLastFree (mTestRoot, 0x1FFFF, 0x10001), 0);
+
+  //
+  // Clip the bottom of the top descriptor: its free size must shrink.
+  //
+  Top->Start = MapEnd - 0xFFFF;
+  MemoryMapTreeUpdate (Top);
+  UT_ASSERT_EQUAL ((UINTN) MemoryMapTreeFind (mTestRoot, 0x20000), 0);
+  UT_ASSERT_EQUAL ((UINTN) MemoryMapTreeFindLastFree (mTestRoot, MAX_UINT64, 0x10001), 0);
+  UT_ASSERT_EQUAL ((UINTN) MemoryMapTreeFindLastFree (mTestRoot, MAX_UINT64, 0x10000), (UINTN) Top);
+  UT_ASSERT_EQUAL (CheckSubtree (mTestRoot, &Height, &MaxFree), 3);
+
+  //
+  // Free the middle descriptor and grow the top one back: everything merges
+  // into one free descriptor.
+  //
+  Top->Start = 0x20000;
+  MemoryMapTreeUpdate (Top);
+  Middle->Type = EfiConventionalMemory;
+  MemoryMapTreeUpdate (Middle);
+  TestMergeEntry (Middle);
+  UT_ASSERT_EQUAL (CheckSubtree (mTestRoot, &Height, &MaxFree), 1);
+  UT_ASSERT_EQUAL (MaxFree, MapEnd + 1);
+  UT_ASSERT_EQUAL ((UINTN) MemoryMapTreeFind (mTestRoot, 0), (UINTN) Middle);
+  UT_ASSERT_EQUAL ((UINTN) MemoryMapTreeFind (mTestRoot, MapEnd), (UINTN) Middle);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Remove every descriptor in a pseudo random order down to an empty tree,
+  then insert them again from the highest address down, checking the tree
+  after each operation.
+
+  @param[in]  Context  Unit test case context
+**/
+UNIT_TEST_STATUS
+EFIAPI
+RemovedDescriptorsShouldBeInsertedAgain (
+  IN UNIT_TEST_CONTEXT      Context
+  )
+{
+  UINTN       Index;
+  UINTN       Count;
+  UINTN       Height;
+  UINT64      MaxFree;
+
+  MemoryMapTreeRemove (&mTestRoot, MemoryMapTreeFind (mTestRoot, 0));
+  mTestEntryInUse[0] = FALSE;
+  UT_ASSERT_EQUAL ((UINTN) mTestRoot, 0);
+
+  //
+  // Descriptors of one page, every other page, alternating free and
+  // allocated.
+  //
+  for (Index = 0; Index < TEST_REINSERT_COUNT; Index++) {
+    TestAddEntry (
+      ((Index % 2) == 0) ? EfiConventionalMemory : EfiBootServicesData,
+      LShiftU64 (Index * 2, EFI_PAGE_SHIFT),
+      LShiftU64 (Index * 2 + 1, EFI_PAGE_SHIFT) - 1
+      );
+  }
+  UT_ASSERT_EQUAL (CheckSubtree (mTestRoot, &Height, &MaxFree), TEST_REINSERT_COUNT);
+
+  for (Count = TEST_REINSERT_COUNT; Count > 0; Count--) {
+    do {
+      Index = TestRandom () % TEST_REINSERT_COUNT;
+    } while (!mTestEntryInUse[Index]);
+    TestRemoveEntry (&mTestEntries[Index]);
+    UT_ASSERT_EQUAL ((UINTN) MemoryMapTreeFind (mTestRoot, mTestEntries[Index].Start), 0);
+    UT_ASSERT_EQUAL (CheckSubtree (mTestRoot, &Height, &MaxFree), Count - 1);
+  }
+  UT_ASSERT_EQUAL ((UINTN) mTestRoot, 0);
+  UT_ASSERT_EQUAL ((UINTN) MemoryMapTreeFind (mTestRoot, 0), 0);
+  UT_ASSERT_EQUAL ((UINTN) MemoryMapTreeFindLastFree (mTestRoot, MAX_UINT64, 1), 0);
+
+  for (Index = TEST_REINSERT_COUNT; Index > 0; Index--) {
+    mTestEntryInUse[Index - 1] = TRUE;
+    MemoryMapTreeInsert (&mTestRoot, &mTestEntries[Index - 1]);
+    UT_ASSERT_EQUAL (CheckSubtree (mTestRoot, &Height, &MaxFree), TEST_REINSERT_COUNT - Index + 1);
+  }
+
+  for (Index = 0; Index < TEST_REINSERT_COUNT; Index++) {
+    UT_ASSERT_EQUAL ((UINTN) MemoryMapTreeFind (mTestRoot, mTestEntries[Index].End), (UINTN) &mTestEntries[Index]);
+    UT_ASSERT_EQUAL ((UINTN) MemoryMapTreeFind (mTestRoot, mTestEntries[Index].End + 1), 0);
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Main entry point to this unit test application.
+
+  Sets up and runs the test suites.
+**/
+VOID
+EFIAPI
+UnitTestMain (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      TreeTests;
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_NAME, UNIT_TEST_VERSION));
+
+  //
+  // Start setting up the test framework for running the tests.
+  //
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_NAME, gEfiCallerBaseName, UNIT_TEST_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  //
+  // Add all test suites and tests.
+  //
+  Status = CreateUnitTestSuite (
+             &TreeTests, Framework,
+             "Memory Map Tree Tests", "DxeCore.MemoryMapTree", NULL, NULL
+             );
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for TreeTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+  AddTestCase (
+    TreeTests,
+    "Tree lookups should match a scan of the descriptors", "MatchLinear",
+    TreeShouldMatchLinearSearch, BuildTestMap, NULL, NULL
+    );
+  AddTestCase (
+    TreeTests,
+    "Boundary addresses should be found", "Boundaries",
+    BoundaryAddressesShouldBeFound, ClearTestMap, NULL, NULL
+    );
+  AddTestCase (
+    TreeTests,
+    "Descriptors clipped in place should be found", "Clip",
+    ClippedDescriptorsShouldBeFound, BuildTestMap, NULL, NULL
+    );
+  AddTestCase (
+    TreeTests,
+    "Removed descriptors should be inserted again", "Reinsert",
+    RemovedDescriptorsShouldBeInsertedAgain, BuildTestMap, NULL, NULL
+    );
+
+  //
+  // Execute the tests.
+  //
+  Status = RunAllTestSuites (Framework);
+
+EXIT:
+  if (Framework != NULL) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return;
+}
+
+///
+/// Avoid ECC error for function name that starts with lower case letter
+///
+#define Main main
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+
+  @param[in] Argc  Number of arguments
+  @param[in] Argv  Array of pointers to arguments
+
+  @retval 0      Success
+  @retval other  Error
+**/
+INT32
+Main (
+  IN INT32  Argc,
+  IN CHAR8  *Argv[]
+  )
+{
+  UnitTestMain ();
+  return 0;
+}
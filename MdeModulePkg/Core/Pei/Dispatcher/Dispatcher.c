@@ -9,6 +9,96 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 
 #include "PeiMain.h"
 
+/**
+  Reorder the PEIMs of one FV that are not in the Apriori file as listed in the
+  dispatch order file of the FV, if there is one. The PEIMs that are not listed
+  keep their order after the listed ones. The DEPEX of the PEIMs is evaluated
+  as usual, so a stale dispatch order file only costs more dispatch passes.
+
+  @param Private          Pointer to the private data passed in from caller
+  @param CoreFileHandle   The instance of PEI_CORE_FV_HANDLE.
+
+**/
+VOID
+OrderPeimsWithDispatchOrder (
+  IN  PEI_CORE_INSTANCE    *Private,
+  IN  PEI_CORE_FV_HANDLE   *CoreFileHandle
+  )
+{
+  EFI_STATUS                          Status;
+  EFI_PEI_FILE_HANDLE                 OrderFileHandle;
+  EFI_GUID                            *Order;
+  UINTN                               OrderCount;
+  UINTN                               Index;
+  UINTN                               Index2;
+  UINTN                               PeimIndex;
+  UINTN                               PeimCount;
+  EFI_GUID                            *Guid;
+  EFI_PEI_FILE_HANDLE                 *TempFileHandles;
+  EFI_GUID                            *TempFileGuid;
+  EFI_PEI_FIRMWARE_VOLUME_PPI         *FvPpi;
+  EFI_FV_FILE_INFO                    FileInfo;
+
+  FvPpi = CoreFileHandle->FvPpi;
+
+  //
+  // Read the dispatch order file
+  //
+  Status = FvPpi->FindFileByName (FvPpi, &gEdkiiPeiDispatchOrderFileGuid, &CoreFileHandle->FvHandle, &OrderFileHandle);
+  if (EFI_ERROR (Status) || (OrderFileHandle == NULL)) {
+    return;
+  }
+  Status = FvPpi->FindSectionByType (FvPpi, EFI_SECTION_RAW, OrderFileHandle, (VOID **) &Order);
+  if (EFI_ERROR (Status)) {
+    return;
+  }
+  Status = FvPpi->GetFileInfo (FvPpi, OrderFileHandle, &FileInfo);
+  ASSERT_EFI_ERROR (Status);
+  OrderCount = FileInfo.BufferSize;
+  if (IS_SECTION2 (FileInfo.Buffer)) {
+    OrderCount -= sizeof (EFI_COMMON_SECTION_HEADER2);
+  } else {
+    OrderCount -= sizeof (EFI_COMMON_SECTION_HEADER);
+  }
+  OrderCount /= sizeof (EFI_GUID);
+
+  //
+  // Move the PEIMs that are not in the Apriori file to the temporary arrays.
+  //
+  TempFileHandles = Private->TempFileHandles;
+  TempFileGuid    = Private->TempFileGuid;
+  PeimCount       = CoreFileHandle->PeimCount - Private->AprioriCount;
+  for (Index = 0; Index < PeimCount; Index++) {
+    TempFileHandles[Index] = CoreFileHandle->FvFileHandles[Private->AprioriCount + Index];
+    Status = FvPpi->GetFileInfo (FvPpi, TempFileHandles[Index], &FileInfo);
+    ASSERT_EFI_ERROR (Status);
+    CopyMem (&TempFileGuid[Index], &FileInfo.FileName, sizeof (EFI_GUID));
+  }
+
+  //
+  // Add the PEIMs in the dispatch order file first, then the others.
+  //
+  Index = Private->AprioriCount;
+  for (Index2 = 0; Index2 < OrderCount; Index2++) {
+    Guid = ScanGuid (TempFileGuid, PeimCount * sizeof (EFI_GUID), &Order[Index2]);
+    if (Guid != NULL) {
+      PeimIndex = ((UINTN)Guid - (UINTN)&TempFileGuid[0])/sizeof (EFI_GUID);
+      if (TempFileHandles[PeimIndex] != NULL) {
+        CoreFileHandle->FvFileHandles[Index++] = TempFileHandles[PeimIndex];
+        TempFileHandles[PeimIndex] = NULL;
+      }
+    }
+  }
+
+  for (Index2 = 0; Index2 < PeimCount; Index2++) {
+    if (TempFileHandles[Index2] != NULL) {
+      CoreFileHandle->FvFileHandles[Index++] = TempFileHandles[Index2];
+      TempFileHandles[Index2] = NULL;
+    }
+  }
+  ASSERT (Index == CoreFileHandle->PeimCount);
+}
+
 /**
 
   Discover all PEIMs and optional Apriori file in one FV. There is at most one
@@ -113,13 +203,15 @@ DiscoverPeimsAndOrderWithApriori (
   }
 
   //
-  // Record PeimCount, allocate buffer for PeimState and FvFileHandles.
+  // Record PeimCount, allocate buffer for PeimState, FvFileHandles and PeimDepexInstallCount.
   //
   CoreFileHandle->PeimCount = PeimCount;
   CoreFileHandle->PeimState = AllocateZeroPool (sizeof (UINT8) * PeimCount);
   ASSERT (CoreFileHandle->PeimState != NULL);
   CoreFileHandle->FvFileHandles = AllocateZeroPool (sizeof (EFI_PEI_FILE_HANDLE) * PeimCount);
   ASSERT (CoreFileHandle->FvFileHandles != NULL);
+  CoreFileHandle->PeimDepexInstallCount = AllocateZeroPool (sizeof (UINTN) * PeimCount);
+  ASSERT (CoreFileHandle->PeimDepexInstallCount != NULL);
 
   //
   // Get Apriori File handle
@@ -193,6 +285,11 @@ DiscoverPeimsAndOrderWithApriori (
     CopyMem (CoreFileHandle->FvFileHandles, TempFileHandles, sizeof (EFI_PEI_FILE_HANDLE) * PeimCount);
   }
 
+  //
+  // Order the rest of the PEIMs as the dispatch order file of the FV lists them.
+  //
+  OrderPeimsWithDispatchOrder (Private, CoreFileHandle);
+
   //
   // The current FV File Handles have been cached. So that we don't have to scan the FV again.
   // Instead, we can retrieve the file handles within this FV from cached records.
@@ -1492,6 +1589,7 @@ PeiDispatcher (
     } else {
       Private->PeimDispatcherReenter    = FALSE;
     }
+    Private->DispatchPassCount++;
 
     for (FvCount = Private->CurrentPeimFvCount; FvCount < Private->FvCount; FvCount++) {
       CoreFvHandle = FindNextCoreFvHandle (Private, FvCount);
@@ -1691,6 +1789,12 @@ PeiDispatcher (
     //
   } while (Private->PeimNeedingDispatch && Private->PeimDispatchOnThisPass);
 
+  DEBUG ((
+    DEBUG_INFO,
+    "PEI Dispatcher: %d passes, %d DEPEX evaluations\n",
+    (UINT32) Private->DispatchPassCount,
+    (UINT32) Private->DepexEvaluationCount
+    ));
 }
 
 /**
@@ -1746,6 +1850,15 @@ DepexSatisfied (
   EFI_STATUS           Status;
   VOID                 *DepexData;
   EFI_FV_FILE_INFO     FileInfo;
+  UINTN                *DepexInstallCount;
+
+  //
+  // A DEPEX found unsatisfied stays unsatisfied until a PPI is installed.
+  //
+  DepexInstallCount = &Private->Fv[Private->CurrentPeimFvCount].PeimDepexInstallCount[PeimCount];
+  if (*DepexInstallCount == Private->PpiData.PpiList.InstallCount + 1) {
+    return FALSE;
+  }
 
   Status = PeiServicesFfsGetFileInfo (FileHandle, &FileInfo);
   if (EFI_ERROR (Status)) {
@@ -1782,7 +1895,13 @@ DepexSatisfied (
   //
   // Evaluate a given DEPEX
   //
-  return PeimDispatchReadiness (&Private->Ps, DepexData);
+  Private->DepexEvaluationCount++;
+  if (!PeimDispatchReadiness (&Private->Ps, DepexData)) {
+    *DepexInstallCount = Private->PpiData.PpiList.InstallCount + 1;
+    return FALSE;
+  }
+
+  return TRUE;
 }
 
 /**
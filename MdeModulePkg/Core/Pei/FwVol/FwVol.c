@@ -245,10 +245,12 @@ FileHandleToVolume (
 /**
   Given the input file pointer, search for the first matching file in the
   FFS volume as defined by SearchType. The search starts from FileHeader inside
-  the Firmware Volume defined by FwVolHeader.
+  the Firmware Volume defined by FwVolHeader by walking the file headers.
   If SearchType is EFI_FV_FILETYPE_ALL, the first FFS file will return without check its file type.
   If SearchType is PEI_CORE_INTERNAL_FFS_FILE_DISPATCH_TYPE,
   the first PEIM, or COMBINED PEIM or FV file type FFS file will return.
+  If SearchType is PEI_CORE_INTERNAL_FFS_FILE_INDEX_TYPE,
+  the next valid FFS file will return, including pad files.
 
   @param FvHandle        Pointer to the FV header of the volume to search
   @param FileName        File name
@@ -262,7 +264,7 @@ FileHandleToVolume (
 
 **/
 EFI_STATUS
-FindFileEx (
+FindFileExByWalk (
   IN  CONST EFI_PEI_FV_HANDLE        FvHandle,
   IN  CONST EFI_GUID                 *FileName,   OPTIONAL
   IN        EFI_FV_FILETYPE          SearchType,
@@ -397,6 +399,9 @@ FindFileEx (
           *FileHeader = FfsFileHeader;
           return EFI_SUCCESS;
         }
+      } else if (SearchType == PEI_CORE_INTERNAL_FFS_FILE_INDEX_TYPE) {
+        *FileHeader = FfsFileHeader;
+        return EFI_SUCCESS;
       } else if (SearchType == PEI_CORE_INTERNAL_FFS_FILE_DISPATCH_TYPE) {
         if ((FfsFileHeader->Type == EFI_FV_FILETYPE_PEIM) ||
             (FfsFileHeader->Type == EFI_FV_FILETYPE_COMBINED_PEIM_DRIVER) ||
@@ -446,6 +451,304 @@ FindFileEx (
   return EFI_NOT_FOUND;
 }
 
+/**
+  Fold the name of a FFS file into the 16-bit hash kept in the file index.
+
+  @param FileName        File name
+
+  @return The hash of the file name.
+**/
+UINT16
+FvFileNameHash (
+  IN CONST EFI_GUID                 *FileName
+  )
+{
+  UINT32                                Hash;
+
+  Hash = ReadUnaligned32 ((CONST UINT32 *) FileName) ^
+         ReadUnaligned32 ((CONST UINT32 *) FileName + 1) ^
+         ReadUnaligned32 ((CONST UINT32 *) FileName + 2) ^
+         ReadUnaligned32 ((CONST UINT32 *) FileName + 3);
+
+  return (UINT16) (Hash ^ (Hash >> 16));
+}
+
+/**
+  Count the FFS files in the valid state of a firmware volume.
+
+  Only the file headers are visited, so the count is an upper bound of the
+  number of files FindFileExByWalk() returns from the volume.
+
+  @param FvHandle        Pointer to the FV header of the volume to count
+
+  @return The number of FFS files in the valid state.
+**/
+UINTN
+CountFvFiles (
+  IN CONST EFI_PEI_FV_HANDLE        FvHandle
+  )
+{
+  EFI_FIRMWARE_VOLUME_HEADER            *FwVolHeader;
+  EFI_FIRMWARE_VOLUME_EXT_HEADER        *FwVolExtHeader;
+  EFI_FFS_FILE_HEADER                   *FfsFileHeader;
+  UINT64                                FileOffset;
+  UINT32                                FileSize;
+  UINT8                                 ErasePolarity;
+  UINT8                                 FileState;
+  UINTN                                 Count;
+
+  FwVolHeader = (EFI_FIRMWARE_VOLUME_HEADER *) FvHandle;
+  if ((FwVolHeader->Attributes & EFI_FVB2_ERASE_POLARITY) != 0) {
+    ErasePolarity = 1;
+  } else {
+    ErasePolarity = 0;
+  }
+
+  if (FwVolHeader->ExtHeaderOffset != 0) {
+    FwVolExtHeader = (EFI_FIRMWARE_VOLUME_EXT_HEADER *) ((UINT8 *) FwVolHeader + FwVolHeader->ExtHeaderOffset);
+    FfsFileHeader = (EFI_FFS_FILE_HEADER *) ((UINT8 *) FwVolExtHeader + FwVolExtHeader->ExtHeaderSize);
+  } else {
+    FfsFileHeader = (EFI_FFS_FILE_HEADER *)((UINT8 *) FwVolHeader + FwVolHeader->HeaderLength);
+  }
+  FfsFileHeader = (EFI_FFS_FILE_HEADER *) ALIGN_POINTER (FfsFileHeader, 8);
+  FileOffset    = (UINT64) ((UINT8 *) FfsFileHeader - (UINT8 *) FwVolHeader);
+
+  Count = 0;
+  while (FileOffset < (FwVolHeader->FvLength - sizeof (EFI_FFS_FILE_HEADER))) {
+    FileState = GetFileState (ErasePolarity, FfsFileHeader);
+    if ((FileState == EFI_FILE_HEADER_CONSTRUCTION) || (FileState == EFI_FILE_HEADER_INVALID)) {
+      FileSize = IS_FFS_FILE2 (FfsFileHeader) ? sizeof (EFI_FFS_FILE_HEADER2) : sizeof (EFI_FFS_FILE_HEADER);
+    } else if ((FileState == EFI_FILE_DATA_VALID) || (FileState == EFI_FILE_MARKED_FOR_UPDATE) ||
+               (FileState == EFI_FILE_DELETED)) {
+      if (FileState != EFI_FILE_DELETED) {
+        Count++;
+      }
+      FileSize = IS_FFS_FILE2 (FfsFileHeader) ? FFS_FILE2_SIZE (FfsFileHeader) : FFS_FILE_SIZE (FfsFileHeader);
+      FileSize = GET_OCCUPIED_SIZE (FileSize, 8);
+    } else {
+      break;
+    }
+
+    if (FileSize == 0) {
+      break;
+    }
+    FileOffset    += FileSize;
+    FfsFileHeader =  (EFI_FFS_FILE_HEADER *) ((UINT8 *) FfsFileHeader + FileSize);
+  }
+
+  return Count;
+}
+
+/**
+  Build the file index of a firmware volume produced by the PEI Core FV PPI.
+
+  The index records the offset, type and name hash of every valid FFS file, so
+  the later searches of the volume do not walk the file headers nor verify the
+  file checksums again. If the index can not be built, the searches fall back
+  to walking the volume.
+
+  @param CoreFvHandle    Pointer to the PEI_CORE_FV_HANDLE of the volume.
+**/
+VOID
+PeiBuildFvFileIndex (
+  IN OUT PEI_CORE_FV_HANDLE         *CoreFvHandle
+  )
+{
+  PEI_CORE_FV_FILE_INDEX_ENTRY          *FileIndex;
+  EFI_PEI_FILE_HANDLE                   FileHandle;
+  EFI_FFS_FILE_HEADER                   *FfsFileHeader;
+  UINTN                                 MaxCount;
+  UINTN                                 Count;
+
+  CoreFvHandle->FileIndex      = NULL;
+  CoreFvHandle->FileIndexCount = 0;
+
+  if ((CoreFvHandle->FvPpi != &mPeiFfs2FwVol.Fv) && (CoreFvHandle->FvPpi != &mPeiFfs3FwVol.Fv)) {
+    return;
+  }
+
+  PERF_INMODULE_BEGIN ("PeiFvFileIndex");
+
+  MaxCount = CountFvFiles (CoreFvHandle->FvHandle);
+  if (MaxCount == 0) {
+    PERF_INMODULE_END ("PeiFvFileIndex");
+    return;
+  }
+
+  FileIndex = AllocatePool (sizeof (PEI_CORE_FV_FILE_INDEX_ENTRY) * MaxCount);
+  if (FileIndex == NULL) {
+    DEBUG ((DEBUG_WARN, "Fail to allocate the file index of FV %p\n", CoreFvHandle->FvHandle));
+    PERF_INMODULE_END ("PeiFvFileIndex");
+    return;
+  }
+
+  Count      = 0;
+  FileHandle = NULL;
+  while (Count < MaxCount) {
+    if (EFI_ERROR (FindFileExByWalk (CoreFvHandle->FvHandle, NULL, PEI_CORE_INTERNAL_FFS_FILE_INDEX_TYPE, &FileHandle, NULL))) {
+      break;
+    }
+    FfsFileHeader               = (EFI_FFS_FILE_HEADER *) FileHandle;
+    FileIndex[Count].Offset     = (UINT32) ((UINTN) FfsFileHeader - (UINTN) CoreFvHandle->FvHandle);
+    FileIndex[Count].Type       = FfsFileHeader->Type;
+    FileIndex[Count].Reserved   = 0;
+    FileIndex[Count].NameHash   = FvFileNameHash (&FfsFileHeader->Name);
+    Count++;
+  }
+
+  CoreFvHandle->FileIndex      = FileIndex;
+  CoreFvHandle->FileIndexCount = Count;
+
+  PERF_INMODULE_END ("PeiFvFileIndex");
+
+  DEBUG ((DEBUG_INFO, "Indexed %d files of FV %p\n", (UINT32) Count, CoreFvHandle->FvHandle));
+}
+
+/**
+  Given the input file pointer, search for the first matching file in the
+  file index of the volume as defined by SearchType.
+
+  @param CoreFvHandle    Pointer to the PEI_CORE_FV_HANDLE of the volume to search.
+  @param FileName        File name
+  @param SearchType      Filter to find only files of this type.
+                         Type EFI_FV_FILETYPE_ALL causes no filtering to be done.
+  @param FileHandle      This parameter must point to a valid FFS volume.
+  @param AprioriFile     Pointer to AprioriFile image in this FV if has
+
+  @return EFI_NOT_FOUND    No files matching the search criteria were found
+  @retval EFI_SUCCESS      Success to search given file
+  @retval EFI_UNSUPPORTED  FileHandle is not in the file index of the volume.
+
+**/
+EFI_STATUS
+FindFileExByIndex (
+  IN        PEI_CORE_FV_HANDLE       *CoreFvHandle,
+  IN  CONST EFI_GUID                 *FileName,   OPTIONAL
+  IN        EFI_FV_FILETYPE          SearchType,
+  IN OUT    EFI_PEI_FILE_HANDLE      *FileHandle,
+  IN OUT    EFI_PEI_FILE_HANDLE      *AprioriFile  OPTIONAL
+  )
+{
+  PEI_CORE_FV_FILE_INDEX_ENTRY          *FileIndex;
+  EFI_FFS_FILE_HEADER                   *FfsFileHeader;
+  UINTN                                 FileOffset;
+  UINTN                                 Index;
+  UINTN                                 Low;
+  UINTN                                 High;
+  UINTN                                 Middle;
+  UINT16                                NameHash;
+  EFI_FV_FILETYPE                       FileType;
+
+  FileIndex = CoreFvHandle->FileIndex;
+
+  if (FileName != NULL) {
+    NameHash = FvFileNameHash (FileName);
+    for (Index = 0; Index < CoreFvHandle->FileIndexCount; Index++) {
+      if (FileIndex[Index].NameHash == NameHash) {
+        FfsFileHeader = (EFI_FFS_FILE_HEADER *) ((UINT8 *) CoreFvHandle->FvHandle + FileIndex[Index].Offset);
+        if (CompareGuid (&FfsFileHeader->Name, FileName)) {
+          *FileHandle = (EFI_PEI_FILE_HANDLE) FfsFileHeader;
+          return EFI_SUCCESS;
+        }
+      }
+    }
+
+    *FileHandle = NULL;
+    return EFI_NOT_FOUND;
+  }
+
+  //
+  // If FileHandle is specified, continue the search after it.
+  //
+  Index = 0;
+  if (*FileHandle != NULL) {
+    FileOffset = (UINTN) *FileHandle - (UINTN) CoreFvHandle->FvHandle;
+    Low        = 0;
+    High       = CoreFvHandle->FileIndexCount;
+    while (Low < High) {
+      Middle = (Low + High) / 2;
+      if (FileIndex[Middle].Offset < FileOffset) {
+        Low = Middle + 1;
+      } else {
+        High = Middle;
+      }
+    }
+    if ((Low == CoreFvHandle->FileIndexCount) || (FileIndex[Low].Offset != FileOffset)) {
+      return EFI_UNSUPPORTED;
+    }
+    Index = Low + 1;
+  }
+
+  for (; Index < CoreFvHandle->FileIndexCount; Index++) {
+    FileType      = FileIndex[Index].Type;
+    FfsFileHeader = (EFI_FFS_FILE_HEADER *) ((UINT8 *) CoreFvHandle->FvHandle + FileIndex[Index].Offset);
+    if (SearchType == PEI_CORE_INTERNAL_FFS_FILE_DISPATCH_TYPE) {
+      if ((FileType == EFI_FV_FILETYPE_PEIM) ||
+          (FileType == EFI_FV_FILETYPE_COMBINED_PEIM_DRIVER) ||
+          (FileType == EFI_FV_FILETYPE_FIRMWARE_VOLUME_IMAGE)) {
+        *FileHandle = (EFI_PEI_FILE_HANDLE) FfsFileHeader;
+        return EFI_SUCCESS;
+      } else if ((AprioriFile != NULL) && (FileType == EFI_FV_FILETYPE_FREEFORM)) {
+        if (CompareGuid (&FfsFileHeader->Name, &gPeiAprioriFileNameGuid)) {
+          *AprioriFile = (EFI_PEI_FILE_HANDLE) FfsFileHeader;
+        }
+      }
+    } else if (((SearchType == FileType) || (SearchType == EFI_FV_FILETYPE_ALL)) &&
+               (FileType != EFI_FV_FILETYPE_FFS_PAD)) {
+      *FileHandle = (EFI_PEI_FILE_HANDLE) FfsFileHeader;
+      return EFI_SUCCESS;
+    }
+  }
+
+  *FileHandle = NULL;
+  return EFI_NOT_FOUND;
+}
+
+/**
+  Given the input file pointer, search for the first matching file in the
+  FFS volume as defined by SearchType. The search starts from FileHeader inside
+  the Firmware Volume defined by FwVolHeader.
+  If SearchType is EFI_FV_FILETYPE_ALL, the first FFS file will return without check its file type.
+  If SearchType is PEI_CORE_INTERNAL_FFS_FILE_DISPATCH_TYPE,
+  the first PEIM, or COMBINED PEIM or FV file type FFS file will return.
+
+  The file index of the volume is used when it has been built, otherwise the
+  volume is walked.
+
+  @param FvHandle        Pointer to the FV header of the volume to search
+  @param FileName        File name
+  @param SearchType      Filter to find only files of this type.
+                         Type EFI_FV_FILETYPE_ALL causes no filtering to be done.
+  @param FileHandle      This parameter must point to a valid FFS volume.
+  @param AprioriFile     Pointer to AprioriFile image in this FV if has
+
+  @return EFI_NOT_FOUND  No files matching the search criteria were found
+  @retval EFI_SUCCESS    Success to search given file
+
+**/
+EFI_STATUS
+FindFileEx (
+  IN  CONST EFI_PEI_FV_HANDLE        FvHandle,
+  IN  CONST EFI_GUID                 *FileName,   OPTIONAL
+  IN        EFI_FV_FILETYPE          SearchType,
+  IN OUT    EFI_PEI_FILE_HANDLE      *FileHandle,
+  IN OUT    EFI_PEI_FILE_HANDLE      *AprioriFile  OPTIONAL
+  )
+{
+  PEI_CORE_FV_HANDLE                    *CoreFvHandle;
+  EFI_STATUS                            Status;
+
+  CoreFvHandle = FvHandleToCoreHandle (FvHandle);
+  if ((CoreFvHandle != NULL) && (CoreFvHandle->FileIndex != NULL)) {
+    Status = FindFileExByIndex (CoreFvHandle, FileName, SearchType, FileHandle, AprioriFile);
+    if (Status != EFI_UNSUPPORTED) {
+      return Status;
+    }
+  }
+
+  return FindFileExByWalk (FvHandle, FileName, SearchType, FileHandle, AprioriFile);
+}
+
 /**
   Initialize PeiCore FV List.
 
@@ -516,6 +819,7 @@ PeiInitializeFv (
     (UINT32) BfvHeader->FvLength,
     FvHandle
     ));
+  PeiBuildFvFileIndex (&PrivateData->Fv[PrivateData->FvCount]);
   PrivateData->FvCount ++;
 
   //
@@ -658,6 +962,7 @@ FirmwareVolumeInfoPpiNotifyCallback (
       FvInfo2Ppi.FvInfoSize,
       FvHandle
       ));
+    PeiBuildFvFileIndex (&PrivateData->Fv[CurFvCount]);
     PrivateData->FvCount ++;
 
     //
@@ -44,6 +44,7 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <Guid/FirmwareFileSystem2.h>
 #include <Guid/FirmwareFileSystem3.h>
 #include <Guid/AprioriFileName.h>
+#include <Guid/DispatchOrderFile.h>
 #include <Guid/MigratedFvInfo.h>
 
 ///
@@ -52,6 +53,13 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 ///
 #define PEI_CORE_INTERNAL_FFS_FILE_DISPATCH_TYPE   0xff
 
+///
+/// It is an FFS type extension used for PeiFindFileEx. It indicates current
+/// FFS searching is for all valid files, including the pad files, to build
+/// the file index of the FV.
+///
+#define PEI_CORE_INTERNAL_FFS_FILE_INDEX_TYPE      0xfe
+
 ///
 /// Pei Core private data structures
 ///
@@ -73,6 +81,10 @@ typedef struct {
   UINTN                 MaxCount;
   UINTN                 LastDispatchedCount;
   ///
+  /// Number of times PPIs have been installed or reinstalled.
+  ///
+  UINTN                 InstallCount;
+  ///
   /// MaxCount number of entries.
   ///
   PEI_PPI_LIST_POINTERS *PpiPtrs;
@@ -131,6 +143,27 @@ typedef struct {
 //
 #define FV_GROWTH_STEP 8
 
+///
+/// Entry of the file index of a FV. The index lists the valid files of the FV
+/// in the FV order, so that the files can be found without walking the FFS
+/// headers again.
+///
+typedef struct {
+  ///
+  /// Offset of the FFS file header from the start of the FV.
+  ///
+  UINT32                              Offset;
+  ///
+  /// Type of the file.
+  ///
+  EFI_FV_FILETYPE                     Type;
+  UINT8                               Reserved;
+  ///
+  /// Hash of the file name, checked before the name itself is compared.
+  ///
+  UINT16                              NameHash;
+} PEI_CORE_FV_FILE_INDEX_ENTRY;
+
 typedef struct {
   EFI_FIRMWARE_VOLUME_HEADER          *FvHeader;
   EFI_PEI_FIRMWARE_VOLUME_PPI         *FvPpi;
@@ -144,8 +177,20 @@ typedef struct {
   // Pointer to the buffer with the PeimCount number of Entries.
   //
   EFI_PEI_FILE_HANDLE                 *FvFileHandles;
+  //
+  // Pointer to the buffer with the PeimCount number of Entries. Each entry is
+  // PpiList.InstallCount + 1 when the DEPEX of the PEIM was last found
+  // unsatisfied, or 0 if the DEPEX has not been evaluated.
+  //
+  UINTN                               *PeimDepexInstallCount;
   BOOLEAN                             ScanFv;
   UINT32                              AuthenticationStatus;
+  //
+  // Pointer to the buffer with the FileIndexCount number of Entries, or NULL
+  // if the FV is not indexed.
+  //
+  PEI_CORE_FV_FILE_INDEX_ENTRY        *FileIndex;
+  UINTN                               FileIndexCount;
 } PEI_CORE_FV_HANDLE;
 
 typedef struct {
@@ -255,6 +300,11 @@ struct _PEI_CORE_INSTANCE {
   BOOLEAN                            PeimNeedingDispatch;
   BOOLEAN                            PeimDispatchOnThisPass;
   BOOLEAN                            PeimDispatcherReenter;
+  ///
+  /// Number of passes and DEPEX evaluations made by the PEI Dispatcher.
+  ///
+  UINTN                              DispatchPassCount;
+  UINTN                              DepexEvaluationCount;
   EFI_PEI_HOB_POINTERS               HobList;
   BOOLEAN                            SwitchStackSignal;
   BOOLEAN                            PeiMemoryInstalled;
@@ -228,6 +228,12 @@ PeiCore (
           if (OldCoreData->Fv[Index].FvFileHandles != NULL) {
             OldCoreData->Fv[Index].FvFileHandles = (EFI_PEI_FILE_HANDLE *) ((UINT8 *) OldCoreData->Fv[Index].FvFileHandles + OldCoreData->HeapOffset);
           }
+          if (OldCoreData->Fv[Index].PeimDepexInstallCount != NULL) {
+            OldCoreData->Fv[Index].PeimDepexInstallCount = (UINTN *) ((UINT8 *) OldCoreData->Fv[Index].PeimDepexInstallCount + OldCoreData->HeapOffset);
+          }
+          if (OldCoreData->Fv[Index].FileIndex != NULL) {
+            OldCoreData->Fv[Index].FileIndex = (PEI_CORE_FV_FILE_INDEX_ENTRY *) ((UINT8 *) OldCoreData->Fv[Index].FileIndex + OldCoreData->HeapOffset);
+          }
         }
         OldCoreData->TempFileGuid         = (EFI_GUID *) ((UINT8 *) OldCoreData->TempFileGuid + OldCoreData->HeapOffset);
         OldCoreData->TempFileHandles      = (EFI_PEI_FILE_HANDLE *) ((UINT8 *) OldCoreData->TempFileHandles + OldCoreData->HeapOffset);
@@ -256,6 +262,12 @@ PeiCore (
           if (OldCoreData->Fv[Index].FvFileHandles != NULL) {
             OldCoreData->Fv[Index].FvFileHandles = (EFI_PEI_FILE_HANDLE *) ((UINT8 *) OldCoreData->Fv[Index].FvFileHandles - OldCoreData->HeapOffset);
           }
+          if (OldCoreData->Fv[Index].PeimDepexInstallCount != NULL) {
+            OldCoreData->Fv[Index].PeimDepexInstallCount = (UINTN *) ((UINT8 *) OldCoreData->Fv[Index].PeimDepexInstallCount - OldCoreData->HeapOffset);
+          }
+          if (OldCoreData->Fv[Index].FileIndex != NULL) {
+            OldCoreData->Fv[Index].FileIndex = (PEI_CORE_FV_FILE_INDEX_ENTRY *) ((UINT8 *) OldCoreData->Fv[Index].FileIndex - OldCoreData->HeapOffset);
+          }
         }
         OldCoreData->TempFileGuid         = (EFI_GUID *) ((UINT8 *) OldCoreData->TempFileGuid - OldCoreData->HeapOffset);
         OldCoreData->TempFileHandles      = (EFI_PEI_FILE_HANDLE *) ((UINT8 *) OldCoreData->TempFileHandles - OldCoreData->HeapOffset);
@@ -518,6 +518,8 @@ InternalPeiInstallPpi (
     PpiList++;
   }
 
+  PpiListPointer->InstallCount++;
+
   //
   // Process any callback level notifies for newly installed PPIs.
   //
@@ -615,6 +617,7 @@ PeiReInstallPpi (
   //
   DEBUG((EFI_D_INFO, "Reinstall PPI: %g\n", NewPpi->Guid));
   PrivateData->PpiData.PpiList.PpiPtrs[Index].Ppi = (EFI_PEI_PPI_DESCRIPTOR *) NewPpi;
+  PrivateData->PpiData.PpiList.InstallCount++;
 
   //
   // Process any callback level notifies for the newly installed PPI.
@@ -0,0 +1,32 @@
+/** @file
+  GUIDs of the PEI and DXE dispatch order files.
+
+  A dispatch order file is a FREEFORM file in a firmware volume with a RAW
+  section that contains an array of EFI_GUID. It lists the file names of the
+  modules of the firmware volume in the order they are expected to be
+  dispatched, and is produced by the DISPATCH_ORDER statement of the FDF.
+  Unlike the a priori file, the dependency expressions of the listed modules
+  are still evaluated by the dispatcher.
+
+Copyright (c) 2021, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef __DISPATCH_ORDER_FILE_H__
+#define __DISPATCH_ORDER_FILE_H__
+
+#define EDKII_PEI_DISPATCH_ORDER_FILE_GUID \
+  { \
+    0xc6eb7052, 0xd916, 0x4f76, { 0x83, 0x67, 0x24, 0xe4, 0x7e, 0x43, 0x1d, 0x47 } \
+  }
+
+#define EDKII_DXE_DISPATCH_ORDER_FILE_GUID \
+  { \
+    0x36957274, 0x1e29, 0x4a96, { 0xb0, 0x6d, 0xba, 0x47, 0x67, 0xf1, 0x48, 0xec } \
+  }
+
+extern EFI_GUID gEdkiiPeiDispatchOrderFileGuid;
+extern EFI_GUID gEdkiiDxeDispatchOrderFileGuid;
+
+#endif
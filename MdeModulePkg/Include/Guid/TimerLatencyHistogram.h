@@ -0,0 +1,55 @@
+/** @file
+  GUID and data structure of the DXE core timer latency histogram.
+
+  When PcdDxeTimerLatencyHistogram is TRUE, the DXE core installs a
+  configuration table with this GUID. It records how late the timer events
+  were signaled compared to their trigger time. The TimerLatencyInfo
+  application in MdeModulePkg dumps it from the UEFI shell.
+
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef __TIMER_LATENCY_HISTOGRAM_H__
+#define __TIMER_LATENCY_HISTOGRAM_H__
+
+#define EDKII_TIMER_LATENCY_HISTOGRAM_GUID \
+  { \
+    0x5d12e7af, 0x9c34, 0x4060, { 0xb4, 0x39, 0x43, 0xc2, 0x16, 0x79, 0xaa, 0x15 } \
+  }
+
+#define EDKII_TIMER_LATENCY_HISTOGRAM_REVISION  0x00000001
+
+///
+/// Number of buckets of the histogram. Bucket 0 counts the timers signaled
+/// on time, and bucket N counts the timers signaled between 2^(N-1) and
+/// 2^N - 1 100ns units late. The last bucket also counts the later ones.
+///
+#define EDKII_TIMER_LATENCY_HISTOGRAM_BUCKETS   32
+
+typedef struct {
+  ///
+  /// Revision of this structure.
+  ///
+  UINT32  Revision;
+  ///
+  /// Number of entries of Bucket.
+  ///
+  UINT32  BucketCount;
+  ///
+  /// Number of timer expirations recorded.
+  ///
+  UINT64  Samples;
+  ///
+  /// Largest latency recorded, in 100ns units.
+  ///
+  UINT64  MaxLatency;
+  ///
+  /// Number of timer expirations recorded in each latency range.
+  ///
+  UINT64  Bucket[EDKII_TIMER_LATENCY_HISTOGRAM_BUCKETS];
+} EDKII_TIMER_LATENCY_HISTOGRAM;
+
+extern EFI_GUID gEdkiiTimerLatencyHistogramGuid;
+
+#endif
@@ -0,0 +1,37 @@
+/** @file
+  GUID and data structure of the reclaim statistics of the variable driver.
+
+  When PcdVariableCollectStatistics is TRUE, the runtime DXE variable driver
+  installs a configuration table with this GUID, and the SMM variable driver
+  returns the same structure for SMM_VARIABLE_FUNCTION_GET_RECLAIM_STATISTICS.
+  Both can be dumped from the UEFI shell with the VariableInfo application.
+
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef __VARIABLE_RECLAIM_STATISTICS_H__
+#define __VARIABLE_RECLAIM_STATISTICS_H__
+
+#define EDKII_VARIABLE_RECLAIM_STATISTICS_GUID \
+  { 0x2e8b6a4f, 0x91c3, 0x4d57, { 0xb0, 0x6e, 0x3a, 0x5d, 0x9c, 0x41, 0xf2, 0x87 } }
+
+///
+/// This structure contains the statistics of the reclaim operations on the
+/// non-volatile variable store. All latencies are in nanoseconds.
+///
+typedef struct {
+  UINT64    FullReclaimCount;              ///< Number of reclaims that rewrote the whole store.
+  UINT64    FullReclaimTotalLatency;       ///< Sum of the latencies of the full reclaims.
+  UINT64    FullReclaimMaxLatency;         ///< Largest latency of a full reclaim.
+  UINT64    IncrementalStepCount;          ///< Number of incremental reclaim steps.
+  UINT64    IncrementalStepTotalLatency;   ///< Sum of the latencies of the incremental reclaim steps.
+  UINT64    IncrementalStepMaxLatency;     ///< Largest latency of an incremental reclaim step.
+  UINT64    IncrementalPassCount;          ///< Number of incremental reclaim passes over the whole store.
+  UINT64    BytesMoved;                    ///< Bytes of valid variables copied by all reclaims.
+  UINT64    BytesReclaimed;                ///< Bytes of free space gained by all reclaims.
+} VARIABLE_RECLAIM_STATISTICS;
+
+extern EFI_GUID gEdkiiVariableReclaimStatisticsGuid;
+
+#endif // __VARIABLE_RECLAIM_STATISTICS_H__
@@ -0,0 +1,65 @@
+/** @file
+  EDKII Load File Digest Protocol.
+
+  A driver producing EFI_LOAD_FILE_PROTOCOL may also produce this protocol on
+  the same handle, if it computes the Authenticode digest of a PE/COFF image
+  while it loads the image into the caller's buffer, e.g. as the data arrives
+  from the network. The image verification can then use that digest instead
+  of reading the whole buffer again to hash it.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef __EDKII_LOAD_FILE_DIGEST_H__
+#define __EDKII_LOAD_FILE_DIGEST_H__
+
+#define EDKII_LOAD_FILE_DIGEST_PROTOCOL_GUID \
+  { \
+    0x06159abe, 0x2f83, 0x43d1, { 0x86, 0xa2, 0xc5, 0x90, 0xd2, 0xb0, 0x71, 0x5f } \
+  }
+
+typedef struct _EDKII_LOAD_FILE_DIGEST_PROTOCOL EDKII_LOAD_FILE_DIGEST_PROTOCOL;
+
+/**
+  Get the Authenticode digest of the PE/COFF image loaded into Buffer by the
+  last LoadFile() call on the same handle.
+
+  The digest is calculated as described in "Calculating the PE Image Hash" of
+  the Windows Authenticode Portable Executable Signature Format. It is only
+  returned once, and only if Buffer and BufferSize are the buffer and the file
+  size that the last LoadFile() call returned.
+
+  @param[in]  This           Pointer to the EDKII_LOAD_FILE_DIGEST_PROTOCOL instance.
+  @param[in]  Buffer         The buffer the image was loaded into.
+  @param[in]  BufferSize     The size of the image in bytes.
+  @param[in]  HashAlgorithm  The hash algorithm of the digest, e.g. EFI_HASH_ALGORITHM_SHA256_GUID.
+  @param[out] Digest         The buffer to return the digest in.
+  @param[in]  DigestSize     The size of Digest in bytes. It must be the digest size of
+                             HashAlgorithm.
+
+  @retval EFI_SUCCESS            The digest was returned in Digest.
+  @retval EFI_INVALID_PARAMETER  This, Buffer, HashAlgorithm or Digest is NULL.
+  @retval EFI_NOT_FOUND          No digest is available for Buffer and BufferSize.
+  @retval EFI_UNSUPPORTED        The digest was not calculated with HashAlgorithm.
+  @retval EFI_BAD_BUFFER_SIZE    DigestSize is not the digest size of HashAlgorithm.
+
+**/
+typedef
+EFI_STATUS
+(EFIAPI *EDKII_LOAD_FILE_DIGEST_GET_IMAGE_DIGEST) (
+  IN  EDKII_LOAD_FILE_DIGEST_PROTOCOL  *This,
+  IN  CONST VOID                       *Buffer,
+  IN  UINTN                            BufferSize,
+  IN  CONST EFI_GUID                   *HashAlgorithm,
+  OUT UINT8                            *Digest,
+  IN  UINTN                            DigestSize
+  );
+
+struct _EDKII_LOAD_FILE_DIGEST_PROTOCOL {
+  EDKII_LOAD_FILE_DIGEST_GET_IMAGE_DIGEST  GetImageDigest;
+};
+
+extern EFI_GUID gEdkiiLoadFileDigestProtocolGuid;
+
+#endif
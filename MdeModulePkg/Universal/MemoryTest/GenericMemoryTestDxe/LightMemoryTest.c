@@ -308,6 +308,44 @@ ConstructNonTestedMemoryRange (
   return EFI_SUCCESS;
 }
 
+/**
+  Store the memory test pattern into a range of physical memory, without
+  flushing the cache. It can run on the APs.
+
+  @param[in] Private  Point to generic memory test driver's private data.
+  @param[in] Start    The memory range's start address.
+  @param[in] Size     The memory range's size.
+
+**/
+VOID
+WriteMemoryPattern (
+  IN  GENERIC_MEMORY_TEST_PRIVATE  *Private,
+  IN  EFI_PHYSICAL_ADDRESS         Start,
+  IN  UINT64                       Size
+  )
+{
+  EFI_PHYSICAL_ADDRESS  Address;
+
+  //
+  // When every byte of the range is covered by the generic pattern, fill the
+  // whole range at once. SetMem64() uses non-temporal stores in the SSE2
+  // BaseMemoryLib instance, so the pattern does not go through the cache.
+  //
+  if ((Private->CoverageSpan == Private->MonoTestSize) &&
+      (Private->MonoPattern == (VOID *) GenericMemoryTestMonoPattern) &&
+      ((Start & (sizeof (UINT64) - 1)) == 0) &&
+      (ModU64x32 (Size, (UINT32) Private->MonoTestSize) == 0)) {
+    SetMem64 ((VOID *) (UINTN) Start, (UINTN) Size, GENERIC_MEMORY_TEST_PATTERN64);
+    return;
+  }
+
+  Address = Start;
+  while (Address < (Start + Size)) {
+    CopyMem ((VOID *) (UINTN) Address, Private->MonoPattern, Private->MonoTestSize);
+    Address += Private->CoverageSpan;
+  }
+}
+
 /**
   Write the memory test pattern into a range of physical memory.
 
@@ -326,10 +364,6 @@ WriteMemory (
   IN  UINT64                       Size
   )
 {
-  EFI_PHYSICAL_ADDRESS  Address;
-
-  Address = Start;
-
   //
   // Add 4G memory address check for IA32 platform
   // NOTE: Without page table, there is no way to use memory above 4G.
@@ -338,10 +372,7 @@ WriteMemory (
     return EFI_SUCCESS;
   }
 
-  while (Address < (Start + Size)) {
-    CopyMem ((VOID *) (UINTN) Address, Private->MonoPattern, Private->MonoTestSize);
-    Address += Private->CoverageSpan;
-  }
+  WriteMemoryPattern (Private, Start, Size);
   //
   // bug bug: we may need GCD service to make the code cache and data uncache,
   // if GCD do not support it or return fail, then just flush the whole cache.
@@ -353,6 +384,88 @@ WriteMemory (
   return EFI_SUCCESS;
 }
 
+/**
+  Compare the range of physical memory which covered by memory test pattern
+  with the pattern. It can run on the APs.
+
+  @param[in]  Private       Point to generic memory test driver's private data.
+  @param[in]  Start         The memory range's start address.
+  @param[in]  Size          The memory range's size.
+  @param[out] ErrorAddress  The address of the first mis-compare found.
+
+  @retval EFI_SUCCESS       No mis-compare found in the range of memory.
+  @retval EFI_DEVICE_ERROR  The range of memory have errors contained.
+
+**/
+EFI_STATUS
+CompareMemoryPattern (
+  IN  GENERIC_MEMORY_TEST_PRIVATE  *Private,
+  IN  EFI_PHYSICAL_ADDRESS         Start,
+  IN  UINT64                       Size,
+  OUT EFI_PHYSICAL_ADDRESS         *ErrorAddress
+  )
+{
+  EFI_PHYSICAL_ADDRESS            Address;
+
+  Address = Start;
+  while (Address < (Start + Size)) {
+    if (CompareMemWithoutCheckArgument (
+          (VOID *) (UINTN) (Address),
+          Private->MonoPattern,
+          Private->MonoTestSize
+          ) != 0) {
+      *ErrorAddress = Address;
+      return EFI_DEVICE_ERROR;
+    }
+
+    Address += Private->CoverageSpan;
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Report an uncorrectable memory error through the status code.
+
+  @param[in] Address  The address of the memory error.
+
+  @retval EFI_DEVICE_ERROR     The memory error is reported.
+  @retval EFI_OUT_OF_RESOURCES Could not allocate the extended error data.
+
+**/
+EFI_STATUS
+ReportMemoryError (
+  IN  EFI_PHYSICAL_ADDRESS         Address
+  )
+{
+  EFI_MEMORY_EXTENDED_ERROR_DATA  *ExtendedErrorData;
+
+  ExtendedErrorData = AllocateZeroPool (sizeof (EFI_MEMORY_EXTENDED_ERROR_DATA));
+  if (ExtendedErrorData == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  ExtendedErrorData->DataHeader.HeaderSize  = (UINT16) sizeof (EFI_STATUS_CODE_DATA);
+  ExtendedErrorData->DataHeader.Size        = (UINT16) (sizeof (EFI_MEMORY_EXTENDED_ERROR_DATA) - sizeof (EFI_STATUS_CODE_DATA));
+  ExtendedErrorData->Granularity            = EFI_MEMORY_ERROR_DEVICE;
+  ExtendedErrorData->Operation              = EFI_MEMORY_OPERATION_READ;
+  ExtendedErrorData->Syndrome               = 0x0;
+  ExtendedErrorData->Address                = Address;
+  ExtendedErrorData->Resolution             = 0x40;
+
+  REPORT_STATUS_CODE_EX (
+      EFI_ERROR_CODE,
+      EFI_COMPUTING_UNIT_MEMORY | EFI_CU_MEMORY_EC_UNCORRECTABLE,
+      0,
+      &gEfiGenericMemTestProtocolGuid,
+      NULL,
+      (UINT8 *) ExtendedErrorData + sizeof (EFI_STATUS_CODE_DATA),
+      ExtendedErrorData->DataHeader.Size
+      );
+
+  return EFI_DEVICE_ERROR;
+}
+
 /**
   Verify the range of physical memory which covered by memory test pattern.
 
@@ -374,12 +487,8 @@ VerifyMemory (
   IN  UINT64                       Size
   )
 {
-  EFI_PHYSICAL_ADDRESS            Address;
-  INTN                            ErrorFound;
-  EFI_MEMORY_EXTENDED_ERROR_DATA  *ExtendedErrorData;
-
-  Address           = Start;
-  ExtendedErrorData = NULL;
+  EFI_STATUS                      Status;
+  EFI_PHYSICAL_ADDRESS            ErrorAddress;
 
   //
   // Add 4G memory address check for IA32 platform
@@ -394,43 +503,12 @@ VerifyMemory (
   // error here. If there is miscompare error here then check if generic
   // memory test driver can disable the bad DIMM.
   //
-  while (Address < (Start + Size)) {
-    ErrorFound = CompareMemWithoutCheckArgument (
-                  (VOID *) (UINTN) (Address),
-                  Private->MonoPattern,
-                  Private->MonoTestSize
-                  );
-    if (ErrorFound != 0) {
-      //
-      // Report uncorrectable errors
-      //
-      ExtendedErrorData = AllocateZeroPool (sizeof (EFI_MEMORY_EXTENDED_ERROR_DATA));
-      if (ExtendedErrorData == NULL) {
-        return EFI_OUT_OF_RESOURCES;
-      }
-
-      ExtendedErrorData->DataHeader.HeaderSize  = (UINT16) sizeof (EFI_STATUS_CODE_DATA);
-      ExtendedErrorData->DataHeader.Size        = (UINT16) (sizeof (EFI_MEMORY_EXTENDED_ERROR_DATA) - sizeof (EFI_STATUS_CODE_DATA));
-      ExtendedErrorData->Granularity            = EFI_MEMORY_ERROR_DEVICE;
-      ExtendedErrorData->Operation              = EFI_MEMORY_OPERATION_READ;
-      ExtendedErrorData->Syndrome               = 0x0;
-      ExtendedErrorData->Address                = Address;
-      ExtendedErrorData->Resolution             = 0x40;
-
-      REPORT_STATUS_CODE_EX (
-          EFI_ERROR_CODE,
-          EFI_COMPUTING_UNIT_MEMORY | EFI_CU_MEMORY_EC_UNCORRECTABLE,
-          0,
-          &gEfiGenericMemTestProtocolGuid,
-          NULL,
-          (UINT8 *) ExtendedErrorData + sizeof (EFI_STATUS_CODE_DATA),
-          ExtendedErrorData->DataHeader.Size
-          );
-
-      return EFI_DEVICE_ERROR;
-    }
-
-    Address += Private->CoverageSpan;
+  Status = CompareMemoryPattern (Private, Start, Size, &ErrorAddress);
+  if (EFI_ERROR (Status)) {
+    //
+    // Report uncorrectable errors
+    //
+    return ReportMemoryError (ErrorAddress);
   }
 
   return EFI_SUCCESS;
@@ -512,6 +590,12 @@ InitializeMemoryTest (
     Private->CoverageSpan = QUICK_SPAN_SIZE;
     break;
   }
+
+  //
+  // Split the memory test across the APs if the platform asks for it
+  //
+  InitializeParallelMemoryTest (Private);
+
   //
   // This is the first time we construct the non-tested memory range, if no
   // extended memory found, we know the system have not any extended memory
@@ -608,9 +692,13 @@ GenPerformMemoryTest (
       // The software memory test (R/W/V) perform here. It will detect the
       // memory mis-compare error.
       //
-      WriteMemory (Private, mCurrentAddress, BlockBoundary);
+      if (Private->MpServices != NULL) {
+        Status = ParallelRangeTest (Private, mCurrentAddress, BlockBoundary);
+      } else {
+        WriteMemory (Private, mCurrentAddress, BlockBoundary);
 
-      Status = VerifyMemory (Private, mCurrentAddress, BlockBoundary);
+        Status = VerifyMemory (Private, mCurrentAddress, BlockBoundary);
+      }
       if (EFI_ERROR (Status)) {
         //
         // If perform here, means there is mis-compare error, and no agent can
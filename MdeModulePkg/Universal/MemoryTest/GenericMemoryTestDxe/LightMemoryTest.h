@@ -13,6 +13,7 @@
 #include <Guid/StatusCodeDataTypeId.h>
 #include <Protocol/GenericMemoryTest.h>
 #include <Protocol/Cpu.h>
+#include <Protocol/MpService.h>
 
 #include <Library/DebugLib.h>
 #include <Library/UefiDriverEntryPoint.h>
@@ -23,12 +24,20 @@
 #include <Library/BaseMemoryLib.h>
 #include <Library/MemoryAllocationLib.h>
 #include <Library/UefiBootServicesTableLib.h>
+#include <Library/PcdLib.h>
+#include <Library/SynchronizationLib.h>
+#include <Library/CacheMaintenanceLib.h>
 
 //
 // Some global define
 //
 #define GENERIC_CACHELINE_SIZE  0x40
 
+//
+// GenericMemoryTestMonoPattern read as a UINT64, used to fill whole ranges
+//
+#define GENERIC_MEMORY_TEST_PATTERN64  0xA5A5A5A55A5A5A5AULL
+
 //
 // attributes for reserved memory before it is promoted to system memory
 //
@@ -110,6 +119,13 @@ typedef struct {
   //
   LIST_ENTRY                    NonTestedMemRanList;
 
+  //
+  // MP services protocol's pointer when the memory test is split across the
+  // APs, and the size of the slices handed to each processor
+  //
+  EFI_MP_SERVICES_PROTOCOL          *MpServices;
+  UINT64                            ParallelSliceSize;
+
 } GENERIC_MEMORY_TEST_PRIVATE;
 
 #define GENERIC_MEMORY_TEST_PRIVATE_FROM_THIS(a) \
@@ -195,6 +211,57 @@ UpdateMemoryMap (
   IN  GENERIC_MEMORY_TEST_PRIVATE  *Private
   );
 
+/**
+  Store the memory test pattern into a range of physical memory, without
+  flushing the cache. It can run on the APs.
+
+  @param[in] Private  Point to generic memory test driver's private data.
+  @param[in] Start    The memory range's start address.
+  @param[in] Size     The memory range's size.
+
+**/
+VOID
+WriteMemoryPattern (
+  IN  GENERIC_MEMORY_TEST_PRIVATE  *Private,
+  IN  EFI_PHYSICAL_ADDRESS         Start,
+  IN  UINT64                       Size
+  );
+
+/**
+  Compare the range of physical memory which covered by memory test pattern
+  with the pattern. It can run on the APs.
+
+  @param[in]  Private       Point to generic memory test driver's private data.
+  @param[in]  Start         The memory range's start address.
+  @param[in]  Size          The memory range's size.
+  @param[out] ErrorAddress  The address of the first mis-compare found.
+
+  @retval EFI_SUCCESS       No mis-compare found in the range of memory.
+  @retval EFI_DEVICE_ERROR  The range of memory have errors contained.
+
+**/
+EFI_STATUS
+CompareMemoryPattern (
+  IN  GENERIC_MEMORY_TEST_PRIVATE  *Private,
+  IN  EFI_PHYSICAL_ADDRESS         Start,
+  IN  UINT64                       Size,
+  OUT EFI_PHYSICAL_ADDRESS         *ErrorAddress
+  );
+
+/**
+  Report an uncorrectable memory error through the status code.
+
+  @param[in] Address  The address of the memory error.
+
+  @retval EFI_DEVICE_ERROR     The memory error is reported.
+  @retval EFI_OUT_OF_RESOURCES Could not allocate the extended error data.
+
+**/
+EFI_STATUS
+ReportMemoryError (
+  IN  EFI_PHYSICAL_ADDRESS         Address
+  );
+
 /**
   Write the memory test pattern into a range of physical memory.
 
@@ -234,6 +301,36 @@ VerifyMemory (
   IN  UINT64                       Size
   );
 
+/**
+  Set up the parallel memory test when PcdMemoryTestParallel is TRUE and the
+  MP services protocol reports more than one enabled processor.
+
+  @param[in] Private  Point to generic memory test driver's private data.
+
+**/
+VOID
+InitializeParallelMemoryTest (
+  IN  GENERIC_MEMORY_TEST_PRIVATE  *Private
+  );
+
+/**
+  Write and verify a range of physical memory on all the enabled processors.
+
+  @param[in] Private  Point to generic memory test driver's private data.
+  @param[in] Start    The memory range's start address.
+  @param[in] Size     The memory range's size.
+
+  @retval EFI_SUCCESS Successful test the range of memory.
+  @retval Others      The range of memory have errors contained.
+
+**/
+EFI_STATUS
+ParallelRangeTest (
+  IN  GENERIC_MEMORY_TEST_PRIVATE  *Private,
+  IN  EFI_PHYSICAL_ADDRESS         Start,
+  IN  UINT64                       Size
+  );
+
 /**
   Test a range of the memory directly .
 
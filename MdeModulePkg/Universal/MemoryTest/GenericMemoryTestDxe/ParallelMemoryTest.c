@@ -0,0 +1,213 @@
+/** @file
+  Split the R/W/V memory test of every BDS block across all the enabled
+  processors through the MP Services protocol.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "LightMemoryTest.h"
+
+typedef struct {
+  GENERIC_MEMORY_TEST_PRIVATE       *Private;
+  BOOLEAN                           Verify;
+  EFI_PHYSICAL_ADDRESS              Start;
+  UINT64                            Size;
+  UINT64                            SliceSize;
+  UINTN                             SliceCount;
+  volatile UINT32                   NextSlice;
+  volatile UINT32                   ErrorFound;
+  EFI_PHYSICAL_ADDRESS              ErrorAddress;
+} PARALLEL_MEMORY_TEST_JOB;
+
+/**
+  Take the slices of the block from the job one at a time, and write or verify
+  them until no slice is left or a mis-compare has been found. It runs on all
+  the APs at the same time, then on the BSP.
+
+  After writing, each processor pushes the pattern out of its own data cache,
+  so that the verify pass reads it back from memory.
+
+  @param[in] Buffer  The PARALLEL_MEMORY_TEST_JOB.
+
+**/
+VOID
+EFIAPI
+ParallelMemoryTestWorker (
+  IN OUT VOID                       *Buffer
+  )
+{
+  PARALLEL_MEMORY_TEST_JOB          *Job;
+  UINTN                             Slice;
+  EFI_PHYSICAL_ADDRESS              Address;
+  UINT64                            Size;
+  EFI_PHYSICAL_ADDRESS              ErrorAddress;
+
+  Job = (PARALLEL_MEMORY_TEST_JOB *) Buffer;
+  while (Job->ErrorFound == 0) {
+    Slice = (UINTN) InterlockedIncrement (&Job->NextSlice) - 1;
+    if (Slice >= Job->SliceCount) {
+      break;
+    }
+
+    Address = Job->Start + MultU64x32 (Job->SliceSize, (UINT32) Slice);
+    Size    = MIN (Job->SliceSize, Job->Start + Job->Size - Address);
+    if (!Job->Verify) {
+      WriteMemoryPattern (Job->Private, Address, Size);
+    } else if (EFI_ERROR (CompareMemoryPattern (Job->Private, Address, Size, &ErrorAddress))) {
+      //
+      // Only the first processor finding an error records its address
+      //
+      if (InterlockedCompareExchange32 (&Job->ErrorFound, 0, 1) == 0) {
+        Job->ErrorAddress = ErrorAddress;
+      }
+    }
+  }
+
+  if (!Job->Verify) {
+    WriteBackInvalidateDataCache ();
+  }
+}
+
+/**
+  Run one pass of the job on all the enabled processors. The BSP waits for the
+  APs and then takes the slices left, or all of them if the APs failed to
+  start.
+
+  @param[in] Private  Point to generic memory test driver's private data.
+  @param[in] Job      The job to run.
+
+**/
+VOID
+RunParallelMemoryTestJob (
+  IN     GENERIC_MEMORY_TEST_PRIVATE  *Private,
+  IN OUT PARALLEL_MEMORY_TEST_JOB     *Job
+  )
+{
+  Job->NextSlice = 0;
+  Private->MpServices->StartupAllAPs (
+                         Private->MpServices,
+                         ParallelMemoryTestWorker,
+                         FALSE,
+                         NULL,
+                         0,
+                         Job,
+                         NULL
+                         );
+
+  ParallelMemoryTestWorker (Job);
+}
+
+/**
+  Set up the parallel memory test when PcdMemoryTestParallel is TRUE and the
+  MP services protocol reports more than one enabled processor.
+
+  @param[in] Private  Point to generic memory test driver's private data.
+
+**/
+VOID
+InitializeParallelMemoryTest (
+  IN  GENERIC_MEMORY_TEST_PRIVATE  *Private
+  )
+{
+  EFI_STATUS                  Status;
+  EFI_MP_SERVICES_PROTOCOL    *MpServices;
+  UINTN                       NumberOfProcessors;
+  UINTN                       NumberOfEnabledProcessors;
+  UINT64                      BlockSize;
+  UINT64                      SliceSize;
+
+  Private->MpServices = NULL;
+
+  if (!FeaturePcdGet (PcdMemoryTestParallel)) {
+    return;
+  }
+
+  Status = gBS->LocateProtocol (
+                  &gEfiMpServiceProtocolGuid,
+                  NULL,
+                  (VOID **) &MpServices
+                  );
+  if (EFI_ERROR (Status)) {
+    return;
+  }
+
+  Status = MpServices->GetNumberOfProcessors (
+                         MpServices,
+                         &NumberOfProcessors,
+                         &NumberOfEnabledProcessors
+                         );
+  if (EFI_ERROR (Status) || NumberOfEnabledProcessors < 2) {
+    return;
+  }
+
+  //
+  // Both sizes must be a multiple of the coverage span, so that the pattern is
+  // written at the same addresses as in the serial memory test.
+  //
+  SliceSize = MAX (PcdGet32 (PcdMemoryTestParallelSliceSize), Private->CoverageSpan);
+  SliceSize = ALIGN_VALUE (SliceSize, (UINT64) Private->CoverageSpan);
+  BlockSize = MAX (PcdGet64 (PcdMemoryTestParallelBlockSize), SliceSize);
+  BlockSize = ALIGN_VALUE (BlockSize, SliceSize);
+
+  Private->MpServices        = MpServices;
+  Private->ParallelSliceSize = SliceSize;
+  Private->BdsBlockSize      = BlockSize;
+
+  DEBUG ((
+    DEBUG_INFO,
+    "GenericMemoryTest: %d processors, block 0x%lx, slice 0x%lx\n",
+    NumberOfEnabledProcessors,
+    BlockSize,
+    SliceSize
+    ));
+}
+
+/**
+  Write and verify a range of physical memory on all the enabled processors.
+
+  @param[in] Private  Point to generic memory test driver's private data.
+  @param[in] Start    The memory range's start address.
+  @param[in] Size     The memory range's size.
+
+  @retval EFI_SUCCESS Successful test the range of memory.
+  @retval Others      The range of memory have errors contained.
+
+**/
+EFI_STATUS
+ParallelRangeTest (
+  IN  GENERIC_MEMORY_TEST_PRIVATE  *Private,
+  IN  EFI_PHYSICAL_ADDRESS         Start,
+  IN  UINT64                       Size
+  )
+{
+  PARALLEL_MEMORY_TEST_JOB    Job;
+
+  //
+  // Add 4G memory address check for IA32 platform
+  // NOTE: Without page table, there is no way to use memory above 4G.
+  //
+  if (Start + Size > MAX_ADDRESS) {
+    return EFI_SUCCESS;
+  }
+
+  Job.Private      = Private;
+  Job.Verify       = FALSE;
+  Job.Start        = Start;
+  Job.Size         = Size;
+  Job.SliceSize    = Private->ParallelSliceSize;
+  Job.SliceCount   = (UINTN) DivU64x64Remainder (Size + Job.SliceSize - 1, Job.SliceSize, NULL);
+  Job.ErrorFound   = 0;
+  Job.ErrorAddress = 0;
+
+  RunParallelMemoryTestJob (Private, &Job);
+
+  Job.Verify = TRUE;
+  RunParallelMemoryTestJob (Private, &Job);
+
+  if (Job.ErrorFound != 0) {
+    return ReportMemoryError (Job.ErrorAddress);
+  }
+
+  return EFI_SUCCESS;
+}
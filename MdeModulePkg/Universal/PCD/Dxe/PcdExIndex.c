@@ -0,0 +1,165 @@
+/** @file
+  The (Token Space Guid, Token Number) hash index of the dynamic-ex PCDs.
+
+  GetExPcdTokenNumber() scans the GUID table and then the ExMap table of each
+  PCD database for every PcdGetEx/PcdSetEx call. The index maps both keys to
+  the token number with a single hash lookup.
+
+Copyright (c) 2021, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "PcdExIndex.h"
+
+#define PCD_EX_INDEX_MIN_BUCKET_COUNT   16
+
+#define PCD_EX_INDEX_ENTRIES(Index)     ((PCD_EX_INDEX_ENTRY *) ((PCD_EX_INDEX *) (Index) + 1))
+
+//
+// Multiplier of Fibonacci hashing, 2^32 divided by the golden ratio.
+//
+#define PCD_EX_INDEX_HASH_MULTIPLIER    0x9E3779B1
+
+/**
+  Compute the hash of a dynamic-ex PCD.
+
+  @param[in] Guid            Token space guid of the PCD.
+  @param[in] ExTokenNumber   Dynamic-ex PCD token number.
+
+  @return The hash value.
+
+**/
+STATIC
+UINT32
+PcdExIndexHash (
+  IN CONST EFI_GUID   *Guid,
+  IN UINT32           ExTokenNumber
+  )
+{
+  UINT32  Hash;
+
+  Hash = (ReadUnaligned32 ((CONST UINT32 *) Guid) ^
+          ReadUnaligned32 ((CONST UINT32 *) Guid + 3) ^
+          ExTokenNumber) * PCD_EX_INDEX_HASH_MULTIPLIER;
+  return Hash ^ (Hash >> 16);
+}
+
+/**
+  Create an empty dynamic-ex PCD index.
+
+  @param[in] ExTokenCount   The number of dynamic-ex PCDs to be added.
+
+  @return The new empty index, or NULL if there is not enough memory.
+
+**/
+PCD_EX_INDEX *
+PcdExIndexCreate (
+  IN UINTN        ExTokenCount
+  )
+{
+  PCD_EX_INDEX  *Index;
+  UINT32        BucketCount;
+
+  //
+  // Keep the load factor at or below 1/2 so that probe chains stay short.
+  //
+  BucketCount = PCD_EX_INDEX_MIN_BUCKET_COUNT;
+  while (BucketCount < ExTokenCount * 2) {
+    BucketCount <<= 1;
+  }
+
+  Index = AllocateZeroPool (sizeof (PCD_EX_INDEX) + BucketCount * sizeof (PCD_EX_INDEX_ENTRY));
+  if (Index == NULL) {
+    return NULL;
+  }
+
+  Index->BucketMask = BucketCount - 1;
+  return Index;
+}
+
+/**
+  Add the dynamic-ex PCDs of an ExMap table to the index. A PCD which is
+  already in the index is not added again, so the tables must be added in
+  the same order as they would be searched.
+
+  @param[in, out] Index          The dynamic-ex PCD index.
+  @param[in]      ExMap          The ExMap table of a PCD database.
+  @param[in]      ExTokenCount   The number of entries in the ExMap table.
+  @param[in]      GuidTable      The GUID table of the same PCD database.
+
+**/
+VOID
+PcdExIndexAddExMap (
+  IN OUT PCD_EX_INDEX             *Index,
+  IN     CONST DYNAMICEX_MAPPING  *ExMap,
+  IN     UINTN                    ExTokenCount,
+  IN     CONST EFI_GUID           *GuidTable
+  )
+{
+  PCD_EX_INDEX_ENTRY  *Entries;
+  CONST EFI_GUID      *Guid;
+  UINTN               MapIndex;
+  UINT32              Bucket;
+
+  Entries = PCD_EX_INDEX_ENTRIES (Index);
+  for (MapIndex = 0; MapIndex < ExTokenCount; MapIndex++) {
+    if (Index->EntryCount >= Index->BucketMask) {
+      //
+      // Always leave an unused entry to terminate the probe chains.
+      //
+      ASSERT (FALSE);
+      return;
+    }
+
+    Guid   = GuidTable + ExMap[MapIndex].ExGuidIndex;
+    Bucket = PcdExIndexHash (Guid, ExMap[MapIndex].ExTokenNumber) & Index->BucketMask;
+    while (Entries[Bucket].TokenNumber != 0) {
+      if (Entries[Bucket].ExTokenNumber == ExMap[MapIndex].ExTokenNumber &&
+          CompareGuid (Entries[Bucket].Guid, Guid)) {
+        break;
+      }
+      Bucket = (Bucket + 1) & Index->BucketMask;
+    }
+
+    if (Entries[Bucket].TokenNumber == 0) {
+      Entries[Bucket].Guid          = Guid;
+      Entries[Bucket].ExTokenNumber = ExMap[MapIndex].ExTokenNumber;
+      Entries[Bucket].TokenNumber   = ExMap[MapIndex].TokenNumber;
+      Index->EntryCount++;
+    }
+  }
+}
+
+/**
+  Find the token number of a dynamic-ex PCD in the index.
+
+  @param[in] Index           The dynamic-ex PCD index.
+  @param[in] Guid            Token space guid for dynamic-ex PCD entry.
+  @param[in] ExTokenNumber   Dynamic-ex PCD token number.
+
+  @return Token Number for dynamic-ex PCD, or 0 if it is not in the index.
+
+**/
+UINTN
+PcdExIndexLookup (
+  IN CONST PCD_EX_INDEX   *Index,
+  IN CONST EFI_GUID       *Guid,
+  IN UINT32               ExTokenNumber
+  )
+{
+  CONST PCD_EX_INDEX_ENTRY  *Entries;
+  UINT32                    Bucket;
+
+  Entries = PCD_EX_INDEX_ENTRIES (Index);
+  Bucket  = PcdExIndexHash (Guid, ExTokenNumber) & Index->BucketMask;
+  while (Entries[Bucket].TokenNumber != 0) {
+    if (Entries[Bucket].ExTokenNumber == ExTokenNumber &&
+        CompareGuid (Entries[Bucket].Guid, Guid)) {
+      return Entries[Bucket].TokenNumber;
+    }
+    Bucket = (Bucket + 1) & Index->BucketMask;
+  }
+
+  return 0;
+}
@@ -0,0 +1,94 @@
+/** @file
+  The (Token Space Guid, Token Number) hash index of the dynamic-ex PCDs, used
+  to find the token number of a dynamic-ex PCD without walking the ExMap tables
+  of the PCD databases.
+
+Copyright (c) 2021, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef _PCD_DXE_EX_INDEX_H_
+#define _PCD_DXE_EX_INDEX_H_
+
+#include <PiDxe.h>
+#include <Guid/PcdDataBaseSignatureGuid.h>
+#include <Library/BaseLib.h>
+#include <Library/DebugLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/MemoryAllocationLib.h>
+
+///
+/// Index entry of one dynamic-ex PCD.
+///
+typedef struct {
+  ///
+  /// Token space GUID of the PCD in the GUID table of its PCD database.
+  ///
+  CONST EFI_GUID    *Guid;
+  UINT32            ExTokenNumber;
+  ///
+  /// Token number of the PCD, 0 if the entry is unused.
+  ///
+  UINT32            TokenNumber;
+} PCD_EX_INDEX_ENTRY;
+
+///
+/// Open addressing hash table of the dynamic-ex PCDs. The entry array
+/// immediately follows this structure in memory.
+///
+typedef struct {
+  UINT32    BucketMask;
+  UINT32    EntryCount;
+} PCD_EX_INDEX;
+
+/**
+  Create an empty dynamic-ex PCD index.
+
+  @param[in] ExTokenCount   The number of dynamic-ex PCDs to be added.
+
+  @return The new empty index, or NULL if there is not enough memory.
+
+**/
+PCD_EX_INDEX *
+PcdExIndexCreate (
+  IN UINTN        ExTokenCount
+  );
+
+/**
+  Add the dynamic-ex PCDs of an ExMap table to the index. A PCD which is
+  already in the index is not added again, so the tables must be added in
+  the same order as they would be searched.
+
+  @param[in, out] Index          The dynamic-ex PCD index.
+  @param[in]      ExMap          The ExMap table of a PCD database.
+  @param[in]      ExTokenCount   The number of entries in the ExMap table.
+  @param[in]      GuidTable      The GUID table of the same PCD database.
+
+**/
+VOID
+PcdExIndexAddExMap (
+  IN OUT PCD_EX_INDEX             *Index,
+  IN     CONST DYNAMICEX_MAPPING  *ExMap,
+  IN     UINTN                    ExTokenCount,
+  IN     CONST EFI_GUID           *GuidTable
+  );
+
+/**
+  Find the token number of a dynamic-ex PCD in the index.
+
+  @param[in] Index           The dynamic-ex PCD index.
+  @param[in] Guid            Token space guid for dynamic-ex PCD entry.
+  @param[in] ExTokenNumber   Dynamic-ex PCD token number.
+
+  @return Token Number for dynamic-ex PCD, or 0 if it is not in the index.
+
+**/
+UINTN
+PcdExIndexLookup (
+  IN CONST PCD_EX_INDEX   *Index,
+  IN CONST EFI_GUID       *Guid,
+  IN UINT32               ExTokenNumber
+  );
+
+#endif
@@ -31,11 +31,49 @@ LIST_ENTRY    *mCallbackFnTable;
 EFI_GUID     **TmpTokenSpaceBuffer;
 UINTN          TmpTokenSpaceBufferCount;
 
+//
+// Hash index of the dynamic-ex PCDs in both PCD databases.
+//
+PCD_EX_INDEX          *mPcdExIndex;
+
+//
+// Cache of the HII type PCD values. A HII type PCD value which has been read
+// from its variable is kept in the default value buffer of the PCD database.
+// It is still valid as long as the generation recorded for the token equals
+// mHiiCacheGeneration, which is advanced whenever a HII variable is set
+// through the PCD services or the SKU is changed. The generation 0 is never
+// valid. The cache is only enabled by PcdHiiPcdValueCache, as the variables
+// written directly with SetVariable() are not tracked.
+//
+UINT32                *mHiiCacheTokenGeneration;
+UINT32                mHiiCacheGeneration = 1;
+
 UINTN                 mPeiPcdDbSize    = 0;
 PEI_PCD_DATABASE      *mPeiPcdDbBinary = NULL;
 UINTN                 mDxePcdDbSize    = 0;
 DXE_PCD_DATABASE      *mDxePcdDbBinary = NULL;
 
+/**
+  Invalidate the cached values of all HII type PCDs.
+
+**/
+VOID
+InvalidateHiiCache (
+  VOID
+  )
+{
+  mHiiCacheGeneration++;
+  if (mHiiCacheGeneration == 0) {
+    //
+    // Skip the generation 0 on wrap around, and forget all old generations.
+    //
+    mHiiCacheGeneration = 1;
+    if (mHiiCacheTokenGeneration != NULL) {
+      ZeroMem (mHiiCacheTokenGeneration, mPcdTotalTokenCount * sizeof (UINT32));
+    }
+  }
+}
+
 /**
   Get Local Token Number by Token Number.
 
@@ -456,6 +494,16 @@ GetWorker (
       } else {
         VaraiableDefaultBuffer = (UINT8 *) PcdDb + VariableHead->DefaultValueOffset;
       }
+
+      if (mHiiCacheTokenGeneration != NULL &&
+          mHiiCacheTokenGeneration[TmpTokenNumber] == mHiiCacheGeneration) {
+        //
+        // The default value buffer still holds the value got from the variable.
+        //
+        RetPtr = (VOID *) VaraiableDefaultBuffer;
+        break;
+      }
+
       Status = GetHiiVariable (Guid, Name, &Data, &DataSize);
       if (Status == EFI_SUCCESS) {
         if (DataSize >= (VariableHead->Offset + GetSize)) {
@@ -480,6 +528,15 @@ GetWorker (
           CopyMem (VaraiableDefaultBuffer, Data + VariableHead->Offset, GetSize);
         }
         FreePool (Data);
+
+        //
+        // Only cache the value got from an existing variable. A variable
+        // which is not found may be created later by other drivers, or may
+        // just not be accessible yet before the variable services are ready.
+        //
+        if (mHiiCacheTokenGeneration != NULL) {
+          mHiiCacheTokenGeneration[TmpTokenNumber] = mHiiCacheGeneration;
+        }
       }
       RetPtr = (VOID *) VaraiableDefaultBuffer;
       break;
@@ -775,6 +832,11 @@ UpdatePcdDatabase (
   PCD_DATABASE_SKU_DELTA      *SkuDelta;
   PCD_DATA_DELTA              *SkuDeltaData;
 
+  //
+  // The delta data may patch the default values of HII type PCDs.
+  //
+  InvalidateHiiCache ();
+
   if (IsPeiDb && mPeiPcdDbBinary != NULL) {
     //
     // Find the delta data for PEI DB
@@ -934,6 +996,36 @@ BuildPcdDxeDataBase (
   for (Index = 0; Index + 1 < mPcdTotalTokenCount + 1; Index++) {
     InitializeListHead (&mCallbackFnTable[Index]);
   }
+
+  //
+  // Build the hash index of the dynamic-ex PCDs, PEI database first as
+  // GetExPcdTokenNumber() searches it first. If there is not enough memory,
+  // GetExPcdTokenNumber() just scans the ExMap tables.
+  //
+  mPcdExIndex = PcdExIndexCreate (TmpTokenSpaceBufferCount);
+  if (mPcdExIndex != NULL) {
+    if (!mPeiDatabaseEmpty) {
+      PcdExIndexAddExMap (
+        mPcdExIndex,
+        (DYNAMICEX_MAPPING *) ((UINT8 *) mPcdDatabase.PeiDb + mPcdDatabase.PeiDb->ExMapTableOffset),
+        mPcdDatabase.PeiDb->ExTokenCount,
+        (EFI_GUID *) ((UINT8 *) mPcdDatabase.PeiDb + mPcdDatabase.PeiDb->GuidTableOffset)
+        );
+    }
+    PcdExIndexAddExMap (
+      mPcdExIndex,
+      (DYNAMICEX_MAPPING *) ((UINT8 *) mPcdDatabase.DxeDb + mPcdDatabase.DxeDb->ExMapTableOffset),
+      mPcdDatabase.DxeDb->ExTokenCount,
+      (EFI_GUID *) ((UINT8 *) mPcdDatabase.DxeDb + mPcdDatabase.DxeDb->GuidTableOffset)
+      );
+  }
+
+  //
+  // The HII type PCD values are not cached if there is not enough memory.
+  //
+  if (FeaturePcdGet (PcdHiiPcdValueCache)) {
+    mHiiCacheTokenGeneration = AllocateZeroPool (mPcdTotalTokenCount * sizeof (UINT32));
+  }
 }
 
 /**
@@ -1458,6 +1550,12 @@ SetHiiVariable (
   Size = 0;
   SetSize = 0;
 
+  //
+  // Other HII type PCDs may be stored in the same variable, so drop the
+  // cached values of all of them.
+  //
+  InvalidateHiiCache ();
+
   //
   // Try to get original variable size information.
   //
@@ -1571,6 +1669,13 @@ GetExPcdTokenNumber (
   EFI_GUID            *GuidTable;
   EFI_GUID            *MatchGuid;
   UINTN               MatchGuidIdx;
+  UINTN               TokenNumber;
+
+  if (mPcdExIndex != NULL) {
+    TokenNumber = PcdExIndexLookup (mPcdExIndex, Guid, ExTokenNumber);
+    ASSERT (TokenNumber != 0);
+    return TokenNumber;
+  }
 
   if (!mPeiDatabaseEmpty) {
     ExMap       = (DYNAMICEX_MAPPING *)((UINT8 *)mPcdDatabase.PeiDb + mPcdDatabase.PeiDb->ExMapTableOffset);
@@ -29,6 +29,8 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <Library/BaseMemoryLib.h>
 #include <Library/UefiRuntimeServicesTableLib.h>
 
+#include "PcdExIndex.h"
+
 //
 // Please make sure the PCD Serivce DXE Version is consistent with
 // the version of the generated DXE PCD Database by build tool.
@@ -1170,6 +1172,15 @@ UpdatePcdDatabase (
   IN BOOLEAN       IsPeiDb
   );
 
+/**
+  Invalidate the cached values of all HII type PCDs.
+
+**/
+VOID
+InvalidateHiiCache (
+  VOID
+  );
+
 extern  PCD_DATABASE   mPcdDatabase;
 
 extern  UINT32         mPcdTotalTokenCount;
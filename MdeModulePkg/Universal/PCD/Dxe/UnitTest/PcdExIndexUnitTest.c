@@ -0,0 +1,462 @@
+/** @file
+  This is a host-based unit test and benchmark for the (Token Space Guid,
+  Token Number) hash index of the dynamic-ex PCDs.
+
+  Copyright (c) 2021, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <time.h>
+#include <cmocka.h>
+
+#include "../PcdExIndex.h"
+
+#include <Library/UnitTestLib.h>
+
+#define UNIT_TEST_NAME        "Dynamic-Ex PCD Index Unit Test"
+#define UNIT_TEST_VERSION     "1.0"
+
+#define TEST_GUID_COUNT       16
+#define TEST_TOKENS_PER_GUID  64
+#define TEST_EX_TOKEN_COUNT   (TEST_GUID_COUNT * TEST_TOKENS_PER_GUID)
+#define TEST_LOOKUP_ROUNDS    100
+#define TEST_COLLISION_COUNT  24
+#define TEST_COLLISION_ROUNDS 64
+
+///=== TEST DATA ==================================================================================
+
+//
+// Two PCD databases in the same layout as the PEI and DXE PCD databases: the
+// second one also holds the first TEST_TOKENS_PER_GUID tokens of the first
+// one, with different token numbers.
+//
+EFI_GUID            mTestGuidTable[2][TEST_GUID_COUNT];
+DYNAMICEX_MAPPING   mTestExMap[2][TEST_EX_TOKEN_COUNT];
+PCD_EX_INDEX        *mTestIndex;
+
+//
+// A PCD database whose PCDs all have the same hash: the first and last four
+// bytes of each token space GUID, XORed with the token number, are the same.
+//
+EFI_GUID            mCollisionGuidTable[TEST_COLLISION_COUNT];
+DYNAMICEX_MAPPING   mCollisionExMap[TEST_COLLISION_COUNT];
+
+///=== HELPER FUNCTIONS ===========================================================================
+
+/**
+  Find the token number of a dynamic-ex PCD the same way as the PCD DXE driver
+  does without the index: scan the GUID table, then the ExMap table of each
+  PCD database.
+
+  @param[in] Guid            Token space guid for dynamic-ex PCD entry.
+  @param[in] ExTokenNumber   Dynamic-ex PCD token number.
+
+  @return Token Number for dynamic-ex PCD, or 0 if it is not found.
+**/
+UINTN
+LinearLookup (
+  IN CONST EFI_GUID   *Guid,
+  IN UINT32           ExTokenNumber
+  )
+{
+  UINTN   Db;
+  UINTN   GuidIndex;
+  UINTN   Index;
+
+  for (Db = 0; Db < 2; Db++) {
+    for (GuidIndex = 0; GuidIndex < TEST_GUID_COUNT; GuidIndex++) {
+      if (CompareGuid (&mTestGuidTable[Db][GuidIndex], Guid)) {
+        break;
+      }
+    }
+    if (GuidIndex == TEST_GUID_COUNT) {
+      continue;
+    }
+    for (Index = 0; Index < TEST_EX_TOKEN_COUNT; Index++) {
+      if ((mTestExMap[Db][Index].ExTokenNumber == ExTokenNumber) &&
+          (mTestExMap[Db][Index].ExGuidIndex == GuidIndex)) {
+        return mTestExMap[Db][Index].TokenNumber;
+      }
+    }
+  }
+
+  return 0;
+}
+
+/**
+  Build the GUID and ExMap tables of two test PCD databases, and the index of
+  them.
+
+  @param[in]  Context  Unit test case context
+**/
+UNIT_TEST_STATUS
+EFIAPI
+BuildTestIndex (
+  IN UNIT_TEST_CONTEXT      Context
+  )
+{
+  UINTN   Db;
+  UINTN   GuidIndex;
+  UINTN   Index;
+
+  for (Db = 0; Db < 2; Db++) {
+    for (GuidIndex = 0; GuidIndex < TEST_GUID_COUNT; GuidIndex++) {
+      //
+      // The second database lists the GUIDs in reverse order.
+      //
+      SetMem (&mTestGuidTable[Db][GuidIndex], sizeof (EFI_GUID), 0x5A);
+      mTestGuidTable[Db][GuidIndex].Data1 = (UINT32) ((Db == 0) ? GuidIndex : TEST_GUID_COUNT - 1 - GuidIndex);
+    }
+    for (Index = 0; Index < TEST_EX_TOKEN_COUNT; Index++) {
+      GuidIndex = Index / TEST_TOKENS_PER_GUID;
+      mTestExMap[Db][Index].ExGuidIndex   = (UINT16) ((Db == 0) ? GuidIndex : TEST_GUID_COUNT - 1 - GuidIndex);
+      mTestExMap[Db][Index].ExTokenNumber = (UINT32) (Index % TEST_TOKENS_PER_GUID) * 0x10 + (UINT32) Db * 0x10000;
+      mTestExMap[Db][Index].TokenNumber   = (UINT16) (Db * TEST_EX_TOKEN_COUNT + Index + 1);
+    }
+  }
+
+  //
+  // Shadow the first token space of the first database in the second one.
+  //
+  for (Index = 0; Index < TEST_TOKENS_PER_GUID; Index++) {
+    mTestExMap[1][Index].ExGuidIndex   = TEST_GUID_COUNT - 1;
+    mTestExMap[1][Index].ExTokenNumber = mTestExMap[0][Index].ExTokenNumber;
+  }
+
+  mTestIndex = PcdExIndexCreate (2 * TEST_EX_TOKEN_COUNT);
+  if (mTestIndex == NULL) {
+    return UNIT_TEST_ERROR_PREREQUISITE_NOT_MET;
+  }
+
+  PcdExIndexAddExMap (mTestIndex, mTestExMap[0], TEST_EX_TOKEN_COUNT, mTestGuidTable[0]);
+  PcdExIndexAddExMap (mTestIndex, mTestExMap[1], TEST_EX_TOKEN_COUNT, mTestGuidTable[1]);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Free the test index.
+
+  @param[in]  Context  Unit test case context
+**/
+VOID
+EFIAPI
+FreeTestIndex (
+  IN UNIT_TEST_CONTEXT      Context
+  )
+{
+  FreePool (mTestIndex);
+  mTestIndex = NULL;
+}
+
+///=== TEST CASES =================================================================================
+
+/**
+  Every token number found through the index must be the one that a scan of
+  the ExMap tables finds, including shadowed tokens and tokens that do not
+  exist.
+
+  @param[in]  Context  Unit test case context
+**/
+UNIT_TEST_STATUS
+EFIAPI
+IndexShouldMatchLinearSearch (
+  IN UNIT_TEST_CONTEXT      Context
+  )
+{
+  UINTN     Db;
+  UINTN     GuidIndex;
+  UINT32    ExTokenNumber;
+  EFI_GUID  Guid;
+
+  for (Db = 0; Db < 2; Db++) {
+    for (GuidIndex = 0; GuidIndex < TEST_GUID_COUNT; GuidIndex++) {
+      for (ExTokenNumber = 0; ExTokenNumber < TEST_TOKENS_PER_GUID * 0x10 + 2; ExTokenNumber++) {
+        UT_ASSERT_EQUAL (
+          PcdExIndexLookup (mTestIndex, &mTestGuidTable[Db][GuidIndex], ExTokenNumber + (UINT32) Db * 0x10000),
+          LinearLookup (&mTestGuidTable[Db][GuidIndex], ExTokenNumber + (UINT32) Db * 0x10000)
+          );
+      }
+    }
+  }
+
+  //
+  // The shadowed tokens come from the first database.
+  //
+  UT_ASSERT_EQUAL (PcdExIndexLookup (mTestIndex, &mTestGuidTable[0][0], 0x10), 2);
+
+  //
+  // A GUID which is in no GUID table.
+  //
+  SetMem (&Guid, sizeof (Guid), 0xA5);
+  UT_ASSERT_EQUAL (PcdExIndexLookup (mTestIndex, &Guid, 0x10), 0);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  PCDs with the same hash share one probe chain, which may wrap around the
+  end of the table. They must all be found, and a PCD with the same hash that
+  is not in the index must not be found.
+
+  @param[in]  Context  Unit test case context
+**/
+UNIT_TEST_STATUS
+EFIAPI
+CollidingTokensShouldBeFound (
+  IN UNIT_TEST_CONTEXT      Context
+  )
+{
+  UINT32        Round;
+  UINTN         Index;
+  PCD_EX_INDEX  *CollisionIndex;
+  EFI_GUID      Guid;
+
+  //
+  // Each round starts the probe chain at another bucket.
+  //
+  for (Round = 0; Round < TEST_COLLISION_ROUNDS; Round++) {
+    for (Index = 0; Index < TEST_COLLISION_COUNT; Index++) {
+      SetMem (&mCollisionGuidTable[Index], sizeof (EFI_GUID), 0x5A);
+      mCollisionGuidTable[Index].Data1     = (Round << 8) ^ (UINT32) Index;
+      mCollisionExMap[Index].ExGuidIndex   = (UINT16) Index;
+      mCollisionExMap[Index].ExTokenNumber = (UINT32) Index;
+      mCollisionExMap[Index].TokenNumber   = (UINT16) (Index + 1);
+    }
+
+    CollisionIndex = PcdExIndexCreate (TEST_COLLISION_COUNT);
+    UT_ASSERT_NOT_NULL (CollisionIndex);
+    PcdExIndexAddExMap (CollisionIndex, mCollisionExMap, TEST_COLLISION_COUNT, mCollisionGuidTable);
+
+    for (Index = 0; Index < TEST_COLLISION_COUNT; Index++) {
+      UT_ASSERT_EQUAL (PcdExIndexLookup (CollisionIndex, &mCollisionGuidTable[Index], (UINT32) Index), Index + 1);
+
+      //
+      // Same hash, but the GUID differs in the bytes that are not hashed.
+      //
+      CopyGuid (&Guid, &mCollisionGuidTable[Index]);
+      Guid.Data2++;
+      UT_ASSERT_EQUAL (PcdExIndexLookup (CollisionIndex, &Guid, (UINT32) Index), 0);
+    }
+
+    FreePool (CollisionIndex);
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  The token numbers at both ends of the UINT32 range are valid dynamic-ex
+  token numbers, and a PCD listed twice resolves to its first entry.
+
+  @param[in]  Context  Unit test case context
+**/
+UNIT_TEST_STATUS
+EFIAPI
+BoundaryTokensShouldBeFound (
+  IN UNIT_TEST_CONTEXT      Context
+  )
+{
+  PCD_EX_INDEX        *BoundaryIndex;
+  DYNAMICEX_MAPPING   ExMap[3];
+
+  BoundaryIndex = PcdExIndexCreate (0);
+  UT_ASSERT_NOT_NULL (BoundaryIndex);
+  UT_ASSERT_EQUAL (PcdExIndexLookup (BoundaryIndex, &mTestGuidTable[0][0], 0), 0);
+  FreePool (BoundaryIndex);
+
+  ExMap[0].ExTokenNumber = 0;
+  ExMap[0].TokenNumber   = 1;
+  ExMap[0].ExGuidIndex   = 0;
+  ExMap[1].ExTokenNumber = MAX_UINT32;
+  ExMap[1].TokenNumber   = 2;
+  ExMap[1].ExGuidIndex   = 0;
+  ExMap[2].ExTokenNumber = 0;
+  ExMap[2].TokenNumber   = 3;
+  ExMap[2].ExGuidIndex   = 0;
+
+  BoundaryIndex = PcdExIndexCreate (ARRAY_SIZE (ExMap));
+  UT_ASSERT_NOT_NULL (BoundaryIndex);
+  PcdExIndexAddExMap (BoundaryIndex, ExMap, ARRAY_SIZE (ExMap), mTestGuidTable[0]);
+
+  UT_ASSERT_EQUAL (PcdExIndexLookup (BoundaryIndex, &mTestGuidTable[0][0], 0), 1);
+  UT_ASSERT_EQUAL (PcdExIndexLookup (BoundaryIndex, &mTestGuidTable[0][0], MAX_UINT32), 2);
+  UT_ASSERT_EQUAL (PcdExIndexLookup (BoundaryIndex, &mTestGuidTable[0][0], 1), 0);
+  UT_ASSERT_EQUAL (PcdExIndexLookup (BoundaryIndex, &mTestGuidTable[0][0], MAX_UINT32 - 1), 0);
+  UT_ASSERT_EQUAL (PcdExIndexLookup (BoundaryIndex, &mTestGuidTable[0][1], 0), 0);
+
+  FreePool (BoundaryIndex);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Measure the time of looking every dynamic-ex PCD up by scanning the ExMap
+  tables and through the index, as PcdGetEx does. The token numbers found are
+  only summed in the timed loops, and checked afterwards.
+
+  @param[in]  Context  Unit test case context
+**/
+UNIT_TEST_STATUS
+EFIAPI
+IndexLookupBenchmark (
+  IN UNIT_TEST_CONTEXT      Context
+  )
+{
+  UINTN                   Round;
+  UINTN                   Db;
+  UINTN                   Index;
+  DYNAMICEX_MAPPING       *ExMap;
+  UINTN                   ExpectedSum;
+  UINTN                   LinearSum;
+  UINTN                   IndexSum;
+  clock_t                 Start;
+  clock_t                 LinearTicks;
+  clock_t                 IndexTicks;
+
+  ExpectedSum = 0;
+  for (Db = 0; Db < 2; Db++) {
+    for (Index = TEST_TOKENS_PER_GUID; Index < TEST_EX_TOKEN_COUNT; Index++) {
+      ExpectedSum += mTestExMap[Db][Index].TokenNumber;
+    }
+  }
+
+  LinearSum = 0;
+  Start     = clock ();
+  for (Round = 0; Round < TEST_LOOKUP_ROUNDS; Round++) {
+    for (Db = 0; Db < 2; Db++) {
+      for (Index = TEST_TOKENS_PER_GUID; Index < TEST_EX_TOKEN_COUNT; Index++) {
+        ExMap      = &mTestExMap[Db][Index];
+        LinearSum += LinearLookup (&mTestGuidTable[Db][ExMap->ExGuidIndex], ExMap->ExTokenNumber);
+      }
+    }
+  }
+  LinearTicks = clock () - Start;
+
+  IndexSum = 0;
+  Start    = clock ();
+  for (Round = 0; Round < TEST_LOOKUP_ROUNDS; Round++) {
+    for (Db = 0; Db < 2; Db++) {
+      for (Index = TEST_TOKENS_PER_GUID; Index < TEST_EX_TOKEN_COUNT; Index++) {
+        ExMap     = &mTestExMap[Db][Index];
+        IndexSum += PcdExIndexLookup (mTestIndex, &mTestGuidTable[Db][ExMap->ExGuidIndex], ExMap->ExTokenNumber);
+      }
+    }
+  }
+  IndexTicks = clock () - Start;
+
+  UT_ASSERT_EQUAL (LinearSum, ExpectedSum * TEST_LOOKUP_ROUNDS);
+  UT_ASSERT_EQUAL (IndexSum, ExpectedSum * TEST_LOOKUP_ROUNDS);
+
+  UT_LOG_INFO (
+    "%d lookups in %d dynamic-ex PCDs: linear %ld us, indexed %ld us\n",
+    TEST_LOOKUP_ROUNDS * 2 * (TEST_EX_TOKEN_COUNT - TEST_TOKENS_PER_GUID),
+    2 * TEST_EX_TOKEN_COUNT,
+    ((UINT64) LinearTicks * 1000000 / CLOCKS_PER_SEC),
+    ((UINT64) IndexTicks * 1000000 / CLOCKS_PER_SEC)
+    );
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Main entry point to this unit test application.
+
+  Sets up and runs the test suites.
+**/
+VOID
+EFIAPI
+UnitTestMain (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      IndexTests;
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_NAME, UNIT_TEST_VERSION));
+
+  //
+  // Start setting up the test framework for running the tests.
+  //
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_NAME, gEfiCallerBaseName, UNIT_TEST_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  //
+  // Add all test suites and tests.
+  //
+  Status = CreateUnitTestSuite (
+             &IndexTests, Framework,
+             "Dynamic-Ex PCD Index Tests", "Pcd.ExIndex", NULL, NULL
+             );
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for IndexTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+  AddTestCase (
+    IndexTests,
+    "Index lookups should match a scan of the ExMap tables", "MatchLinear",
+    IndexShouldMatchLinearSearch, BuildTestIndex, FreeTestIndex, NULL
+    );
+  AddTestCase (
+    IndexTests,
+    "Colliding tokens should be found", "Collisions",
+    CollidingTokensShouldBeFound, BuildTestIndex, FreeTestIndex, NULL
+    );
+  AddTestCase (
+    IndexTests,
+    "Boundary and duplicate tokens should be found", "Boundaries",
+    BoundaryTokensShouldBeFound, BuildTestIndex, FreeTestIndex, NULL
+    );
+  AddTestCase (
+    IndexTests,
+    "Benchmark of linear and indexed lookups", "Benchmark",
+    IndexLookupBenchmark, BuildTestIndex, FreeTestIndex, NULL
+    );
+
+  //
+  // Execute the tests.
+  //
+  Status = RunAllTestSuites (Framework);
+
+EXIT:
+  if (Framework != NULL) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return;
+}
+
+///
+/// Avoid ECC error for function name that starts with lower case letter
+///
+#define Main main
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+
+  @param[in] Argc  Number of arguments
+  @param[in] Argv  Array of pointers to arguments
+
+  @retval 0      Success
+  @retval other  Error
+**/
+INT32
+Main (
+  IN INT32  Argc,
+  IN CHAR8  *Argv[]
+  )
+{
+  UnitTestMain ();
+  return 0;
+}
@@ -86,14 +86,16 @@ GetLbaAndOffsetByAddress (
 }
 
 /**
-  Writes a buffer to variable storage space, in the working block.
+  Writes a buffer to a region of variable storage space, in the working block.
 
-  This function writes a buffer to variable storage space into a firmware
-  volume block device. The destination is specified by parameter
-  VariableBase. Fault Tolerant Write protocol is used for writing.
+  This function writes a buffer to a region of variable storage space into a
+  firmware volume block device. The region may span several blocks, and does
+  not need to be block aligned. Fault Tolerant Write protocol is used for
+  writing, so the region is either fully updated or left unchanged.
 
-  @param  VariableBase   Base address of variable to write
-  @param  VariableBuffer Point to the variable data buffer.
+  @param  Address        Base address of the region to write.
+  @param  Size           Size of the region in bytes.
+  @param  Buffer         Point to the data to write.
 
   @retval EFI_SUCCESS    The function completed successfully.
   @retval EFI_NOT_FOUND  Fail to locate Fault Tolerant Write protocol.
@@ -101,16 +103,16 @@ GetLbaAndOffsetByAddress (
 
 **/
 EFI_STATUS
-FtwVariableSpace (
-  IN EFI_PHYSICAL_ADDRESS   VariableBase,
-  IN VARIABLE_STORE_HEADER  *VariableBuffer
+FtwVariableRegion (
+  IN EFI_PHYSICAL_ADDRESS   Address,
+  IN UINTN                  Size,
+  IN VOID                   *Buffer
   )
 {
   EFI_STATUS                         Status;
   EFI_HANDLE                         FvbHandle;
   EFI_LBA                            VarLba;
   UINTN                              VarOffset;
-  UINTN                              FtwBufferSize;
   EFI_FAULT_TOLERANT_WRITE_PROTOCOL  *FtwProtocol;
 
   //
@@ -123,21 +125,18 @@ FtwVariableSpace (
   //
   // Locate Fvb handle by address.
   //
-  Status = GetFvbInfoByAddress (VariableBase, &FvbHandle, NULL);
+  Status = GetFvbInfoByAddress (Address, &FvbHandle, NULL);
   if (EFI_ERROR (Status)) {
     return Status;
   }
   //
   // Get LBA and Offset by address.
   //
-  Status = GetLbaAndOffsetByAddress (VariableBase, &VarLba, &VarOffset);
+  Status = GetLbaAndOffsetByAddress (Address, &VarLba, &VarOffset);
   if (EFI_ERROR (Status)) {
     return EFI_ABORTED;
   }
 
-  FtwBufferSize = ((VARIABLE_STORE_HEADER *) ((UINTN) VariableBase))->Size;
-  ASSERT (FtwBufferSize == VariableBuffer->Size);
-
   //
   // FTW write record.
   //
@@ -145,11 +144,40 @@ FtwVariableSpace (
                           FtwProtocol,
                           VarLba,         // LBA
                           VarOffset,      // Offset
-                          FtwBufferSize,  // NumBytes
+                          Size,           // NumBytes
                           NULL,           // PrivateData NULL
                           FvbHandle,      // Fvb Handle
-                          (VOID *) VariableBuffer // write buffer
+                          Buffer          // write buffer
                           );
 
   return Status;
 }
+
+/**
+  Writes a buffer to variable storage space, in the working block.
+
+  This function writes a buffer to variable storage space into a firmware
+  volume block device. The destination is specified by parameter
+  VariableBase. Fault Tolerant Write protocol is used for writing.
+
+  @param  VariableBase   Base address of variable to write
+  @param  VariableBuffer Point to the variable data buffer.
+
+  @retval EFI_SUCCESS    The function completed successfully.
+  @retval EFI_NOT_FOUND  Fail to locate Fault Tolerant Write protocol.
+  @retval EFI_ABORTED    The function could not complete successfully.
+
+**/
+EFI_STATUS
+FtwVariableSpace (
+  IN EFI_PHYSICAL_ADDRESS   VariableBase,
+  IN VARIABLE_STORE_HEADER  *VariableBuffer
+  )
+{
+  UINTN                              FtwBufferSize;
+
+  FtwBufferSize = ((VARIABLE_STORE_HEADER *) ((UINTN) VariableBase))->Size;
+  ASSERT (FtwBufferSize == VariableBuffer->Size);
+
+  return FtwVariableRegion (VariableBase, FtwBufferSize, VariableBuffer);
+}
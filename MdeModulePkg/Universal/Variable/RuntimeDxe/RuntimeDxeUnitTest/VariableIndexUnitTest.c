@@ -0,0 +1,560 @@
+/** @file
+  This is a host-based unit test for the (Name, Guid) hash index of the
+  variable stores.
+
+  Copyright (c) 2021, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include "../VariableParsing.h"
+#include "../VariableIndex.h"
+
+#include <Library/PrintLib.h>
+#include <Library/UnitTestLib.h>
+
+#define UNIT_TEST_NAME        "Variable Store Index Unit Test"
+#define UNIT_TEST_VERSION     "1.0"
+
+#define TEST_STORE_SIZE       SIZE_512KB
+#define TEST_VARIABLE_COUNT   2000
+
+///=== TEST DATA ==================================================================================
+
+//
+// Test GUID 1 {0A3C4C0A-6E2B-4A3E-8D61-3B8C2B1F7A11}
+//
+EFI_GUID  mTestGuid1 = {
+  0x0a3c4c0a, 0x6e2b, 0x4a3e, {0x8d, 0x61, 0x3b, 0x8c, 0x2b, 0x1f, 0x7a, 0x11}
+};
+
+//
+// Test GUID 2 {6D1F6B9E-2C4E-4F27-9B0E-5A0C8E3D2F42}
+//
+EFI_GUID  mTestGuid2 = {
+  0x6d1f6b9e, 0x2c4e, 0x4f27, {0x9b, 0x0e, 0x5a, 0x0c, 0x8e, 0x3d, 0x2f, 0x42}
+};
+
+//
+// Two names whose hash with mTestGuid1 is the same.
+//
+CHAR16  mTestCollidingName1[] = L"Var1e0f8";
+CHAR16  mTestCollidingName2[] = L"Var61926";
+
+VARIABLE_STORE_HEADER   *mTestStore;
+UINTN                   mTestStoreLastOffset;
+VARIABLE_STORE_INDEX    *mTestIndex;
+BOOLEAN                 mTestAtRuntime;
+
+///=== HELPER FUNCTIONS ===========================================================================
+
+/**
+  Stub of AtRuntime() for the code under test.
+
+  @return The runtime state set by the test case.
+**/
+BOOLEAN
+AtRuntime (
+  VOID
+  )
+{
+  return mTestAtRuntime;
+}
+
+/**
+  Compute the hash of a variable name and vendor GUID.
+
+  @param[in] Name         Variable name.
+  @param[in] NameSize     Size in bytes of the variable name, including the
+                          null terminator.
+  @param[in] VendorGuid   Variable vendor GUID.
+
+  @return The hash value.
+**/
+UINT32
+VariableIndexHash (
+  IN CONST VOID       *Name,
+  IN UINTN            NameSize,
+  IN CONST EFI_GUID   *VendorGuid
+  );
+
+/**
+  Append a variable to the test variable store.
+
+  @param[in] Name     Variable name.
+  @param[in] Guid     Variable vendor GUID.
+  @param[in] State    Variable state.
+
+  @return The header of the new variable.
+**/
+VARIABLE_HEADER *
+AppendTestVariable (
+  IN CHAR16     *Name,
+  IN EFI_GUID   *Guid,
+  IN UINT8      State
+  )
+{
+  AUTHENTICATED_VARIABLE_HEADER  *Variable;
+  UINT8                          *Data;
+
+  Variable = (AUTHENTICATED_VARIABLE_HEADER *) ((UINTN) mTestStore + mTestStoreLastOffset);
+  SetMem (Variable, sizeof (*Variable), 0);
+  Variable->StartId    = VARIABLE_DATA;
+  Variable->State      = State;
+  Variable->Attributes = EFI_VARIABLE_NON_VOLATILE | EFI_VARIABLE_BOOTSERVICE_ACCESS;
+  Variable->NameSize   = (UINT32) StrSize (Name);
+  Variable->DataSize   = sizeof (UINT32);
+  CopyGuid (&Variable->VendorGuid, Guid);
+  CopyMem (GetVariableNamePtr ((VARIABLE_HEADER *) Variable, TRUE), Name, Variable->NameSize);
+  Data = GetVariableDataPtr ((VARIABLE_HEADER *) Variable, TRUE);
+  WriteUnaligned32 ((UINT32 *) Data, (UINT32) mTestStoreLastOffset);
+
+  mTestStoreLastOffset = (UINTN) GetNextVariablePtr ((VARIABLE_HEADER *) Variable, TRUE) - (UINTN) mTestStore;
+  return (VARIABLE_HEADER *) Variable;
+}
+
+/**
+  Build the name of the test variable with the given number.
+
+  @param[in]  Number   Number of the test variable.
+  @param[out] Name     Buffer of 16 characters that receives the name.
+**/
+VOID
+GetTestVariableName (
+  IN  UINTN     Number,
+  OUT CHAR16    *Name
+  )
+{
+  UnicodeSPrint (Name, 16 * sizeof (CHAR16), L"Boot%04x", Number);
+}
+
+/**
+  Prepare a variable store holding TEST_VARIABLE_COUNT variables, a tenth of
+  them deleted and updated again, and an empty index for it.
+
+  @param[in]  Context  Unit test case context
+**/
+UNIT_TEST_STATUS
+EFIAPI
+BuildTestStore (
+  IN UNIT_TEST_CONTEXT      Context
+  )
+{
+  UINTN             Number;
+  CHAR16            Name[16];
+  VARIABLE_HEADER   *Variable;
+
+  mTestStore = AllocatePool (TEST_STORE_SIZE);
+  UT_ASSERT_NOT_NULL (mTestStore);
+  SetMem (mTestStore, TEST_STORE_SIZE, 0xff);
+  CopyGuid (&mTestStore->Signature, &gEfiAuthenticatedVariableGuid);
+  mTestStore->Size   = TEST_STORE_SIZE;
+  mTestStore->Format = VARIABLE_STORE_FORMATTED;
+  mTestStore->State  = VARIABLE_STORE_HEALTHY;
+  mTestStoreLastOffset = (UINTN) GetStartPointer (mTestStore) - (UINTN) mTestStore;
+
+  for (Number = 0; Number < TEST_VARIABLE_COUNT; Number++) {
+    GetTestVariableName (Number, Name);
+    Variable = AppendTestVariable (Name, ((Number & 1) == 0) ? &mTestGuid1 : &mTestGuid2, VAR_ADDED);
+    if ((Number % 10) == 0) {
+      //
+      // Simulate an update: old copy deleted, new copy appended.
+      //
+      Variable->State &= VAR_DELETED;
+      AppendTestVariable (Name, ((Number & 1) == 0) ? &mTestGuid1 : &mTestGuid2, VAR_ADDED);
+    } else if ((Number % 10) == 5) {
+      //
+      // Simulate an interrupted update: the old copy is IN_DELETED_TRANSITION
+      // and the new copy is still there.
+      //
+      Variable->State &= VAR_IN_DELETED_TRANSITION;
+      AppendTestVariable (Name, ((Number & 1) == 0) ? &mTestGuid1 : &mTestGuid2, VAR_ADDED);
+    }
+  }
+
+  mTestIndex = VariableIndexCreate (TEST_STORE_SIZE, TRUE);
+  UT_ASSERT_NOT_NULL (mTestIndex);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Free the test variable store and its index.
+
+  @param[in]  Context  Unit test case context
+**/
+VOID
+EFIAPI
+FreeTestStore (
+  IN UNIT_TEST_CONTEXT      Context
+  )
+{
+  if (mTestStore != NULL) {
+    FreePool (mTestStore);
+    mTestStore = NULL;
+  }
+  if (mTestIndex != NULL) {
+    FreePool (mTestIndex);
+    mTestIndex = NULL;
+  }
+  mTestAtRuntime = FALSE;
+}
+
+/**
+  Look a variable up with FindVariableEx() and FindVariableInIndex() and check
+  that both find the same variable.
+
+  @param[in] Name     Variable name.
+  @param[in] Guid     Variable vendor GUID.
+
+  @retval TRUE        Both lookups have the same result.
+  @retval FALSE       The lookups differ.
+**/
+BOOLEAN
+LookupsMatch (
+  IN CHAR16     *Name,
+  IN EFI_GUID   *Guid
+  )
+{
+  EFI_STATUS              LinearStatus;
+  EFI_STATUS              IndexStatus;
+  VARIABLE_POINTER_TRACK  Linear;
+  VARIABLE_POINTER_TRACK  Indexed;
+
+  ZeroMem (&Linear, sizeof (Linear));
+  Linear.StartPtr = GetStartPointer (mTestStore);
+  Linear.EndPtr   = GetEndPointer (mTestStore);
+  CopyMem (&Indexed, &Linear, sizeof (Indexed));
+
+  LinearStatus = FindVariableEx (Name, Guid, FALSE, &Linear, TRUE);
+  IndexStatus  = FindVariableInIndex (mTestIndex, Name, Guid, FALSE, &Indexed, TRUE);
+
+  if (LinearStatus != IndexStatus) {
+    return FALSE;
+  }
+  if (EFI_ERROR (LinearStatus)) {
+    return TRUE;
+  }
+  return (BOOLEAN) ((Linear.CurrPtr == Indexed.CurrPtr) &&
+                    (Linear.InDeletedTransitionPtr == Indexed.InDeletedTransitionPtr));
+}
+
+///=== TEST CASES =================================================================================
+
+/**
+  Every variable found through the index must be the one that a walk of the
+  store finds, including deleted and IN_DELETED_TRANSITION copies and
+  variables that do not exist.
+
+  @param[in]  Context  Unit test case context
+**/
+UNIT_TEST_STATUS
+EFIAPI
+IndexShouldMatchLinearSearch (
+  IN UNIT_TEST_CONTEXT      Context
+  )
+{
+  UINTN     Number;
+  CHAR16    Name[16];
+
+  for (Number = 0; Number < TEST_VARIABLE_COUNT + 10; Number++) {
+    GetTestVariableName (Number, Name);
+    UT_ASSERT_TRUE (LookupsMatch (Name, &mTestGuid1));
+    UT_ASSERT_TRUE (LookupsMatch (Name, &mTestGuid2));
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Variables appended to the store after the index was built, including one
+  whose name is written only after its header, must be found.
+
+  @param[in]  Context  Unit test case context
+**/
+UNIT_TEST_STATUS
+EFIAPI
+IndexShouldFindAppendedVariables (
+  IN UNIT_TEST_CONTEXT      Context
+  )
+{
+  VARIABLE_HEADER   *Variable;
+
+  UT_ASSERT_TRUE (LookupsMatch (L"Appended", &mTestGuid1));
+
+  AppendTestVariable (L"Appended", &mTestGuid1, VAR_ADDED);
+  UT_ASSERT_TRUE (LookupsMatch (L"Appended", &mTestGuid1));
+
+  //
+  // Header only, then completed: the index must not hash the name too early.
+  //
+  Variable = AppendTestVariable (L"Pending", &mTestGuid2, VAR_HEADER_VALID_ONLY);
+  SetMem (GetVariableNamePtr (Variable, TRUE), sizeof (L"Pending"), 0xff);
+  UT_ASSERT_TRUE (LookupsMatch (L"Pending", &mTestGuid2));
+  CopyMem (GetVariableNamePtr (Variable, TRUE), L"Pending", sizeof (L"Pending"));
+  Variable->State = VAR_ADDED;
+  UT_ASSERT_TRUE (LookupsMatch (L"Pending", &mTestGuid2));
+
+  //
+  // After the store is rewritten, a reset index must still agree.
+  //
+  mTestStoreLastOffset = (UINTN) GetStartPointer (mTestStore) - (UINTN) mTestStore;
+  SetMem (GetStartPointer (mTestStore), TEST_STORE_SIZE - mTestStoreLastOffset, 0xff);
+  AppendTestVariable (L"Pending", &mTestGuid2, VAR_ADDED);
+  VariableIndexReset (mTestIndex);
+  UT_ASSERT_TRUE (LookupsMatch (L"Pending", &mTestGuid2));
+  UT_ASSERT_TRUE (LookupsMatch (L"Appended", &mTestGuid1));
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Variables whose name and vendor GUID have the same hash share the same
+  bucket and hash value, and must still be told apart by their names.
+
+  @param[in]  Context  Unit test case context
+**/
+UNIT_TEST_STATUS
+EFIAPI
+HashCollisionsShouldBeResolved (
+  IN UNIT_TEST_CONTEXT      Context
+  )
+{
+  VARIABLE_HEADER         *First;
+  VARIABLE_HEADER         *Second;
+  VARIABLE_POINTER_TRACK  PtrTrack;
+
+  UT_ASSERT_EQUAL (
+    VariableIndexHash (mTestCollidingName1, sizeof (mTestCollidingName1), &mTestGuid1),
+    VariableIndexHash (mTestCollidingName2, sizeof (mTestCollidingName2), &mTestGuid1)
+    );
+
+  First = AppendTestVariable (mTestCollidingName1, &mTestGuid1, VAR_ADDED);
+  UT_ASSERT_TRUE (LookupsMatch (mTestCollidingName2, &mTestGuid1));
+
+  Second = AppendTestVariable (mTestCollidingName2, &mTestGuid1, VAR_ADDED);
+  UT_ASSERT_TRUE (LookupsMatch (mTestCollidingName1, &mTestGuid1));
+  UT_ASSERT_TRUE (LookupsMatch (mTestCollidingName2, &mTestGuid1));
+
+  ZeroMem (&PtrTrack, sizeof (PtrTrack));
+  PtrTrack.StartPtr = GetStartPointer (mTestStore);
+  PtrTrack.EndPtr   = GetEndPointer (mTestStore);
+  UT_ASSERT_NOT_EFI_ERROR (FindVariableInIndex (mTestIndex, mTestCollidingName1, &mTestGuid1, FALSE, &PtrTrack, TRUE));
+  UT_ASSERT_EQUAL ((UINTN) PtrTrack.CurrPtr, (UINTN) First);
+  UT_ASSERT_NOT_EFI_ERROR (FindVariableInIndex (mTestIndex, mTestCollidingName2, &mTestGuid1, FALSE, &PtrTrack, TRUE));
+  UT_ASSERT_EQUAL ((UINTN) PtrTrack.CurrPtr, (UINTN) Second);
+
+  //
+  // Deleting one of them must not hide the other one.
+  //
+  First->State &= VAR_DELETED;
+  UT_ASSERT_TRUE (LookupsMatch (mTestCollidingName1, &mTestGuid1));
+  UT_ASSERT_TRUE (LookupsMatch (mTestCollidingName2, &mTestGuid1));
+  UT_ASSERT_NOT_EFI_ERROR (FindVariableInIndex (mTestIndex, mTestCollidingName2, &mTestGuid1, FALSE, &PtrTrack, TRUE));
+  UT_ASSERT_EQUAL ((UINTN) PtrTrack.CurrPtr, (UINTN) Second);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  A variable goes through every state of an update, is deleted and is added
+  again, without the index being reset. Each lookup must return the same
+  copies as a walk of the store.
+
+  @param[in]  Context  Unit test case context
+**/
+UNIT_TEST_STATUS
+EFIAPI
+DeletedVariablesShouldBeFoundAgain (
+  IN UNIT_TEST_CONTEXT      Context
+  )
+{
+  VARIABLE_HEADER         *Old;
+  VARIABLE_HEADER         *New;
+  VARIABLE_POINTER_TRACK  PtrTrack;
+
+  ZeroMem (&PtrTrack, sizeof (PtrTrack));
+  PtrTrack.StartPtr = GetStartPointer (mTestStore);
+  PtrTrack.EndPtr   = GetEndPointer (mTestStore);
+
+  Old = AppendTestVariable (L"Reinserted", &mTestGuid2, VAR_ADDED);
+  UT_ASSERT_TRUE (LookupsMatch (L"Reinserted", &mTestGuid2));
+
+  //
+  // Update interrupted before the new copy is written: the old copy is used.
+  //
+  Old->State &= VAR_IN_DELETED_TRANSITION;
+  UT_ASSERT_TRUE (LookupsMatch (L"Reinserted", &mTestGuid2));
+  UT_ASSERT_NOT_EFI_ERROR (FindVariableInIndex (mTestIndex, L"Reinserted", &mTestGuid2, FALSE, &PtrTrack, TRUE));
+  UT_ASSERT_EQUAL ((UINTN) PtrTrack.CurrPtr, (UINTN) Old);
+
+  New = AppendTestVariable (L"Reinserted", &mTestGuid2, VAR_HEADER_VALID_ONLY);
+  UT_ASSERT_TRUE (LookupsMatch (L"Reinserted", &mTestGuid2));
+
+  New->State = VAR_ADDED;
+  UT_ASSERT_TRUE (LookupsMatch (L"Reinserted", &mTestGuid2));
+  UT_ASSERT_NOT_EFI_ERROR (FindVariableInIndex (mTestIndex, L"Reinserted", &mTestGuid2, FALSE, &PtrTrack, TRUE));
+  UT_ASSERT_EQUAL ((UINTN) PtrTrack.CurrPtr, (UINTN) New);
+  UT_ASSERT_EQUAL ((UINTN) PtrTrack.InDeletedTransitionPtr, (UINTN) Old);
+
+  Old->State &= VAR_DELETED;
+  UT_ASSERT_TRUE (LookupsMatch (L"Reinserted", &mTestGuid2));
+
+  //
+  // Delete the variable, then add it again.
+  //
+  New->State &= VAR_DELETED;
+  UT_ASSERT_TRUE (LookupsMatch (L"Reinserted", &mTestGuid2));
+  UT_ASSERT_EQUAL (FindVariableInIndex (mTestIndex, L"Reinserted", &mTestGuid2, FALSE, &PtrTrack, TRUE), EFI_NOT_FOUND);
+
+  New = AppendTestVariable (L"Reinserted", &mTestGuid2, VAR_ADDED);
+  UT_ASSERT_TRUE (LookupsMatch (L"Reinserted", &mTestGuid2));
+  UT_ASSERT_NOT_EFI_ERROR (FindVariableInIndex (mTestIndex, L"Reinserted", &mTestGuid2, FALSE, &PtrTrack, TRUE));
+  UT_ASSERT_EQUAL ((UINTN) PtrTrack.CurrPtr, (UINTN) New);
+  UT_ASSERT_EQUAL ((UINTN) PtrTrack.InDeletedTransitionPtr, 0);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  At runtime, a variable without EFI_VARIABLE_RUNTIME_ACCESS is only found
+  when the runtime check is ignored.
+
+  @param[in]  Context  Unit test case context
+**/
+UNIT_TEST_STATUS
+EFIAPI
+BootTimeVariablesShouldBeHiddenAtRuntime (
+  IN UNIT_TEST_CONTEXT      Context
+  )
+{
+  VARIABLE_POINTER_TRACK  Linear;
+  VARIABLE_POINTER_TRACK  Indexed;
+
+  AppendTestVariable (L"BootTimeOnly", &mTestGuid1, VAR_ADDED);
+
+  ZeroMem (&Linear, sizeof (Linear));
+  Linear.StartPtr = GetStartPointer (mTestStore);
+  Linear.EndPtr   = GetEndPointer (mTestStore);
+  CopyMem (&Indexed, &Linear, sizeof (Indexed));
+
+  mTestAtRuntime = TRUE;
+  UT_ASSERT_EQUAL (FindVariableEx (L"BootTimeOnly", &mTestGuid1, FALSE, &Linear, TRUE), EFI_NOT_FOUND);
+  UT_ASSERT_EQUAL (FindVariableInIndex (mTestIndex, L"BootTimeOnly", &mTestGuid1, FALSE, &Indexed, TRUE), EFI_NOT_FOUND);
+
+  UT_ASSERT_NOT_EFI_ERROR (FindVariableEx (L"BootTimeOnly", &mTestGuid1, TRUE, &Linear, TRUE));
+  UT_ASSERT_NOT_EFI_ERROR (FindVariableInIndex (mTestIndex, L"BootTimeOnly", &mTestGuid1, TRUE, &Indexed, TRUE));
+  UT_ASSERT_EQUAL ((UINTN) Linear.CurrPtr, (UINTN) Indexed.CurrPtr);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Main entry point to this unit test application.
+
+  Sets up and runs the test suites.
+**/
+VOID
+EFIAPI
+UnitTestMain (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      IndexTests;
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_NAME, UNIT_TEST_VERSION));
+
+  //
+  // Start setting up the test framework for running the tests.
+  //
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_NAME, gEfiCallerBaseName, UNIT_TEST_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  //
+  // Add all test suites and tests.
+  //
+  Status = CreateUnitTestSuite (
+             &IndexTests, Framework,
+             "Variable Store Index Tests", "Variable.Index", NULL, NULL
+             );
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for IndexTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+  AddTestCase (
+    IndexTests,
+    "Index lookups should match a walk of the store", "MatchLinear",
+    IndexShouldMatchLinearSearch, BuildTestStore, FreeTestStore, NULL
+    );
+  AddTestCase (
+    IndexTests,
+    "Variables appended after the index was built should be found", "Appended",
+    IndexShouldFindAppendedVariables, BuildTestStore, FreeTestStore, NULL
+    );
+  AddTestCase (
+    IndexTests,
+    "Variables with the same hash should be told apart", "Collisions",
+    HashCollisionsShouldBeResolved, BuildTestStore, FreeTestStore, NULL
+    );
+  AddTestCase (
+    IndexTests,
+    "Deleted variables should be found once added again", "Reinserted",
+    DeletedVariablesShouldBeFoundAgain, BuildTestStore, FreeTestStore, NULL
+    );
+  AddTestCase (
+    IndexTests,
+    "Boot time variables should be hidden at runtime", "Runtime",
+    BootTimeVariablesShouldBeHiddenAtRuntime, BuildTestStore, FreeTestStore, NULL
+    );
+
+  //
+  // Execute the tests.
+  //
+  Status = RunAllTestSuites (Framework);
+
+EXIT:
+  if (Framework != NULL) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return;
+}
+
+///
+/// Avoid ECC error for function name that starts with lower case letter
+///
+#define Main main
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+
+  @param[in] Argc  Number of arguments
+  @param[in] Argv  Array of pointers to arguments
+
+  @retval 0      Success
+  @retval other  Error
+**/
+INT32
+Main (
+  IN INT32  Argc,
+  IN CHAR8  *Argv[]
+  )
+{
+  UnitTestMain ();
+  return 0;
+}
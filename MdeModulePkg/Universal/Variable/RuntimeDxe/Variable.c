@@ -31,6 +31,13 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 
 VARIABLE_MODULE_GLOBAL  *mVariableModuleGlobal;
 
+///
+/// (Name, Guid) hash indexes of the volatile, HOB and non-volatile variable
+/// stores, indexed by VARIABLE_STORE_TYPE. A NULL entry means the store is
+/// searched linearly.
+///
+VARIABLE_STORE_INDEX   *mVariableStoreIndex[VariableStoreTypeMax];
+
 ///
 /// Define a memory cache that improves the search performance for a variable.
 /// For EmuNvMode == TRUE, it will be equal to NonVolatileVariableBase.
@@ -47,6 +54,29 @@ EFI_FIRMWARE_VOLUME_HEADER *mNvFvHeaderCache  = NULL;
 ///
 VARIABLE_INFO_ENTRY    *gVariableInfo         = NULL;
 
+///
+/// The reclaim statistics of the non-volatile variable store.
+///
+VARIABLE_RECLAIM_STATISTICS  gVariableReclaimStatistics;
+
+///
+/// Store offset from which the incremental reclaim looks for the next deleted
+/// variable, 0 if no pass of the incremental reclaim is in progress.
+///
+UINTN                  mIncrementalReclaimOffset     = 0;
+
+///
+/// Last variable offset of the non-volatile store when the previous pass of the
+/// incremental reclaim, or the previous reclaim of the whole store, ended.
+///
+UINTN                  mIncrementalReclaimEndOffset  = 0;
+
+///
+/// Buffer of one flash block and one variable, used by the incremental reclaim.
+///
+UINT8                  *mIncrementalReclaimBuffer    = NULL;
+UINTN                  mIncrementalReclaimBufferSize = 0;
+
 ///
 /// The flag to indicate whether the platform has left the DXE phase of execution.
 ///
@@ -490,6 +520,74 @@ InitializeVariableQuota (
   CalculateCommonUserVariableTotalSize ();
 }
 
+/**
+  Return the time elapsed since the given value of the performance counter.
+
+  @param[in] StartTicks         Value of the performance counter at the start.
+
+  @return The elapsed time in nanoseconds.
+
+**/
+UINT64
+GetReclaimElapsedTime (
+  IN UINT64                     StartTicks
+  )
+{
+  UINT64                        CounterStart;
+  UINT64                        CounterEnd;
+  UINT64                        Ticks;
+
+  GetPerformanceCounterProperties (&CounterStart, &CounterEnd);
+  Ticks = GetPerformanceCounter ();
+  if (CounterStart < CounterEnd) {
+    Ticks = Ticks - StartTicks;
+  } else {
+    Ticks = StartTicks - Ticks;
+  }
+
+  return GetTimeInNanoSecond (Ticks);
+}
+
+/**
+  Record a reclaim operation of the non-volatile variable store in the
+  reclaim statistics.
+
+  @param[in] Incremental        TRUE for a step of the incremental reclaim,
+                                FALSE for a reclaim of the whole store.
+  @param[in] Latency            Latency of the operation in nanoseconds.
+  @param[in] BytesMoved         Bytes of valid variables copied by the operation.
+  @param[in] BytesReclaimed     Bytes of free space gained by the operation.
+
+**/
+VOID
+UpdateVariableReclaimStatistics (
+  IN BOOLEAN                    Incremental,
+  IN UINT64                     Latency,
+  IN UINTN                      BytesMoved,
+  IN UINTN                      BytesReclaimed
+  )
+{
+  if (!FeaturePcdGet (PcdVariableCollectStatistics)) {
+    return;
+  }
+
+  if (Incremental) {
+    gVariableReclaimStatistics.IncrementalStepCount++;
+    gVariableReclaimStatistics.IncrementalStepTotalLatency += Latency;
+    if (Latency > gVariableReclaimStatistics.IncrementalStepMaxLatency) {
+      gVariableReclaimStatistics.IncrementalStepMaxLatency = Latency;
+    }
+  } else {
+    gVariableReclaimStatistics.FullReclaimCount++;
+    gVariableReclaimStatistics.FullReclaimTotalLatency += Latency;
+    if (Latency > gVariableReclaimStatistics.FullReclaimMaxLatency) {
+      gVariableReclaimStatistics.FullReclaimMaxLatency = Latency;
+    }
+  }
+  gVariableReclaimStatistics.BytesMoved     += BytesMoved;
+  gVariableReclaimStatistics.BytesReclaimed += BytesReclaimed;
+}
+
 /**
 
   Variable store garbage collection and reclaim operation.
@@ -538,7 +636,18 @@ Reclaim (
   VARIABLE_HEADER       *UpdatingVariable;
   VARIABLE_HEADER       *UpdatingInDeletedTransition;
   BOOLEAN               AuthFormat;
+  UINT64                StartTicks;
+  UINTN                 OldLastVariableOffset;
 
+  //
+  // Read the performance counter only when the statistics are collected, the
+  // platform may have no timer.
+  //
+  StartTicks = 0;
+  if (FeaturePcdGet (PcdVariableCollectStatistics) && !IsVolatile) {
+    StartTicks = GetPerformanceCounter ();
+  }
+  OldLastVariableOffset = *LastVariableOffset;
   AuthFormat = mVariableModuleGlobal->VariableGlobal.AuthFormat;
   UpdatingVariable = NULL;
   UpdatingInDeletedTransition = NULL;
@@ -775,6 +884,27 @@ Reclaim (
   }
 
 Done:
+  //
+  // The variables have moved, so the index of the store must be rebuilt.
+  //
+  VariableIndexReset (mVariableStoreIndex[IsVolatile ? VariableStoreTypeVolatile : VariableStoreTypeNv]);
+
+  if (!IsVolatile) {
+    //
+    // The offsets kept by the incremental reclaim are stale now.
+    //
+    mIncrementalReclaimOffset    = 0;
+    mIncrementalReclaimEndOffset = *LastVariableOffset;
+    if (!EFI_ERROR (Status) && FeaturePcdGet (PcdVariableCollectStatistics)) {
+      UpdateVariableReclaimStatistics (
+        FALSE,
+        GetReclaimElapsedTime (StartTicks),
+        (UINTN) CurrPtr - (UINTN) GetStartPointer ((VARIABLE_STORE_HEADER *) ValidBuffer),
+        (OldLastVariableOffset > *LastVariableOffset) ? (OldLastVariableOffset - *LastVariableOffset) : 0
+        );
+    }
+  }
+
   DoneStatus = EFI_SUCCESS;
   if (IsVolatile || mVariableModuleGlobal->VariableGlobal.EmuNvMode) {
     DoneStatus = SynchronizeRuntimeVariableCache (
@@ -804,6 +934,473 @@ Done:
   return Status;
 }
 
+/**
+  Recalculate the total sizes of the valid variables in the non-volatile
+  variable store, after the incremental reclaim compacted it.
+
+**/
+VOID
+RecalculateNonVolatileVariableTotalSize (
+  VOID
+  )
+{
+  VARIABLE_HEADER               *Variable;
+  VARIABLE_HEADER               *NextVariable;
+  VARIABLE_POINTER_TRACK        VariablePtrTrack;
+  UINTN                         VariableSize;
+  BOOLEAN                       AuthFormat;
+  EFI_STATUS                    Status;
+
+  AuthFormat = mVariableModuleGlobal->VariableGlobal.AuthFormat;
+
+  mVariableModuleGlobal->HwErrVariableTotalSize      = 0;
+  mVariableModuleGlobal->CommonVariableTotalSize     = 0;
+  mVariableModuleGlobal->CommonUserVariableTotalSize = 0;
+  Variable = GetStartPointer (mNvVariableCache);
+  while (IsValidVariableHeader (Variable, GetEndPointer (mNvVariableCache))) {
+    NextVariable = GetNextVariablePtr (Variable, AuthFormat);
+    if (Variable->State == (VAR_IN_DELETED_TRANSITION & VAR_ADDED)) {
+      //
+      // An IN_DELETED_TRANSITION variable is only valid if there is not also
+      // a same ADDED one.
+      //
+      VariablePtrTrack.StartPtr = GetStartPointer (mNvVariableCache);
+      VariablePtrTrack.EndPtr   = GetEndPointer (mNvVariableCache);
+      Status = FindVariableEx (
+                 GetVariableNamePtr (Variable, AuthFormat),
+                 GetVendorGuidPtr (Variable, AuthFormat),
+                 FALSE,
+                 &VariablePtrTrack,
+                 AuthFormat
+                 );
+      if (!EFI_ERROR (Status) && (VariablePtrTrack.CurrPtr->State == VAR_ADDED)) {
+        Variable = NextVariable;
+        continue;
+      }
+    }
+    if ((Variable->State == VAR_ADDED) || (Variable->State == (VAR_IN_DELETED_TRANSITION & VAR_ADDED))) {
+      VariableSize = (UINTN) NextVariable - (UINTN) Variable;
+      if ((Variable->Attributes & EFI_VARIABLE_HARDWARE_ERROR_RECORD) == EFI_VARIABLE_HARDWARE_ERROR_RECORD) {
+        mVariableModuleGlobal->HwErrVariableTotalSize += VariableSize;
+      } else {
+        mVariableModuleGlobal->CommonVariableTotalSize += VariableSize;
+        if (IsUserVariable (Variable)) {
+          mVariableModuleGlobal->CommonUserVariableTotalSize += VariableSize;
+        }
+      }
+    }
+    Variable = NextVariable;
+  }
+}
+
+/**
+  Do one step of the incremental reclaim of the non-volatile variable store.
+
+  A step looks for the first deleted variable from mIncrementalReclaimOffset.
+  If only deleted variables follow it, the step erases the ones that start in
+  the last block in use. Otherwise the step rewrites the block that holds the
+  deleted variable: the valid variables of the block are packed, then valid
+  variables of the following blocks are moved into the room left. What
+  remains of the room is covered by a deleted filler variable, so that the
+  store can be parsed after each step.
+
+  Each step is a single fault tolerant write, so a power failure leaves the
+  store either as it was before the step or as it is after it. A moved
+  variable goes to a lower offset, where FindVariableEx() would find it
+  before its original, so the region written by the step also covers the
+  header of the original and marks it as DELETED in the same write. No
+  variable is moved past an IN_DELETED_TRANSITION one, which must stay in
+  front of its ADDED twin.
+
+  @param[out] PassDone          TRUE if no deleted variable is left, and the
+                                pass over the store is complete.
+  @param[out] BytesMoved        Bytes of valid variables copied by the step.
+  @param[out] BytesReclaimed    Bytes of free space gained by the step.
+
+  @retval EFI_SUCCESS           The step is done.
+  @retval EFI_BUFFER_TOO_SMALL  The region to rewrite is larger than the reclaim buffer.
+  @retval EFI_VOLUME_CORRUPTED  The hole left in the block cannot hold a filler variable.
+  @retval Others                The write failed; the store is still consistent.
+
+**/
+EFI_STATUS
+ReclaimVariableStoreStep (
+  OUT BOOLEAN                   *PassDone,
+  OUT UINTN                     *BytesMoved,
+  OUT UINTN                     *BytesReclaimed
+  )
+{
+  EFI_STATUS                          Status;
+  EFI_FIRMWARE_VOLUME_BLOCK_PROTOCOL  *Fvb;
+  EFI_PHYSICAL_ADDRESS                FvBase;
+  VOID                                *FtwProtocol;
+  BOOLEAN                             AuthFormat;
+  UINT8                               *Store;
+  VARIABLE_HEADER                     *Variable;
+  VARIABLE_HEADER                     *Filler;
+  UINTN                               HeaderSize;
+  UINTN                               FillerMinSize;
+  UINTN                               StoreToFv;
+  UINTN                               BlockSize;
+  UINTN                               LastOffset;
+  UINTN                               DeletedOffset;
+  UINTN                               LastHeaderOffset;
+  BOOLEAN                             ValidAfterDeleted;
+  UINTN                               Offset;
+  UINTN                               NextOffset;
+  UINTN                               KeptOffset;
+  UINTN                               VariableSize;
+  UINTN                               BlockEnd;
+  UINTN                               RegionEnd;
+  UINTN                               WriteOffset;
+  UINTN                               MovedOffset[VARIABLE_RECLAIM_MAX_MOVE_COUNT];
+  UINTN                               MovedCount;
+  UINTN                               MovedEnd;
+  UINTN                               Index;
+
+  *PassDone       = FALSE;
+  *BytesMoved     = 0;
+  *BytesReclaimed = 0;
+
+  AuthFormat    = mVariableModuleGlobal->VariableGlobal.AuthFormat;
+  HeaderSize    = GetVariableHeaderSize (AuthFormat);
+  FillerMinSize = HeaderSize + HEADER_ALIGN (sizeof (CHAR16));
+  Store         = (UINT8 *) mNvVariableCache;
+  LastOffset    = mVariableModuleGlobal->NonVolatileLastVariableOffset;
+  Fvb           = mVariableModuleGlobal->FvbInstance;
+
+  if (mIncrementalReclaimOffset == 0) {
+    mIncrementalReclaimOffset = (UINTN) GetStartPointer (mNvVariableCache) - (UINTN) Store;
+  }
+
+  //
+  // Find the first deleted variable, and whether a valid variable follows it.
+  //
+  DeletedOffset     = LastOffset;
+  LastHeaderOffset  = LastOffset;
+  ValidAfterDeleted = FALSE;
+  for (Offset = mIncrementalReclaimOffset; Offset < LastOffset; Offset = NextOffset) {
+    Variable = (VARIABLE_HEADER *) (Store + Offset);
+    if (!IsValidVariableHeader (Variable, GetEndPointer (mNvVariableCache))) {
+      break;
+    }
+    NextOffset       = (UINTN) GetNextVariablePtr (Variable, AuthFormat) - (UINTN) Store;
+    LastHeaderOffset = Offset;
+    if ((Variable->State == VAR_ADDED) || (Variable->State == (VAR_IN_DELETED_TRANSITION & VAR_ADDED))) {
+      if (DeletedOffset != LastOffset) {
+        ValidAfterDeleted = TRUE;
+        break;
+      }
+    } else if (DeletedOffset == LastOffset) {
+      DeletedOffset = Offset;
+    }
+  }
+
+  if (DeletedOffset == LastOffset) {
+    mIncrementalReclaimOffset = 0;
+    *PassDone = TRUE;
+    return EFI_SUCCESS;
+  }
+  mIncrementalReclaimOffset = DeletedOffset;
+
+  Status = GetFtwProtocol (&FtwProtocol);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+  Status = Fvb->GetPhysicalAddress (Fvb, &FvBase);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+  StoreToFv = (UINTN) (mVariableModuleGlobal->VariableGlobal.NonVolatileVariableBase - FvBase);
+  //
+  // Assume the FV has one type of BlockLength, as GetLbaAndOffsetByAddress() does.
+  //
+  BlockSize = mNvFvHeaderCache->BlockMap[0].Length;
+
+  if (!ValidAfterDeleted) {
+    //
+    // Only deleted variables are left: erase the ones that start in the block
+    // of the last variable. The previous variable ends where they start, so
+    // the store stays parsable and the free area after it stays erased.
+    //
+    for (Offset = DeletedOffset; Offset < LastHeaderOffset; Offset = NextOffset) {
+      if ((Offset + StoreToFv) / BlockSize == (LastHeaderOffset + StoreToFv) / BlockSize) {
+        break;
+      }
+      NextOffset = (UINTN) GetNextVariablePtr ((VARIABLE_HEADER *) (Store + Offset), AuthFormat) - (UINTN) Store;
+    }
+    if (LastOffset - Offset > mIncrementalReclaimBufferSize) {
+      return EFI_BUFFER_TOO_SMALL;
+    }
+
+    SetMem (mIncrementalReclaimBuffer, LastOffset - Offset, 0xff);
+    Status = FtwVariableRegion (
+               mVariableModuleGlobal->VariableGlobal.NonVolatileVariableBase + Offset,
+               LastOffset - Offset,
+               mIncrementalReclaimBuffer
+               );
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+    SetMem (Store + Offset, LastOffset - Offset, 0xff);
+    mVariableModuleGlobal->NonVolatileLastVariableOffset = Offset;
+    *BytesReclaimed = LastOffset - Offset;
+    goto Done;
+  }
+
+  //
+  // Rewrite the block from the deleted variable to its end.
+  //
+  BlockEnd = ((DeletedOffset + StoreToFv) / BlockSize + 1) * BlockSize - StoreToFv;
+  BlockEnd = MIN (BlockEnd, mNvVariableCache->Size);
+  CopyMem (mIncrementalReclaimBuffer, Store + DeletedOffset, BlockEnd - DeletedOffset);
+
+  //
+  // Pack the valid variables that start in the block.
+  //
+  WriteOffset = DeletedOffset;
+  for (Offset = DeletedOffset; (Offset < BlockEnd) && (Offset < LastOffset); Offset = NextOffset) {
+    Variable     = (VARIABLE_HEADER *) (Store + Offset);
+    NextOffset   = (UINTN) GetNextVariablePtr (Variable, AuthFormat) - (UINTN) Store;
+    VariableSize = NextOffset - Offset;
+    if ((Variable->State != VAR_ADDED) && (Variable->State != (VAR_IN_DELETED_TRANSITION & VAR_ADDED))) {
+      continue;
+    }
+    if (WriteOffset + VariableSize > BlockEnd) {
+      //
+      // It does not fit in the block once packed, keep it where it is.
+      //
+      break;
+    }
+    if (WriteOffset != Offset) {
+      CopyMem (mIncrementalReclaimBuffer + WriteOffset - DeletedOffset, Variable, VariableSize);
+      *BytesMoved += VariableSize;
+    }
+    WriteOffset += VariableSize;
+  }
+  KeptOffset = Offset;
+  RegionEnd  = BlockEnd;
+  MovedCount = 0;
+  MovedEnd   = BlockEnd;
+
+  if (KeptOffset == LastOffset) {
+    //
+    // Nothing follows the packed variables: the rest of the region becomes free
+    // space, including the tail of a variable that went past the end of the block.
+    //
+    RegionEnd = MAX (BlockEnd, LastOffset);
+    if (RegionEnd - DeletedOffset > mIncrementalReclaimBufferSize) {
+      return EFI_BUFFER_TOO_SMALL;
+    }
+    SetMem (
+      mIncrementalReclaimBuffer + WriteOffset - DeletedOffset,
+      RegionEnd - WriteOffset,
+      0xff
+      );
+  } else {
+    if (KeptOffset >= BlockEnd) {
+      //
+      // Move valid variables of the following blocks into the room left. The filler
+      // will end at KeptOffset, so the room it needs is checked for each variable.
+      // The header of each moved variable must be within the region to be marked
+      // as DELETED by the same write.
+      //
+      for (Offset = KeptOffset; (Offset < LastOffset) && (MovedCount < VARIABLE_RECLAIM_MAX_MOVE_COUNT); Offset = NextOffset) {
+        Variable     = (VARIABLE_HEADER *) (Store + Offset);
+        if (!IsValidVariableHeader (Variable, GetEndPointer (mNvVariableCache)) ||
+            (Variable->State == (VAR_IN_DELETED_TRANSITION & VAR_ADDED)) ||
+            (Offset + HeaderSize - DeletedOffset > mIncrementalReclaimBufferSize)) {
+          break;
+        }
+        NextOffset   = (UINTN) GetNextVariablePtr (Variable, AuthFormat) - (UINTN) Store;
+        VariableSize = NextOffset - Offset;
+        if ((Variable->State != VAR_ADDED) ||
+            (WriteOffset + VariableSize > BlockEnd) ||
+            ((KeptOffset - (WriteOffset + VariableSize) != 0) && (KeptOffset - (WriteOffset + VariableSize) < FillerMinSize))) {
+          continue;
+        }
+        CopyMem (mIncrementalReclaimBuffer + WriteOffset - DeletedOffset, Variable, VariableSize);
+        MovedOffset[MovedCount++] = Offset;
+        MovedEnd      = Offset + HeaderSize;
+        WriteOffset  += VariableSize;
+        *BytesMoved  += VariableSize;
+      }
+    }
+
+    if (*BytesMoved == 0) {
+      //
+      // Nothing moves into the hole, so leave the block as it is.
+      //
+      mIncrementalReclaimOffset = KeptOffset;
+      return EFI_SUCCESS;
+    }
+
+    //
+    // The region grows past the block to hold the headers of the moved variables,
+    // and the header of the filler if it crosses the end of the block.
+    //
+    RegionEnd = MovedEnd;
+    if (WriteOffset != KeptOffset) {
+      if (KeptOffset - WriteOffset < FillerMinSize) {
+        return EFI_VOLUME_CORRUPTED;
+      }
+      RegionEnd = MAX (RegionEnd, WriteOffset + FillerMinSize);
+    }
+    if (RegionEnd - DeletedOffset > mIncrementalReclaimBufferSize) {
+      return EFI_BUFFER_TOO_SMALL;
+    }
+    if (RegionEnd > BlockEnd) {
+      CopyMem (mIncrementalReclaimBuffer + BlockEnd - DeletedOffset, Store + BlockEnd, RegionEnd - BlockEnd);
+    }
+
+    if (WriteOffset != KeptOffset) {
+      //
+      // Cover the hole up to KeptOffset with a deleted variable.
+      //
+      Filler = (VARIABLE_HEADER *) (mIncrementalReclaimBuffer + WriteOffset - DeletedOffset);
+      ZeroMem (Filler, HeaderSize);
+      Filler->StartId = VARIABLE_DATA;
+      Filler->State   = VAR_ADDED & VAR_DELETED;
+      SetNameSizeOfVariable (Filler, sizeof (CHAR16), AuthFormat);
+      SetDataSizeOfVariable (Filler, KeptOffset - WriteOffset - FillerMinSize, AuthFormat);
+      *GetVariableNamePtr (Filler, AuthFormat) = L'\0';
+    }
+
+    //
+    // The new copies and the DELETED originals are written together.
+    //
+    for (Index = 0; Index < MovedCount; Index++) {
+      Variable = (VARIABLE_HEADER *) (mIncrementalReclaimBuffer + MovedOffset[Index] - DeletedOffset);
+      Variable->State &= VAR_DELETED;
+    }
+  }
+
+  Status = FtwVariableRegion (
+             mVariableModuleGlobal->VariableGlobal.NonVolatileVariableBase + DeletedOffset,
+             RegionEnd - DeletedOffset,
+             mIncrementalReclaimBuffer
+             );
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+  CopyMem (Store + DeletedOffset, mIncrementalReclaimBuffer, RegionEnd - DeletedOffset);
+
+  if (KeptOffset == LastOffset) {
+    mVariableModuleGlobal->NonVolatileLastVariableOffset = WriteOffset;
+    *BytesReclaimed = LastOffset - WriteOffset;
+    mIncrementalReclaimOffset = WriteOffset;
+  } else if (MovedCount == VARIABLE_RECLAIM_MAX_MOVE_COUNT) {
+    //
+    // There may be room left for more variables, come back to the filler.
+    //
+    mIncrementalReclaimOffset = WriteOffset;
+  } else {
+    mIncrementalReclaimOffset = KeptOffset;
+  }
+
+Done:
+  //
+  // The variables have moved, so the index of the store must be rebuilt.
+  //
+  VariableIndexReset (mVariableStoreIndex[VariableStoreTypeNv]);
+  SynchronizeRuntimeVariableCache (
+    &mVariableModuleGlobal->VariableGlobal.VariableRuntimeCacheContext.VariableRuntimeNvCache,
+    0,
+    mNvVariableCache->Size
+    );
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Compact the non-volatile variable store incrementally, within the time
+  budget of PcdVariableReclaimTimeBudget, once it is filled over
+  PcdVariableReclaimThreshold.
+
+  A pass over the store is started when the store is filled over the
+  threshold and has grown since the previous pass, then continued by the
+  following calls until no deleted variable is left. At least one step is
+  done per call, and at most VARIABLE_RECLAIM_MAX_STEP_COUNT. Unlike Reclaim(),
+  a step never rewrites more than one block and a variable, so the latency of
+  SetVariable() stays bounded. The performance counter is read only if the
+  time budget is not 0 or the statistics are collected. At runtime, the store
+  is only compacted if the FTW protocol is still available, as in SMM.
+
+  Caution: This function may be invoked at SMM mode.
+
+**/
+VOID
+ReclaimVariableStoreIncrementally (
+  VOID
+  )
+{
+  EFI_STATUS                    Status;
+  UINT64                        StartTicks;
+  UINT64                        StepTicks;
+  UINT64                        Budget;
+  UINTN                         StepCount;
+  BOOLEAN                       PassDone;
+  UINTN                         BytesMoved;
+  UINTN                         BytesReclaimed;
+
+  //
+  // Unlike Reclaim(), a step needs no memory allocation, so it can go on at
+  // runtime as long as the FTW protocol can be used.
+  //
+  if ((mIncrementalReclaimBuffer == NULL) || mVariableModuleGlobal->VariableGlobal.EmuNvMode) {
+    return;
+  }
+  if (AtRuntime () && !CanReclaimAtRuntime ()) {
+    return;
+  }
+
+  if (mIncrementalReclaimOffset == 0) {
+    if ((mVariableModuleGlobal->NonVolatileLastVariableOffset <= mIncrementalReclaimEndOffset) ||
+        ((UINT64) mVariableModuleGlobal->NonVolatileLastVariableOffset * 100 <
+         (UINT64) PcdGet8 (PcdVariableReclaimThreshold) * mNvVariableCache->Size)) {
+      return;
+    }
+  }
+
+  Budget     = MultU64x32 (PcdGet32 (PcdVariableReclaimTimeBudget), 1000);
+  StartTicks = 0;
+  StepTicks  = 0;
+  if (Budget != 0) {
+    StartTicks = GetPerformanceCounter ();
+  }
+  for (StepCount = 0; StepCount < VARIABLE_RECLAIM_MAX_STEP_COUNT; StepCount++) {
+    if (FeaturePcdGet (PcdVariableCollectStatistics)) {
+      StepTicks = GetPerformanceCounter ();
+    }
+    Status = ReclaimVariableStoreStep (&PassDone, &BytesMoved, &BytesReclaimed);
+    if (EFI_ERROR (Status)) {
+      //
+      // Give up the pass, and do not start another one until the store grows.
+      //
+      DEBUG ((DEBUG_WARN, "Variable: Incremental reclaim step failed - %r\n", Status));
+      mIncrementalReclaimOffset    = 0;
+      mIncrementalReclaimEndOffset = mVariableModuleGlobal->NonVolatileLastVariableOffset;
+      return;
+    }
+
+    if (PassDone) {
+      RecalculateNonVolatileVariableTotalSize ();
+      mIncrementalReclaimEndOffset = mVariableModuleGlobal->NonVolatileLastVariableOffset;
+      if (FeaturePcdGet (PcdVariableCollectStatistics)) {
+        gVariableReclaimStatistics.IncrementalPassCount++;
+      }
+      break;
+    }
+
+    if (FeaturePcdGet (PcdVariableCollectStatistics)) {
+      UpdateVariableReclaimStatistics (TRUE, GetReclaimElapsedTime (StepTicks), BytesMoved, BytesReclaimed);
+    }
+    if ((Budget == 0) || (GetReclaimElapsedTime (StartTicks) >= Budget)) {
+      break;
+    }
+  }
+}
+
 /**
   Finds variable in storage blocks of volatile and non-volatile storage areas.
 
@@ -868,7 +1465,8 @@ FindVariable (
     PtrTrack->EndPtr   = GetEndPointer   (VariableStoreHeader[Type]);
     PtrTrack->Volatile = (BOOLEAN) (Type == VariableStoreTypeVolatile);
 
-    Status =  FindVariableEx (
+    Status =  FindVariableInIndex (
+                mVariableStoreIndex[Type],
                 VariableName,
                 VendorGuid,
                 IgnoreRtCheck,
@@ -2482,6 +3080,7 @@ VariableServiceGetNextVariableName (
               VariableName,
               VendorGuid,
               VariableStoreHeader,
+              mVariableStoreIndex,
               &VariablePtr,
               AuthFormat
               );
@@ -2788,6 +3387,10 @@ VariableServiceSetVariable (
     Status = UpdateVariable (VariableName, VendorGuid, Data, DataSize, Attributes, 0, 0, &Variable, NULL);
   }
 
+  if (!EFI_ERROR (Status)) {
+    ReclaimVariableStoreIncrementally ();
+  }
+
 Done:
   InterlockedDecrement (&mVariableModuleGlobal->VariableGlobal.ReentrantState);
   ReleaseLockOnlyAtBootTime (&mVariableModuleGlobal->VariableGlobal.VariableServicesLock);
@@ -3322,6 +3925,18 @@ VariableWriteServiceInitialize (
 
   FlushHobVariableToFlash (NULL, NULL);
 
+  if ((PcdGet8 (PcdVariableReclaimThreshold) != 0) && !mVariableModuleGlobal->VariableGlobal.EmuNvMode) {
+    //
+    // One block, plus the tail of a variable that starts in it, or the headers
+    // of the variables moved into it from the next block.
+    //
+    mIncrementalReclaimBufferSize = mNvFvHeaderCache->BlockMap[0].Length + GetMaxVariableSize ();
+    mIncrementalReclaimBuffer     = AllocateRuntimePool (mIncrementalReclaimBufferSize);
+    if (mIncrementalReclaimBuffer == NULL) {
+      DEBUG ((DEBUG_WARN, "Variable: No buffer for incremental reclaim, it is disabled\n"));
+    }
+  }
+
   Status = EFI_SUCCESS;
   ZeroMem (&mAuthContextOut, sizeof (mAuthContextOut));
   if (mVariableModuleGlobal->VariableGlobal.AuthFormat) {
@@ -3658,6 +4273,25 @@ VariableCommonInitialize (
   VolatileVariableStore->Reserved    = 0;
   VolatileVariableStore->Reserved1   = 0;
 
+  //
+  // Create the (Name, Guid) index of each variable store. A store without
+  // index is still searched linearly, so failing to create one is not fatal.
+  //
+  mVariableStoreIndex[VariableStoreTypeVolatile] = VariableIndexCreate (
+                                                     VolatileVariableStore->Size,
+                                                     mVariableModuleGlobal->VariableGlobal.AuthFormat
+                                                     );
+  if (mVariableModuleGlobal->VariableGlobal.HobVariableBase != 0) {
+    mVariableStoreIndex[VariableStoreTypeHob] = VariableIndexCreate (
+                                                  ((VARIABLE_STORE_HEADER *) (UINTN) mVariableModuleGlobal->VariableGlobal.HobVariableBase)->Size,
+                                                  mVariableModuleGlobal->VariableGlobal.AuthFormat
+                                                  );
+  }
+  mVariableStoreIndex[VariableStoreTypeNv] = VariableIndexCreate (
+                                               mNvVariableCache->Size,
+                                               mVariableModuleGlobal->VariableGlobal.AuthFormat
+                                               );
+
   return EFI_SUCCESS;
 }
 
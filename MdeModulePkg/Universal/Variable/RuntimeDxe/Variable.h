@@ -31,9 +31,11 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <Library/MemoryAllocationLib.h>
 #include <Library/AuthVariableLib.h>
 #include <Library/VarCheckLib.h>
+#include <Library/TimerLib.h>
 #include <Guid/GlobalVariable.h>
 #include <Guid/EventGroup.h>
 #include <Guid/VariableFormat.h>
+#include <Guid/VariableReclaimStatistics.h>
 #include <Guid/SystemNvDataGuid.h>
 #include <Guid/FaultTolerantWrite.h>
 #include <Guid/VarErrorFlag.h>
@@ -57,6 +59,18 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 ///
 #define ISO_639_2_ENTRY_SIZE    3
 
+///
+/// The maximum number of variables that one incremental reclaim step moves
+/// from the following blocks into the block it compacts.
+///
+#define VARIABLE_RECLAIM_MAX_MOVE_COUNT   64
+
+///
+/// The maximum number of incremental reclaim steps done by one SetVariable()
+/// call, whatever the time budget.
+///
+#define VARIABLE_RECLAIM_MAX_STEP_COUNT   16
+
 typedef enum {
   VariableStoreTypeVolatile,
   VariableStoreTypeHob,
@@ -160,6 +174,30 @@ FtwVariableSpace (
   IN VARIABLE_STORE_HEADER  *VariableBuffer
   );
 
+/**
+  Writes a buffer to a region of variable storage space, in the working block.
+
+  This function writes a buffer to a region of variable storage space into a
+  firmware volume block device. The region may span several blocks, and does
+  not need to be block aligned. Fault Tolerant Write protocol is used for
+  writing, so the region is either fully updated or left unchanged.
+
+  @param  Address        Base address of the region to write.
+  @param  Size           Size of the region in bytes.
+  @param  Buffer         Point to the data to write.
+
+  @retval EFI_SUCCESS    The function completed successfully.
+  @retval EFI_NOT_FOUND  Fail to locate Fault Tolerant Write protocol.
+  @retval EFI_ABORTED    The function could not complete successfully.
+
+**/
+EFI_STATUS
+FtwVariableRegion (
+  IN EFI_PHYSICAL_ADDRESS   Address,
+  IN UINTN                  Size,
+  IN VOID                   *Buffer
+  );
+
 /**
   Finds variable in storage blocks of volatile and non-volatile storage areas.
 
@@ -265,6 +303,19 @@ AtRuntime (
   VOID
   );
 
+/**
+  Return TRUE if the Fault Tolerant Write protocol can still be used to
+  compact the non-volatile variable store after ExitBootServices () has
+  been called.
+
+  @retval TRUE  The variable store can be compacted at runtime.
+  @retval FALSE The variable store can only be compacted at boot time.
+**/
+BOOLEAN
+CanReclaimAtRuntime (
+  VOID
+  );
+
 /**
   Initializes a basic mutual exclusion lock.
 
@@ -383,6 +434,17 @@ ReclaimForOS(
   VOID
   );
 
+/**
+  Compact the non-volatile variable store incrementally, within the time
+  budget of PcdVariableReclaimTimeBudget, once it is filled over
+  PcdVariableReclaimThreshold.
+
+**/
+VOID
+ReclaimVariableStoreIncrementally (
+  VOID
+  );
+
 /**
   Get maximum variable size, covering both non-volatile and volatile variables.
 
@@ -693,6 +755,8 @@ extern VARIABLE_MODULE_GLOBAL       *mVariableModuleGlobal;
 extern EFI_FIRMWARE_VOLUME_HEADER   *mNvFvHeaderCache;
 extern VARIABLE_STORE_HEADER        *mNvVariableCache;
 extern VARIABLE_INFO_ENTRY          *gVariableInfo;
+extern VARIABLE_RECLAIM_STATISTICS  gVariableReclaimStatistics;
+extern UINT8                        *mIncrementalReclaimBuffer;
 extern BOOLEAN                      mEndOfDxe;
 extern VAR_CHECK_REQUEST_SOURCE     mRequestSource;
 
@@ -11,6 +11,7 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 **/
 
 #include "Variable.h"
+#include "VariableIndex.h"
 
 #include <Protocol/VariablePolicy.h>
 #include <Library/VariablePolicyLib.h>
@@ -61,6 +62,21 @@ AtRuntime (
   return EfiAtRuntime ();
 }
 
+/**
+  Return TRUE if the Fault Tolerant Write protocol can still be used to
+  compact the non-volatile variable store after ExitBootServices () has
+  been called.
+
+  @retval FALSE The FTW protocol is gone with the boot services.
+**/
+BOOLEAN
+CanReclaimAtRuntime (
+  VOID
+  )
+{
+  return FALSE;
+}
+
 
 /**
   Initializes a basic mutual exclusion lock.
@@ -141,6 +157,7 @@ ReleaseLockOnlyAtBootTime (
   @retval EFI_SUCCESS           The FTW protocol instance was found and returned in FtwProtocol.
   @retval EFI_NOT_FOUND         The FTW protocol instance was not found.
   @retval EFI_INVALID_PARAMETER SarProtocol is NULL.
+  @retval EFI_UNSUPPORTED       The FTW protocol cannot be used at runtime.
 
 **/
 EFI_STATUS
@@ -150,6 +167,13 @@ GetFtwProtocol (
 {
   EFI_STATUS                              Status;
 
+  if (AtRuntime ()) {
+    //
+    // Boot services are gone, and the FTW protocol with them.
+    //
+    return EFI_UNSUPPORTED;
+  }
+
   //
   // Locate Fault Tolerent Write protocol
   //
@@ -265,6 +289,10 @@ VariableClassAddressChangeEvent (
   EfiConvertPointer (0x0, (VOID **) &mVariableModuleGlobal);
   EfiConvertPointer (0x0, (VOID **) &mNvVariableCache);
   EfiConvertPointer (0x0, (VOID **) &mNvFvHeaderCache);
+  EfiConvertPointer (0x0, (VOID **) &mIncrementalReclaimBuffer);
+  for (Index = 0; Index < VariableStoreTypeMax; Index++) {
+    EfiConvertPointer (0x0, (VOID **) &mVariableStoreIndex[Index]);
+  }
 
   if (mAuthContextOut.AddressPointer != NULL) {
     for (Index = 0; Index < mAuthContextOut.AddressPointerCount; Index++) {
@@ -322,6 +350,7 @@ OnReadyToBoot (
     } else {
       gBS->InstallConfigurationTable (&gEfiVariableGuid, gVariableInfo);
     }
+    gBS->InstallConfigurationTable (&gEdkiiVariableReclaimStatisticsGuid, &gVariableReclaimStatistics);
   }
 
   gBS->CloseEvent (Event);
@@ -108,6 +108,7 @@ VariableExLibFindNextVariable (
              VariableName,
              VendorGuid,
              VariableStoreHeader,
+             mVariableStoreIndex,
              &VariablePtr,
              mVariableModuleGlobal->VariableGlobal.AuthFormat
              );
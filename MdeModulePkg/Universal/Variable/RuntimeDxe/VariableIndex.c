@@ -0,0 +1,368 @@
+/** @file
+  The (Name, Guid) hash index of a variable store.
+
+  FindVariableEx() walks every variable header of a store until it finds the
+  requested one. The index maps the hash of the variable name and vendor GUID
+  to the offsets of the variable headers with that hash, so only those headers
+  need to be inspected.
+
+  Caution: This module requires additional review when modified.
+  This driver will have external input - variable data. They may be input in SMM mode.
+  This external input must be validated carefully to avoid security issue like
+  buffer overflow, integer overflow.
+
+Copyright (c) 2021, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "VariableParsing.h"
+#include "VariableIndex.h"
+
+#define VARIABLE_INDEX_MIN_BUCKET_COUNT   16
+
+#define VARIABLE_INDEX_BUCKETS(Index)     ((UINT32 *) ((VARIABLE_STORE_INDEX *) (Index) + 1))
+#define VARIABLE_INDEX_ENTRIES(Index)     ((VARIABLE_INDEX_ENTRY *) (VARIABLE_INDEX_BUCKETS (Index) + (Index)->BucketCount))
+
+//
+// FNV-1a 32-bit parameters.
+//
+#define VARIABLE_INDEX_HASH_OFFSET_BASIS  0x811C9DC5
+#define VARIABLE_INDEX_HASH_PRIME         0x01000193
+
+/**
+  Compute the hash of a variable name and vendor GUID.
+
+  @param[in] Name         Pointer to the variable name.
+  @param[in] NameSize     Size in bytes of the variable name, including the
+                          null terminator.
+  @param[in] VendorGuid   Pointer to the vendor GUID.
+
+  @return The hash value.
+
+**/
+UINT32
+VariableIndexHash (
+  IN CONST VOID       *Name,
+  IN UINTN            NameSize,
+  IN CONST EFI_GUID   *VendorGuid
+  )
+{
+  UINT32        Hash;
+  CONST UINT8   *Byte;
+  UINTN         Count;
+
+  Hash = VARIABLE_INDEX_HASH_OFFSET_BASIS;
+
+  Byte = (CONST UINT8 *) Name;
+  for (Count = 0; Count < NameSize; Count++) {
+    Hash = (Hash ^ Byte[Count]) * VARIABLE_INDEX_HASH_PRIME;
+  }
+
+  Byte = (CONST UINT8 *) VendorGuid;
+  for (Count = 0; Count < sizeof (EFI_GUID); Count++) {
+    Hash = (Hash ^ Byte[Count]) * VARIABLE_INDEX_HASH_PRIME;
+  }
+
+  return Hash;
+}
+
+/**
+  Compute the hash of the variable at a given variable header.
+
+  @param[in]  Variable      Pointer to the variable header.
+  @param[in]  EndPtr        Pointer to the end of the variable store.
+  @param[in]  AuthFormat    TRUE indicates authenticated variables are used.
+                            FALSE indicates authenticated variables are not used.
+  @param[out] Hash          The hash of the variable name and vendor GUID.
+
+  @retval TRUE              The hash was computed.
+  @retval FALSE             The variable name is empty or goes beyond the end
+                            of the variable store.
+
+**/
+BOOLEAN
+VariableIndexHashHeader (
+  IN  VARIABLE_HEADER       *Variable,
+  IN  VARIABLE_HEADER       *EndPtr,
+  IN  BOOLEAN               AuthFormat,
+  OUT UINT32                *Hash
+  )
+{
+  UINTN     NameSize;
+  UINTN     Name;
+
+  NameSize = NameSizeOfVariable (Variable, AuthFormat);
+  Name     = (UINTN) GetVariableNamePtr (Variable, AuthFormat);
+  if ((NameSize == 0) || (Name > (UINTN) EndPtr) || (NameSize > (UINTN) EndPtr - Name)) {
+    return FALSE;
+  }
+
+  *Hash = VariableIndexHash ((VOID *) Name, NameSize, GetVendorGuidPtr (Variable, AuthFormat));
+  return TRUE;
+}
+
+/**
+  Link an entry into its hash bucket, keeping the bucket in ascending offset
+  order so that a lookup sees the variables in the same order as a walk of
+  the store would.
+
+  @param[in, out] Index         The variable store index.
+  @param[in]      EntryNumber   Number plus one of the entry to link.
+
+**/
+VOID
+VariableIndexLinkEntry (
+  IN OUT VARIABLE_STORE_INDEX   *Index,
+  IN     UINT32                 EntryNumber
+  )
+{
+  VARIABLE_INDEX_ENTRY    *Entries;
+  VARIABLE_INDEX_ENTRY    *Entry;
+  UINT32                  *Link;
+
+  Entries = VARIABLE_INDEX_ENTRIES (Index);
+  Entry   = &Entries[EntryNumber - 1];
+  Link    = &VARIABLE_INDEX_BUCKETS (Index)[Entry->Hash & (Index->BucketCount - 1)];
+  while ((*Link != 0) && (Entries[*Link - 1].Offset < Entry->Offset)) {
+    Link = &Entries[*Link - 1].Next;
+  }
+
+  Entry->Next = *Link;
+  *Link       = EntryNumber;
+}
+
+/**
+  Bring the index up to date with the variable store: hash the pending
+  entries whose name and data have been written since, and index the
+  variables appended to the store since the last update.
+
+  @param[in, out] Index         The variable store index.
+  @param[in]      StartPtr      Pointer to the first variable of the store.
+  @param[in]      EndPtr        Pointer to the end of the variable store.
+  @param[in]      AuthFormat    TRUE indicates authenticated variables are used.
+                                FALSE indicates authenticated variables are not used.
+
+**/
+VOID
+VariableIndexUpdate (
+  IN OUT VARIABLE_STORE_INDEX   *Index,
+  IN     VARIABLE_HEADER        *StartPtr,
+  IN     VARIABLE_HEADER        *EndPtr,
+  IN     BOOLEAN                AuthFormat
+  )
+{
+  VARIABLE_INDEX_ENTRY    *Entries;
+  VARIABLE_INDEX_ENTRY    *Entry;
+  VARIABLE_HEADER         *Variable;
+  UINT32                  *Link;
+  UINT32                  EntryNumber;
+
+  Entries = VARIABLE_INDEX_ENTRIES (Index);
+
+  Link = &Index->PendingHead;
+  while (*Link != 0) {
+    EntryNumber = *Link;
+    Entry       = &Entries[EntryNumber - 1];
+    Variable    = (VARIABLE_HEADER *) ((UINTN) StartPtr + Entry->Offset);
+    if (Variable->State == VAR_HEADER_VALID_ONLY) {
+      Link = &Entry->Next;
+      continue;
+    }
+
+    *Link = Entry->Next;
+    if (VariableIndexHashHeader (Variable, EndPtr, AuthFormat, &Entry->Hash)) {
+      VariableIndexLinkEntry (Index, EntryNumber);
+    }
+  }
+
+  for ( Variable = (VARIABLE_HEADER *) ((UINTN) StartPtr + Index->IndexedOffset)
+      ; IsValidVariableHeader (Variable, EndPtr)
+      ; Variable = GetNextVariablePtr (Variable, AuthFormat)
+      ) {
+    if (Index->EntryCount == Index->MaxEntryCount) {
+      Index->Overflow = TRUE;
+      return;
+    }
+
+    Entry         = &Entries[Index->EntryCount];
+    Entry->Offset = (UINT32) ((UINTN) Variable - (UINTN) StartPtr);
+    Entry->Next   = 0;
+    if (Variable->State == VAR_HEADER_VALID_ONLY) {
+      //
+      // Only the header has been written so far. Hash the variable once its
+      // name is there too.
+      //
+      Index->EntryCount++;
+      Entry->Next        = Index->PendingHead;
+      Index->PendingHead = Index->EntryCount;
+    } else if (VariableIndexHashHeader (Variable, EndPtr, AuthFormat, &Entry->Hash)) {
+      Index->EntryCount++;
+      VariableIndexLinkEntry (Index, Index->EntryCount);
+    }
+
+    Index->IndexedOffset = (UINT32) ((UINTN) GetNextVariablePtr (Variable, AuthFormat) - (UINTN) StartPtr);
+  }
+}
+
+/**
+  Create the hash index of a variable store of the given size.
+
+  @param[in] StoreSize    Size in bytes of the variable store to index.
+  @param[in] AuthFormat   TRUE indicates authenticated variables are used.
+                          FALSE indicates authenticated variables are not used.
+
+  @return The new empty index, or NULL if there is not enough memory.
+
+**/
+VARIABLE_STORE_INDEX *
+VariableIndexCreate (
+  IN  UINTN     StoreSize,
+  IN  BOOLEAN   AuthFormat
+  )
+{
+  VARIABLE_STORE_INDEX  *Index;
+  UINTN                 MaxEntryCount;
+  UINTN                 BucketCount;
+
+  //
+  // The smallest variable is a header, a one character name and one byte of
+  // data, aligned.
+  //
+  MaxEntryCount = StoreSize / HEADER_ALIGN (GetVariableHeaderSize (AuthFormat) + sizeof (CHAR16) + 1);
+  if ((MaxEntryCount == 0) || (MaxEntryCount > BIT28)) {
+    return NULL;
+  }
+
+  BucketCount = GetPowerOfTwo32 ((UINT32) MaxEntryCount);
+  if (BucketCount < VARIABLE_INDEX_MIN_BUCKET_COUNT) {
+    BucketCount = VARIABLE_INDEX_MIN_BUCKET_COUNT;
+  }
+
+  Index = AllocateRuntimeZeroPool (
+            sizeof (VARIABLE_STORE_INDEX) +
+            BucketCount * sizeof (UINT32) +
+            MaxEntryCount * sizeof (VARIABLE_INDEX_ENTRY)
+            );
+  if (Index == NULL) {
+    return NULL;
+  }
+
+  Index->BucketCount   = (UINT32) BucketCount;
+  Index->MaxEntryCount = (UINT32) MaxEntryCount;
+  return Index;
+}
+
+/**
+  Drop all entries of a variable store index. It must be called whenever the
+  variables of the indexed store are moved, e.g. after a reclaim.
+
+  @param[in, out] Index   The index to reset, may be NULL.
+
+**/
+VOID
+VariableIndexReset (
+  IN OUT VARIABLE_STORE_INDEX   *Index
+  )
+{
+  if (Index == NULL) {
+    return;
+  }
+
+  ZeroMem (VARIABLE_INDEX_BUCKETS (Index), Index->BucketCount * sizeof (UINT32));
+  Index->EntryCount    = 0;
+  Index->IndexedOffset = 0;
+  Index->PendingHead   = 0;
+  Index->Overflow      = FALSE;
+}
+
+/**
+  Find the variable in the specified variable store with the help of its
+  index. The result is the same as FindVariableEx() on the same store.
+
+  @param[in, out]  Index               The index of the variable store. If it
+                                       is NULL, FindVariableEx() is used.
+  @param[in]       VariableName        Name of the variable to be found
+  @param[in]       VendorGuid          Vendor GUID to be found.
+  @param[in]       IgnoreRtCheck       Ignore EFI_VARIABLE_RUNTIME_ACCESS attribute
+                                       check at runtime when searching variable.
+  @param[in, out]  PtrTrack            Variable Track Pointer structure that contains Variable Information.
+  @param[in]       AuthFormat          TRUE indicates authenticated variables are used.
+                                       FALSE indicates authenticated variables are not used.
+
+  @retval          EFI_SUCCESS         Variable found successfully
+  @retval          EFI_NOT_FOUND       Variable not found
+**/
+EFI_STATUS
+FindVariableInIndex (
+  IN OUT VARIABLE_STORE_INDEX    *Index,
+  IN     CHAR16                  *VariableName,
+  IN     EFI_GUID                *VendorGuid,
+  IN     BOOLEAN                 IgnoreRtCheck,
+  IN OUT VARIABLE_POINTER_TRACK  *PtrTrack,
+  IN     BOOLEAN                 AuthFormat
+  )
+{
+  VARIABLE_INDEX_ENTRY    *Entries;
+  VARIABLE_INDEX_ENTRY    *Entry;
+  VARIABLE_HEADER         *Variable;
+  VARIABLE_HEADER         *InDeletedVariable;
+  UINT32                  EntryNumber;
+  UINT32                  Hash;
+  UINTN                   NameSize;
+
+  //
+  // An empty name asks for the first variable of the store, which the index
+  // cannot help with.
+  //
+  if ((Index == NULL) || (VariableName[0] == 0)) {
+    return FindVariableEx (VariableName, VendorGuid, IgnoreRtCheck, PtrTrack, AuthFormat);
+  }
+
+  VariableIndexUpdate (Index, PtrTrack->StartPtr, PtrTrack->EndPtr, AuthFormat);
+  if (Index->Overflow) {
+    return FindVariableEx (VariableName, VendorGuid, IgnoreRtCheck, PtrTrack, AuthFormat);
+  }
+
+  PtrTrack->InDeletedTransitionPtr = NULL;
+  InDeletedVariable = NULL;
+
+  NameSize = StrSize (VariableName);
+  Hash     = VariableIndexHash (VariableName, NameSize, VendorGuid);
+  Entries  = VARIABLE_INDEX_ENTRIES (Index);
+
+  for ( EntryNumber = VARIABLE_INDEX_BUCKETS (Index)[Hash & (Index->BucketCount - 1)]
+      ; EntryNumber != 0
+      ; EntryNumber = Entry->Next
+      ) {
+    Entry = &Entries[EntryNumber - 1];
+    if (Entry->Hash != Hash) {
+      continue;
+    }
+
+    Variable = (VARIABLE_HEADER *) ((UINTN) PtrTrack->StartPtr + Entry->Offset);
+    if (Variable->State != VAR_ADDED &&
+        Variable->State != (VAR_IN_DELETED_TRANSITION & VAR_ADDED)) {
+      continue;
+    }
+    if (!IgnoreRtCheck && AtRuntime () && ((Variable->Attributes & EFI_VARIABLE_RUNTIME_ACCESS) == 0)) {
+      continue;
+    }
+    if (!CompareGuid (VendorGuid, GetVendorGuidPtr (Variable, AuthFormat)) ||
+        (NameSizeOfVariable (Variable, AuthFormat) != NameSize) ||
+        (CompareMem (VariableName, GetVariableNamePtr (Variable, AuthFormat), NameSize) != 0)) {
+      continue;
+    }
+
+    if (Variable->State == (VAR_IN_DELETED_TRANSITION & VAR_ADDED)) {
+      InDeletedVariable = Variable;
+    } else {
+      PtrTrack->CurrPtr                = Variable;
+      PtrTrack->InDeletedTransitionPtr = InDeletedVariable;
+      return EFI_SUCCESS;
+    }
+  }
+
+  PtrTrack->CurrPtr = InDeletedVariable;
+  return (PtrTrack->CurrPtr == NULL) ? EFI_NOT_FOUND : EFI_SUCCESS;
+}
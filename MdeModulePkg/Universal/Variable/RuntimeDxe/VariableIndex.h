@@ -0,0 +1,122 @@
+/** @file
+  The (Name, Guid) hash index of a variable store, used to find a variable
+  without walking every variable header in the store.
+
+Copyright (c) 2021, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef _VARIABLE_INDEX_H_
+#define _VARIABLE_INDEX_H_
+
+#include "Variable.h"
+
+///
+/// Index entry of one variable header in a variable store.
+///
+typedef struct {
+  ///
+  /// Offset of the variable header from the first variable of the store.
+  ///
+  UINT32    Offset;
+  ///
+  /// Hash of the variable name and vendor GUID.
+  ///
+  UINT32    Hash;
+  ///
+  /// Number plus one of the next entry in the same bucket, 0 for the last
+  /// one. The entries of a bucket are kept in ascending Offset order.
+  ///
+  UINT32    Next;
+} VARIABLE_INDEX_ENTRY;
+
+///
+/// Hash index of a variable store. The bucket array and the entry array
+/// immediately follow this structure in memory, so that the index holds no
+/// pointer that needs to be converted at SetVirtualAddressMap() time.
+///
+/// The index only records where each variable header is. Its State and
+/// Attributes are always read back from the store, so a variable being
+/// deleted or marked IN_DELETED_TRANSITION needs no index update. Variables
+/// appended to the store are picked up on the next lookup. Only a rewrite of
+/// the whole store, as done by Reclaim(), needs VariableIndexReset().
+///
+typedef struct {
+  UINT32    BucketCount;
+  UINT32    MaxEntryCount;
+  UINT32    EntryCount;
+  ///
+  /// Offset from the first variable up to which the store has been indexed.
+  ///
+  UINT32    IndexedOffset;
+  ///
+  /// Chain of entries whose name and data were not written yet when they
+  /// were indexed, so their hash is still unknown.
+  ///
+  UINT32    PendingHead;
+  ///
+  /// TRUE if the store holds more variables than the index can track. The
+  /// index is not used until the next VariableIndexReset().
+  ///
+  BOOLEAN   Overflow;
+} VARIABLE_STORE_INDEX;
+
+/**
+  Create the hash index of a variable store of the given size.
+
+  @param[in] StoreSize    Size in bytes of the variable store to index.
+  @param[in] AuthFormat   TRUE indicates authenticated variables are used.
+                          FALSE indicates authenticated variables are not used.
+
+  @return The new empty index, or NULL if there is not enough memory.
+
+**/
+VARIABLE_STORE_INDEX *
+VariableIndexCreate (
+  IN  UINTN     StoreSize,
+  IN  BOOLEAN   AuthFormat
+  );
+
+/**
+  Drop all entries of a variable store index. It must be called whenever the
+  variables of the indexed store are moved, e.g. after a reclaim.
+
+  @param[in, out] Index   The index to reset, may be NULL.
+
+**/
+VOID
+VariableIndexReset (
+  IN OUT VARIABLE_STORE_INDEX   *Index
+  );
+
+/**
+  Find the variable in the specified variable store with the help of its
+  index. The result is the same as FindVariableEx() on the same store.
+
+  @param[in, out]  Index               The index of the variable store. If it
+                                       is NULL, FindVariableEx() is used.
+  @param[in]       VariableName        Name of the variable to be found
+  @param[in]       VendorGuid          Vendor GUID to be found.
+  @param[in]       IgnoreRtCheck       Ignore EFI_VARIABLE_RUNTIME_ACCESS attribute
+                                       check at runtime when searching variable.
+  @param[in, out]  PtrTrack            Variable Track Pointer structure that contains Variable Information.
+  @param[in]       AuthFormat          TRUE indicates authenticated variables are used.
+                                       FALSE indicates authenticated variables are not used.
+
+  @retval          EFI_SUCCESS         Variable found successfully
+  @retval          EFI_NOT_FOUND       Variable not found
+**/
+EFI_STATUS
+FindVariableInIndex (
+  IN OUT VARIABLE_STORE_INDEX    *Index,
+  IN     CHAR16                  *VariableName,
+  IN     EFI_GUID                *VendorGuid,
+  IN     BOOLEAN                 IgnoreRtCheck,
+  IN OUT VARIABLE_POINTER_TRACK  *PtrTrack,
+  IN     BOOLEAN                 AuthFormat
+  );
+
+extern VARIABLE_STORE_INDEX   *mVariableStoreIndex[VariableStoreTypeMax];
+
+#endif
@@ -518,6 +518,8 @@ FindVariableEx (
   @param[in]  VendorGuid        Variable Vendor Guid.
   @param[in]  VariableStoreList A list of variable stores that should be used to get the next variable.
                                 The maximum number of entries is the max value of VARIABLE_STORE_TYPE.
+  @param[in]  StoreIndexList    A list of the indexes of the variable stores in VariableStoreList, or
+                                NULL if the variable stores are not indexed.
   @param[out] VariablePtr       Pointer to variable header address.
   @param[in]  AuthFormat        TRUE indicates authenticated variables are used.
                                 FALSE indicates authenticated variables are not used.
@@ -535,6 +537,7 @@ VariableServiceGetNextVariableInternal (
   IN  CHAR16                *VariableName,
   IN  EFI_GUID              *VendorGuid,
   IN  VARIABLE_STORE_HEADER **VariableStoreList,
+  IN  VARIABLE_STORE_INDEX  **StoreIndexList OPTIONAL,
   OUT VARIABLE_HEADER       **VariablePtr,
   IN  BOOLEAN               AuthFormat
   )
@@ -563,7 +566,14 @@ VariableServiceGetNextVariableInternal (
     Variable.EndPtr   = GetEndPointer   (VariableStoreList[StoreType]);
     Variable.Volatile = (BOOLEAN) (StoreType == VariableStoreTypeVolatile);
 
-    Status = FindVariableEx (VariableName, VendorGuid, FALSE, &Variable, AuthFormat);
+    Status = FindVariableInIndex (
+               (StoreIndexList == NULL) ? NULL : StoreIndexList[StoreType],
+               VariableName,
+               VendorGuid,
+               FALSE,
+               &Variable,
+               AuthFormat
+               );
     if (!EFI_ERROR (Status)) {
       break;
     }
@@ -642,7 +652,8 @@ VariableServiceGetNextVariableInternal (
           //
           VariablePtrTrack.StartPtr = Variable.StartPtr;
           VariablePtrTrack.EndPtr = Variable.EndPtr;
-          Status = FindVariableEx (
+          Status = FindVariableInIndex (
+                     (StoreIndexList == NULL) ? NULL : StoreIndexList[StoreType],
                      GetVariableNamePtr (Variable.CurrPtr, AuthFormat),
                      GetVendorGuidPtr (Variable.CurrPtr, AuthFormat),
                      FALSE,
@@ -663,7 +674,8 @@ VariableServiceGetNextVariableInternal (
            ) {
           VariableInHob.StartPtr = GetStartPointer (VariableStoreList[VariableStoreTypeHob]);
           VariableInHob.EndPtr   = GetEndPointer   (VariableStoreList[VariableStoreTypeHob]);
-          Status = FindVariableEx (
+          Status = FindVariableInIndex (
+                     (StoreIndexList == NULL) ? NULL : StoreIndexList[VariableStoreTypeHob],
                      GetVariableNamePtr (Variable.CurrPtr, AuthFormat),
                      GetVendorGuidPtr (Variable.CurrPtr, AuthFormat),
                      FALSE,
@@ -12,6 +12,7 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 
 #include <Guid/ImageAuthentication.h>
 #include "Variable.h"
+#include "VariableIndex.h"
 
 /**
 
@@ -290,6 +291,8 @@ FindVariableEx (
   @param[in]  VendorGuid        Variable Vendor Guid.
   @param[in]  VariableStoreList A list of variable stores that should be used to get the next variable.
                                 The maximum number of entries is the max value of VARIABLE_STORE_TYPE.
+  @param[in]  StoreIndexList    A list of the indexes of the variable stores in VariableStoreList, or
+                                NULL if the variable stores are not indexed.
   @param[out] VariablePtr       Pointer to variable header address.
   @param[in]  AuthFormat        TRUE indicates authenticated variables are used.
                                 FALSE indicates authenticated variables are not used.
@@ -307,6 +310,7 @@ VariableServiceGetNextVariableInternal (
   IN  CHAR16                *VariableName,
   IN  EFI_GUID              *VendorGuid,
   IN  VARIABLE_STORE_HEADER **VariableStoreList,
+  IN  VARIABLE_STORE_INDEX  **StoreIndexList OPTIONAL,
   OUT VARIABLE_HEADER       **VariablePtr,
   IN  BOOLEAN               AuthFormat
   );
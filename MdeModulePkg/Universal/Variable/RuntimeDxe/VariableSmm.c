@@ -126,6 +126,21 @@ AtRuntime (
   return mAtRuntime;
 }
 
+/**
+  Return TRUE if the Fault Tolerant Write protocol can still be used to
+  compact the non-volatile variable store after ExitBootServices () has
+  been called.
+
+  @retval TRUE  The SMM FTW protocol stays available at runtime.
+**/
+BOOLEAN
+CanReclaimAtRuntime (
+  VOID
+  )
+{
+  return TRUE;
+}
+
 /**
   Initializes a basic mutual exclusion lock.
 
@@ -726,6 +741,19 @@ SmmVariableHandler (
       *CommBufferSize = InfoSize + SMM_VARIABLE_COMMUNICATE_HEADER_SIZE;
       break;
 
+    case SMM_VARIABLE_FUNCTION_GET_RECLAIM_STATISTICS:
+      if (!FeaturePcdGet (PcdVariableCollectStatistics)) {
+        Status = EFI_UNSUPPORTED;
+        break;
+      }
+      if (CommBufferPayloadSize < sizeof (VARIABLE_RECLAIM_STATISTICS)) {
+        DEBUG ((EFI_D_ERROR, "GetReclaimStatistics: SMM communication buffer size invalid!\n"));
+        return EFI_SUCCESS;
+      }
+      CopyMem (SmmVariableFunctionHeader->Data, &gVariableReclaimStatistics, sizeof (VARIABLE_RECLAIM_STATISTICS));
+      Status = EFI_SUCCESS;
+      break;
+
     case SMM_VARIABLE_FUNCTION_LOCK_VARIABLE:
       if (mEndOfDxe) {
         Status = EFI_ACCESS_DENIED;
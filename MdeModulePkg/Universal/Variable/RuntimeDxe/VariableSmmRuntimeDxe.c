@@ -906,6 +906,7 @@ GetNextVariableNameInRuntimeCache (
                 VariableName,
                 VendorGuid,
                 VariableStoreHeader,
+                NULL,
                 &VariablePtr,
                 mVariableAuthFormat
                 );
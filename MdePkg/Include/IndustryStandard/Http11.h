@@ -76,6 +76,13 @@
 ///
 #define HTTP_HEADER_ACCEPT_RANGES      "Accept-Ranges"
 
+///
+/// Range Request Header
+/// The Range request-header field requests only one or more sub-ranges of the
+/// entity. A server which supports it responds with 206 (Partial Content).
+///
+#define HTTP_HEADER_RANGE              "Range"
+
 
 ///
 /// Accept-Encoding Request Header
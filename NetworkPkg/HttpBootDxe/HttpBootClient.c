@@ -580,21 +580,24 @@ HttpBootHttpIoCallback (
 }
 
 /**
-  Create a HttpIo instance for the file download.
+  Initialize a HttpIo instance with the station configuration of the driver.
 
   @param[in]    Private        The pointer to the driver's private data.
+  @param[in]    Callback       Callback function of the HttpIo, could be NULL.
+  @param[out]   HttpIo         The HttpIo instance to initialize.
 
   @retval EFI_SUCCESS          Successfully created.
   @retval Others               Failed to create HttpIo.
 
 **/
 EFI_STATUS
-HttpBootCreateHttpIo (
-  IN     HTTP_BOOT_PRIVATE_DATA       *Private
+HttpBootInitHttpIo (
+  IN     HTTP_BOOT_PRIVATE_DATA       *Private,
+  IN     HTTP_IO_CALLBACK             Callback,   OPTIONAL
+     OUT HTTP_IO                      *HttpIo
   )
 {
   HTTP_IO_CONFIG_DATA          ConfigData;
-  EFI_STATUS                   Status;
   EFI_HANDLE                   ImageHandle;
 
   ASSERT (Private != NULL);
@@ -613,15 +616,34 @@ HttpBootCreateHttpIo (
     ImageHandle = Private->Ip6Nic->ImageHandle;
   }
 
-  Status = HttpIoCreateIo (
-             ImageHandle,
-             Private->Controller,
-             Private->UsingIpv6 ? IP_VERSION_6 : IP_VERSION_4,
-             &ConfigData,
-             HttpBootHttpIoCallback,
-             (VOID *) Private,
-             &Private->HttpIo
-             );
+  return HttpIoCreateIo (
+           ImageHandle,
+           Private->Controller,
+           Private->UsingIpv6 ? IP_VERSION_6 : IP_VERSION_4,
+           &ConfigData,
+           Callback,
+           (VOID *) Private,
+           HttpIo
+           );
+}
+
+/**
+  Create a HttpIo instance for the file download.
+
+  @param[in]    Private        The pointer to the driver's private data.
+
+  @retval EFI_SUCCESS          Successfully created.
+  @retval Others               Failed to create HttpIo.
+
+**/
+EFI_STATUS
+HttpBootCreateHttpIo (
+  IN     HTTP_BOOT_PRIVATE_DATA       *Private
+  )
+{
+  EFI_STATUS                   Status;
+
+  Status = HttpBootInitHttpIo (Private, HttpBootHttpIoCallback, &Private->HttpIo);
   if (EFI_ERROR (Status)) {
     return Status;
   }
@@ -849,6 +871,7 @@ HttpBootGetBootFileCallback (
       MIN (Length, CallbackData->BufferSize - CallbackData->CopyedSize)
       );
     CallbackData->CopyedSize += MIN (Length, CallbackData->BufferSize - CallbackData->CopyedSize);
+    HttpBootImageDigestUpdate (CallbackData->Private, CallbackData->CopyedSize);
   }
 
   //
@@ -870,6 +893,262 @@ HttpBootGetBootFileCallback (
   return EFI_SUCCESS;
 }
 
+/**
+  Download the boot file in several byte ranges, each over its own HTTP connection.
+
+  All the requests are sent first, then the ranges are received round-robin directly
+  into Buffer. While one connection is being read, the others keep receiving data
+  into their TCP windows, so the transfers overlap on the wire.
+
+  The connections don't report to the HttpIo callback, the file size reported by
+  the HEAD response is still used for the download progress. The message-body is
+  reported to the HTTP Boot callback in file order, as soon as it is contiguous,
+  so the callback sees the same data as from a single connection. The Authenticode
+  digest of the file is calculated from the same data.
+
+  @param[in]       Private         The pointer to the driver's private data.
+  @param[in]       Url             The URL of the boot file.
+  @param[in]       FileSize        The size of the boot file.
+  @param[out]      Buffer          The memory buffer to transfer the file to, which
+                                   must be at least FileSize bytes.
+  @param[out]      ReportedSize    The number of bytes of the message-body reported
+                                   to the HTTP Boot callback, also on error.
+
+  @retval EFI_SUCCESS              The file was loaded.
+  @retval EFI_UNSUPPORTED          The ranged download isn't enabled, or the server
+                                   doesn't support the range requests.
+  @retval EFI_OUT_OF_RESOURCES     Could not allocate needed resources.
+  @retval Others                   Unexpected error happened.
+
+**/
+EFI_STATUS
+HttpBootGetBootFileByRange (
+  IN     HTTP_BOOT_PRIVATE_DATA   *Private,
+  IN     CHAR16                   *Url,
+  IN     UINTN                    FileSize,
+     OUT UINT8                    *Buffer,
+     OUT UINTN                    *ReportedSize
+  )
+{
+  EFI_STATUS                 Status;
+  HTTP_BOOT_RANGE_PART       *Parts;
+  UINTN                      ConnectionCount;
+  UINTN                      PartCount;
+  UINTN                      PartSize;
+  UINTN                      Index;
+  HTTP_IO_HEADER             *HttpIoHeader;
+  CHAR8                      *HostName;
+  CHAR8                      RangeStr[HTTP_BOOT_RANGE_STR_LEN];
+  EFI_HTTP_REQUEST_DATA      RequestData;
+  HTTP_IO_RESPONSE_DATA      ResponseData;
+  UINTN                      ContentLength;
+  BOOLEAN                    Done;
+  UINTN                      ReceivedPart;
+  UINTN                      ReceivedSize;
+  UINT32                     ReportLength;
+
+  *ReportedSize   = 0;
+  ConnectionCount = PcdGet8 (PcdHttpBootRangeConnections);
+  if (ConnectionCount < 2 || FileSize < HTTP_BOOT_RANGE_MIN_SIZE) {
+    return EFI_UNSUPPORTED;
+  }
+
+  Parts = AllocateZeroPool (ConnectionCount * sizeof (HTTP_BOOT_RANGE_PART));
+  if (Parts == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  //
+  // 1. Build the HTTP header for the requests: Host, Accept, User-Agent and Range.
+  //
+  HttpIoHeader = HttpIoCreateHeader (4);
+  if (HttpIoHeader == NULL) {
+    Status = EFI_OUT_OF_RESOURCES;
+    goto ON_EXIT;
+  }
+
+  HostName = NULL;
+  Status = HttpUrlGetHostName (
+             Private->BootFileUri,
+             Private->BootFileUriParser,
+             &HostName
+             );
+  if (EFI_ERROR (Status)) {
+    goto ON_EXIT;
+  }
+  Status = HttpIoSetHeader (HttpIoHeader, HTTP_HEADER_HOST, HostName);
+  FreePool (HostName);
+  if (EFI_ERROR (Status)) {
+    goto ON_EXIT;
+  }
+
+  Status = HttpIoSetHeader (HttpIoHeader, HTTP_HEADER_ACCEPT, "*/*");
+  if (EFI_ERROR (Status)) {
+    goto ON_EXIT;
+  }
+
+  Status = HttpIoSetHeader (HttpIoHeader, HTTP_HEADER_USER_AGENT, HTTP_USER_AGENT_EFI_HTTP_BOOT);
+  if (EFI_ERROR (Status)) {
+    goto ON_EXIT;
+  }
+
+  //
+  // 2. Create one HTTP child for each range. Use as many as could be created, and
+  //    split the file evenly between them.
+  //
+  for (Index = 0; Index < ConnectionCount; Index++) {
+    Status = HttpBootInitHttpIo (Private, NULL, &Parts[Index].HttpIo);
+    if (EFI_ERROR (Status)) {
+      break;
+    }
+    Parts[Index].Created = TRUE;
+  }
+
+  PartCount = Index;
+  if (PartCount < 2) {
+    Status = EFI_UNSUPPORTED;
+    goto ON_EXIT;
+  }
+
+  PartSize = FileSize / PartCount;
+  for (Index = 0; Index < PartCount; Index++) {
+    Parts[Index].Offset = Index * PartSize;
+    Parts[Index].End    = (Index == PartCount - 1) ? FileSize : (Index + 1) * PartSize;
+  }
+
+  //
+  // 3. Send out the range requests.
+  //
+  RequestData.Method = HttpMethodGet;
+  RequestData.Url    = Url;
+  for (Index = 0; Index < PartCount; Index++) {
+    AsciiSPrint (
+      RangeStr,
+      sizeof (RangeStr),
+      "%a=%Lu-%Lu",
+      HTTP_BOOT_RANGE_UNIT,
+      (UINT64) Parts[Index].Offset,
+      (UINT64) (Parts[Index].End - 1)
+      );
+    Status = HttpIoSetHeader (HttpIoHeader, HTTP_HEADER_RANGE, RangeStr);
+    if (EFI_ERROR (Status)) {
+      goto ON_EXIT;
+    }
+
+    Status = HttpIoSendRequest (
+               &Parts[Index].HttpIo,
+               &RequestData,
+               HttpIoHeader->HeaderCount,
+               HttpIoHeader->Headers,
+               0,
+               NULL
+               );
+    if (EFI_ERROR (Status)) {
+      goto ON_EXIT;
+    }
+  }
+
+  //
+  // 4. Receive the response headers. Each response must be "206 Partial Content"
+  //    with exactly the length of the requested range, otherwise fall back to a
+  //    single connection.
+  //
+  for (Index = 0; Index < PartCount; Index++) {
+    ZeroMem (&ResponseData, sizeof (HTTP_IO_RESPONSE_DATA));
+    Status = HttpIoRecvResponse (&Parts[Index].HttpIo, TRUE, &ResponseData);
+    if (!EFI_ERROR (Status)) {
+      if (EFI_ERROR (ResponseData.Status)) {
+        Status = ResponseData.Status;
+      } else if (ResponseData.Response.StatusCode != HTTP_STATUS_206_PARTIAL_CONTENT) {
+        Status = EFI_UNSUPPORTED;
+      } else {
+        Status = HttpIoGetContentLength (ResponseData.HeaderCount, ResponseData.Headers, &ContentLength);
+        if (EFI_ERROR (Status) || ContentLength != Parts[Index].End - Parts[Index].Offset) {
+          Status = EFI_UNSUPPORTED;
+        }
+      }
+    }
+
+    if (ResponseData.Headers != NULL) {
+      HttpFreeHeaderFields (ResponseData.Headers, ResponseData.HeaderCount);
+    }
+
+    if (EFI_ERROR (Status)) {
+      goto ON_EXIT;
+    }
+  }
+
+  //
+  // 5. Receive the message-body of all ranges directly into the caller's buffer.
+  //
+  ReceivedPart = 0;
+  do {
+    Done = TRUE;
+    for (Index = 0; Index < PartCount; Index++) {
+      if (Parts[Index].Offset >= Parts[Index].End) {
+        continue;
+      }
+
+      Done = FALSE;
+      ZeroMem (&ResponseData, sizeof (HTTP_IO_RESPONSE_DATA));
+      ResponseData.Body       = (CHAR8 *) Buffer + Parts[Index].Offset;
+      ResponseData.BodyLength = Parts[Index].End - Parts[Index].Offset;
+      Status = HttpIoRecvResponse (&Parts[Index].HttpIo, FALSE, &ResponseData);
+      if (EFI_ERROR (Status) || EFI_ERROR (ResponseData.Status)) {
+        if (EFI_ERROR (ResponseData.Status)) {
+          Status = ResponseData.Status;
+        }
+        goto ON_EXIT;
+      }
+
+      Parts[Index].Offset += ResponseData.BodyLength;
+
+      //
+      // Find the first byte not received yet, all the data before it is in Buffer.
+      //
+      while ((ReceivedPart < PartCount) && (Parts[ReceivedPart].Offset >= Parts[ReceivedPart].End)) {
+        ReceivedPart++;
+      }
+      ReceivedSize = (ReceivedPart < PartCount) ? Parts[ReceivedPart].Offset : FileSize;
+      HttpBootImageDigestUpdate (Private, ReceivedSize);
+
+      //
+      // Report the data from the first byte not reported yet up to the first
+      // byte not received yet.
+      //
+      while ((Private->HttpBootCallback != NULL) && (*ReportedSize < ReceivedSize)) {
+        ReportLength = (UINT32) MIN (ReceivedSize - *ReportedSize, MAX_UINT32);
+        Status = Private->HttpBootCallback->Callback (
+                   Private->HttpBootCallback,
+                   HttpBootHttpEntityBody,
+                   TRUE,
+                   ReportLength,
+                   Buffer + *ReportedSize
+                   );
+        if (EFI_ERROR (Status)) {
+          goto ON_EXIT;
+        }
+        *ReportedSize += ReportLength;
+      }
+    }
+  } while (!Done);
+
+  Status = EFI_SUCCESS;
+
+ON_EXIT:
+  for (Index = 0; Index < ConnectionCount; Index++) {
+    if (Parts[Index].Created) {
+      HttpIoDestroyIo (&Parts[Index].HttpIo);
+    }
+  }
+  if (HttpIoHeader != NULL) {
+    HttpIoFreeHeader (HttpIoHeader);
+  }
+  FreePool (Parts);
+
+  return Status;
+}
+
 /**
   This function download the boot file by using UEFI HTTP protocol.
 
@@ -920,6 +1199,8 @@ HttpBootGetBootFile (
   CHAR16                     *Url;
   BOOLEAN                    IdentityMode;
   UINTN                      ReceivedSize;
+  UINTN                      ReportedSize;
+  EFI_HTTP_HEADER            *Header;
 
   ASSERT (Private != NULL);
   ASSERT (Private->HttpCreated);
@@ -944,9 +1225,41 @@ HttpBootGetBootFile (
   if (!HeaderOnly && Buffer != NULL) {
     Status = HttpBootGetFileFromCache (Private, Url, BufferSize, Buffer, ImageType);
     if (Status != EFI_NOT_FOUND) {
+      if (!EFI_ERROR (Status)) {
+        HttpBootImageDigestUpdate (Private, *BufferSize);
+      }
       FreePool (Url);
       return Status;
     }
+
+    //
+    // Download the file over several connections if the server accepts range
+    // requests and the caller provides a buffer for the whole file.
+    //
+    if (Private->BootFileRangeSupported && (Private->BootFileSize != 0) &&
+        (*BufferSize >= Private->BootFileSize)) {
+      Status = HttpBootGetBootFileByRange (Private, Url, Private->BootFileSize, Buffer, &ReportedSize);
+      if (!EFI_ERROR (Status) || (Status == EFI_ABORTED) || (ReportedSize != 0)) {
+        //
+        // Once the callback has seen part of the message-body, a download over
+        // one connection would report it again, so return the error instead.
+        //
+        if (!EFI_ERROR (Status)) {
+          *BufferSize = Private->BootFileSize;
+          *ImageType  = Private->ImageType;
+        }
+        FreePool (Url);
+        return Status;
+      }
+
+      DEBUG ((EFI_D_INFO, "HttpBootGetBootFile: Ranged download %r, fall back to one connection.\n", Status));
+
+      //
+      // The data hashed so far is written again by the download over one
+      // connection, and might not be the same, so don't produce a digest.
+      //
+      HttpBootImageDigestStop (&Private->ImageDigest);
+    }
   }
 
   //
@@ -1103,6 +1416,15 @@ HttpBootGetBootFile (
     goto ERROR_5;
   }
 
+  //
+  // Remember whether the server accepts range requests for the file.
+  //
+  if (HeaderOnly) {
+    Header = HttpFindHeader (ResponseData->HeaderCount, ResponseData->Headers, HTTP_HEADER_ACCEPT_RANGES);
+    Private->BootFileRangeSupported = (BOOLEAN) ((Header != NULL) &&
+                                                 (AsciiStriCmp (Header->FieldValue, HTTP_BOOT_RANGE_UNIT) == 0));
+  }
+
   //
   // 3.2 Cache the response header.
   //
@@ -1177,6 +1499,7 @@ HttpBootGetBootFile (
           goto ERROR_6;
         }
         ReceivedSize += ResponseBody.BodyLength;
+        HttpBootImageDigestUpdate (Private, ReceivedSize);
         if (Private->HttpBootCallback != NULL) {
           Status = Private->HttpBootCallback->Callback (
                      Private->HttpBootCallback,
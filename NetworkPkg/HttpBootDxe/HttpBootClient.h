@@ -13,6 +13,9 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #define HTTP_BOOT_REQUEST_TIMEOUT            5000      // 5 seconds in uints of millisecond.
 #define HTTP_BOOT_RESPONSE_TIMEOUT           5000      // 5 seconds in uints of millisecond.
 #define HTTP_BOOT_BLOCK_SIZE                 1500
+#define HTTP_BOOT_RANGE_MIN_SIZE             SIZE_4MB  // Smaller files are downloaded over one connection.
+#define HTTP_BOOT_RANGE_UNIT                 "bytes"
+#define HTTP_BOOT_RANGE_STR_LEN              48
 
 
 
@@ -40,6 +43,16 @@ typedef struct {
   LIST_ENTRY                 EntityDataList;  // Entity data (message-body)
 } HTTP_BOOT_CACHE_CONTENT;
 
+//
+// One byte range of the boot file, downloaded over its own HTTP connection.
+//
+typedef struct {
+  HTTP_IO                    HttpIo;
+  BOOLEAN                    Created;
+  UINTN                      Offset;          // Next byte of the range to receive.
+  UINTN                      End;             // One past the last byte of the range.
+} HTTP_BOOT_RANGE_PART;
+
 //
 // Callback data for HTTP_BODY_PARSER_CALLBACK()
 //
@@ -173,6 +173,8 @@ HttpBootDestroyIp4Children (
            Private->Ip4Nic->Controller,
            &gEfiLoadFileProtocolGuid,
            &Private->Ip4Nic->LoadFile,
+           &gEdkiiLoadFileDigestProtocolGuid,
+           &Private->Ip4Nic->LoadFileDigest,
            &gEfiDevicePathProtocolGuid,
            Private->Ip4Nic->DevicePath,
            NULL
@@ -249,6 +251,8 @@ HttpBootDestroyIp6Children (
            Private->Ip6Nic->Controller,
            &gEfiLoadFileProtocolGuid,
            &Private->Ip6Nic->LoadFile,
+           &gEdkiiLoadFileDigestProtocolGuid,
+           &Private->Ip6Nic->LoadFileDigest,
            &gEfiDevicePathProtocolGuid,
            Private->Ip6Nic->DevicePath,
            NULL
@@ -578,10 +582,13 @@ HttpBootIp4DxeDriverBindingStart (
   // Create a child handle for the HTTP boot and install DevPath and Load file protocol on it.
   //
   CopyMem (&Private->Ip4Nic->LoadFile, &gHttpBootDxeLoadFile, sizeof (EFI_LOAD_FILE_PROTOCOL));
+  CopyMem (&Private->Ip4Nic->LoadFileDigest, &gHttpBootDxeLoadFileDigest, sizeof (EDKII_LOAD_FILE_DIGEST_PROTOCOL));
   Status = gBS->InstallMultipleProtocolInterfaces (
                   &Private->Ip4Nic->Controller,
                   &gEfiLoadFileProtocolGuid,
                   &Private->Ip4Nic->LoadFile,
+                  &gEdkiiLoadFileDigestProtocolGuid,
+                  &Private->Ip4Nic->LoadFileDigest,
                   &gEfiDevicePathProtocolGuid,
                   Private->Ip4Nic->DevicePath,
                   NULL
@@ -1109,10 +1116,13 @@ HttpBootIp6DxeDriverBindingStart (
   // Create a child handle for the HTTP boot and install DevPath and Load file protocol on it.
   //
   CopyMem (&Private->Ip6Nic->LoadFile, &gHttpBootDxeLoadFile, sizeof (Private->LoadFile));
+  CopyMem (&Private->Ip6Nic->LoadFileDigest, &gHttpBootDxeLoadFileDigest, sizeof (EDKII_LOAD_FILE_DIGEST_PROTOCOL));
   Status = gBS->InstallMultipleProtocolInterfaces (
                   &Private->Ip6Nic->Controller,
                   &gEfiLoadFileProtocolGuid,
                   &Private->Ip6Nic->LoadFile,
+                  &gEdkiiLoadFileDigestProtocolGuid,
+                  &Private->Ip6Nic->LoadFileDigest,
                   &gEfiDevicePathProtocolGuid,
                   Private->Ip6Nic->DevicePath,
                   NULL
@@ -32,6 +32,7 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <Library/HiiLib.h>
 #include <Library/PrintLib.h>
 #include <Library/DpcLib.h>
+#include <Library/BaseCryptLib.h>
 
 //
 // UEFI Driver Model Protocols
@@ -54,12 +55,14 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <Protocol/Ip6Config.h>
 #include <Protocol/RamDisk.h>
 #include <Protocol/AdapterInformation.h>
+#include <Protocol/Hash.h>
 
 //
 // Produced Protocols
 //
 #include <Protocol/LoadFile.h>
 #include <Protocol/HttpBootCallback.h>
+#include <Protocol/LoadFileDigest.h>
 
 //
 // Consumed Guids
@@ -109,6 +112,7 @@ typedef enum  {
 #include "HttpBootSupport.h"
 #include "HttpBootClient.h"
 #include "HttpBootConfig.h"
+#include "HttpBootImageDigest.h"
 
 typedef union {
   HTTP_BOOT_DHCP4_PACKET_CACHE              Dhcp4;
@@ -120,6 +124,7 @@ struct _HTTP_BOOT_VIRTUAL_NIC {
   EFI_HANDLE                                Controller;
   EFI_HANDLE                                ImageHandle;
   EFI_LOAD_FILE_PROTOCOL                    LoadFile;
+  EDKII_LOAD_FILE_DIGEST_PROTOCOL           LoadFileDigest;
   EFI_DEVICE_PATH_PROTOCOL                  *DevicePath;
   HTTP_BOOT_PRIVATE_DATA                    *Private;
 };
@@ -209,9 +214,16 @@ struct _HTTP_BOOT_PRIVATE_DATA {
   CHAR8                                     *BootFileUri;
   VOID                                      *BootFileUriParser;
   UINTN                                     BootFileSize;
+  BOOLEAN                                   BootFileRangeSupported;
   BOOLEAN                                   NoGateway;
   HTTP_BOOT_IMAGE_TYPE                      ImageType;
 
+  //
+  // Authenticode digest of the boot file, kept after the HTTP Boot service
+  // has been stopped until the image verification asks for it.
+  //
+  HTTP_BOOT_IMAGE_DIGEST                    ImageDigest;
+
   //
   // URI string extracted from the input FilePath parameter.
   //
@@ -265,7 +277,10 @@ struct _HTTP_BOOT_PRIVATE_DATA {
 #define HTTP_BOOT_PRIVATE_DATA_FROM_LOADFILE(a)   CR (a, HTTP_BOOT_PRIVATE_DATA, LoadFile, HTTP_BOOT_PRIVATE_DATA_SIGNATURE)
 #define HTTP_BOOT_PRIVATE_DATA_FROM_ID(a)         CR (a, HTTP_BOOT_PRIVATE_DATA, Id, HTTP_BOOT_PRIVATE_DATA_SIGNATURE)
 #define HTTP_BOOT_VIRTUAL_NIC_FROM_LOADFILE(a)    CR (a, HTTP_BOOT_VIRTUAL_NIC, LoadFile, HTTP_BOOT_VIRTUAL_NIC_SIGNATURE)
+#define HTTP_BOOT_VIRTUAL_NIC_FROM_LOADFILE_DIGEST(a) \
+  CR (a, HTTP_BOOT_VIRTUAL_NIC, LoadFileDigest, HTTP_BOOT_VIRTUAL_NIC_SIGNATURE)
 extern EFI_LOAD_FILE_PROTOCOL               gHttpBootDxeLoadFile;
+extern EDKII_LOAD_FILE_DIGEST_PROTOCOL      gHttpBootDxeLoadFileDigest;
 
 /**
   Tests to see if this driver supports a given controller. If a child device is provided,
@@ -0,0 +1,479 @@
+/** @file
+  Calculate the Authenticode digest of the boot file while it is downloaded,
+  and produce it with the EDKII_LOAD_FILE_DIGEST_PROTOCOL.
+
+  Caution: This file requires additional review when modified.
+  The boot file is external input, and its PE/COFF header is parsed before the
+  image verification has checked it. HttpBootImageDigestParse() must make sure
+  that all the data it reads and all the ranges it builds are within the file.
+
+  The ranges hashed are the ones hashed by HashPeImage() of
+  DxeImageVerificationLib, so the digest is the same. If the file has anything
+  that the streaming calculation can't follow, e.g. sections which aren't in
+  file order, no digest is produced, and the image verification hashes the
+  image itself.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "HttpBootDxe.h"
+
+/**
+  Free the resources used to calculate the digest, and stop calculating it.
+
+  @param[in, out]  ImageDigest     The digest of the boot file.
+
+**/
+VOID
+HttpBootImageDigestStop (
+  IN OUT HTTP_BOOT_IMAGE_DIGEST   *ImageDigest
+  )
+{
+  if (ImageDigest->HashContext != NULL) {
+    FreePool (ImageDigest->HashContext);
+    ImageDigest->HashContext = NULL;
+  }
+  if (ImageDigest->Ranges != NULL) {
+    FreePool (ImageDigest->Ranges);
+    ImageDigest->Ranges = NULL;
+  }
+  ImageDigest->Started      = FALSE;
+  ImageDigest->HeaderParsed = FALSE;
+  ImageDigest->RangeCount   = 0;
+  ImageDigest->RangeIndex   = 0;
+  ImageDigest->HashedSize   = 0;
+}
+
+/**
+  Add a range of the file to the ranges to hash. Empty ranges are not added.
+
+  @param[in, out]  ImageDigest     The digest of the boot file.
+  @param[in]       Start           Offset of the first byte of the range.
+  @param[in]       End             Offset of the byte after the range.
+
+  @retval TRUE     The range was added.
+  @retval FALSE    The range isn't within the file.
+
+**/
+BOOLEAN
+HttpBootImageDigestAddRange (
+  IN OUT HTTP_BOOT_IMAGE_DIGEST   *ImageDigest,
+  IN     UINTN                    Start,
+  IN     UINTN                    End
+  )
+{
+  if ((End < Start) || (End > ImageDigest->FileSize)) {
+    return FALSE;
+  }
+
+  if (End > Start) {
+    ImageDigest->Ranges[ImageDigest->RangeCount].Start = Start;
+    ImageDigest->Ranges[ImageDigest->RangeCount].End   = End;
+    ImageDigest->RangeCount++;
+  }
+  return TRUE;
+}
+
+/**
+  Build the ranges of the file to hash from the PE/COFF header, as described in
+  "Calculating the PE Image Hash" of the Authenticode specification.
+
+  Caution: This function may receive untrusted input.
+
+  @param[in, out]  ImageDigest     The digest of the boot file.
+  @param[in]       Size            Number of bytes at the start of the buffer which
+                                   hold their final data.
+
+  @retval EFI_SUCCESS              The ranges were built.
+  @retval EFI_NOT_READY            The header hasn't been downloaded yet.
+  @retval EFI_UNSUPPORTED          The file isn't a PE/COFF image, or its ranges
+                                   can't be hashed in file order.
+  @retval EFI_OUT_OF_RESOURCES     Could not allocate needed resources.
+
+**/
+EFI_STATUS
+HttpBootImageDigestParse (
+  IN OUT HTTP_BOOT_IMAGE_DIGEST   *ImageDigest,
+  IN     UINTN                    Size
+  )
+{
+  EFI_IMAGE_DOS_HEADER                 *DosHdr;
+  EFI_IMAGE_OPTIONAL_HEADER_PTR_UNION  Hdr;
+  EFI_IMAGE_SECTION_HEADER             *Section;
+  EFI_IMAGE_DATA_DIRECTORY             *SecDataDir;
+  UINTN                                PeCoffHeaderOffset;
+  UINTN                                HeaderEnd;
+  UINTN                                CheckSumEnd;
+  UINTN                                SecDataDirOffset;
+  UINTN                                SizeOfHeaders;
+  UINT32                               NumberOfRvaAndSizes;
+  UINTN                                NumberOfSections;
+  UINTN                                SumOfBytesHashed;
+  UINTN                                CertSize;
+  UINTN                                FirstSection;
+  UINTN                                Start;
+  UINTN                                End;
+  UINTN                                Index;
+  UINTN                                Pos;
+
+  //
+  // 1. Wait until the PE/COFF header and the section table are in the buffer.
+  //
+  if (Size < sizeof (EFI_IMAGE_DOS_HEADER)) {
+    return EFI_NOT_READY;
+  }
+
+  DosHdr = (EFI_IMAGE_DOS_HEADER *) ImageDigest->Buffer;
+  if (DosHdr->e_magic == EFI_IMAGE_DOS_SIGNATURE) {
+    PeCoffHeaderOffset = DosHdr->e_lfanew;
+  } else {
+    PeCoffHeaderOffset = 0;
+  }
+
+  if ((ImageDigest->FileSize < sizeof (EFI_IMAGE_NT_HEADERS64)) ||
+      (PeCoffHeaderOffset > ImageDigest->FileSize - sizeof (EFI_IMAGE_NT_HEADERS64))) {
+    return EFI_UNSUPPORTED;
+  }
+  if (Size < PeCoffHeaderOffset + sizeof (EFI_IMAGE_NT_HEADERS64)) {
+    return EFI_NOT_READY;
+  }
+
+  Hdr.Pe32 = (EFI_IMAGE_NT_HEADERS32 *) (ImageDigest->Buffer + PeCoffHeaderOffset);
+  if (Hdr.Pe32->Signature != EFI_IMAGE_NT_SIGNATURE) {
+    return EFI_UNSUPPORTED;
+  }
+
+  NumberOfSections = Hdr.Pe32->FileHeader.NumberOfSections;
+  HeaderEnd        = sizeof (UINT32) + sizeof (EFI_IMAGE_FILE_HEADER) +
+                     Hdr.Pe32->FileHeader.SizeOfOptionalHeader +
+                     NumberOfSections * sizeof (EFI_IMAGE_SECTION_HEADER);
+  if (HeaderEnd > ImageDigest->FileSize - PeCoffHeaderOffset) {
+    return EFI_UNSUPPORTED;
+  }
+  HeaderEnd += PeCoffHeaderOffset;
+  if (Size < HeaderEnd) {
+    return EFI_NOT_READY;
+  }
+
+  //
+  // The fields read here are all within EFI_IMAGE_NT_HEADERS64.
+  //
+  if (Hdr.Pe32->OptionalHeader.Magic == EFI_IMAGE_NT_OPTIONAL_HDR32_MAGIC) {
+    CheckSumEnd         = (UINTN) (&Hdr.Pe32->OptionalHeader.CheckSum + 1) - (UINTN) ImageDigest->Buffer;
+    SizeOfHeaders       = Hdr.Pe32->OptionalHeader.SizeOfHeaders;
+    NumberOfRvaAndSizes = Hdr.Pe32->OptionalHeader.NumberOfRvaAndSizes;
+    SecDataDir          = &Hdr.Pe32->OptionalHeader.DataDirectory[EFI_IMAGE_DIRECTORY_ENTRY_SECURITY];
+  } else if (Hdr.Pe32->OptionalHeader.Magic == EFI_IMAGE_NT_OPTIONAL_HDR64_MAGIC) {
+    CheckSumEnd         = (UINTN) (&Hdr.Pe32Plus->OptionalHeader.CheckSum + 1) - (UINTN) ImageDigest->Buffer;
+    SizeOfHeaders       = Hdr.Pe32Plus->OptionalHeader.SizeOfHeaders;
+    NumberOfRvaAndSizes = Hdr.Pe32Plus->OptionalHeader.NumberOfRvaAndSizes;
+    SecDataDir          = &Hdr.Pe32Plus->OptionalHeader.DataDirectory[EFI_IMAGE_DIRECTORY_ENTRY_SECURITY];
+  } else {
+    return EFI_UNSUPPORTED;
+  }
+  SecDataDirOffset = (UINTN) SecDataDir - (UINTN) ImageDigest->Buffer;
+
+  //
+  // There are at most 3 ranges in the header, one for each section, and one
+  // for the data after the sections.
+  //
+  ImageDigest->Ranges = AllocatePool ((NumberOfSections + 4) * sizeof (HTTP_BOOT_DIGEST_RANGE));
+  if (ImageDigest->Ranges == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+  ImageDigest->RangeCount = 0;
+
+  //
+  // 2. The header, without the CheckSum field and the Cert Directory.
+  //
+  if (!HttpBootImageDigestAddRange (ImageDigest, 0, CheckSumEnd - sizeof (UINT32))) {
+    return EFI_UNSUPPORTED;
+  }
+  if (NumberOfRvaAndSizes <= EFI_IMAGE_DIRECTORY_ENTRY_SECURITY) {
+    if (!HttpBootImageDigestAddRange (ImageDigest, CheckSumEnd, SizeOfHeaders)) {
+      return EFI_UNSUPPORTED;
+    }
+    CertSize = 0;
+  } else {
+    if (!HttpBootImageDigestAddRange (ImageDigest, CheckSumEnd, SecDataDirOffset) ||
+        !HttpBootImageDigestAddRange (ImageDigest, SecDataDirOffset + sizeof (EFI_IMAGE_DATA_DIRECTORY), SizeOfHeaders)) {
+      return EFI_UNSUPPORTED;
+    }
+    CertSize = SecDataDir->Size;
+  }
+
+  //
+  // 3. The sections with data, sorted by PointerToRawData, like HashPeImage()
+  //    does. The sort keeps the order of the sections at the same offset.
+  //
+  SumOfBytesHashed = SizeOfHeaders;
+  FirstSection     = ImageDigest->RangeCount;
+  Section          = (EFI_IMAGE_SECTION_HEADER *) (
+                       (UINT8 *) &Hdr.Pe32->OptionalHeader +
+                       Hdr.Pe32->FileHeader.SizeOfOptionalHeader
+                       );
+  for (Index = 0; Index < NumberOfSections; Index++, Section++) {
+    if (Section->SizeOfRawData == 0) {
+      continue;
+    }
+
+    Start = Section->PointerToRawData;
+    if ((Start > ImageDigest->FileSize) ||
+        (Section->SizeOfRawData > ImageDigest->FileSize - Start)) {
+      return EFI_UNSUPPORTED;
+    }
+    End = Start + Section->SizeOfRawData;
+    if (Section->SizeOfRawData > MAX_UINTN - SumOfBytesHashed) {
+      return EFI_UNSUPPORTED;
+    }
+    SumOfBytesHashed += Section->SizeOfRawData;
+
+    Pos = ImageDigest->RangeCount;
+    while ((Pos > FirstSection) && (Start < ImageDigest->Ranges[Pos - 1].Start)) {
+      ImageDigest->Ranges[Pos] = ImageDigest->Ranges[Pos - 1];
+      Pos--;
+    }
+    ImageDigest->Ranges[Pos].Start = Start;
+    ImageDigest->Ranges[Pos].End   = End;
+    ImageDigest->RangeCount++;
+  }
+
+  //
+  // The data is hashed as it arrives, so each range must start after the end
+  // of the previous one.
+  //
+  for (Index = 1; Index < ImageDigest->RangeCount; Index++) {
+    if (ImageDigest->Ranges[Index].Start < ImageDigest->Ranges[Index - 1].End) {
+      return EFI_UNSUPPORTED;
+    }
+  }
+
+  //
+  // 4. The data after SUM_OF_BYTES_HASHED, without the certificate table at
+  //    the end of the file.
+  //
+  if (ImageDigest->FileSize > SumOfBytesHashed) {
+    if (CertSize > ImageDigest->FileSize - SumOfBytesHashed) {
+      return EFI_UNSUPPORTED;
+    }
+    if ((ImageDigest->RangeCount > 0) &&
+        (SumOfBytesHashed < ImageDigest->Ranges[ImageDigest->RangeCount - 1].End)) {
+      return EFI_UNSUPPORTED;
+    }
+    if (!HttpBootImageDigestAddRange (ImageDigest, SumOfBytesHashed, ImageDigest->FileSize - CertSize)) {
+      return EFI_UNSUPPORTED;
+    }
+  }
+
+  ImageDigest->HeaderParsed = TRUE;
+  return EFI_SUCCESS;
+}
+
+/**
+  Start to calculate the Authenticode digest of the boot file, which is loaded
+  into Buffer.
+
+  Any digest of a previous boot file is dropped. Nothing is calculated if
+  PcdLoadFileImageDigest is FALSE, or if the boot file isn't an EFI image.
+
+  @param[in]    Private         The pointer to the driver's private data.
+  @param[in]    Buffer          The buffer the boot file is loaded into.
+  @param[in]    FileSize        The size of the boot file.
+
+**/
+VOID
+HttpBootImageDigestStart (
+  IN HTTP_BOOT_PRIVATE_DATA     *Private,
+  IN UINT8                      *Buffer,
+  IN UINTN                      FileSize
+  )
+{
+  HTTP_BOOT_IMAGE_DIGEST        *ImageDigest;
+
+  ImageDigest = &Private->ImageDigest;
+  HttpBootImageDigestStop (ImageDigest);
+  ImageDigest->Valid = FALSE;
+
+  if (!FeaturePcdGet (PcdLoadFileImageDigest) ||
+      (Private->ImageType != ImageTypeEfi) || (Buffer == NULL) || (FileSize == 0)) {
+    return;
+  }
+
+  ImageDigest->HashContext = AllocatePool (Sha256GetContextSize ());
+  if (ImageDigest->HashContext == NULL) {
+    return;
+  }
+  if (!Sha256Init (ImageDigest->HashContext)) {
+    HttpBootImageDigestStop (ImageDigest);
+    return;
+  }
+
+  ImageDigest->Buffer    = Buffer;
+  ImageDigest->FileSize  = FileSize;
+  ImageDigest->UsingIpv6 = Private->UsingIpv6;
+  ImageDigest->Started   = TRUE;
+}
+
+/**
+  Hash the part of the boot file which has been written to the buffer.
+
+  @param[in]    Private         The pointer to the driver's private data.
+  @param[in]    Size            Number of bytes at the start of the buffer which
+                                hold their final data.
+
+**/
+VOID
+HttpBootImageDigestUpdate (
+  IN HTTP_BOOT_PRIVATE_DATA     *Private,
+  IN UINTN                      Size
+  )
+{
+  HTTP_BOOT_IMAGE_DIGEST        *ImageDigest;
+  HTTP_BOOT_DIGEST_RANGE        *Range;
+  EFI_STATUS                    Status;
+  UINTN                         Start;
+  UINTN                         End;
+
+  ImageDigest = &Private->ImageDigest;
+  if (!ImageDigest->Started) {
+    return;
+  }
+
+  Size = MIN (Size, ImageDigest->FileSize);
+  if (!ImageDigest->HeaderParsed) {
+    Status = HttpBootImageDigestParse (ImageDigest, Size);
+    if (Status == EFI_NOT_READY) {
+      return;
+    }
+    if (EFI_ERROR (Status)) {
+      DEBUG ((DEBUG_INFO, "HttpBootImageDigestUpdate: No digest for the boot file - %r\n", Status));
+      HttpBootImageDigestStop (ImageDigest);
+      return;
+    }
+  }
+
+  while (ImageDigest->RangeIndex < ImageDigest->RangeCount) {
+    Range = &ImageDigest->Ranges[ImageDigest->RangeIndex];
+    Start = MAX (Range->Start, ImageDigest->HashedSize);
+    End   = MIN (Range->End, Size);
+    if (Start >= End) {
+      break;
+    }
+
+    if (!Sha256Update (ImageDigest->HashContext, ImageDigest->Buffer + Start, End - Start)) {
+      HttpBootImageDigestStop (ImageDigest);
+      return;
+    }
+    ImageDigest->HashedSize = End;
+
+    if (End < Range->End) {
+      break;
+    }
+    ImageDigest->RangeIndex++;
+  }
+}
+
+/**
+  Complete the Authenticode digest of the boot file.
+
+  The digest is only kept if the boot file was loaded successfully and all of
+  it has been hashed.
+
+  @param[in]    Private         The pointer to the driver's private data.
+  @param[in]    Status          The status of the download.
+  @param[in]    FileSize        The size of the downloaded file.
+
+**/
+VOID
+HttpBootImageDigestFinish (
+  IN HTTP_BOOT_PRIVATE_DATA     *Private,
+  IN EFI_STATUS                 Status,
+  IN UINTN                      FileSize
+  )
+{
+  HTTP_BOOT_IMAGE_DIGEST        *ImageDigest;
+
+  ImageDigest = &Private->ImageDigest;
+  if (!ImageDigest->Started) {
+    return;
+  }
+
+  if (!EFI_ERROR (Status) && (FileSize == ImageDigest->FileSize)) {
+    HttpBootImageDigestUpdate (Private, FileSize);
+    if (ImageDigest->Started && ImageDigest->HeaderParsed &&
+        (ImageDigest->RangeIndex == ImageDigest->RangeCount)) {
+      ImageDigest->Valid = Sha256Final (ImageDigest->HashContext, ImageDigest->Digest);
+    }
+  }
+
+  HttpBootImageDigestStop (ImageDigest);
+}
+
+/**
+  Get the Authenticode digest of the PE/COFF image loaded into Buffer by the
+  last LoadFile() call on the same handle.
+
+  @param[in]  This           Pointer to the EDKII_LOAD_FILE_DIGEST_PROTOCOL instance.
+  @param[in]  Buffer         The buffer the image was loaded into.
+  @param[in]  BufferSize     The size of the image in bytes.
+  @param[in]  HashAlgorithm  The hash algorithm of the digest.
+  @param[out] Digest         The buffer to return the digest in.
+  @param[in]  DigestSize     The size of Digest in bytes.
+
+  @retval EFI_SUCCESS            The digest was returned in Digest.
+  @retval EFI_INVALID_PARAMETER  This, Buffer, HashAlgorithm or Digest is NULL.
+  @retval EFI_NOT_FOUND          No digest is available for Buffer and BufferSize.
+  @retval EFI_UNSUPPORTED        The digest was not calculated with HashAlgorithm.
+  @retval EFI_BAD_BUFFER_SIZE    DigestSize is not the digest size of HashAlgorithm.
+
+**/
+EFI_STATUS
+EFIAPI
+HttpBootGetImageDigest (
+  IN  EDKII_LOAD_FILE_DIGEST_PROTOCOL  *This,
+  IN  CONST VOID                       *Buffer,
+  IN  UINTN                            BufferSize,
+  IN  CONST EFI_GUID                   *HashAlgorithm,
+  OUT UINT8                            *Digest,
+  IN  UINTN                            DigestSize
+  )
+{
+  HTTP_BOOT_VIRTUAL_NIC         *VirtualNic;
+  HTTP_BOOT_IMAGE_DIGEST        *ImageDigest;
+
+  if ((This == NULL) || (Buffer == NULL) || (HashAlgorithm == NULL) || (Digest == NULL)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  VirtualNic  = HTTP_BOOT_VIRTUAL_NIC_FROM_LOADFILE_DIGEST (This);
+  ImageDigest = &VirtualNic->Private->ImageDigest;
+  if (!ImageDigest->Valid ||
+      (ImageDigest->UsingIpv6 != (BOOLEAN) (VirtualNic == VirtualNic->Private->Ip6Nic)) ||
+      (ImageDigest->Buffer != Buffer) || (ImageDigest->FileSize != BufferSize)) {
+    return EFI_NOT_FOUND;
+  }
+
+  if (!CompareGuid (HashAlgorithm, &gEfiHashAlgorithmSha256Guid)) {
+    return EFI_UNSUPPORTED;
+  }
+  if (DigestSize != SHA256_DIGEST_SIZE) {
+    return EFI_BAD_BUFFER_SIZE;
+  }
+
+  //
+  // The digest is only given out once, so that it can't be taken for another
+  // image loaded later at the same address.
+  //
+  CopyMem (Digest, ImageDigest->Digest, SHA256_DIGEST_SIZE);
+  ImageDigest->Valid = FALSE;
+  return EFI_SUCCESS;
+}
+
+///
+/// Load File Digest Protocol instance
+///
+GLOBAL_REMOVE_IF_UNREFERENCED
+EDKII_LOAD_FILE_DIGEST_PROTOCOL  gHttpBootDxeLoadFileDigest = {
+  HttpBootGetImageDigest
+};
@@ -0,0 +1,131 @@
+/** @file
+  Declaration of the Authenticode digest calculated while the boot file is
+  downloaded, and of the EDKII_LOAD_FILE_DIGEST_PROTOCOL produced with it.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef __EFI_HTTP_BOOT_IMAGE_DIGEST_H__
+#define __EFI_HTTP_BOOT_IMAGE_DIGEST_H__
+
+//
+// One range of the file that is part of the Authenticode digest.
+//
+typedef struct {
+  UINTN                      Start;
+  UINTN                      End;             // One past the last byte of the range.
+} HTTP_BOOT_DIGEST_RANGE;
+
+//
+// The Authenticode digest of the boot file. The data is hashed as soon as the
+// download has written it to the caller's buffer, so this requires that every
+// range of the file hashed comes after the previous one.
+//
+typedef struct {
+  BOOLEAN                    Started;         // A digest is being calculated.
+  BOOLEAN                    HeaderParsed;    // Ranges has been built from the image header.
+  BOOLEAN                    Valid;           // Digest holds the digest of Buffer.
+  BOOLEAN                    UsingIpv6;       // The file was loaded on the IPv6 virtual NIC.
+  UINT8                      *Buffer;
+  UINTN                      FileSize;
+  VOID                       *HashContext;
+  HTTP_BOOT_DIGEST_RANGE     *Ranges;
+  UINTN                      RangeCount;
+  UINTN                      RangeIndex;      // First range not completely hashed.
+  UINTN                      HashedSize;      // Offset of the first byte not hashed.
+  UINT8                      Digest[SHA256_DIGEST_SIZE];
+} HTTP_BOOT_IMAGE_DIGEST;
+
+/**
+  Free the resources used to calculate the digest, and stop calculating it.
+
+  @param[in, out]  ImageDigest     The digest of the boot file.
+
+**/
+VOID
+HttpBootImageDigestStop (
+  IN OUT HTTP_BOOT_IMAGE_DIGEST   *ImageDigest
+  );
+
+/**
+  Start to calculate the Authenticode digest of the boot file, which is loaded
+  into Buffer.
+
+  Any digest of a previous boot file is dropped. Nothing is calculated if
+  PcdLoadFileImageDigest is FALSE, or if the boot file isn't an EFI image.
+
+  @param[in]    Private         The pointer to the driver's private data.
+  @param[in]    Buffer          The buffer the boot file is loaded into.
+  @param[in]    FileSize        The size of the boot file.
+
+**/
+VOID
+HttpBootImageDigestStart (
+  IN HTTP_BOOT_PRIVATE_DATA     *Private,
+  IN UINT8                      *Buffer,
+  IN UINTN                      FileSize
+  );
+
+/**
+  Hash the part of the boot file which has been written to the buffer.
+
+  @param[in]    Private         The pointer to the driver's private data.
+  @param[in]    Size            Number of bytes at the start of the buffer which
+                                hold their final data.
+
+**/
+VOID
+HttpBootImageDigestUpdate (
+  IN HTTP_BOOT_PRIVATE_DATA     *Private,
+  IN UINTN                      Size
+  );
+
+/**
+  Complete the Authenticode digest of the boot file.
+
+  The digest is only kept if the boot file was loaded successfully and all of
+  it has been hashed.
+
+  @param[in]    Private         The pointer to the driver's private data.
+  @param[in]    Status          The status of the download.
+  @param[in]    FileSize        The size of the downloaded file.
+
+**/
+VOID
+HttpBootImageDigestFinish (
+  IN HTTP_BOOT_PRIVATE_DATA     *Private,
+  IN EFI_STATUS                 Status,
+  IN UINTN                      FileSize
+  );
+
+/**
+  Get the Authenticode digest of the PE/COFF image loaded into Buffer by the
+  last LoadFile() call on the same handle.
+
+  @param[in]  This           Pointer to the EDKII_LOAD_FILE_DIGEST_PROTOCOL instance.
+  @param[in]  Buffer         The buffer the image was loaded into.
+  @param[in]  BufferSize     The size of the image in bytes.
+  @param[in]  HashAlgorithm  The hash algorithm of the digest.
+  @param[out] Digest         The buffer to return the digest in.
+  @param[in]  DigestSize     The size of Digest in bytes.
+
+  @retval EFI_SUCCESS            The digest was returned in Digest.
+  @retval EFI_INVALID_PARAMETER  This, Buffer, HashAlgorithm or Digest is NULL.
+  @retval EFI_NOT_FOUND          No digest is available for Buffer and BufferSize.
+  @retval EFI_UNSUPPORTED        The digest was not calculated with HashAlgorithm.
+  @retval EFI_BAD_BUFFER_SIZE    DigestSize is not the digest size of HashAlgorithm.
+
+**/
+EFI_STATUS
+EFIAPI
+HttpBootGetImageDigest (
+  IN  EDKII_LOAD_FILE_DIGEST_PROTOCOL  *This,
+  IN  CONST VOID                       *Buffer,
+  IN  UINTN                            BufferSize,
+  IN  CONST EFI_GUID                   *HashAlgorithm,
+  OUT UINT8                            *Digest,
+  IN  UINTN                            DigestSize
+  );
+
+#endif
@@ -382,8 +382,10 @@ HttpBootLoadFile (
   }
 
   //
-  // Load the boot file into Buffer
+  // Load the boot file into Buffer, and calculate the Authenticode digest of
+  // an EFI image as its data arrives.
   //
+  HttpBootImageDigestStart (Private, Buffer, Private->BootFileSize);
   Status = HttpBootGetBootFile (
              Private,
              FALSE,
@@ -391,6 +393,7 @@ HttpBootLoadFile (
              Buffer,
              ImageType
              );
+  HttpBootImageDigestFinish (Private, Status, *BufferSize);
 
 ON_EXIT:
   HttpBootUninstallCallback (Private);
@@ -455,6 +458,7 @@ HttpBootStop (
   Private->BootFileUri = NULL;
   Private->BootFileUriParser = NULL;
   Private->BootFileSize = 0;
+  Private->BootFileRangeSupported = FALSE;
   Private->SelectIndex = 0;
   Private->SelectProxyType = HttpOfferTypeMax;
 
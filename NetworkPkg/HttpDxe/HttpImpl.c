@@ -1024,7 +1024,7 @@ HttpResponseWorker (
       HttpInstance->NextMsg     = NULL;
       HttpInstance->CacheOffset = 0;
       SizeofHeaders = HdrLen;
-      BufferSize = HttpInstance->CacheLen;
+      BufferSize = HdrLen;
 
       //
       // Check whether we cached the whole HTTP headers.
@@ -1386,23 +1386,23 @@ HttpResponseWorker (
       HttpMsg->BodyLength = HttpInstance->NextMsg - (CHAR8 *) HttpMsg->Body;
     }
 
-    HttpInstance->CacheLen = Fragment.Len - HttpMsg->BodyLength;
-    if (HttpInstance->CacheLen != 0) {
+    if (Fragment.Len > HttpMsg->BodyLength) {
+      //
+      // Keep the decrypted fragment as the cache buffer rather than copying the
+      // remaining data out of it. The data not returned yet starts at CacheOffset.
+      //
       if (HttpInstance->CacheBody != NULL) {
         FreePool (HttpInstance->CacheBody);
       }
 
-      HttpInstance->CacheBody = AllocateZeroPool (HttpInstance->CacheLen);
-      if (HttpInstance->CacheBody == NULL) {
-        Status = EFI_OUT_OF_RESOURCES;
-        goto Error2;
-      }
-
-      CopyMem (HttpInstance->CacheBody, Fragment.Bulk + HttpMsg->BodyLength, HttpInstance->CacheLen);
-      HttpInstance->CacheOffset = 0;
+      HttpInstance->CacheBody   = (CHAR8 *) Fragment.Bulk;
+      HttpInstance->CacheLen    = Fragment.Len;
+      HttpInstance->CacheOffset = HttpMsg->BodyLength;
       if (HttpInstance->NextMsg != NULL) {
-        HttpInstance->NextMsg = HttpInstance->CacheBody;
+        HttpInstance->NextMsg = HttpInstance->CacheBody + HttpMsg->BodyLength;
       }
+
+      Fragment.Bulk = NULL;
     }
 
     if (Fragment.Bulk != NULL) {
@@ -1103,6 +1103,9 @@ HttpConfigureTcp4 (
   Tcp4Option->KeepAliveTime          = HTTP_KEEP_ALIVE_TIME;
   Tcp4Option->KeepAliveInterval      = HTTP_KEEP_ALIVE_INTERVAL;
   Tcp4Option->EnableNagle            = TRUE;
+  Tcp4Option->EnableTimeStamp        = TRUE;
+  Tcp4Option->EnableWindowScaling    = TRUE;
+  Tcp4Option->EnableSelectiveAck     = TRUE;
   Tcp4CfgData->ControlOption         = Tcp4Option;
 
   Status = HttpInstance->Tcp4->Configure (HttpInstance->Tcp4, Tcp4CfgData);
@@ -1174,6 +1177,9 @@ HttpConfigureTcp6 (
   Tcp6Option->KeepAliveTime      = HTTP_KEEP_ALIVE_TIME;
   Tcp6Option->KeepAliveInterval  = HTTP_KEEP_ALIVE_INTERVAL;
   Tcp6Option->EnableNagle        = TRUE;
+  Tcp6Option->EnableTimeStamp    = TRUE;
+  Tcp6Option->EnableWindowScaling = TRUE;
+  Tcp6Option->EnableSelectiveAck = TRUE;
 
   Status = HttpInstance->Tcp6->Configure (HttpInstance->Tcp6, Tcp6CfgData);
   if (EFI_ERROR (Status)) {
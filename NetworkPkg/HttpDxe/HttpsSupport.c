@@ -1543,6 +1543,16 @@ TlsProcessMessage (
     BufferSize += FragmentTable[Index].FragmentLength;
   }
 
+  //
+  // TLS driver returns the processed data in a single fragment, which is allocated
+  // from pool and owned by the caller. Take it over directly instead of copying.
+  //
+  if (FragmentCount == 1) {
+    Fragment->Len  = BufferSize;
+    Fragment->Bulk = FragmentTable[0].FragmentBuffer;
+    goto ON_EXIT;
+  }
+
   //
   // Allocate buffer for processed data.
   //
@@ -1756,18 +1766,13 @@ HttpsReceive (
     ASSERT (((TLS_RECORD_HEADER *) (TempFragment.Bulk))->ContentType == TlsContentTypeApplicationData);
 
     BufferInSize = ((TLS_RECORD_HEADER *) (TempFragment.Bulk))->Length;
-    BufferIn = AllocateZeroPool (BufferInSize);
-    if (BufferIn == NULL) {
-      Status = EFI_OUT_OF_RESOURCES;
-      return Status;
-    }
-
-    CopyMem (BufferIn, TempFragment.Bulk + TLS_RECORD_HEADER_LENGTH, BufferInSize);
 
     //
-    // Free the buffer in TempFragment.
+    // Strip the record header in place, so the decrypted buffer is returned
+    // to the caller without another allocation and copy.
     //
-    FreePool (TempFragment.Bulk);
+    BufferIn = TempFragment.Bulk;
+    CopyMem (BufferIn, BufferIn + TLS_RECORD_HEADER_LENGTH, BufferInSize);
 
   } else if ((RecordHeader.ContentType == TlsContentTypeAlert) &&
     (RecordHeader.Version.Major == 0x03) &&
@@ -0,0 +1,67 @@
+/** @file
+
+  MNP Statistics Protocol, produced by the MNP driver on the handle of each
+  network device it manages. It reports the packets that MNP has received and
+  transmitted on the device.
+
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+
+#ifndef __MNP_STATISTICS_H__
+#define __MNP_STATISTICS_H__
+
+//
+// MNP Statistics Protocol GUID value
+//
+#define EDKII_MNP_STATISTICS_PROTOCOL_GUID \
+    { \
+      0x61e50c56, 0xafa5, 0x4cb4, { 0xa1, 0x67, 0x5e, 0xa8, 0x9c, 0x55, 0xe1, 0x8c } \
+    }
+
+//
+// Forward reference for pure ANSI compatibility
+//
+typedef struct _EDKII_MNP_STATISTICS_PROTOCOL  EDKII_MNP_STATISTICS_PROTOCOL;
+
+///
+/// Packet counters of a network device, since MNP started managing it.
+///
+typedef struct {
+  UINT64  RxPackets;      ///< Packets received from SNP.
+  UINT64  TxPackets;      ///< Packets transmitted through SNP.
+  UINT64  RxDropped;      ///< Received packets dropped for a size error, a full receive queue or a timeout.
+  UINT64  TxDropped;      ///< Packets that could not be transmitted.
+} EDKII_MNP_STATISTICS;
+
+/**
+  Get the packet counters of the network device.
+
+  @param  This        Protocol instance pointer.
+  @param  Statistics  Pointer to the buffer to receive the counters.
+
+  @retval EFI_SUCCESS            The counters are returned.
+  @retval EFI_INVALID_PARAMETER  Statistics is NULL.
+
+**/
+typedef
+EFI_STATUS
+(EFIAPI *EDKII_MNP_GET_STATISTICS)(
+  IN  EDKII_MNP_STATISTICS_PROTOCOL  *This,
+  OUT EDKII_MNP_STATISTICS           *Statistics
+  );
+
+///
+/// MNP Statistics Protocol structure.
+///
+struct _EDKII_MNP_STATISTICS_PROTOCOL {
+  EDKII_MNP_GET_STATISTICS  GetStatistics;
+};
+
+///
+/// MNP Statistics Protocol GUID variable.
+///
+extern EFI_GUID gEdkiiMnpStatisticsProtocolGuid;
+
+#endif
@@ -436,6 +436,7 @@ MnpInitializeDeviceData (
   // Copy the MNP Protocol interfaces from the template.
   //
   CopyMem (&MnpDeviceData->VlanConfig, &mVlanConfigProtocolTemplate, sizeof (EFI_VLAN_CONFIG_PROTOCOL));
+  MnpDeviceData->Statistics.GetStatistics = MnpGetStatistics;
 
   //
   // Open the Simple Network protocol.
@@ -561,6 +562,21 @@ MnpInitializeDeviceData (
     goto ERROR;
   }
 
+  //
+  // Report the packet counters of the device.
+  //
+  Status = gBS->InstallMultipleProtocolInterfaces (
+                  &ControllerHandle,
+                  &gEdkiiMnpStatisticsProtocolGuid,
+                  &MnpDeviceData->Statistics,
+                  NULL
+                  );
+  if (EFI_ERROR (Status)) {
+    DEBUG ((EFI_D_ERROR, "MnpInitializeDeviceData: Install statistics protocol failed, %r.\n", Status));
+
+    goto ERROR;
+  }
+
 ERROR:
   if (EFI_ERROR (Status)) {
     //
@@ -624,6 +640,13 @@ MnpDestroyDeviceData (
 
   NET_CHECK_SIGNATURE (MnpDeviceData, MNP_DEVICE_DATA_SIGNATURE);
 
+  gBS->UninstallMultipleProtocolInterfaces (
+         MnpDeviceData->ControllerHandle,
+         &gEdkiiMnpStatisticsProtocolGuid,
+         &MnpDeviceData->Statistics,
+         NULL
+         );
+
   //
   // Free Vlan Config variable name string
   //
@@ -1280,6 +1303,8 @@ MnpStart (
     }
 
     MnpDeviceData->EnableSystemPoll = EnableSystemPoll;
+    MnpDeviceData->PollInterval     = MNP_SYS_POLL_INTERVAL;
+    MnpDeviceData->IdlePollCount    = 0;
   }
 
   //
@@ -1352,6 +1377,15 @@ MnpStop (
   //
   Status = gBS->SetTimer (MnpDeviceData->MediaDetectTimer, TimerCancel, 0);
 
+  DEBUG (
+    (EFI_D_INFO,
+    "MnpStop: Rx %ld, Tx %ld, RxDropped %ld, TxDropped %ld.\n",
+    MnpDeviceData->RxPackets,
+    MnpDeviceData->TxPackets,
+    MnpDeviceData->RxDropped,
+    MnpDeviceData->TxDropped)
+    );
+
   //
   // Stop the simple network.
   //
@@ -15,6 +15,7 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <Protocol/SimpleNetwork.h>
 #include <Protocol/ServiceBinding.h>
 #include <Protocol/VlanConfig.h>
+#include <Protocol/MnpStatistics.h>
 
 #include <Library/BaseLib.h>
 #include <Library/BaseMemoryLib.h>
@@ -69,6 +70,12 @@ typedef struct {
 
   EFI_EVENT                     PollTimer;
   BOOLEAN                       EnableSystemPoll;
+  //
+  // Current period of PollTimer, and the number of consecutive polls
+  // which received nothing.
+  //
+  UINT64                        PollInterval;
+  UINT32                        IdlePollCount;
 
   EFI_EVENT                     TimeoutCheckTimer;
   EFI_EVENT                     MediaDetectTimer;
@@ -85,6 +92,15 @@ typedef struct {
   UINT32                        BufferLength;
   UINT32                        PaddingSize;
   NET_BUF                       *RxNbufCache;
+
+  //
+  // Packet statistics of this device, reported through Statistics.
+  //
+  EDKII_MNP_STATISTICS_PROTOCOL Statistics;
+  UINT64                        RxPackets;
+  UINT64                        TxPackets;
+  UINT64                        RxDropped;
+  UINT64                        TxDropped;
 } MNP_DEVICE_DATA;
 
 #define MNP_DEVICE_DATA_FROM_THIS(a) \
@@ -95,6 +111,14 @@ typedef struct {
   MNP_DEVICE_DATA_SIGNATURE \
   )
 
+#define MNP_DEVICE_DATA_FROM_STATISTICS(a) \
+  CR ( \
+  (a), \
+  MNP_DEVICE_DATA, \
+  Statistics, \
+  MNP_DEVICE_DATA_SIGNATURE \
+  )
+
 #define MNP_SERVICE_DATA_SIGNATURE  SIGNATURE_32 ('M', 'n', 'p', 'S')
 
 typedef struct {
@@ -14,6 +14,9 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #define NET_ETHER_FCS_SIZE            4
 
 #define MNP_SYS_POLL_INTERVAL         (10 * TICKS_PER_MS)   // 10 milliseconds
+#define MNP_SYS_POLL_BUSY_INTERVAL    (1 * TICKS_PER_MS)    // 1 millisecond
+#define MNP_SYS_POLL_IDLE_COUNT       20    // Empty polls before falling back to MNP_SYS_POLL_INTERVAL.
+#define MNP_RX_BATCH_NUM              32    // Maximum packets received in one poll.
 #define MNP_TIMEOUT_CHECK_INTERVAL    (50 * TICKS_PER_MS)   // 50 milliseconds
 #define MNP_MEDIA_DETECT_INTERVAL     (500 * TICKS_PER_MS)  // 500 milliseconds
 #define MNP_TX_TIMEOUT_TIME           (500 * TICKS_PER_MS)  // 500 milliseconds
@@ -430,6 +433,22 @@ MnpReceivePacket (
   IN OUT MNP_DEVICE_DATA   *MnpDeviceData
   );
 
+/**
+  Receive and deliver up to MNP_RX_BATCH_NUM packets, and adapt the system poll
+  interval to the traffic seen.
+
+  @param[in, out]  MnpDeviceData        Pointer to the mnp device context data.
+
+  @retval EFI_SUCCESS           At least one packet is received.
+  @retval Others                The status of MnpReceivePacket when no packet is
+                                received.
+
+**/
+EFI_STATUS
+MnpReceivePackets (
+  IN OUT MNP_DEVICE_DATA   *MnpDeviceData
+  );
+
 /**
   Allocate a free NET_BUF from MnpDeviceData->FreeNbufQue. If there is none
   in the queue, first try to allocate some and add them into the queue, then
@@ -895,4 +914,21 @@ MnpConfigReceiveFilters (
   IN MNP_DEVICE_DATA     *MnpDeviceData
   );
 
+/**
+  Get the packet counters of the network device managed by MNP.
+
+  @param[in]   This           Pointer to the EDKII_MNP_STATISTICS_PROTOCOL instance.
+  @param[out]  Statistics     Pointer to the buffer to receive the counters.
+
+  @retval EFI_SUCCESS            The counters are returned.
+  @retval EFI_INVALID_PARAMETER  This is NULL or Statistics is NULL.
+
+**/
+EFI_STATUS
+EFIAPI
+MnpGetStatistics (
+  IN  EDKII_MNP_STATISTICS_PROTOCOL  *This,
+  OUT EDKII_MNP_STATISTICS           *Statistics
+  );
+
 #endif
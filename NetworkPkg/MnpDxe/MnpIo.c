@@ -234,6 +234,7 @@ MnpSyncSendPacket (
     // Media not present, skip packet transmit and report EFI_NO_MEDIA
     //
     DEBUG ((EFI_D_WARN, "MnpSyncSendPacket: No network cable detected.\n"));
+    MnpDeviceData->TxDropped++;
     Token->Status = EFI_NO_MEDIA;
     goto SIGNAL_TOKEN;
   }
@@ -263,6 +264,7 @@ MnpSyncSendPacket (
   if (Status == EFI_NOT_READY) {
     Status = MnpRecycleTxBuf (MnpDeviceData);
     if (EFI_ERROR (Status)) {
+      MnpDeviceData->TxDropped++;
       Token->Status = EFI_DEVICE_ERROR;
       goto SIGNAL_TOKEN;
     }
@@ -279,7 +281,10 @@ MnpSyncSendPacket (
   }
 
   if (EFI_ERROR (Status)) {
+    MnpDeviceData->TxDropped++;
     Token->Status = EFI_DEVICE_ERROR;
+  } else {
+    MnpDeviceData->TxPackets++;
   }
 
 SIGNAL_TOKEN:
@@ -489,6 +494,7 @@ MnpQueueRcvdPacket (
   if (Instance->RcvdPacketQueueSize == MNP_MAX_RCVD_PACKET_QUE_SIZE) {
 
     DEBUG ((EFI_D_WARN, "MnpQueueRcvdPacket: Drop one packet bcz queue size limit reached.\n"));
+    Instance->MnpServiceData->MnpDeviceData->RxDropped++;
 
     //
     // Get the oldest packet.
@@ -917,9 +923,12 @@ MnpReceivePacket (
       HeaderSize,
       BufLen)
       );
+    MnpDeviceData->RxDropped++;
     return EFI_DEVICE_ERROR;
   }
 
+  MnpDeviceData->RxPackets++;
+
   Trimmed = 0;
   if (Nbuf->TotalSize != BufLen) {
     //
@@ -1001,6 +1010,68 @@ EXIT:
 }
 
 
+/**
+  Receive and deliver up to MNP_RX_BATCH_NUM packets, and adapt the system poll
+  interval to the traffic seen.
+
+  While packets keep arriving the poll timer runs at MNP_SYS_POLL_BUSY_INTERVAL,
+  so that a burst is drained without waiting for the next idle period. After
+  MNP_SYS_POLL_IDLE_COUNT polls without any packet, it falls back to
+  MNP_SYS_POLL_INTERVAL.
+
+  @param[in, out]  MnpDeviceData        Pointer to the mnp device context data.
+
+  @retval EFI_SUCCESS           At least one packet is received.
+  @retval Others                The status of MnpReceivePacket when no packet is
+                                received.
+
+**/
+EFI_STATUS
+MnpReceivePackets (
+  IN OUT MNP_DEVICE_DATA   *MnpDeviceData
+  )
+{
+  EFI_STATUS  Status;
+  UINTN       Index;
+  UINT64      Interval;
+
+  Status = EFI_NOT_READY;
+  for (Index = 0; Index < MNP_RX_BATCH_NUM; Index++) {
+    Status = MnpReceivePacket (MnpDeviceData);
+    if (EFI_ERROR (Status)) {
+      break;
+    }
+  }
+
+  if (Index != 0) {
+    Status = EFI_SUCCESS;
+  }
+
+  if (!MnpDeviceData->EnableSystemPoll) {
+    return Status;
+  }
+
+  Interval = MnpDeviceData->PollInterval;
+  if (Index != 0) {
+    MnpDeviceData->IdlePollCount = 0;
+    Interval                     = MNP_SYS_POLL_BUSY_INTERVAL;
+  } else if (Interval != MNP_SYS_POLL_INTERVAL) {
+    MnpDeviceData->IdlePollCount++;
+    if (MnpDeviceData->IdlePollCount >= MNP_SYS_POLL_IDLE_COUNT) {
+      Interval = MNP_SYS_POLL_INTERVAL;
+    }
+  }
+
+  if (Interval != MnpDeviceData->PollInterval) {
+    if (!EFI_ERROR (gBS->SetTimer (MnpDeviceData->PollTimer, TimerPeriodic, Interval))) {
+      MnpDeviceData->PollInterval = Interval;
+    }
+  }
+
+  return Status;
+}
+
+
 /**
   Remove the received packets if timeout occurs.
 
@@ -1060,6 +1131,7 @@ MnpCheckPacketTimeout (
           // Drop the timeout packet.
           //
           DEBUG ((EFI_D_WARN, "MnpCheckPacketTimeout: Received packet timeout.\n"));
+          MnpDeviceData->RxDropped++;
           MnpRecycleRxData (NULL, RxDataWrap);
           Instance->RcvdPacketQueueSize--;
         }
@@ -1124,7 +1196,7 @@ MnpSystemPoll (
   //
   // Try to receive packets from Snp.
   //
-  MnpReceivePacket (MnpDeviceData);
+  MnpReceivePackets (MnpDeviceData);
 
   //
   // Dispatch the DPC queued by the NotifyFunction of rx token's events.
@@ -775,7 +775,7 @@ MnpPoll (
   //
   // Try to receive packets.
   //
-  Status = MnpReceivePacket (Instance->MnpServiceData->MnpDeviceData);
+  Status = MnpReceivePackets (Instance->MnpServiceData->MnpDeviceData);
 
   //
   // Dispatch the DPC queued by the NotifyFunction of rx token's events.
@@ -787,3 +787,42 @@ ON_EXIT:
 
   return Status;
 }
+
+/**
+  Get the packet counters of the network device managed by MNP.
+
+  @param[in]   This           Pointer to the EDKII_MNP_STATISTICS_PROTOCOL instance.
+  @param[out]  Statistics     Pointer to the buffer to receive the counters.
+
+  @retval EFI_SUCCESS            The counters are returned.
+  @retval EFI_INVALID_PARAMETER  This is NULL or Statistics is NULL.
+
+**/
+EFI_STATUS
+EFIAPI
+MnpGetStatistics (
+  IN  EDKII_MNP_STATISTICS_PROTOCOL  *This,
+  OUT EDKII_MNP_STATISTICS           *Statistics
+  )
+{
+  MNP_DEVICE_DATA  *MnpDeviceData;
+  EFI_TPL          OldTpl;
+
+  if ((This == NULL) || (Statistics == NULL)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  MnpDeviceData = MNP_DEVICE_DATA_FROM_STATISTICS (This);
+
+  //
+  // The counters are updated at TPL_CALLBACK.
+  //
+  OldTpl = gBS->RaiseTPL (TPL_CALLBACK);
+  Statistics->RxPackets = MnpDeviceData->RxPackets;
+  Statistics->TxPackets = MnpDeviceData->TxPackets;
+  Statistics->RxDropped = MnpDeviceData->RxDropped;
+  Statistics->TxDropped = MnpDeviceData->TxDropped;
+  gBS->RestoreTPL (OldTpl);
+
+  return EFI_SUCCESS;
+}
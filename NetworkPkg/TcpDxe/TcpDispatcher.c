@@ -120,7 +120,7 @@ Tcp4GetMode (
       Option->EnableTimeStamp        = (BOOLEAN) (!TCP_FLG_ON (Tcb->CtrlFlag, TCP_CTRL_NO_TS));
       Option->EnableWindowScaling    = (BOOLEAN) (!TCP_FLG_ON (Tcb->CtrlFlag, TCP_CTRL_NO_WS));
 
-      Option->EnableSelectiveAck     = FALSE;
+      Option->EnableSelectiveAck     = (BOOLEAN) (!TCP_FLG_ON (Tcb->CtrlFlag, TCP_CTRL_NO_SACK));
       Option->EnablePathMtuDiscovery = FALSE;
     }
   }
@@ -198,7 +198,7 @@ Tcp6GetMode (
       Option->EnableTimeStamp        = (BOOLEAN) (!TCP_FLG_ON (Tcb->CtrlFlag, TCP_CTRL_NO_TS));
       Option->EnableWindowScaling    = (BOOLEAN) (!TCP_FLG_ON (Tcb->CtrlFlag, TCP_CTRL_NO_WS));
 
-      Option->EnableSelectiveAck     = FALSE;
+      Option->EnableSelectiveAck     = (BOOLEAN) (!TCP_FLG_ON (Tcb->CtrlFlag, TCP_CTRL_NO_SACK));
       Option->EnablePathMtuDiscovery = FALSE;
     }
   }
@@ -562,7 +562,7 @@ TcpConfigurePcb (
   Tcb->RcvMss           = TcpGetRcvMss (Sk);
 
   Tcb->SRtt             = 0;
-  Tcb->Rto              = 3 * TCP_TICK_HZ;
+  Tcb->Rto              = TCP_RTO_INIT;
 
   Tcb->CWnd             = Tcb->SndMss;
   Tcb->Ssthresh         = 0xffffffff;
@@ -577,6 +577,12 @@ TcpConfigurePcb (
   Tcb->TimeWaitTimeout  = TCP_TIME_WAIT_TIME;
   Tcb->ConnectTimeout   = TCP_CONNECT_TIME;
 
+  //
+  // The receive buffer configured by the application is only
+  // the initial size, it is enlarged on demand up to this.
+  //
+  Tcb->RcvBufMax        = TCP_RCV_BUF_SIZE;
+
   if (Sk->IpVersion == IP_VERSION_4) {
     //
     // initialize Tcb in the light of CfgData
@@ -708,6 +714,10 @@ TcpConfigurePcb (
     if (!Option->EnableWindowScaling) {
       TCP_SET_FLG (Tcb->CtrlFlag, TCP_CTRL_NO_WS);
     }
+
+    if (!Option->EnableSelectiveAck) {
+      TCP_SET_FLG (Tcb->CtrlFlag, TCP_CTRL_NO_SACK);
+    }
   }
 
   //
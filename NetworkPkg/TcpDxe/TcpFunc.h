@@ -360,6 +360,22 @@ TcpRetransmit (
   IN TCP_SEQNO Seq
   );
 
+/**
+  Retransmit the first hole in the SACK scoreboard that hasn't been
+  retransmitted in the current recovery, as rule 1 of NextSeg () in RFC6675.
+
+  @param[in, out]  Tcb     Pointer to the TCP_CB of this TCP instance.
+
+  @retval TRUE     A hole is retransmitted.
+  @retval FALSE    No hole is found below the highest SACKed sequence,
+                   or the retransmission failed.
+
+**/
+BOOLEAN
+TcpSackRetransmit (
+  IN OUT TCP_CB *Tcb
+  );
+
 /**
   Check whether to send data/SYN/FIN and piggyback an ACK.
 
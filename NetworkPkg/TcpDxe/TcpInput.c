@@ -62,9 +62,14 @@ TcpFastRecover (
     TCP_CLEAR_FLG (Tcb->CtrlFlag, TCP_CTRL_RTT_ON);
 
     //
-    // Step 2: Entering fast retransmission
+    // Step 2: Entering fast retransmission. If the peer
+    // supports SACK, the first hole starts at SndUna too.
     //
-    TcpRetransmit (Tcb, Tcb->SndUna);
+    Tcb->HighRxt = Tcb->SndUna;
+    if (!TcpSackRetransmit (Tcb)) {
+      TcpRetransmit (Tcb, Tcb->SndUna);
+    }
+
     Tcb->CWnd = Tcb->Ssthresh + 3 * Tcb->SndMss;
 
     DEBUG (
@@ -84,12 +89,18 @@ TcpFastRecover (
     //
     // Step 3: Fast Recovery,
     // If this is a duplicated ACK, increse Cwnd by SMSS.
+    // With SACK, the segment that left the network is
+    // replaced by the retransmission of the next hole
+    // instead, so multiple losses in one window are
+    // repaired without waiting for the partial ACKs.
     //
 
     // Step 4 is skipped here only to be executed later
     // by TcpToSendData
     //
-    Tcb->CWnd += Tcb->SndMss;
+    if (!TcpSackRetransmit (Tcb)) {
+      Tcb->CWnd += Tcb->SndMss;
+    }
     DEBUG (
       (EFI_D_NET,
       "TcpFastRecover: received another duplicated ACK (%d) for TCB %p\n",
@@ -126,9 +137,17 @@ TcpFastRecover (
       //
       // Step 5 - Partial ACK:
       // fast retransmit the first unacknowledge field
-      // , then deflate the CWnd
+      // , then deflate the CWnd. If it has already been
+      // retransmitted by SACK recovery, send the next hole.
       //
-      TcpRetransmit (Tcb, Seg->Ack);
+      if (TCP_SEQ_LT (Tcb->HighRxt, Seg->Ack)) {
+        Tcb->HighRxt = Seg->Ack;
+      }
+
+      if (!TcpSackRetransmit (Tcb) && (Tcb->HighRxt == Seg->Ack)) {
+        TcpRetransmit (Tcb, Seg->Ack);
+      }
+
       Acked = TCP_SUB_SEQ (Seg->Ack, Tcb->SndUna);
 
       //
@@ -206,7 +225,25 @@ TcpFastLossRecover (
 }
 
 /**
-  Compute the RTT as specified in RFC2988.
+  Fall back to a 3 seconds RTO after the connection is established, if the
+  SYN or SYN/ACK was retransmitted and no RTT is sampled, as section 5.7 of
+  RFC6298 requires.
+
+  @param[in, out]  Tcb      Pointer to the TCP_CB of this TCP instance.
+
+**/
+VOID
+TcpSynLossRto (
+  IN OUT TCP_CB *Tcb
+  )
+{
+  if ((Tcb->SRtt == 0) && (Tcb->LossTimes != 0)) {
+    Tcb->Rto = TCP_RTO_SYN_LOSS;
+  }
+}
+
+/**
+  Compute the RTT as specified in RFC6298.
 
   @param[in, out]  Tcb      Pointer to the TCP_CB of this TCP instance.
   @param[in]       Measure  Currently measured RTT in heartbeats.
@@ -232,7 +269,7 @@ TcpComputeRtt (
     }
 
     Tcb->RttVar = (3 * Tcb->RttVar + Var) >> 2;
-    Tcb->SRtt   = 7 * (Tcb->SRtt >> 3) + Measure;
+    Tcb->SRtt   = Tcb->SRtt - (Tcb->SRtt >> 3) + Measure;
 
   } else {
     //
@@ -378,6 +415,56 @@ TcpTrimInWnd (
   return TcpTrimSegment (Nbuf, Tcb->RcvNxt, Tcb->RcvWl2 + Tcb->RcvWnd);
 }
 
+/**
+  Grow the receive buffer if the application consumes the data as fast as
+  it arrives, and the received data in one round trip approaches the buffer
+  size. Then the advertised window, not the buffer configured by the
+  application, won't limit the throughput of a long fat pipe.
+
+  @param[in, out]  Tcb        Pointer to the TCP_CB of this TCP instance.
+  @param[in]       Delivered  The bytes just delivered to the socket layer.
+
+**/
+VOID
+TcpRcvBufAutoTune (
+  IN OUT TCP_CB *Tcb,
+  IN     UINT32 Delivered
+  )
+{
+  UINT32  BufSize;
+  UINT32  Interval;
+
+  BufSize = GET_RCV_BUFFSIZE (Tcb->Sk);
+
+  if (BufSize >= Tcb->RcvBufMax) {
+    return;
+  }
+
+  Tcb->RcvSpaceBytes += Delivered;
+
+  //
+  // Measure per round trip, but no shorter than one tick.
+  //
+  Interval = MAX (Tcb->SRtt >> TCP_RTT_SHIFT, 1);
+  if (TCP_SUB_TIME (mTcpTick, Tcb->RcvSpaceTime) < Interval) {
+    return;
+  }
+
+  if ((Tcb->RcvSpaceBytes >= BufSize / 2) && (GET_RCV_DATASIZE (Tcb->Sk) < BufSize / 2)) {
+    SET_RCV_BUFFSIZE (Tcb->Sk, MIN (BufSize * 2, Tcb->RcvBufMax));
+
+    DEBUG (
+      (EFI_D_NET,
+      "TcpRcvBufAutoTune: receive buffer of TCB %p is enlarged to %d\n",
+      Tcb,
+      GET_RCV_BUFFSIZE (Tcb->Sk))
+      );
+  }
+
+  Tcb->RcvSpaceBytes = 0;
+  Tcb->RcvSpaceTime  = mTcpTick;
+}
+
 /**
   Process the data and FIN flag, and check whether to deliver
   data to the socket layer.
@@ -399,6 +486,7 @@ TcpDeliverData (
   TCP_SEQNO       Seq;
   TCP_SEG         *Seg;
   UINT32          Urgent;
+  UINT32          Delivered;
 
   ASSERT ((Tcb != NULL) && (Tcb->Sk != NULL));
 
@@ -414,8 +502,9 @@ TcpDeliverData (
   //
   // Deliver data to the socket layer
   //
-  Entry = Tcb->RcvQue.ForwardLink;
-  Seq   = Tcb->RcvNxt;
+  Entry     = Tcb->RcvQue.ForwardLink;
+  Seq       = Tcb->RcvNxt;
+  Delivered = 0;
 
   while (Entry != &Tcb->RcvQue) {
     Nbuf  = NET_LIST_USER_STRUCT (Entry, NET_BUF, List);
@@ -550,6 +639,7 @@ TcpDeliverData (
         }
       }
 
+      Delivered += Nbuf->TotalSize;
       SockDataRcvd (Tcb->Sk, Nbuf, Urgent);
     }
 
@@ -561,6 +651,10 @@ TcpDeliverData (
     NetbufFree (Nbuf);
   }
 
+  if (Delivered != 0) {
+    TcpRcvBufAutoTune (Tcb, Delivered);
+  }
+
   return 0;
 }
 
@@ -593,6 +687,12 @@ TcpQueueData (
   Seg   = TCPSEG_NETBUF (Nbuf);
   Head  = &Tcb->RcvQue;
 
+  //
+  // Remember the latest segment, its block is reported
+  // first in the SACK option.
+  //
+  Tcb->RcvSackSeq = Seg->Seq;
+
   //
   // Fast path to process normal case. That is,
   // no out-of-order segments are received.
@@ -726,6 +826,107 @@ TcpAdjustSndQue (
   return 1;
 }
 
+/**
+  Update the SACK scoreboard with the cumulative ACK and the SACK option
+  in the received segment as specified in RFC2018.
+
+  @param[in, out]  Tcb      Pointer to the TCP_CB of this TCP instance.
+  @param[in]       Ack      The acknowledge sequence number of the received segment.
+  @param[in]       Option   Pointer to the options parsed from the received segment.
+
+**/
+VOID
+TcpSackUpdate (
+  IN OUT TCP_CB     *Tcb,
+  IN     TCP_SEQNO  Ack,
+  IN     TCP_OPTION *Option
+  )
+{
+  TCP_SACK_BLOCK  Board[TCP_SACK_BOARD_SIZE + 1];
+  TCP_SACK_BLOCK  New;
+  UINTN           Count;
+  UINTN           Index;
+  UINTN           Block;
+  BOOLEAN         Inserted;
+
+  //
+  // Drop the ranges that are cumulatively ACKed.
+  //
+  Count = 0;
+  for (Index = 0; Index < Tcb->SackCount; Index++) {
+    if (TCP_SEQ_GT (Tcb->SackBoard[Index].Right, Ack)) {
+      Tcb->SackBoard[Count] = Tcb->SackBoard[Index];
+      if (TCP_SEQ_LT (Tcb->SackBoard[Count].Left, Ack)) {
+        Tcb->SackBoard[Count].Left = Ack;
+      }
+
+      Count++;
+    }
+  }
+
+  Tcb->SackCount = (UINT8) Count;
+
+  if (!TCP_FLG_ON (Option->Flag, TCP_OPTION_RCVD_SACK)) {
+    return;
+  }
+
+  for (Block = 0; Block < Option->SackCount; Block++) {
+    New = Option->SackBlock[Block];
+
+    //
+    // Ignore the invalid blocks, and the D-SACK blocks below Ack.
+    //
+    if (TCP_SEQ_LEQ (New.Right, Ack) || TCP_SEQ_LEQ (New.Right, New.Left) ||
+        TCP_SEQ_GT (New.Right, Tcb->SndNxt)) {
+      continue;
+    }
+
+    if (TCP_SEQ_LT (New.Left, Ack)) {
+      New.Left = Ack;
+    }
+
+    //
+    // Insert the block into the sorted board, merging the
+    // ranges it overlaps or touches.
+    //
+    Count    = 0;
+    Inserted = FALSE;
+
+    for (Index = 0; Index < Tcb->SackCount; Index++) {
+      if (TCP_SEQ_LT (Tcb->SackBoard[Index].Right, New.Left)) {
+        Board[Count++] = Tcb->SackBoard[Index];
+
+      } else if (TCP_SEQ_LT (New.Right, Tcb->SackBoard[Index].Left)) {
+        if (!Inserted) {
+          Board[Count++] = New;
+          Inserted       = TRUE;
+        }
+
+        Board[Count++] = Tcb->SackBoard[Index];
+
+      } else {
+        if (TCP_SEQ_LT (Tcb->SackBoard[Index].Left, New.Left)) {
+          New.Left = Tcb->SackBoard[Index].Left;
+        }
+
+        if (TCP_SEQ_GT (Tcb->SackBoard[Index].Right, New.Right)) {
+          New.Right = Tcb->SackBoard[Index].Right;
+        }
+      }
+    }
+
+    if (!Inserted) {
+      Board[Count++] = New;
+    }
+
+    //
+    // If the board overflows, the highest range is forgotten.
+    //
+    Tcb->SackCount = (UINT8) MIN (Count, TCP_SACK_BOARD_SIZE);
+    CopyMem (Tcb->SackBoard, Board, Tcb->SackCount * sizeof (TCP_SACK_BLOCK));
+  }
+}
+
 /**
   Process the received TCP segments.
 
@@ -1003,6 +1204,8 @@ TcpInput (
           TCP_CLEAR_FLG (Tcb->CtrlFlag, TCP_CTRL_RTT_ON);
         }
 
+        TcpSynLossRto (Tcb);
+
         if (TcpTrimInWnd (Tcb, Nbuf) == 0) {
           DEBUG (
             (EFI_D_ERROR,
@@ -1184,6 +1387,7 @@ TcpInput (
 
       TcpClearTimer (Tcb, TCP_TIMER_CONNECT);
       TcpDeliverData (Tcb);
+      TcpSynLossRto (Tcb);
 
       DEBUG (
         (EFI_D_NET,
@@ -1244,9 +1448,15 @@ TcpInput (
       Tcb->TsRecentAge  = mTcpTick;
     }
 
-    TcpComputeRtt (Tcb, TCP_SUB_TIME (mTcpTick, Option.TSEcr));
+    //
+    // Only the ACK of new data gives a valid RTT sample,
+    // the duplicate ACKs echo the timestamp of an older segment.
+    //
+    if (TCP_SEQ_GT (Seg->Ack, Tcb->SndUna)) {
+      TcpComputeRtt (Tcb, TCP_SUB_TIME (mTcpTick, Option.TSEcr));
+    }
 
-  } else if (TCP_FLG_ON (Tcb->CtrlFlag, TCP_CTRL_RTT_ON)) {
+  } else if (TCP_FLG_ON (Tcb->CtrlFlag, TCP_CTRL_RTT_ON) && TCP_SEQ_GT (Seg->Ack, Tcb->RttSeq)) {
 
     ASSERT (Tcb->CongestState == TCP_CONGEST_OPEN);
 
@@ -1254,14 +1464,22 @@ TcpInput (
     TCP_CLEAR_FLG (Tcb->CtrlFlag, TCP_CTRL_RTT_ON);
   }
 
+  //
+  // RFC6298 section 5.2 and 5.3: turn off the timer when all the data
+  // is ACKed, restart it only when new data is ACKed.
+  //
   if (Seg->Ack == Tcb->SndNxt) {
 
     TcpClearTimer (Tcb, TCP_TIMER_REXMIT);
-  } else {
+  } else if (TCP_SEQ_GT (Seg->Ack, Tcb->SndUna) || !TCP_TIMER_ON (Tcb->EnabledTimer, TCP_TIMER_REXMIT)) {
 
     TcpSetTimer (Tcb, TCP_TIMER_REXMIT, Tcb->Rto);
   }
 
+  if (TCP_FLG_ON (Tcb->CtrlFlag, TCP_CTRL_RCVD_SACK)) {
+    TcpSackUpdate (Tcb, Seg->Ack, &Option);
+  }
+
   //
   // Count duplicate acks.
   //
@@ -80,7 +80,12 @@ TcpComputeScale (
 
   ASSERT ((Tcb != NULL) && (Tcb->Sk != NULL));
 
-  BufSize = GET_RCV_BUFFSIZE (Tcb->Sk);
+  //
+  // The receive buffer may be enlarged by auto-tuning after the
+  // handshake, but the scale can't be changed any more. So compute
+  // it from the size the buffer may grow to.
+  //
+  BufSize = MAX (GET_RCV_BUFFSIZE (Tcb->Sk), Tcb->RcvBufMax);
 
   Scale   = 0;
   while ((Scale < TCP_OPTION_MAX_WS) && ((UINT32) (TCP_OPTION_MAX_WIN << Scale) < BufSize)) {
@@ -159,6 +164,28 @@ TcpSynBuildOption (
     TcpPutUint32 (Data, TCP_OPTION_WS_FAST | TcpComputeScale (Tcb));
   }
 
+  //
+  // Build SACK permitted option, only when configured
+  // to use SACK, and either we are doing active open
+  // or we have received SACK permitted option from peer.
+  //
+  if (!TCP_FLG_ON (Tcb->CtrlFlag, TCP_CTRL_NO_SACK) &&
+      (!TCP_FLG_ON (TCPSEG_NETBUF (Nbuf)->Flag, TCP_FLG_ACK) ||
+        TCP_FLG_ON (Tcb->CtrlFlag, TCP_CTRL_RCVD_SACK))
+      ) {
+
+    Data = NetbufAllocSpace (
+             Nbuf,
+             TCP_OPTION_SACK_PERM_ALIGNED_LEN,
+             NET_BUF_HEAD
+             );
+
+    ASSERT (Data != NULL);
+
+    Len += TCP_OPTION_SACK_PERM_ALIGNED_LEN;
+    TcpPutUint32 (Data, TCP_OPTION_SACK_PERM_FAST);
+  }
+
   //
   // Build the MSS option.
   //
@@ -171,6 +198,115 @@ TcpSynBuildOption (
   return Len;
 }
 
+/**
+  Build the SACK option from the out-of-order segments in the RcvQue as
+  specified in RFC2018. The block containing the latest queued segment is
+  reported first, the others follow in sequence order.
+
+  @param[in]  Tcb     Pointer to the TCP_CB of this TCP instance.
+  @param[in]  Nbuf    Pointer to the buffer to store the option.
+  @param[in]  Room    The option space left in the segment.
+
+  @return             The length of the SACK option, 0 if none is built.
+
+**/
+UINT16
+TcpBuildSackOption (
+  IN TCP_CB  *Tcb,
+  IN NET_BUF *Nbuf,
+  IN UINT16  Room
+  )
+{
+  TCP_SACK_BLOCK  Block[TCP_SACK_MAX_BLOCK];
+  TCP_SACK_BLOCK  Latest;
+  TCP_SACK_BLOCK  Cur;
+  LIST_ENTRY      *Entry;
+  TCP_SEG         *Seg;
+  UINT8           *Data;
+  UINT16          Len;
+  UINTN           MaxCount;
+  UINTN           Count;
+  UINTN           Index;
+  BOOLEAN         Open;
+  BOOLEAN         HasLatest;
+
+  if (Room < TCP_OPTION_SACK_MIN_LEN + 2) {
+    return 0;
+  }
+
+  MaxCount  = MIN (TCP_SACK_MAX_BLOCK, (Room - 4) / TCP_OPTION_SACK_BLOCK_LEN);
+  Count     = 0;
+  Open      = FALSE;
+  HasLatest = FALSE;
+  Entry     = Tcb->RcvQue.ForwardLink;
+
+  ZeroMem (&Latest, sizeof (TCP_SACK_BLOCK));
+  ZeroMem (&Cur, sizeof (TCP_SACK_BLOCK));
+
+  //
+  // Merge the contiguous segments into blocks. A block is
+  // closed when a gap is found or the queue ends.
+  //
+  while (TRUE) {
+    Seg = NULL;
+
+    if (Entry != &Tcb->RcvQue) {
+      Seg   = TCPSEG_NETBUF (NET_LIST_USER_STRUCT (Entry, NET_BUF, List));
+      Entry = Entry->ForwardLink;
+
+      if (TCP_SEQ_LEQ (Seg->End, Tcb->RcvNxt)) {
+        continue;
+      }
+
+      if (Open && (Cur.Right == Seg->Seq)) {
+        Cur.Right = Seg->End;
+        continue;
+      }
+    }
+
+    if (Open) {
+      if (TCP_SEQ_LEQ (Cur.Left, Tcb->RcvSackSeq) && TCP_SEQ_LT (Tcb->RcvSackSeq, Cur.Right)) {
+        Latest    = Cur;
+        HasLatest = TRUE;
+      } else if (Count < MaxCount) {
+        Block[Count++] = Cur;
+      }
+    }
+
+    if (Seg == NULL) {
+      break;
+    }
+
+    Cur.Left  = Seg->Seq;
+    Cur.Right = Seg->End;
+    Open      = TRUE;
+  }
+
+  if (HasLatest) {
+    Count = MIN (Count, MaxCount - 1);
+    CopyMem (&Block[1], &Block[0], Count * sizeof (TCP_SACK_BLOCK));
+    Block[0] = Latest;
+    Count++;
+  }
+
+  if (Count == 0) {
+    return 0;
+  }
+
+  Len  = (UINT16) (4 + Count * TCP_OPTION_SACK_BLOCK_LEN);
+  Data = NetbufAllocSpace (Nbuf, Len, NET_BUF_HEAD);
+  ASSERT (Data != NULL);
+
+  TcpPutUint32 (Data, TCP_OPTION_SACK_FAST | (Len - 2));
+
+  for (Index = 0; Index < Count; Index++) {
+    TcpPutUint32 (Data + 4 + Index * TCP_OPTION_SACK_BLOCK_LEN, Block[Index].Left);
+    TcpPutUint32 (Data + 8 + Index * TCP_OPTION_SACK_BLOCK_LEN, Block[Index].Right);
+  }
+
+  return Len;
+}
+
 /**
   Build the TCP option in synchronized states.
 
@@ -188,9 +324,11 @@ TcpBuildOption (
 {
   UINT8   *Data;
   UINT16  Len;
+  UINT32  DataLen;
 
   ASSERT ((Tcb != NULL) && (Nbuf != NULL) && (Nbuf->Tcp == NULL));
-  Len = 0;
+  Len     = 0;
+  DataLen = Nbuf->TotalSize;
 
   //
   // Build the Timestamp option.
@@ -213,6 +351,20 @@ TcpBuildOption (
     TcpPutUint32 (Data + 8, Tcb->TsRecent);
   }
 
+  //
+  // Build the SACK option if there is out-of-order data. It isn't
+  // accounted for by the SndMss, so only put it in segments without
+  // data.
+  //
+  if (TCP_FLG_ON (Tcb->CtrlFlag, TCP_CTRL_RCVD_SACK) &&
+      !TCP_FLG_ON (TCPSEG_NETBUF (Nbuf)->Flag, TCP_FLG_RST) &&
+      (DataLen == 0) &&
+      !IsListEmpty (&Tcb->RcvQue)
+      ) {
+
+    Len = (UINT16) (Len + TcpBuildSackOption (Tcb, Nbuf, (UINT16) (TCP_OPTION_MAX_LEN - Len)));
+  }
+
   return Len;
 }
 
@@ -238,6 +390,7 @@ TcpParseOption (
   UINT8 Cur;
   UINT8 Type;
   UINT8 Len;
+  UINT8 Index;
 
   ASSERT ((Tcp != NULL) && (Option != NULL));
 
@@ -313,6 +466,50 @@ TcpParseOption (
       Cur += TCP_OPTION_TS_LEN;
       break;
 
+    case TCP_OPTION_SACK_PERM:
+      Len = Head[Cur + 1];
+
+      if ((Len != TCP_OPTION_SACK_PERM_LEN) || (TotalLen - Cur < TCP_OPTION_SACK_PERM_LEN)) {
+
+        return -1;
+      }
+
+      TCP_SET_FLG (Option->Flag, TCP_OPTION_RCVD_SACK_PERM);
+
+      Cur += TCP_OPTION_SACK_PERM_LEN;
+      break;
+
+    case TCP_OPTION_SACK:
+      if (TotalLen - Cur < TCP_OPTION_SACK_MIN_LEN) {
+
+        return -1;
+      }
+
+      Len = Head[Cur + 1];
+
+      if ((Len < TCP_OPTION_SACK_MIN_LEN) ||
+          ((Len - 2) % TCP_OPTION_SACK_BLOCK_LEN != 0) ||
+          (TotalLen - Cur < Len)) {
+
+        return -1;
+      }
+
+      //
+      // Keep at most TCP_SACK_MAX_BLOCK blocks, the first
+      // ones are the most recently received by the peer.
+      //
+      Option->SackCount = 0;
+      for (Index = 2; (Index < Len) && (Option->SackCount < TCP_SACK_MAX_BLOCK); Index += TCP_OPTION_SACK_BLOCK_LEN) {
+        Option->SackBlock[Option->SackCount].Left  = TcpGetUint32 (&Head[Cur + Index]);
+        Option->SackBlock[Option->SackCount].Right = TcpGetUint32 (&Head[Cur + Index + 4]);
+        Option->SackCount++;
+      }
+
+      TCP_SET_FLG (Option->Flag, TCP_OPTION_RCVD_SACK);
+
+      Cur = (UINT8) (Cur + Len);
+      break;
+
     case TCP_OPTION_NOP:
       Cur++;
       break;
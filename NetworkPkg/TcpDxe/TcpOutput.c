@@ -735,6 +735,77 @@ OnError:
   return -1;
 }
 
+/**
+  Retransmit the first hole in the SACK scoreboard that hasn't been
+  retransmitted in the current recovery, as rule 1 of NextSeg () in RFC6675.
+
+  @param[in, out]  Tcb     Pointer to the TCP_CB of this TCP instance.
+
+  @retval TRUE     A hole is retransmitted.
+  @retval FALSE    No hole is found below the highest SACKed sequence,
+                   or the retransmission failed.
+
+**/
+BOOLEAN
+TcpSackRetransmit (
+  IN OUT TCP_CB *Tcb
+  )
+{
+  TCP_SEQNO       Seq;
+  UINT32          Len;
+  UINTN           Index;
+
+  if (Tcb->SackCount == 0) {
+    return FALSE;
+  }
+
+  Seq = Tcb->SndUna;
+  if (TCP_SEQ_GT (Tcb->HighRxt, Seq)) {
+    Seq = Tcb->HighRxt;
+  }
+
+  //
+  // The scoreboard is sorted. Skip the SACKed ranges to find
+  // the first sequence that isn't SACKed. Only the data below
+  // a SACKed range is considered lost.
+  //
+  for (Index = 0; Index < Tcb->SackCount; Index++) {
+    if (TCP_SEQ_LT (Seq, Tcb->SackBoard[Index].Left)) {
+      break;
+    }
+
+    if (TCP_SEQ_LT (Seq, Tcb->SackBoard[Index].Right)) {
+      Seq = Tcb->SackBoard[Index].Right;
+    }
+  }
+
+  if (Index == Tcb->SackCount) {
+    return FALSE;
+  }
+
+  //
+  // TcpRetransmit () sends up to SndMss bytes of the sent data from
+  // Seq, which may span several queued segments. The data below
+  // SndNxt was in the send window when it was sent, so the window
+  // normally doesn't limit it further. Advance HighRxt past all of it.
+  //
+  Len = MIN (TCP_SUB_SEQ (Tcb->SndNxt, Seq), Tcb->SndMss);
+
+  if (TcpRetransmit (Tcb, Seq) != 0) {
+    return FALSE;
+  }
+
+  DEBUG (
+    (EFI_D_NET,
+    "TcpSackRetransmit: retransmit the hole at %d for TCB %p\n",
+    Seq,
+    Tcb)
+    );
+
+  Tcb->HighRxt = Seq + Len;
+  return TRUE;
+}
+
 /**
   Verify that all the segments in SndQue are in good shape.
 
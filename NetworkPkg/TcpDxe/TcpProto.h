@@ -72,6 +72,8 @@
 #define TCP_CTRL_TIMER_ON        0x1000 ///< At least one of the timer is on.
 #define TCP_CTRL_RTT_ON          0x2000 ///< The RTT measurement is on.
 #define TCP_CTRL_ACK_NOW         0x4000 ///< Send the ACK now, don't delay.
+#define TCP_CTRL_NO_SACK         0x8000 ///< Disable SACK option.
+#define TCP_CTRL_RCVD_SACK      0x10000 ///< Received a SACK-permitted option in syn.
 
 //
 // Timer related values
@@ -88,6 +90,8 @@
 #define TCP_RTT_SHIFT            3                  ///< SRTT & RTTVAR scaled by 8.
 #define TCP_RTO_MIN              TCP_TICK_HZ        ///< The minimum value of RTO.
 #define TCP_RTO_MAX              (TCP_TICK_HZ * 60) ///< The maximum value of RTO.
+#define TCP_RTO_INIT             TCP_TICK_HZ        ///< The initial value of RTO.
+#define TCP_RTO_SYN_LOSS         (TCP_TICK_HZ * 3)  ///< RTO after a lost SYN, no RTT sample.
 #define TCP_FOLD_RTT             4                  ///< Timeout threshold to fold RTT.
 
 //
@@ -118,6 +122,12 @@
 #define TCP_BACKLOG              10
 #define TCP_BACKLOG_MIN          5
 #define TCP_MAX_LOSS_MIN         6
+
+//
+// SACK related values
+//
+#define TCP_SACK_MAX_BLOCK       4 ///< Max SACK blocks carried by one option.
+#define TCP_SACK_BOARD_SIZE      8 ///< Max SACKed ranges kept by the sender.
 #define TCP_CONNECT_TIME_MIN     (60 * TCP_TICK_HZ)
 #define TCP_MAX_KEEPALIVE_MIN    4
 #define TCP_KEEPALIVE_IDLE_MAX   (TCP_TICK_HZ * 60 * 60 * 4)
@@ -219,6 +229,14 @@ typedef struct _TCP_SEG {
   UINT32    Wnd;  ///< TCP window size field.
 } TCP_SEG;
 
+///
+/// A block of contiguous data received by the peer, used by SACK.
+///
+typedef struct _TCP_SACK_BLOCK {
+  TCP_SEQNO Left;  ///< The first sequence number of the block.
+  TCP_SEQNO Right; ///< The sequence number following the last byte of the block.
+} TCP_SACK_BLOCK;
+
 ///
 /// Network endpoint, IP plus Port structure.
 ///
@@ -315,6 +333,21 @@ struct _TCP_CONTROL_BLOCK {
   //
   TCP_SEQNO         RetxmitSeqMax;       ///< Max Seq number in previous retransmission.
 
+  //
+  // RFC2018 and RFC6675 variables, about SACK based loss recovery.
+  //
+  TCP_SACK_BLOCK    SackBoard[TCP_SACK_BOARD_SIZE]; ///< SACKed ranges above SndUna, sorted.
+  UINT8             SackCount;                      ///< Number of valid ranges in SackBoard.
+  TCP_SEQNO         HighRxt;    ///< Highest seq retransmitted in current recovery.
+  TCP_SEQNO         RcvSackSeq; ///< Seq of the latest segment put into RcvQue.
+
+  //
+  // Receive buffer auto-tuning.
+  //
+  UINT32            RcvBufMax;     ///< The size the receive buffer may grow to.
+  UINT32            RcvSpaceBytes; ///< Bytes delivered in current measurement.
+  UINT32            RcvSpaceTime;  ///< When current measurement started.
+
   //
   // configuration parameters, for EFI_TCP4_PROTOCOL specification
   //
@@ -220,6 +220,13 @@ TcpRexmitTimeout (
     return ;
   }
 
+  //
+  // The peer may discard the data it has SACKed, so
+  // forget the scoreboard as RFC2018 requires.
+  //
+  Tcb->SackCount = 0;
+  Tcb->HighRxt   = Tcb->SndUna;
+
   TcpBackoffRto (Tcb);
   TcpRetransmit (Tcb, Tcb->SndUna);
   TcpSetTimer (Tcb, TCP_TIMER_REXMIT, Tcb->Rto);
@@ -1,14 +1,16 @@
 /** @file
 
-  This driver produces Block I/O Protocol instances for virtio-blk devices.
+  This driver produces Block I/O and Block I/O 2 Protocol instances for
+  virtio-blk devices.
 
   The implementation is basic:
 
   - No attach/detach (ie. removable media).
 
-  - Although the non-blocking interfaces of EFI_BLOCK_IO2_PROTOCOL could be a
-    good match for multiple in-flight virtio-blk requests, we stick to
-    synchronous requests and EFI_BLOCK_IO_PROTOCOL for now.
+  - Multiple virtio-blk requests are in flight on the virtqueue at the same
+    time, each occupying a fixed slot of descriptors. Completions are polled
+    for -- by the caller of a synchronous request, and by a periodic timer for
+    the non-blocking interfaces of EFI_BLOCK_IO2_PROTOCOL.
 
   Copyright (C) 2012, Red Hat, Inc.
   Copyright (c) 2012 - 2018, Intel Corporation. All rights reserved.<BR>
@@ -19,6 +21,7 @@
 **/
 
 #include <IndustryStandard/VirtioBlk.h>
+#include <Library/BaseLib.h>
 #include <Library/BaseMemoryLib.h>
 #include <Library/DebugLib.h>
 #include <Library/MemoryAllocationLib.h>
@@ -178,279 +181,586 @@ VerifyReadWriteRequest (
 
 /**
 
-  Format a read / write / flush request as three consecutive virtio
-  descriptors, push them to the host, and poll for the response.
+  Complete a request received through EFI_BLOCK_IO_PROTOCOL or
+  EFI_BLOCK_IO2_PROTOCOL, after all of its virtio-blk requests have been
+  processed by the host, or could not be submitted.
 
-  This is the main workhorse function. Two use cases are supported, read/write
-  and flush. The function may only be called after the request parameters have
-  been verified by
-  - specific checks in ReadBlocks() / WriteBlocks() / FlushBlocks(), and
-  - VerifyReadWriteRequest() (for read/write only).
-
-  Parameters handled commonly:
-
-    @param[in] Dev             The virtio-blk device the request is targeted
-                               at.
+  Must be called at TPL_NOTIFY.
 
-  Flush request:
+  @param[in] Request  The request to complete. For an asynchronous request,
+                      Token->Event is signaled and Request is freed. For a
+                      synchronous request, the waiting caller of
+                      SubmitRequest() is responsible for freeing Request.
 
-    @param[in] Lba             Must be zero.
+**/
 
-    @param[in] BufferSize      Must be zero.
+STATIC
+VOID
+CompleteRequest (
+  IN VBLK_REQ *Request
+  )
+{
+  ASSERT (Request->Submitted);
+  ASSERT (Request->InFlight == 0);
 
-    @param[in out] Buffer      Ignored by the function.
+  if (Request->Token != NULL) {
+    Request->Token->TransactionStatus = Request->Status;
+    gBS->SignalEvent (Request->Token->Event);
+    FreePool (Request);
+  } else {
+    Request->Done = TRUE;
+  }
+}
 
-    @param[in] RequestIsWrite  Must be TRUE.
 
-  Read/Write request:
+/**
 
-    @param[in] Lba             Logical Block Address: number of logical blocks
-                               to skip from the beginning of the device.
+  Format the next virtio-blk request of a read / write / flush request as a
+  descriptor chain in a free slot, and make it available to the host.
 
-    @param[in] BufferSize      Size of buffer to transfer, in bytes. The caller
-                               is responsible to ensure this parameter is
-                               positive.
+  The host is not notified; that is the caller's responsibility.
 
-    @param[in out] Buffer      The guest side area to read data from the device
-                               into, or write data to the device from.
+  Must be called at TPL_NOTIFY, with at least one free slot.
 
-    @param[in] RequestIsWrite  TRUE iff data transfer goes from guest to
-                               device.
+  The virtio-blk request consists of the request header in the first
+  descriptor, the data buffer in at most (Dev->SlotDescCount - 2) descriptors
+  of at most Dev->MaxSegmentSize bytes each, and the host status in the last
+  descriptor. A flush request has no data buffer.
 
-  Return values are common to both use cases, and are appropriate to be
-  forwarded by the EFI_BLOCK_IO_PROTOCOL functions (ReadBlocks(),
-  WriteBlocks(), FlushBlocks()).
+  @param[in,out] Dev      The virtio-blk device the request is targeted at.
 
+  @param[in,out] Request  The request at the head of Dev->QueuedRequests. On
+                          output, the request is advanced past the submitted
+                          part, and removed from Dev->QueuedRequests if there
+                          is nothing left to submit.
 
-  @retval EFI_SUCCESS          Transfer complete.
+  @retval EFI_SUCCESS       The virtio-blk request has been made available to
+                            the host.
 
-  @retval EFI_DEVICE_ERROR     Failed to notify host side via VirtIo write, or
-                               unable to parse host response, or host response
-                               is not VIRTIO_BLK_S_OK or failed to map Buffer
-                               for a bus master operation.
+  @retval EFI_DEVICE_ERROR  Failed to map the data buffer for a bus master
+                            operation. Request has been failed and removed
+                            from Dev->QueuedRequests, and completed if it has
+                            no virtio-blk requests in flight.
 
 **/
 
 STATIC
 EFI_STATUS
-EFIAPI
-SynchronousRequest (
-  IN              VBLK_DEV *Dev,
-  IN              EFI_LBA  Lba,
-  IN              UINTN    BufferSize,
-  IN OUT volatile VOID     *Buffer,
-  IN              BOOLEAN  RequestIsWrite
+SubmitSlot (
+  IN OUT VBLK_DEV *Dev,
+  IN OUT VBLK_REQ *Request
   )
 {
-  UINT32                  BlockSize;
-  volatile VIRTIO_BLK_REQ Request;
-  volatile UINT8          *HostStatus;
-  VOID                    *HostStatusBuffer;
-  DESC_INDICES            Indices;
-  VOID                    *RequestMapping;
-  VOID                    *StatusMapping;
-  VOID                    *BufferMapping;
-  EFI_PHYSICAL_ADDRESS    BufferDeviceAddress;
-  EFI_PHYSICAL_ADDRESS    HostStatusDeviceAddress;
-  EFI_PHYSICAL_ADDRESS    RequestDeviceAddress;
-  EFI_STATUS              Status;
-  EFI_STATUS              UnmapStatus;
-
-  BlockSize = Dev->BlockIoMedia.BlockSize;
-
-  //
-  // Set BufferMapping and BufferDeviceAddress to suppress incorrect
-  // compiler/analyzer warnings.
-  //
-  BufferMapping       = NULL;
-  BufferDeviceAddress = 0;
-
-  //
-  // ensured by VirtioBlkInit()
-  //
-  ASSERT (BlockSize > 0);
-  ASSERT (BlockSize % 512 == 0);
-
-  //
-  // ensured by contract above, plus VerifyReadWriteRequest()
-  //
-  ASSERT (BufferSize % BlockSize == 0);
+  UINT16                   Slot;
+  volatile VBLK_SHARED_REQ *SharedReq;
+  EFI_PHYSICAL_ADDRESS     SharedReqDeviceAddress;
+  UINTN                    TransferSize;
+  UINTN                    Remaining;
+  UINT32                   SegmentSize;
+  VOID                     *BufferMapping;
+  EFI_PHYSICAL_ADDRESS     BufferDeviceAddress;
+  DESC_INDICES             Indices;
+  UINT16                   NextAvailIdx;
+  EFI_STATUS               Status;
 
-  //
-  // Prepare virtio-blk request header, setting zero size for flush.
-  // IO Priority is homogeneously 0.
-  //
-  Request.Type   = RequestIsWrite ?
-                   (BufferSize == 0 ? VIRTIO_BLK_T_FLUSH : VIRTIO_BLK_T_OUT) :
-                   VIRTIO_BLK_T_IN;
-  Request.IoPrio = 0;
-  Request.Sector = MultU64x32(Lba, BlockSize / 512);
+  ASSERT (Dev->FreeSlotCount > 0);
 
   //
-  // Host status is bi-directional (we preset with a value and expect the
-  // device to update it). Allocate a host status buffer which can be mapped
-  // to access equally by both processor and the device.
+  // Map the data buffer first, so that a failure leaves the slot free.
   //
-  Status = Dev->VirtIo->AllocateSharedPages (
-                          Dev->VirtIo,
-                          EFI_SIZE_TO_PAGES (sizeof *HostStatus),
-                          &HostStatusBuffer
-                          );
-  if (EFI_ERROR (Status)) {
-    return EFI_DEVICE_ERROR;
-  }
-
-  HostStatus = HostStatusBuffer;
-
-  //
-  // Map virtio-blk request header (must be done after request header is
-  // populated)
-  //
-  Status = VirtioMapAllBytesInSharedBuffer (
-             Dev->VirtIo,
-             VirtioOperationBusMasterRead,
-             (VOID *) &Request,
-             sizeof Request,
-             &RequestDeviceAddress,
-             &RequestMapping
-             );
-  if (EFI_ERROR (Status)) {
-    Status = EFI_DEVICE_ERROR;
-    goto FreeHostStatusBuffer;
-  }
-
-  //
-  // Map data buffer
-  //
-  if (BufferSize > 0) {
+  TransferSize  = MIN (Request->BufferSize, Dev->MaxTransferSize);
+  BufferMapping = NULL;
+  BufferDeviceAddress = 0;
+  if (TransferSize > 0) {
     Status = VirtioMapAllBytesInSharedBuffer (
                Dev->VirtIo,
-               (RequestIsWrite ?
+               (Request->RequestIsWrite ?
                 VirtioOperationBusMasterRead :
                 VirtioOperationBusMasterWrite),
-               (VOID *) Buffer,
-               BufferSize,
+               Request->Buffer,
+               TransferSize,
                &BufferDeviceAddress,
                &BufferMapping
                );
     if (EFI_ERROR (Status)) {
-      Status = EFI_DEVICE_ERROR;
-      goto UnmapRequestBuffer;
+      Request->Status    = EFI_DEVICE_ERROR;
+      Request->Submitted = TRUE;
+      RemoveEntryList (&Request->Link);
+      if (Request->InFlight == 0) {
+        CompleteRequest (Request);
+      }
+      return EFI_DEVICE_ERROR;
     }
   }
 
-  //
-  // preset a host status for ourselves that we do not accept as success
-  //
-  *HostStatus = VIRTIO_BLK_S_IOERR;
+  Slot = Dev->FreeSlotStack[--Dev->FreeSlotCount];
+  Dev->Slots[Slot].Request       = Request;
+  Dev->Slots[Slot].BufferMapping = BufferMapping;
+  Dev->Slots[Slot].BufferSize    = TransferSize;
 
   //
-  // Map the Status Buffer with VirtioOperationBusMasterCommonBuffer so that
-  // both processor and device can access it.
+  // Prepare the virtio-blk request header, and preset a host status that we
+  // do not accept as success. IO Priority is homogeneously 0.
   //
-  Status = VirtioMapAllBytesInSharedBuffer (
-             Dev->VirtIo,
-             VirtioOperationBusMasterCommonBuffer,
-             HostStatusBuffer,
-             sizeof *HostStatus,
-             &HostStatusDeviceAddress,
-             &StatusMapping
-             );
-  if (EFI_ERROR (Status)) {
-    Status = EFI_DEVICE_ERROR;
-    goto UnmapDataBuffer;
-  }
+  SharedReq = &Dev->SharedReqs[Slot];
+  SharedReq->Request.Type   = Request->IsFlush ?
+                              VIRTIO_BLK_T_FLUSH :
+                              (Request->RequestIsWrite ?
+                               VIRTIO_BLK_T_OUT :
+                               VIRTIO_BLK_T_IN);
+  SharedReq->Request.IoPrio = 0;
+  SharedReq->Request.Sector = MultU64x32 (
+                                Request->Lba,
+                                Dev->BlockIoMedia.BlockSize / 512
+                                );
+  SharedReq->HostStatus     = VIRTIO_BLK_S_IOERR;
 
-  VirtioPrepare (&Dev->Ring, &Indices);
+  SharedReqDeviceAddress = Dev->SharedReqsDeviceAddress +
+                           Slot * sizeof (VBLK_SHARED_REQ);
 
   //
-  // ensured by VirtioBlkInit() -- this predicate, in combination with the
-  // lock-step progress, ensures we don't have to track free descriptors.
+  // Each slot owns a fixed range of Dev->SlotDescCount descriptors, so the
+  // head descriptor identifies the slot when the host returns the chain.
   //
-  ASSERT (Dev->Ring.QueueSize >= 3);
+  Indices.HeadDescIdx = (UINT16) (Slot * Dev->SlotDescCount);
+  Indices.NextDescIdx = Indices.HeadDescIdx;
 
   //
   // virtio-blk header in first desc
   //
   VirtioAppendDesc (
     &Dev->Ring,
-    RequestDeviceAddress,
-    sizeof Request,
+    SharedReqDeviceAddress + OFFSET_OF (VBLK_SHARED_REQ, Request),
+    sizeof (VIRTIO_BLK_REQ),
     VRING_DESC_F_NEXT,
     &Indices
     );
 
   //
-  // data buffer for read/write in second desc
+  // data buffer for read/write in the middle descs; VRING_DESC_F_WRITE is
+  // interpreted from the host's point of view. TransferSize is at most
+  // (Dev->SlotDescCount - 2) * Dev->MaxSegmentSize, ensured by
+  // VirtioBlkInit().
   //
-  if (BufferSize > 0) {
-    //
-    // From virtio-0.9.5, 2.3.2 Descriptor Table:
-    // "no descriptor chain may be more than 2^32 bytes long in total".
-    //
-    // The predicate is ensured by the call contract above (for flush), or
-    // VerifyReadWriteRequest() (for read/write). It also implies that
-    // converting BufferSize to UINT32 will not truncate it.
-    //
-    ASSERT (BufferSize <= SIZE_1GB);
-
-    //
-    // VRING_DESC_F_WRITE is interpreted from the host's point of view.
-    //
+  Remaining = TransferSize;
+  while (Remaining > 0) {
+    SegmentSize = (UINT32) MIN (Remaining, Dev->MaxSegmentSize);
     VirtioAppendDesc (
       &Dev->Ring,
       BufferDeviceAddress,
-      (UINT32) BufferSize,
-      VRING_DESC_F_NEXT | (RequestIsWrite ? 0 : VRING_DESC_F_WRITE),
+      SegmentSize,
+      VRING_DESC_F_NEXT | (Request->RequestIsWrite ? 0 : VRING_DESC_F_WRITE),
       &Indices
       );
+    BufferDeviceAddress += SegmentSize;
+    Remaining           -= SegmentSize;
   }
+  ASSERT ((UINT16) (Indices.NextDescIdx - Indices.HeadDescIdx) <
+          Dev->SlotDescCount);
 
   //
-  // host status in last (second or third) desc
+  // host status in last desc
   //
   VirtioAppendDesc (
     &Dev->Ring,
-    HostStatusDeviceAddress,
-    sizeof *HostStatus,
+    SharedReqDeviceAddress + OFFSET_OF (VBLK_SHARED_REQ, HostStatus),
+    sizeof SharedReq->HostStatus,
     VRING_DESC_F_WRITE,
     &Indices
     );
 
   //
-  // virtio-blk's only virtqueue is #0, called "requestq" (see Appendix D).
+  // virtio-0.9.5, 2.4.1.2 Updating the Available Ring, and 2.4.1.3 Updating
+  // the Index Field.
   //
-  if (VirtioFlush (Dev->VirtIo, 0, &Dev->Ring, &Indices,
-        NULL) == EFI_SUCCESS &&
-      *HostStatus == VIRTIO_BLK_S_OK) {
-    Status = EFI_SUCCESS;
-  } else {
-    Status = EFI_DEVICE_ERROR;
+  NextAvailIdx = *Dev->Ring.Avail.Idx;
+  Dev->Ring.Avail.Ring[NextAvailIdx++ % Dev->Ring.QueueSize] =
+    Indices.HeadDescIdx;
+  MemoryFence ();
+  *Dev->Ring.Avail.Idx = NextAvailIdx;
+
+  //
+  // Advance the request past the submitted part.
+  //
+  Request->InFlight++;
+  Request->Lba        += TransferSize / Dev->BlockIoMedia.BlockSize;
+  Request->Buffer     += TransferSize;
+  Request->BufferSize -= TransferSize;
+  if (Request->BufferSize == 0) {
+    Request->Submitted = TRUE;
+    RemoveEntryList (&Request->Link);
   }
 
-  Dev->VirtIo->UnmapSharedBuffer (Dev->VirtIo, StatusMapping);
+  return EFI_SUCCESS;
+}
 
-UnmapDataBuffer:
-  if (BufferSize > 0) {
-    UnmapStatus = Dev->VirtIo->UnmapSharedBuffer (Dev->VirtIo, BufferMapping);
-    if (EFI_ERROR (UnmapStatus) && !RequestIsWrite && !EFI_ERROR (Status)) {
-      //
-      // Data from the bus master may not reach the caller; fail the request.
-      //
-      Status = EFI_DEVICE_ERROR;
+
+/**
+
+  Submit virtio-blk requests from the queued read / write / flush requests
+  while there are free slots, and notify the host.
+
+  Requests are submitted in order. A flush request is submitted only when no
+  virtio-blk request is in flight, so that it covers all writes queued before
+  it; later requests wait behind the flush request until it is submitted.
+
+  Must be called at TPL_NOTIFY.
+
+  @param[in,out] Dev  The virtio-blk device to submit requests to.
+
+**/
+
+STATIC
+VOID
+SubmitQueuedRequests (
+  IN OUT VBLK_DEV *Dev
+  )
+{
+  VBLK_REQ   *Request;
+  BOOLEAN    Notify;
+  EFI_STATUS Status;
+
+  Notify = FALSE;
+  while (!IsListEmpty (&Dev->QueuedRequests) && Dev->FreeSlotCount > 0) {
+    Request = VBLK_REQ_FROM_LINK (GetFirstNode (&Dev->QueuedRequests));
+    if (Request->IsFlush && Dev->FreeSlotCount < Dev->NumSlots) {
+      break;
+    }
+
+    Status = SubmitSlot (Dev, Request);
+    if (!EFI_ERROR (Status)) {
+      Notify = TRUE;
     }
   }
 
-UnmapRequestBuffer:
-  Dev->VirtIo->UnmapSharedBuffer (Dev->VirtIo, RequestMapping);
+  if (!Notify) {
+    return;
+  }
 
-FreeHostStatusBuffer:
-  Dev->VirtIo->FreeSharedPages (
-                 Dev->VirtIo,
-                 EFI_SIZE_TO_PAGES (sizeof *HostStatus),
-                 HostStatusBuffer
-                 );
+  //
+  // virtio-0.9.5, 2.4.1.4 Notifying the Device -- gratuitous notifications are
+  // OK. virtio-blk's only virtqueue is #0, called "requestq" (see Appendix D).
+  //
+  MemoryFence ();
+  Status = Dev->VirtIo->SetQueueNotify (Dev->VirtIo, 0);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "%a: SetQueueNotify(): %r\n", __FUNCTION__, Status));
+  }
+}
+
+
+/**
+
+  Process the descriptor chains that the host has returned in the used ring,
+  releasing their slots, and complete the read / write / flush requests that
+  have no more virtio-blk requests to submit or in flight.
+
+  Must be called at TPL_NOTIFY.
+
+  @param[in,out] Dev  The virtio-blk device to process completions for.
+
+**/
+
+STATIC
+VOID
+ReapCompletedRequests (
+  IN OUT VBLK_DEV *Dev
+  )
+{
+  volatile CONST VRING_USED_ELEM *UsedElem;
+  UINT32                         HeadDescIdx;
+  UINT16                         Slot;
+  VBLK_REQ                       *Request;
+  EFI_STATUS                     UnmapStatus;
+
+  //
+  // virtio-0.9.5, 2.4.2 Receiving Used Buffers From the Device
+  //
+  MemoryFence ();
+  while (Dev->LastUsedIdx != *Dev->Ring.Used.Idx) {
+    MemoryFence ();
+    UsedElem    = &Dev->Ring.Used.UsedElem[Dev->LastUsedIdx++ %
+                                           Dev->Ring.QueueSize];
+    HeadDescIdx = UsedElem->Id;
+    Slot        = (UINT16) (HeadDescIdx / Dev->SlotDescCount);
+    if (HeadDescIdx % Dev->SlotDescCount != 0 || Slot >= Dev->NumSlots ||
+        Dev->Slots[Slot].Request == NULL) {
+      DEBUG ((DEBUG_ERROR, "%a: unexpected used descriptor %u\n",
+        __FUNCTION__, HeadDescIdx));
+      ASSERT (FALSE);
+      continue;
+    }
 
+    Request = Dev->Slots[Slot].Request;
+    if (Dev->SharedReqs[Slot].HostStatus != VIRTIO_BLK_S_OK) {
+      Request->Status = EFI_DEVICE_ERROR;
+    }
+
+    if (Dev->Slots[Slot].BufferSize > 0) {
+      UnmapStatus = Dev->VirtIo->UnmapSharedBuffer (
+                                   Dev->VirtIo,
+                                   Dev->Slots[Slot].BufferMapping
+                                   );
+      if (EFI_ERROR (UnmapStatus) && !Request->RequestIsWrite) {
+        //
+        // Data from the bus master may not reach the caller; fail the request.
+        //
+        Request->Status = EFI_DEVICE_ERROR;
+      }
+    }
+
+    Dev->Slots[Slot].Request = NULL;
+    Dev->FreeSlotStack[Dev->FreeSlotCount++] = Slot;
+
+    Request->InFlight--;
+    if (Request->Submitted && Request->InFlight == 0) {
+      CompleteRequest (Request);
+    }
+  }
+}
+
+
+/**
+
+  Arm the periodic timer when read / write / flush requests are queued or in
+  flight, and cancel it when the device becomes idle, so that an idle device
+  costs no timer interrupts.
+
+  Must be called at TPL_NOTIFY, after the queued and the completed requests
+  have been processed.
+
+  @param[in,out] Dev  The virtio-blk device to update the timer of.
+
+**/
+
+STATIC
+VOID
+UpdateAsyncTimer (
+  IN OUT VBLK_DEV *Dev
+  )
+{
+  BOOLEAN    Busy;
+  EFI_STATUS Status;
+
+  Busy = (BOOLEAN) (!IsListEmpty (&Dev->QueuedRequests) ||
+                    Dev->FreeSlotCount < Dev->NumSlots);
+  if (Busy == Dev->AsyncTimerArmed) {
+    return;
+  }
+
+  Status = gBS->SetTimer (
+                  Dev->AsyncTimer,
+                  Busy ? TimerPeriodic : TimerCancel,
+                  Busy ? VBLK_ASYNC_TIMER : 0
+                  );
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "%a: SetTimer(): %r\n", __FUNCTION__, Status));
+    return;
+  }
+  Dev->AsyncTimerArmed = Busy;
+}
+
+
+/**
+
+  Notification function of the periodic timer that drives the virtio-blk
+  requests in flight, at TPL_NOTIFY.
+
+  @param[in] Event    Event whose notification function is being invoked.
+
+  @param[in] Context  Pointer to the VBLK_DEV structure.
+
+**/
+
+STATIC
+VOID
+EFIAPI
+VirtioBlkAsyncTimer (
+  IN  EFI_EVENT Event,
+  IN  VOID      *Context
+  )
+{
+  VBLK_DEV *Dev;
+
+  Dev = Context;
+  ReapCompletedRequests (Dev);
+  SubmitQueuedRequests (Dev);
+  UpdateAsyncTimer (Dev);
+}
+
+
+/**
+
+  Poll the virtio ring until a synchronous request completes, or until no
+  request is queued or in flight.
+
+  @param[in,out] Dev      The virtio-blk device to poll.
+
+  @param[in]     Request  The synchronous request to wait for. If NULL, wait
+                          for all requests of Dev.
+
+**/
+
+STATIC
+VOID
+WaitForRequests (
+  IN OUT VBLK_DEV *Dev,
+  IN     VBLK_REQ *Request OPTIONAL
+  )
+{
+  EFI_TPL OldTpl;
+  UINTN   PollPeriodUsecs;
+
+  //
+  // Keep slowing down until we reach a poll period of slightly above 1 ms.
+  //
+  PollPeriodUsecs = 1;
+  OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
+  for (;;) {
+    ReapCompletedRequests (Dev);
+    SubmitQueuedRequests (Dev);
+    if (Request != NULL ?
+        Request->Done :
+        (IsListEmpty (&Dev->QueuedRequests) &&
+         Dev->FreeSlotCount == Dev->NumSlots)) {
+      UpdateAsyncTimer (Dev);
+      break;
+    }
+    gBS->RestoreTPL (OldTpl);
+
+    gBS->Stall (PollPeriodUsecs); // calls AcpiTimerLib::MicroSecondDelay
+    if (PollPeriodUsecs < 1024) {
+      PollPeriodUsecs *= 2;
+    }
+
+    OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
+  }
+  gBS->RestoreTPL (OldTpl);
+}
+
+
+/**
+
+  Queue a read / write / flush request for submission to the host as one or
+  more virtio-blk requests, and wait for its completion if it is synchronous.
+
+  Up to Dev->NumSlots virtio-blk requests, from any number of read / write /
+  flush requests, are in flight at the same time. Completed virtio-blk
+  requests are reaped either by the periodic timer, or by the caller of a
+  synchronous request while it waits.
+
+  The function may only be called after the request parameters have been
+  verified by
+  - specific checks in ReadBlocks() / WriteBlocks() / FlushBlocks() and their
+    EFI_BLOCK_IO2_PROTOCOL counterparts, and
+  - VerifyReadWriteRequest() (for read/write only).
+
+  Parameters handled commonly:
+
+    @param[in] Dev             The virtio-blk device the request is targeted
+                               at.
+
+    @param[in] Token           NULL for a synchronous request. Otherwise the
+                               token of an asynchronous request, with a
+                               non-NULL Event.
+
+  Flush request:
+
+    @param[in] Lba             Must be zero.
+
+    @param[in] BufferSize      Must be zero.
+
+    @param[in out] Buffer      Ignored by the function.
+
+    @param[in] RequestIsWrite  Must be TRUE.
+
+  Read/Write request:
+
+    @param[in] Lba             Logical Block Address: number of logical blocks
+                               to skip from the beginning of the device.
+
+    @param[in] BufferSize      Size of buffer to transfer, in bytes. The caller
+                               is responsible to ensure this parameter is
+                               positive.
+
+    @param[in out] Buffer      The guest side area to read data from the device
+                               into, or write data to the device from.
+
+    @param[in] RequestIsWrite  TRUE iff data transfer goes from guest to
+                               device.
+
+  Return values are common to both use cases, and are appropriate to be
+  forwarded by the EFI_BLOCK_IO_PROTOCOL and EFI_BLOCK_IO2_PROTOCOL functions.
+  For an asynchronous request, the outcome of the transfer is reported in
+  Token->TransactionStatus.
+
+
+  @retval EFI_SUCCESS           Transfer complete (synchronous request), or
+                                request queued (asynchronous request).
+
+  @retval EFI_OUT_OF_RESOURCES  Failed to allocate the request.
+
+  @retval EFI_DEVICE_ERROR      Failed to map Buffer for a bus master
+                                operation, or host response is not
+                                VIRTIO_BLK_S_OK (synchronous request only).
+
+**/
+
+STATIC
+EFI_STATUS
+SubmitRequest (
+  IN     VBLK_DEV            *Dev,
+  IN     EFI_LBA             Lba,
+  IN     UINTN               BufferSize,
+  IN OUT VOID                *Buffer,
+  IN     BOOLEAN             RequestIsWrite,
+  IN     EFI_BLOCK_IO2_TOKEN *Token          OPTIONAL
+  )
+{
+  VBLK_REQ   *Request;
+  EFI_TPL    OldTpl;
+  EFI_STATUS Status;
+
+  //
+  // ensured by VirtioBlkInit()
+  //
+  ASSERT (Dev->BlockIoMedia.BlockSize > 0);
+  ASSERT (Dev->BlockIoMedia.BlockSize % 512 == 0);
+
+  //
+  // ensured by contract above, plus VerifyReadWriteRequest()
+  //
+  ASSERT (BufferSize % Dev->BlockIoMedia.BlockSize == 0);
+  ASSERT (BufferSize > 0 || RequestIsWrite);
+
+  Request = AllocateZeroPool (sizeof *Request);
+  if (Request == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+  Request->Signature      = VBLK_REQ_SIG;
+  Request->Token          = Token;
+  Request->Lba            = Lba;
+  Request->Buffer         = Buffer;
+  Request->BufferSize     = BufferSize;
+  Request->RequestIsWrite = RequestIsWrite;
+  Request->IsFlush        = (BOOLEAN) (BufferSize == 0);
+  Request->Status         = EFI_SUCCESS;
+
+  OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
+  InsertTailList (&Dev->QueuedRequests, &Request->Link);
+  SubmitQueuedRequests (Dev);
+  if (Token != NULL) {
+    UpdateAsyncTimer (Dev);
+  }
+  gBS->RestoreTPL (OldTpl);
+
+  if (Token != NULL) {
+    return EFI_SUCCESS;
+  }
+
+  WaitForRequests (Dev, Request);
+  Status = Request->Status;
+  FreePool (Request);
   return Status;
 }
 
@@ -466,7 +776,7 @@ FreeHostStatusBuffer:
     ReadBlocksEx() Implementation.
 
   Parameter checks and conformant return values are implemented in
-  VerifyReadWriteRequest() and SynchronousRequest().
+  VerifyReadWriteRequest() and SubmitRequest().
 
   A zero BufferSize doesn't seem to be prohibited, so do nothing in that case,
   successfully.
@@ -501,12 +811,13 @@ VirtioBlkReadBlocks (
     return Status;
   }
 
-  return SynchronousRequest (
+  return SubmitRequest (
            Dev,
            Lba,
            BufferSize,
            Buffer,
-           FALSE       // RequestIsWrite
+           FALSE,      // RequestIsWrite
+           NULL        // Token
            );
 }
 
@@ -521,7 +832,7 @@ VirtioBlkReadBlocks (
     WriteBlockEx() Implementation.
 
   Parameter checks and conformant return values are implemented in
-  VerifyReadWriteRequest() and SynchronousRequest().
+  VerifyReadWriteRequest() and SubmitRequest().
 
   A zero BufferSize doesn't seem to be prohibited, so do nothing in that case,
   successfully.
@@ -556,12 +867,13 @@ VirtioBlkWriteBlocks (
     return Status;
   }
 
-  return SynchronousRequest (
+  return SubmitRequest (
            Dev,
            Lba,
            BufferSize,
            Buffer,
-           TRUE        // RequestIsWrite
+           TRUE,      // RequestIsWrite
+           NULL        // Token
            );
 }
 
@@ -593,17 +905,214 @@ VirtioBlkFlushBlocks (
 
   Dev = VIRTIO_BLK_FROM_BLOCK_IO (This);
   return Dev->BlockIoMedia.WriteCaching ?
-           SynchronousRequest (
+           SubmitRequest (
              Dev,
              0,    // Lba
              0,    // BufferSize
              NULL, // Buffer
-             TRUE  // RequestIsWrite
+             TRUE, // RequestIsWrite
+             NULL  // Token
              ) :
            EFI_SUCCESS;
 }
 
 
+//
+// UEFI Spec 2.4, 13.10 EFI Block I/O 2 Protocol
+//
+EFI_STATUS
+EFIAPI
+VirtioBlkResetEx (
+  IN EFI_BLOCK_IO2_PROTOCOL *This,
+  IN BOOLEAN                ExtendedVerification
+  )
+{
+  //
+  // If we managed to initialize and install the driver, then the device is
+  // working correctly. Let the requests in flight run to completion.
+  //
+  WaitForRequests (VIRTIO_BLK_FROM_BLOCK_IO2 (This), NULL);
+  return EFI_SUCCESS;
+}
+
+
+/**
+
+  Finish a BlockIo2 request that requires no data transfer, such as a zero
+  BufferSize read or write, or a flush on a device without write caching.
+
+  @param[in,out] Token  The token of the request, or NULL.
+
+  @retval EFI_SUCCESS  Always.
+
+**/
+
+STATIC
+EFI_STATUS
+CompleteEmptyRequest (
+  IN OUT EFI_BLOCK_IO2_TOKEN *Token OPTIONAL
+  )
+{
+  if (Token != NULL && Token->Event != NULL) {
+    Token->TransactionStatus = EFI_SUCCESS;
+    gBS->SignalEvent (Token->Event);
+  }
+  return EFI_SUCCESS;
+}
+
+
+/**
+
+  ReadBlocksEx() operation for virtio-blk.
+
+  See
+  - UEFI Spec 2.4, 13.10 EFI Block I/O 2 Protocol,
+    EFI_BLOCK_IO2_PROTOCOL.ReadBlocksEx().
+  - Driver Writer's Guide for UEFI 2.3.1 v1.01, 24.2.2. ReadBlocks() and
+    ReadBlocksEx() Implementation.
+
+  If Token is NULL, or Token->Event is NULL, the request is carried out
+  synchronously, like ReadBlocks(). Otherwise the request is queued, and
+  Token->Event is signaled once the request completes.
+
+**/
+
+EFI_STATUS
+EFIAPI
+VirtioBlkReadBlocksEx (
+  IN     EFI_BLOCK_IO2_PROTOCOL *This,
+  IN     UINT32                 MediaId,
+  IN     EFI_LBA                Lba,
+  IN OUT EFI_BLOCK_IO2_TOKEN    *Token,
+  IN     UINTN                  BufferSize,
+  OUT    VOID                   *Buffer
+  )
+{
+  VBLK_DEV   *Dev;
+  EFI_STATUS Status;
+
+  if (BufferSize == 0) {
+    return CompleteEmptyRequest (Token);
+  }
+
+  Dev = VIRTIO_BLK_FROM_BLOCK_IO2 (This);
+  Status = VerifyReadWriteRequest (
+             &Dev->BlockIoMedia,
+             Lba,
+             BufferSize,
+             FALSE               // RequestIsWrite
+             );
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  return SubmitRequest (
+           Dev,
+           Lba,
+           BufferSize,
+           Buffer,
+           FALSE,      // RequestIsWrite
+           (Token != NULL && Token->Event != NULL) ? Token : NULL
+           );
+}
+
+
+/**
+
+  WriteBlocksEx() operation for virtio-blk.
+
+  See
+  - UEFI Spec 2.4, 13.10 EFI Block I/O 2 Protocol,
+    EFI_BLOCK_IO2_PROTOCOL.WriteBlocksEx().
+  - Driver Writer's Guide for UEFI 2.3.1 v1.01, 24.2.3 WriteBlocks() and
+    WriteBlockEx() Implementation.
+
+  If Token is NULL, or Token->Event is NULL, the request is carried out
+  synchronously, like WriteBlocks(). Otherwise the request is queued, and
+  Token->Event is signaled once the request completes.
+
+**/
+
+EFI_STATUS
+EFIAPI
+VirtioBlkWriteBlocksEx (
+  IN     EFI_BLOCK_IO2_PROTOCOL *This,
+  IN     UINT32                 MediaId,
+  IN     EFI_LBA                Lba,
+  IN OUT EFI_BLOCK_IO2_TOKEN    *Token,
+  IN     UINTN                  BufferSize,
+  IN     VOID                   *Buffer
+  )
+{
+  VBLK_DEV   *Dev;
+  EFI_STATUS Status;
+
+  if (BufferSize == 0) {
+    return CompleteEmptyRequest (Token);
+  }
+
+  Dev = VIRTIO_BLK_FROM_BLOCK_IO2 (This);
+  Status = VerifyReadWriteRequest (
+             &Dev->BlockIoMedia,
+             Lba,
+             BufferSize,
+             TRUE                // RequestIsWrite
+             );
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  return SubmitRequest (
+           Dev,
+           Lba,
+           BufferSize,
+           Buffer,
+           TRUE,       // RequestIsWrite
+           (Token != NULL && Token->Event != NULL) ? Token : NULL
+           );
+}
+
+
+/**
+
+  FlushBlocksEx() operation for virtio-blk.
+
+  See
+  - UEFI Spec 2.4, 13.10 EFI Block I/O 2 Protocol,
+    EFI_BLOCK_IO2_PROTOCOL.FlushBlocksEx().
+  - Driver Writer's Guide for UEFI 2.3.1 v1.01, 24.2.4 FlushBlocks() and
+    FlushBlocksEx() Implementation.
+
+  The flush is submitted to the device only after all read and write requests
+  queued before it have completed.
+
+**/
+
+EFI_STATUS
+EFIAPI
+VirtioBlkFlushBlocksEx (
+  IN     EFI_BLOCK_IO2_PROTOCOL *This,
+  IN OUT EFI_BLOCK_IO2_TOKEN    *Token
+  )
+{
+  VBLK_DEV *Dev;
+
+  Dev = VIRTIO_BLK_FROM_BLOCK_IO2 (This);
+  if (!Dev->BlockIoMedia.WriteCaching) {
+    return CompleteEmptyRequest (Token);
+  }
+
+  return SubmitRequest (
+           Dev,
+           0,    // Lba
+           0,    // BufferSize
+           NULL, // Buffer
+           TRUE, // RequestIsWrite
+           (Token != NULL && Token->Event != NULL) ? Token : NULL
+           );
+}
+
+
 /**
 
   Device probe function for this driver.
@@ -685,6 +1194,111 @@ VirtioBlkDriverBindingSupported (
 }
 
 
+/**
+
+  Allocate and map the request headers and host status bytes that the slots of
+  descriptors share with the device, and mark all slots free.
+
+  @param[in,out] Dev  The driver instance. Dev->NumSlots must be set.
+
+  @retval EFI_SUCCESS  Setup complete.
+
+  @return              Error codes from VirtIo->AllocateSharedPages() or
+                       VirtioMapAllBytesInSharedBuffer().
+
+**/
+
+STATIC
+EFI_STATUS
+VirtioBlkInitSlots (
+  IN OUT VBLK_DEV *Dev
+  )
+{
+  EFI_STATUS Status;
+  VOID       *SharedReqs;
+  UINTN      SharedReqsSize;
+  UINT16     Slot;
+
+  ASSERT (Dev->NumSlots > 0);
+  ASSERT (Dev->NumSlots <= VBLK_MAX_IN_FLIGHT);
+
+  SharedReqsSize = Dev->NumSlots * sizeof (VBLK_SHARED_REQ);
+  Status = Dev->VirtIo->AllocateSharedPages (
+                          Dev->VirtIo,
+                          EFI_SIZE_TO_PAGES (SharedReqsSize),
+                          &SharedReqs
+                          );
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+  ZeroMem (SharedReqs, SharedReqsSize);
+
+  //
+  // The host status is bi-directional (we preset it with a value and expect
+  // the device to update it), so map the area as a common buffer.
+  //
+  Status = VirtioMapAllBytesInSharedBuffer (
+             Dev->VirtIo,
+             VirtioOperationBusMasterCommonBuffer,
+             SharedReqs,
+             SharedReqsSize,
+             &Dev->SharedReqsDeviceAddress,
+             &Dev->SharedReqsMap
+             );
+  if (EFI_ERROR (Status)) {
+    Dev->VirtIo->FreeSharedPages (
+                   Dev->VirtIo,
+                   EFI_SIZE_TO_PAGES (SharedReqsSize),
+                   SharedReqs
+                   );
+    return Status;
+  }
+  Dev->SharedReqs = SharedReqs;
+
+  for (Slot = 0; Slot < Dev->NumSlots; Slot++) {
+    Dev->Slots[Slot].Request = NULL;
+    Dev->FreeSlotStack[Slot] = (UINT16) (Dev->NumSlots - 1 - Slot);
+  }
+  Dev->FreeSlotCount = Dev->NumSlots;
+  Dev->LastUsedIdx   = 0;
+  InitializeListHead (&Dev->QueuedRequests);
+
+  //
+  // Completions are polled for, the host should not send interrupts.
+  //
+  *Dev->Ring.Avail.Flags = (UINT16) VRING_AVAIL_F_NO_INTERRUPT;
+  return EFI_SUCCESS;
+}
+
+
+/**
+
+  Release the resources set up by VirtioBlkInitSlots(). The host must have
+  been reset, so that it no longer accesses the slots.
+
+  @param[in,out] Dev  The driver instance.
+
+**/
+
+STATIC
+VOID
+VirtioBlkUninitSlots (
+  IN OUT VBLK_DEV *Dev
+  )
+{
+  ASSERT (IsListEmpty (&Dev->QueuedRequests));
+
+  Dev->VirtIo->UnmapSharedBuffer (Dev->VirtIo, Dev->SharedReqsMap);
+  Dev->VirtIo->FreeSharedPages (
+                 Dev->VirtIo,
+                 EFI_SIZE_TO_PAGES (Dev->NumSlots * sizeof (VBLK_SHARED_REQ)),
+                 (VOID *) Dev->SharedReqs
+                 );
+  Dev->SharedReqs    = NULL;
+  Dev->FreeSlotCount = 0;
+}
+
+
 /**
 
   Set up all BlockIo and virtio-blk aspects of this driver for the specified
@@ -701,7 +1315,7 @@ VirtioBlkDriverBindingSupported (
 
   @return                  Error codes from VirtioRingInit() or
                            VIRTIO_CFG_READ() / VIRTIO_CFG_WRITE or
-                           VirtioRingMap().
+                           VirtioRingMap() or VirtioBlkInitSlots().
 
 **/
 
@@ -721,12 +1335,17 @@ VirtioBlkInit (
   UINT8      PhysicalBlockExp;
   UINT8      AlignmentOffset;
   UINT32     OptIoSize;
+  UINT32     SizeMax;
+  UINT32     SegMax;
   UINT16     QueueSize;
   UINT64     RingBaseShift;
+  UINT32     MaxSegments;
 
   PhysicalBlockExp = 0;
   AlignmentOffset = 0;
   OptIoSize = 0;
+  SizeMax = 0;
+  SegMax = 0;
 
   //
   // Execute virtio-0.9.5, 2.2.1 Device Initialization Sequence.
@@ -815,8 +1434,33 @@ VirtioBlkInit (
     }
   }
 
+  //
+  // A zero limit on the segment size or on the segment count is not useful;
+  // don't negotiate such a feature.
+  //
+  if (Features & VIRTIO_BLK_F_SIZE_MAX) {
+    Status = VIRTIO_CFG_READ (Dev, SizeMax, &SizeMax);
+    if (EFI_ERROR (Status)) {
+      goto Failed;
+    }
+    if (SizeMax == 0) {
+      Features &= ~(UINT64)VIRTIO_BLK_F_SIZE_MAX;
+    }
+  }
+
+  if (Features & VIRTIO_BLK_F_SEG_MAX) {
+    Status = VIRTIO_CFG_READ (Dev, SegMax, &SegMax);
+    if (EFI_ERROR (Status)) {
+      goto Failed;
+    }
+    if (SegMax == 0) {
+      Features &= ~(UINT64)VIRTIO_BLK_F_SEG_MAX;
+    }
+  }
+
   Features &= VIRTIO_BLK_F_BLK_SIZE | VIRTIO_BLK_F_TOPOLOGY | VIRTIO_BLK_F_RO |
-              VIRTIO_BLK_F_FLUSH | VIRTIO_F_VERSION_1 |
+              VIRTIO_BLK_F_FLUSH | VIRTIO_BLK_F_SIZE_MAX |
+              VIRTIO_BLK_F_SEG_MAX | VIRTIO_F_VERSION_1 |
               VIRTIO_F_IOMMU_PLATFORM;
 
   //
@@ -841,11 +1485,49 @@ VirtioBlkInit (
   if (EFI_ERROR (Status)) {
     goto Failed;
   }
-  if (QueueSize < 3) { // SynchronousRequest() uses at most three descriptors
+  if (QueueSize < 3) { // a virtio-blk request needs at least three descriptors
+    Status = EFI_UNSUPPORTED;
+    goto Failed;
+  }
+
+  //
+  // Determine how a request is laid out in a slot of descriptors: the request
+  // header, at most MaxSegments data segments of at most Dev->MaxSegmentSize
+  // bytes each, and the host status. Without VIRTIO_BLK_F_SIZE_MAX, a single
+  // data segment covers the largest request we submit (see
+  // VerifyReadWriteRequest()); without VIRTIO_BLK_F_SEG_MAX, we use a single
+  // data segment.
+  //
+  Dev->MaxSegmentSize = SIZE_1GB;
+  if (Features & VIRTIO_BLK_F_SIZE_MAX) {
+    Dev->MaxSegmentSize = MIN (SizeMax, SIZE_1GB);
+  }
+
+  MaxSegments = 1;
+  if (Features & VIRTIO_BLK_F_SEG_MAX) {
+    MaxSegments = MIN (SegMax, VBLK_MAX_SEGMENTS);
+    MaxSegments = MIN (MaxSegments,
+                    (SIZE_1GB + Dev->MaxSegmentSize - 1) / Dev->MaxSegmentSize);
+  }
+  MaxSegments = MIN (MaxSegments, (UINT32) QueueSize - 2);
+
+  Dev->MaxTransferSize = (UINT32) MIN (
+                                    MultU64x32 (Dev->MaxSegmentSize, MaxSegments),
+                                    SIZE_1GB
+                                    );
+  Dev->MaxTransferSize -= Dev->MaxTransferSize % BlockSize;
+  if (Dev->MaxTransferSize == 0) {
+    //
+    // We can't transfer a single logical block in a request.
+    //
     Status = EFI_UNSUPPORTED;
     goto Failed;
   }
 
+  Dev->SlotDescCount = (UINT16) (MaxSegments + 2);
+  Dev->NumSlots      = (UINT16) MIN (QueueSize / Dev->SlotDescCount,
+                                   VBLK_MAX_IN_FLIGHT);
+
   Status = VirtioRingInit (Dev->VirtIo, QueueSize, &Dev->Ring);
   if (EFI_ERROR (Status)) {
     goto Failed;
@@ -864,18 +1546,26 @@ VirtioBlkInit (
     goto ReleaseQueue;
   }
 
+  //
+  // If anything fails from here on, we must unmap the ring resources.
+  //
+  Status = VirtioBlkInitSlots (Dev);
+  if (EFI_ERROR (Status)) {
+    goto UnmapQueue;
+  }
+
   //
   // Additional steps for MMIO: align the queue appropriately, and set the
-  // size. If anything fails from here on, we must unmap the ring resources.
+  // size. If anything fails from here on, we must release the slots.
   //
   Status = Dev->VirtIo->SetQueueNum (Dev->VirtIo, QueueSize);
   if (EFI_ERROR (Status)) {
-    goto UnmapQueue;
+    goto UninitSlots;
   }
 
   Status = Dev->VirtIo->SetQueueAlign (Dev->VirtIo, EFI_PAGE_SIZE);
   if (EFI_ERROR (Status)) {
-    goto UnmapQueue;
+    goto UninitSlots;
   }
 
   //
@@ -887,7 +1577,7 @@ VirtioBlkInit (
                           RingBaseShift
                           );
   if (EFI_ERROR (Status)) {
-    goto UnmapQueue;
+    goto UninitSlots;
   }
 
 
@@ -898,7 +1588,7 @@ VirtioBlkInit (
     Features &= ~(UINT64)(VIRTIO_F_VERSION_1 | VIRTIO_F_IOMMU_PLATFORM);
     Status = Dev->VirtIo->SetGuestFeatures (Dev->VirtIo, Features);
     if (EFI_ERROR (Status)) {
-      goto UnmapQueue;
+      goto UninitSlots;
     }
   }
 
@@ -908,7 +1598,7 @@ VirtioBlkInit (
   NextDevStat |= VSTAT_DRIVER_OK;
   Status = Dev->VirtIo->SetDeviceStatus (Dev->VirtIo, NextDevStat);
   if (EFI_ERROR (Status)) {
-    goto UnmapQueue;
+    goto UninitSlots;
   }
 
   //
@@ -921,6 +1611,11 @@ VirtioBlkInit (
   Dev->BlockIo.ReadBlocks            = &VirtioBlkReadBlocks;
   Dev->BlockIo.WriteBlocks           = &VirtioBlkWriteBlocks;
   Dev->BlockIo.FlushBlocks           = &VirtioBlkFlushBlocks;
+  Dev->BlockIo2.Media                = &Dev->BlockIoMedia;
+  Dev->BlockIo2.Reset                = &VirtioBlkResetEx;
+  Dev->BlockIo2.ReadBlocksEx         = &VirtioBlkReadBlocksEx;
+  Dev->BlockIo2.WriteBlocksEx        = &VirtioBlkWriteBlocksEx;
+  Dev->BlockIo2.FlushBlocksEx        = &VirtioBlkFlushBlocksEx;
   Dev->BlockIoMedia.MediaId          = 0;
   Dev->BlockIoMedia.RemovableMedia   = FALSE;
   Dev->BlockIoMedia.MediaPresent     = TRUE;
@@ -935,6 +1630,9 @@ VirtioBlkInit (
   DEBUG ((DEBUG_INFO, "%a: LbaSize=0x%x[B] NumBlocks=0x%Lx[Lba]\n",
     __FUNCTION__, Dev->BlockIoMedia.BlockSize,
     Dev->BlockIoMedia.LastBlock + 1));
+  DEBUG ((DEBUG_INFO, "%a: MaxTransfer=0x%x[B] MaxSegment=0x%x[B] "
+    "InFlight=%u\n", __FUNCTION__, Dev->MaxTransferSize, Dev->MaxSegmentSize,
+    Dev->NumSlots));
 
   if (Features & VIRTIO_BLK_F_TOPOLOGY) {
     Dev->BlockIo.Revision = EFI_BLOCK_IO_PROTOCOL_REVISION3;
@@ -951,6 +1649,9 @@ VirtioBlkInit (
   }
   return EFI_SUCCESS;
 
+UninitSlots:
+  VirtioBlkUninitSlots (Dev);
+
 UnmapQueue:
   Dev->VirtIo->UnmapSharedBuffer (Dev->VirtIo, Dev->RingMap);
 
@@ -992,10 +1693,12 @@ VirtioBlkUninit (
   //
   Dev->VirtIo->SetDeviceStatus (Dev->VirtIo, 0);
 
+  VirtioBlkUninitSlots (Dev);
   Dev->VirtIo->UnmapSharedBuffer (Dev->VirtIo, Dev->RingMap);
   VirtioRingUninit (Dev->VirtIo, &Dev->Ring);
 
   SetMem (&Dev->BlockIo,      sizeof Dev->BlockIo,      0x00);
+  SetMem (&Dev->BlockIo2,     sizeof Dev->BlockIo2,     0x00);
   SetMem (&Dev->BlockIoMedia, sizeof Dev->BlockIoMedia, 0x00);
 }
 
@@ -1051,13 +1754,16 @@ VirtioBlkExitBoot (
 
   @retval EFI_SUCCESS           Driver instance has been created and
                                 initialized  for the virtio-blk device, it
-                                is now accessible via EFI_BLOCK_IO_PROTOCOL.
+                                is now accessible via EFI_BLOCK_IO_PROTOCOL
+                                and EFI_BLOCK_IO2_PROTOCOL.
 
   @retval EFI_OUT_OF_RESOURCES  Memory allocation failed.
 
   @return                       Error codes from the OpenProtocol() boot
                                 service, the VirtIo protocol, VirtioBlkInit(),
-                                or the InstallProtocolInterface() boot service.
+                                the CreateEvent() boot service,
+                                or the InstallMultipleProtocolInterfaces() boot
+                                service.
 
 **/
 
@@ -1099,18 +1805,34 @@ VirtioBlkDriverBindingStart (
   }
 
   //
-  // Setup complete, attempt to export the driver instance's BlockIo interface.
+  // The periodic timer reaps completed virtio-blk requests and submits queued
+  // ones, for asynchronous EFI_BLOCK_IO2_PROTOCOL requests. It is armed by
+  // UpdateAsyncTimer() while requests are outstanding.
   //
-  Dev->Signature = VBLK_SIG;
-  Status = gBS->InstallProtocolInterface (&DeviceHandle,
-                  &gEfiBlockIoProtocolGuid, EFI_NATIVE_INTERFACE,
-                  &Dev->BlockIo);
+  Status = gBS->CreateEvent (EVT_TIMER | EVT_NOTIFY_SIGNAL, TPL_NOTIFY,
+                  &VirtioBlkAsyncTimer, Dev, &Dev->AsyncTimer);
   if (EFI_ERROR (Status)) {
     goto CloseExitBoot;
   }
 
+  //
+  // Setup complete, attempt to export the driver instance's BlockIo and
+  // BlockIo2 interfaces.
+  //
+  Dev->Signature = VBLK_SIG;
+  Status = gBS->InstallMultipleProtocolInterfaces (&DeviceHandle,
+                  &gEfiBlockIoProtocolGuid, &Dev->BlockIo,
+                  &gEfiBlockIo2ProtocolGuid, &Dev->BlockIo2,
+                  NULL);
+  if (EFI_ERROR (Status)) {
+    goto CloseAsyncTimer;
+  }
+
   return EFI_SUCCESS;
 
+CloseAsyncTimer:
+  gBS->CloseEvent (Dev->AsyncTimer);
+
 CloseExitBoot:
   gBS->CloseEvent (Dev->ExitBoot);
 
@@ -1130,7 +1852,8 @@ FreeVirtioBlk:
 
 /**
 
-  Stop driving a virtio-blk device and remove its BlockIo interface.
+  Stop driving a virtio-blk device and remove its BlockIo and BlockIo2
+  interfaces.
 
   This function replays the success path of DriverBindingStart() in reverse.
   The host side virtio-blk device is reset, so that the OS boot loader or the
@@ -1181,12 +1904,21 @@ VirtioBlkDriverBindingStop (
   //
   // Handle Stop() requests for in-use driver instances gracefully.
   //
-  Status = gBS->UninstallProtocolInterface (DeviceHandle,
-                  &gEfiBlockIoProtocolGuid, &Dev->BlockIo);
+  Status = gBS->UninstallMultipleProtocolInterfaces (DeviceHandle,
+                  &gEfiBlockIoProtocolGuid, &Dev->BlockIo,
+                  &gEfiBlockIo2ProtocolGuid, &Dev->BlockIo2,
+                  NULL);
   if (EFI_ERROR (Status)) {
     return Status;
   }
 
+  //
+  // Complete the asynchronous requests that are still queued or in flight,
+  // signaling their tokens.
+  //
+  WaitForRequests (Dev, NULL);
+  gBS->CloseEvent (Dev->AsyncTimer);
+
   gBS->CloseEvent (Dev->ExitBoot);
 
   VirtioBlkUninit (Dev);
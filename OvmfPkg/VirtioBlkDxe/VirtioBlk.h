@@ -1,7 +1,7 @@
 /** @file
 
   Internal definitions for the virtio-blk driver, which produces Block I/O
-  Protocol instances for virtio-blk devices.
+  and Block I/O 2 Protocol instances for virtio-blk devices.
 
   Copyright (C) 2012, Red Hat, Inc.
 
@@ -13,13 +13,73 @@
 #define _VIRTIO_BLK_DXE_H_
 
 #include <Protocol/BlockIo.h>
+#include <Protocol/BlockIo2.h>
 #include <Protocol/ComponentName.h>
 #include <Protocol/DriverBinding.h>
 
 #include <IndustryStandard/Virtio.h>
 
 
-#define VBLK_SIG SIGNATURE_32 ('V', 'B', 'L', 'K')
+#define VBLK_SIG     SIGNATURE_32 ('V', 'B', 'L', 'K')
+#define VBLK_REQ_SIG SIGNATURE_32 ('V', 'B', 'R', 'Q')
+
+//
+// Upper limit on the number of virtio-blk requests that are in flight on the
+// virtqueue at the same time, and on the number of data descriptors (segments)
+// that a single virtio-blk request may consist of.
+//
+#define VBLK_MAX_IN_FLIGHT 64
+#define VBLK_MAX_SEGMENTS  16
+
+//
+// Period of the timer that reaps completed virtio-blk requests and submits
+// queued ones. The timer only runs while requests are queued or in flight.
+//
+#define VBLK_ASYNC_TIMER   EFI_TIMER_PERIOD_MILLISECONDS (1)
+
+//
+// The request header and the host status of one virtio-blk request, in memory
+// that is shared with the device. Each slot of descriptors owns one of these.
+//
+#pragma pack(1)
+typedef struct {
+  VIRTIO_BLK_REQ Request;
+  UINT8          HostStatus;
+} VBLK_SHARED_REQ;
+#pragma pack()
+
+//
+// A read, write or flush request received through EFI_BLOCK_IO_PROTOCOL or
+// EFI_BLOCK_IO2_PROTOCOL. The request is broken up into virtio-blk requests
+// that transfer at most VBLK_DEV.MaxTransferSize bytes each.
+//
+typedef struct {
+  UINT32              Signature;
+  LIST_ENTRY          Link;           // VBLK_DEV.QueuedRequests
+  EFI_BLOCK_IO2_TOKEN *Token;         // NULL for a synchronous request
+  EFI_LBA             Lba;            // first block not submitted yet
+  UINT8               *Buffer;        // first byte not submitted yet
+  UINTN               BufferSize;     // number of bytes not submitted yet
+  BOOLEAN             RequestIsWrite;
+  BOOLEAN             IsFlush;
+  BOOLEAN             Submitted;      // no more virtio-blk requests to submit
+  BOOLEAN             Done;           // synchronous request complete
+  UINTN               InFlight;       // virtio-blk requests on the virtqueue
+  EFI_STATUS          Status;
+} VBLK_REQ;
+
+#define VBLK_REQ_FROM_LINK(LinkPointer) \
+        CR (LinkPointer, VBLK_REQ, Link, VBLK_REQ_SIG)
+
+//
+// Host side bookkeeping for a slot of descriptors, ie. a virtio-blk request in
+// flight.
+//
+typedef struct {
+  VBLK_REQ *Request;                  // NULL if the slot is free
+  VOID     *BufferMapping;
+  UINTN    BufferSize;
+} VBLK_SLOT;
 
 typedef struct {
   //
@@ -27,20 +87,38 @@ typedef struct {
   // at various call depths. The table to the right should make it easier to
   // track them.
   //
-  //                     field                    init function       init dpth
-  //                     ---------------------    ------------------  ---------
-  UINT32                 Signature;            // DriverBindingStart  0
-  VIRTIO_DEVICE_PROTOCOL *VirtIo;              // DriverBindingStart  0
-  EFI_EVENT              ExitBoot;             // DriverBindingStart  0
-  VRING                  Ring;                 // VirtioRingInit      2
-  EFI_BLOCK_IO_PROTOCOL  BlockIo;              // VirtioBlkInit       1
-  EFI_BLOCK_IO_MEDIA     BlockIoMedia;         // VirtioBlkInit       1
-  VOID                   *RingMap;             // VirtioRingMap       2
+  //                       field                                 init function       init dpth
+  //                       ----------------------------------    ------------------  ---------
+  UINT32                   Signature;                         // DriverBindingStart  0
+  VIRTIO_DEVICE_PROTOCOL   *VirtIo;                           // DriverBindingStart  0
+  EFI_EVENT                ExitBoot;                          // DriverBindingStart  0
+  EFI_EVENT                AsyncTimer;                        // DriverBindingStart  0
+  BOOLEAN                  AsyncTimerArmed;                   // DriverBindingStart  0
+  VRING                    Ring;                              // VirtioRingInit      2
+  EFI_BLOCK_IO_PROTOCOL    BlockIo;                           // VirtioBlkInit       1
+  EFI_BLOCK_IO2_PROTOCOL   BlockIo2;                          // VirtioBlkInit       1
+  EFI_BLOCK_IO_MEDIA       BlockIoMedia;                      // VirtioBlkInit       1
+  UINT32                   MaxSegmentSize;                    // VirtioBlkInit       1
+  UINT32                   MaxTransferSize;                   // VirtioBlkInit       1
+  UINT16                   SlotDescCount;                     // VirtioBlkInit       1
+  UINT16                   NumSlots;                          // VirtioBlkInit       1
+  VOID                     *RingMap;                          // VirtioRingMap       2
+  volatile VBLK_SHARED_REQ *SharedReqs;                       // VirtioBlkInitSlots  2
+  EFI_PHYSICAL_ADDRESS     SharedReqsDeviceAddress;           // VirtioBlkInitSlots  2
+  VOID                     *SharedReqsMap;                    // VirtioBlkInitSlots  2
+  VBLK_SLOT                Slots[VBLK_MAX_IN_FLIGHT];         // VirtioBlkInitSlots  2
+  UINT16                   FreeSlotStack[VBLK_MAX_IN_FLIGHT]; // VirtioBlkInitSlots  2
+  UINT16                   FreeSlotCount;                     // VirtioBlkInitSlots  2
+  UINT16                   LastUsedIdx;                       // VirtioBlkInitSlots  2
+  LIST_ENTRY               QueuedRequests;                    // VirtioBlkInitSlots  2
 } VBLK_DEV;
 
 #define VIRTIO_BLK_FROM_BLOCK_IO(BlockIoPointer) \
         CR (BlockIoPointer, VBLK_DEV, BlockIo, VBLK_SIG)
 
+#define VIRTIO_BLK_FROM_BLOCK_IO2(BlockIo2Pointer) \
+        CR (BlockIo2Pointer, VBLK_DEV, BlockIo2, VBLK_SIG)
+
 
 /**
 
@@ -106,13 +184,16 @@ VirtioBlkDriverBindingSupported (
 
   @retval EFI_SUCCESS           Driver instance has been created and
                                 initialized  for the virtio-blk device, it
-                                is now accessible via EFI_BLOCK_IO_PROTOCOL.
+                                is now accessible via EFI_BLOCK_IO_PROTOCOL
+                                and EFI_BLOCK_IO2_PROTOCOL.
 
   @retval EFI_OUT_OF_RESOURCES  Memory allocation failed.
 
   @return                       Error codes from the OpenProtocol() boot
-                                service, VirtioBlkInit(), or the
-                                InstallProtocolInterface() boot service.
+                                service, VirtioBlkInit(), the CreateEvent() or
+                                SetTimer() boot services, or the
+                                InstallMultipleProtocolInterfaces() boot
+                                service.
 
 **/
 
@@ -127,7 +208,8 @@ VirtioBlkDriverBindingStart (
 
 /**
 
-  Stop driving a virtio-blk device and remove its BlockIo interface.
+  Stop driving a virtio-blk device and remove its BlockIo and BlockIo2
+  interfaces.
 
   This function replays the success path of DriverBindingStart() in reverse.
   The host side virtio-blk device is reset, so that the OS boot loader or the
@@ -182,7 +264,7 @@ VirtioBlkReset (
     ReadBlocksEx() Implementation.
 
   Parameter checks and conformant return values are implemented in
-  VerifyReadWriteRequest() and SynchronousRequest().
+  VerifyReadWriteRequest() and SubmitRequest().
 
   A zero BufferSize doesn't seem to be prohibited, so do nothing in that case,
   successfully.
@@ -211,7 +293,7 @@ VirtioBlkReadBlocks (
     WriteBlockEx() Implementation.
 
   Parameter checks and conformant return values are implemented in
-  VerifyReadWriteRequest() and SynchronousRequest().
+  VerifyReadWriteRequest() and SubmitRequest().
 
   A zero BufferSize doesn't seem to be prohibited, so do nothing in that case,
   successfully.
@@ -253,6 +335,96 @@ VirtioBlkFlushBlocks (
   );
 
 
+//
+// UEFI Spec 2.4, 13.10 EFI Block I/O 2 Protocol
+//
+EFI_STATUS
+EFIAPI
+VirtioBlkResetEx (
+  IN EFI_BLOCK_IO2_PROTOCOL *This,
+  IN BOOLEAN                ExtendedVerification
+  );
+
+
+/**
+
+  ReadBlocksEx() operation for virtio-blk.
+
+  See
+  - UEFI Spec 2.4, 13.10 EFI Block I/O 2 Protocol,
+    EFI_BLOCK_IO2_PROTOCOL.ReadBlocksEx().
+  - Driver Writer's Guide for UEFI 2.3.1 v1.01, 24.2.2. ReadBlocks() and
+    ReadBlocksEx() Implementation.
+
+  If Token is NULL, or Token->Event is NULL, the request is carried out
+  synchronously, like ReadBlocks(). Otherwise the request is queued, and
+  Token->Event is signaled once the request completes.
+
+**/
+
+EFI_STATUS
+EFIAPI
+VirtioBlkReadBlocksEx (
+  IN     EFI_BLOCK_IO2_PROTOCOL *This,
+  IN     UINT32                 MediaId,
+  IN     EFI_LBA                Lba,
+  IN OUT EFI_BLOCK_IO2_TOKEN    *Token,
+  IN     UINTN                  BufferSize,
+  OUT    VOID                   *Buffer
+  );
+
+
+/**
+
+  WriteBlocksEx() operation for virtio-blk.
+
+  See
+  - UEFI Spec 2.4, 13.10 EFI Block I/O 2 Protocol,
+    EFI_BLOCK_IO2_PROTOCOL.WriteBlocksEx().
+  - Driver Writer's Guide for UEFI 2.3.1 v1.01, 24.2.3 WriteBlocks() and
+    WriteBlockEx() Implementation.
+
+  If Token is NULL, or Token->Event is NULL, the request is carried out
+  synchronously, like WriteBlocks(). Otherwise the request is queued, and
+  Token->Event is signaled once the request completes.
+
+**/
+
+EFI_STATUS
+EFIAPI
+VirtioBlkWriteBlocksEx (
+  IN     EFI_BLOCK_IO2_PROTOCOL *This,
+  IN     UINT32                 MediaId,
+  IN     EFI_LBA                Lba,
+  IN OUT EFI_BLOCK_IO2_TOKEN    *Token,
+  IN     UINTN                  BufferSize,
+  IN     VOID                   *Buffer
+  );
+
+
+/**
+
+  FlushBlocksEx() operation for virtio-blk.
+
+  See
+  - UEFI Spec 2.4, 13.10 EFI Block I/O 2 Protocol,
+    EFI_BLOCK_IO2_PROTOCOL.FlushBlocksEx().
+  - Driver Writer's Guide for UEFI 2.3.1 v1.01, 24.2.4 FlushBlocks() and
+    FlushBlocksEx() Implementation.
+
+  The flush is submitted to the device only after all read and write requests
+  queued before it have completed.
+
+**/
+
+EFI_STATUS
+EFIAPI
+VirtioBlkFlushBlocksEx (
+  IN     EFI_BLOCK_IO2_PROTOCOL *This,
+  IN OUT EFI_BLOCK_IO2_TOKEN    *Token
+  );
+
+
 //
 // The purpose of the following scaffolding (EFI_COMPONENT_NAME_PROTOCOL and
 // EFI_COMPONENT_NAME2_PROTOCOL implementation) is to format the driver's name
@@ -36,6 +36,14 @@ UINT8                               *mImageBase       = NULL;
 UINT8                               mImageDigest[MAX_DIGEST_SIZE];
 UINTN                               mImageDigestSize;
 
+//
+// Authenticode digests already computed for the current PE/COFF image, indexed
+// by hash algorithm. An image carrying several signatures with the same digest
+// algorithm is hashed only once per verification.
+//
+UINT8                               mImageDigestCache[HASHALG_MAX][MAX_DIGEST_SIZE];
+BOOLEAN                             mImageDigestCached[HASHALG_MAX];
+
 //
 // Notify string for authorization UI.
 //
@@ -346,6 +354,15 @@ HashPeImage (
   }
 
   mHashTypeStr = mHash[HashAlg].Name;
+
+  //
+  // Reuse the digest if this image has already been hashed with HashAlg.
+  //
+  if (mImageDigestCached[HashAlg]) {
+    CopyMem (mImageDigest, mImageDigestCache[HashAlg], mImageDigestSize);
+    return TRUE;
+  }
+
   CtxSize   = mHash[HashAlg].GetContextSize();
 
   HashCtx = AllocatePool (CtxSize);
@@ -589,6 +606,10 @@ HashPeImage (
   }
 
   Status  = mHash[HashAlg].HashFinal(HashCtx, mImageDigest);
+  if (Status) {
+    CopyMem (mImageDigestCache[HashAlg], mImageDigest, mImageDigestSize);
+    mImageDigestCached[HashAlg] = TRUE;
+  }
 
 Done:
   if (HashCtx != NULL) {
@@ -600,6 +621,68 @@ Done:
   return Status;
 }
 
+/**
+  Get the SHA256 Authenticode digest of the image from the driver which loaded
+  the file into FileBuffer, e.g. a network boot driver which hashed the image
+  as it was downloaded, and cache it as the SHA256 digest of the image.
+
+  The digest is only used if the driver produces it for this exact buffer and
+  size. Otherwise HashPeImage() hashes the image.
+
+  @param[in]    File       The device path of the file.
+  @param[in]    FileBuffer The buffer of the file.
+  @param[in]    FileSize   The size of the file.
+
+**/
+VOID
+GetLoadFileImageDigest (
+  IN  CONST EFI_DEVICE_PATH_PROTOCOL   *File,
+  IN  VOID                             *FileBuffer,
+  IN  UINTN                            FileSize
+  )
+{
+  EFI_STATUS                        Status;
+  EFI_HANDLE                        DeviceHandle;
+  EFI_DEVICE_PATH_PROTOCOL          *TempDevicePath;
+  EDKII_LOAD_FILE_DIGEST_PROTOCOL   *LoadFileDigest;
+
+  if (File == NULL) {
+    return;
+  }
+
+  DeviceHandle   = NULL;
+  TempDevicePath = (EFI_DEVICE_PATH_PROTOCOL *) File;
+  Status = gBS->LocateDevicePath (
+                  &gEdkiiLoadFileDigestProtocolGuid,
+                  &TempDevicePath,
+                  &DeviceHandle
+                  );
+  if (EFI_ERROR (Status)) {
+    return;
+  }
+
+  Status = gBS->HandleProtocol (
+                  DeviceHandle,
+                  &gEdkiiLoadFileDigestProtocolGuid,
+                  (VOID **) &LoadFileDigest
+                  );
+  if (EFI_ERROR (Status)) {
+    return;
+  }
+
+  Status = LoadFileDigest->GetImageDigest (
+                             LoadFileDigest,
+                             FileBuffer,
+                             FileSize,
+                             &gEfiHashAlgorithmSha256Guid,
+                             mImageDigestCache[HASHALG_SHA256],
+                             SHA256_DIGEST_SIZE
+                             );
+  if (!EFI_ERROR (Status)) {
+    mImageDigestCached[HASHALG_SHA256] = TRUE;
+  }
+}
+
 /**
   Recognize the Hash algorithm in PE/COFF Authenticode and calculate hash of
   Pe/Coff image based on the authenticode image hashing in PE/COFF Specification
@@ -1747,6 +1830,11 @@ DxeImageVerificationHandler (
   mImageBase  = (UINT8 *) FileBuffer;
   mImageSize  = FileSize;
 
+  //
+  // Digests cached for a previous image are not valid for this one.
+  //
+  ZeroMem (mImageDigestCached, sizeof (mImageDigestCached));
+
   ZeroMem (&ImageContext, sizeof (ImageContext));
   ImageContext.Handle    = (VOID *) FileBuffer;
   ImageContext.ImageRead = (PE_COFF_LOADER_READ_FILE) DxeImageVerificationLibImageRead;
@@ -1803,6 +1891,13 @@ DxeImageVerificationHandler (
     }
   }
 
+  //
+  // Use the SHA256 digest calculated while the file was loaded, if any.
+  //
+  if (FeaturePcdGet (PcdLoadFileImageDigest)) {
+    GetLoadFileImageDigest (File, FileBuffer, FileSize);
+  }
+
   //
   // Start Image Validation.
   //
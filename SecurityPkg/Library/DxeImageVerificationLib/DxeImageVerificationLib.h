@@ -28,6 +28,8 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <Protocol/BlockIo.h>
 #include <Protocol/SimpleFileSystem.h>
 #include <Protocol/VariableWrite.h>
+#include <Protocol/Hash.h>
+#include <Protocol/LoadFileDigest.h>
 #include <Guid/ImageAuthentication.h>
 #include <Guid/AuthenticatedVariableFormat.h>
 #include <IndustryStandard/PeImage.h>
@@ -0,0 +1,156 @@
+/** @file
+  UEFI Application to compare the dispatch latency of MpParallelFor() with
+  one StartupAllAPs() call per work item.
+
+  Copyright (c) 2021, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Uefi.h>
+#include <Pi/PiMultiPhase.h>
+#include <Protocol/MpService.h>
+#include <Library/BaseLib.h>
+#include <Library/SynchronizationLib.h>
+#include <Library/TimerLib.h>
+#include <Library/UefiLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+#include <Library/MpParallelLib.h>
+
+#define BENCHMARK_ITEM_COUNT  1024
+
+volatile UINT32             mBenchmarkCounter;
+
+/**
+  Work item of the StartupAllAPs() baseline.
+
+  @param[in]  Buffer      Unused.
+**/
+VOID
+EFIAPI
+BenchmarkApProcedure (
+  IN VOID                   *Buffer
+  )
+{
+  InterlockedIncrement (&mBenchmarkCounter);
+}
+
+/**
+  Work item of the MpParallelFor() run.
+
+  @param[in]  Index       Unused.
+  @param[in]  Context     Unused.
+**/
+VOID
+EFIAPI
+BenchmarkParallelProcedure (
+  IN UINTN                  Index,
+  IN VOID                   *Context
+  )
+{
+  InterlockedIncrement (&mBenchmarkCounter);
+}
+
+/**
+  Return the time elapsed since StartTicks, in nanoseconds.
+
+  @param[in]  StartTicks  Performance counter value at the start of the run.
+
+  @return The elapsed time in nanoseconds.
+**/
+UINT64
+BenchmarkElapsed (
+  IN UINT64                 StartTicks
+  )
+{
+  UINT64                    Start;
+  UINT64                    End;
+  UINT64                    Ticks;
+
+  GetPerformanceCounterProperties (&Start, &End);
+  Ticks = GetPerformanceCounter ();
+  if (End >= Start) {
+    Ticks = Ticks - StartTicks;
+  } else {
+    Ticks = StartTicks - Ticks;
+  }
+
+  return GetTimeInNanoSecond (Ticks);
+}
+
+/**
+  The user Entry Point for Application. The user code starts with this function
+  as the real entry point for the application.
+
+  @param[in] ImageHandle    The firmware allocated handle for the EFI image.
+  @param[in] SystemTable    A pointer to the EFI System Table.
+
+  @retval EFI_SUCCESS       The entry point is executed successfully.
+  @retval other             Some error occurs when executing this entry point.
+
+**/
+EFI_STATUS
+EFIAPI
+UefiMain (
+  IN EFI_HANDLE             ImageHandle,
+  IN EFI_SYSTEM_TABLE       *SystemTable
+  )
+{
+  EFI_STATUS                Status;
+  EFI_MP_SERVICES_PROTOCOL  *MpServices;
+  UINTN                     NumberOfProcessors;
+  UINTN                     NumberOfEnabledProcessors;
+  UINTN                     Index;
+  UINT64                    StartTicks;
+  UINT64                    StartupAllApsTime;
+  UINT64                    ParallelForTime;
+
+  Status = gBS->LocateProtocol (&gEfiMpServiceProtocolGuid, NULL, (VOID **) &MpServices);
+  if (EFI_ERROR (Status)) {
+    Print (L"MP Services Protocol not found - %r\n", Status);
+    return Status;
+  }
+
+  Status = MpServices->GetNumberOfProcessors (MpServices, &NumberOfProcessors, &NumberOfEnabledProcessors);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  Print (L"Processors: %d, enabled: %d, work items: %d\n", NumberOfProcessors, NumberOfEnabledProcessors, BENCHMARK_ITEM_COUNT);
+
+  //
+  // Baseline: wake up all the APs once per work item.
+  //
+  mBenchmarkCounter = 0;
+  StartTicks = GetPerformanceCounter ();
+  for (Index = 0; Index < BENCHMARK_ITEM_COUNT; Index++) {
+    Status = MpServices->StartupAllAPs (MpServices, BenchmarkApProcedure, FALSE, NULL, 0, NULL, NULL);
+    if (EFI_ERROR (Status) && (Status != EFI_NOT_STARTED)) {
+      Print (L"StartupAllAPs failed - %r\n", Status);
+      return Status;
+    }
+  }
+  StartupAllApsTime = BenchmarkElapsed (StartTicks);
+  Print (
+    L"StartupAllAPs: %ld ns total, %ld ns per dispatch, %d procedure calls\n",
+    StartupAllApsTime,
+    DivU64x32 (StartupAllApsTime, BENCHMARK_ITEM_COUNT),
+    mBenchmarkCounter
+    );
+
+  //
+  // One wakeup for the whole batch.
+  //
+  mBenchmarkCounter = 0;
+  StartTicks = GetPerformanceCounter ();
+  MpParallelFor (BENCHMARK_ITEM_COUNT, BenchmarkParallelProcedure, NULL);
+  ParallelForTime = BenchmarkElapsed (StartTicks);
+  Print (
+    L"MpParallelFor: %ld ns total, %ld ns per work item, %d procedure calls\n",
+    ParallelForTime,
+    DivU64x32 (ParallelForTime, BENCHMARK_ITEM_COUNT),
+    mBenchmarkCounter
+    );
+
+  return EFI_SUCCESS;
+}
@@ -0,0 +1,82 @@
+/** @file
+  Header file for the MP Parallel Library.
+
+  The library splits a batch of small, independent work items across all enabled
+  logical processors. The processors are woken once per batch and then pull
+  chunks of work items from a shared queue until the batch is drained, so the
+  cost of an AP wakeup is paid once instead of once per work item.
+
+  Copyright (c) 2021, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef _MP_PARALLEL_LIB_H_
+#define _MP_PARALLEL_LIB_H_
+
+/**
+  Procedure run for every index of a parallel-for.
+
+  The procedure may run on the BSP or on any AP, so it must follow the same
+  rules as an EFI_AP_PROCEDURE: it must not call UEFI boot services and must
+  only touch data that no other index touches, or protect it with a lock.
+
+  @param[in]  Index       The index of the work item, in [0, Count).
+  @param[in]  Context     The context passed to MpParallelFor().
+**/
+typedef
+VOID
+(EFIAPI *MP_PARALLEL_PROCEDURE) (
+  IN UINTN                  Index,
+  IN VOID                   *Context
+  );
+
+///
+/// One work item submitted through MpParallelRunTasks().
+///
+typedef struct {
+  EFI_AP_PROCEDURE          Procedure;
+  VOID                      *Argument;
+} MP_PARALLEL_TASK;
+
+/**
+  Run Procedure once for every index in [0, Count) on all enabled logical
+  processors, and return once all of them have completed.
+
+  The BSP takes part in the work whenever the current TPL allows it. If the MP
+  services are not available, only one processor is enabled or the APs are
+  busy, all the work items are run on the calling processor.
+
+  @param[in]  Count       The number of work items.
+  @param[in]  Procedure   The procedure to run for every work item.
+  @param[in]  Context     The context passed to every call of Procedure.
+
+  @retval EFI_SUCCESS            All the work items have been run.
+  @retval EFI_INVALID_PARAMETER  Procedure is NULL.
+**/
+EFI_STATUS
+EFIAPI
+MpParallelFor (
+  IN UINTN                  Count,
+  IN MP_PARALLEL_PROCEDURE  Procedure,
+  IN VOID                   *Context    OPTIONAL
+  );
+
+/**
+  Run a list of independent tasks on all enabled logical processors, and
+  return once all of them have completed.
+
+  @param[in]  Tasks       The array of tasks to run.
+  @param[in]  TaskCount   The number of entries in Tasks.
+
+  @retval EFI_SUCCESS            All the tasks have been run.
+  @retval EFI_INVALID_PARAMETER  Tasks is NULL and TaskCount is not 0.
+**/
+EFI_STATUS
+EFIAPI
+MpParallelRunTasks (
+  IN MP_PARALLEL_TASK       *Tasks,
+  IN UINTN                  TaskCount
+  );
+
+#endif
@@ -0,0 +1,297 @@
+/** @file
+  MP Parallel Library instance for DXE drivers and UEFI applications.
+
+  A batch is dispatched with a single non-blocking StartupAllAPs() call. Every
+  processor, the BSP included, then runs the same worker that claims chunks of
+  work items from a shared counter until none is left. Processors that finish
+  early keep claiming chunks, so uneven work items balance themselves out
+  without a second round trip through the MP services. The BSP then waits for
+  the APs on a counter of the job, as the MP services only check the
+  completion of a non-blocking request from a periodic timer.
+
+  Copyright (c) 2021, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <PiDxe.h>
+#include <Protocol/MpService.h>
+#include <Library/BaseLib.h>
+#include <Library/DebugLib.h>
+#include <Library/SynchronizationLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+#include <Library/MpParallelLib.h>
+
+//
+// Number of chunks handed out per enabled processor. Several chunks per
+// processor let fast processors pick up the work of slow ones, while keeping
+// the shared counter off the hot path for very small work items.
+//
+#define MP_PARALLEL_CHUNKS_PER_CPU  8
+
+typedef struct {
+  MP_PARALLEL_PROCEDURE     Procedure;
+  VOID                      *Context;
+  UINTN                     Count;
+  UINTN                     ChunkSize;
+  UINT32                    ChunkCount;
+  volatile UINT32           NextChunk;
+  volatile UINT32           FinishedCount;
+} MP_PARALLEL_JOB;
+
+EFI_MP_SERVICES_PROTOCOL    *mMpParallelMpServices = NULL;
+
+//
+// The event passed to the non-blocking StartupAllAPs() calls. It is never
+// closed, as the MP services signal it after MpParallelFor() has returned.
+//
+EFI_EVENT                   mMpParallelEvent = NULL;
+
+/**
+  Claim and run chunks of work items until the job is drained.
+
+  This function is run on the BSP and on all the enabled APs.
+
+  @param[in]  Buffer      Pointer to the MP_PARALLEL_JOB.
+**/
+VOID
+EFIAPI
+MpParallelWorker (
+  IN VOID                   *Buffer
+  )
+{
+  MP_PARALLEL_JOB           *Job;
+  UINT32                    Chunk;
+  UINTN                     Index;
+  UINTN                     Last;
+
+  Job = (MP_PARALLEL_JOB *) Buffer;
+  while (TRUE) {
+    Chunk = InterlockedIncrement (&Job->NextChunk) - 1;
+    if (Chunk >= Job->ChunkCount) {
+      break;
+    }
+
+    Index = (UINTN) Chunk * Job->ChunkSize;
+    Last  = MIN (Index + Job->ChunkSize, Job->Count);
+    for (; Index < Last; Index++) {
+      Job->Procedure (Index, Job->Context);
+    }
+  }
+}
+
+/**
+  Run the worker on an AP, then count the AP as finished.
+
+  The BSP returns from MpParallelFor() once all the APs are counted, so the
+  job is not accessed after the count is updated.
+
+  @param[in]  Buffer      Pointer to the MP_PARALLEL_JOB.
+**/
+VOID
+EFIAPI
+MpParallelApWorker (
+  IN VOID                   *Buffer
+  )
+{
+  MP_PARALLEL_JOB           *Job;
+
+  Job = (MP_PARALLEL_JOB *) Buffer;
+  MpParallelWorker (Job);
+  InterlockedIncrement (&Job->FinishedCount);
+}
+
+/**
+  Return the MP services protocol, or NULL when it is not installed yet.
+
+  @return The EFI_MP_SERVICES_PROTOCOL interface or NULL.
+**/
+EFI_MP_SERVICES_PROTOCOL *
+MpParallelGetMpServices (
+  VOID
+  )
+{
+  EFI_STATUS                Status;
+
+  if (mMpParallelMpServices == NULL) {
+    Status = gBS->LocateProtocol (&gEfiMpServiceProtocolGuid, NULL, (VOID **) &mMpParallelMpServices);
+    if (EFI_ERROR (Status)) {
+      mMpParallelMpServices = NULL;
+    }
+  }
+
+  return mMpParallelMpServices;
+}
+
+/**
+  Run Procedure once for every index in [0, Count) on all enabled logical
+  processors, and return once all of them have completed.
+
+  The BSP takes part in the work whenever the current TPL allows it. If the MP
+  services are not available, only one processor is enabled or the APs are
+  busy, all the work items are run on the calling processor.
+
+  @param[in]  Count       The number of work items.
+  @param[in]  Procedure   The procedure to run for every work item.
+  @param[in]  Context     The context passed to every call of Procedure.
+
+  @retval EFI_SUCCESS            All the work items have been run.
+  @retval EFI_INVALID_PARAMETER  Procedure is NULL.
+**/
+EFI_STATUS
+EFIAPI
+MpParallelFor (
+  IN UINTN                  Count,
+  IN MP_PARALLEL_PROCEDURE  Procedure,
+  IN VOID                   *Context    OPTIONAL
+  )
+{
+  EFI_STATUS                Status;
+  EFI_MP_SERVICES_PROTOCOL  *MpServices;
+  MP_PARALLEL_JOB           Job;
+  UINTN                     NumberOfProcessors;
+  UINTN                     NumberOfEnabledProcessors;
+  UINTN                     ChunkCount;
+  EFI_TPL                   Tpl;
+  EFI_EVENT                 WaitEvent;
+  UINT32                    ApCount;
+
+  if (Procedure == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (Count == 0) {
+    return EFI_SUCCESS;
+  }
+
+  NumberOfEnabledProcessors = 1;
+  MpServices = MpParallelGetMpServices ();
+  if (MpServices != NULL) {
+    Status = MpServices->GetNumberOfProcessors (
+                           MpServices,
+                           &NumberOfProcessors,
+                           &NumberOfEnabledProcessors
+                           );
+    if (EFI_ERROR (Status)) {
+      NumberOfEnabledProcessors = 1;
+    }
+  }
+
+  //
+  // Split the work items into chunks. The chunk count is kept well below
+  // MAX_UINT32 so that the shared counter cannot wrap around even after every
+  // processor has incremented it once past the end.
+  //
+  ChunkCount = MIN (Count, NumberOfEnabledProcessors * MP_PARALLEL_CHUNKS_PER_CPU);
+  ChunkCount = MIN (ChunkCount, MAX_UINT32 / 2);
+
+  Job.Procedure     = Procedure;
+  Job.Context       = Context;
+  Job.Count         = Count;
+  Job.ChunkSize     = (Count + ChunkCount - 1) / ChunkCount;
+  Job.ChunkCount    = (UINT32) ((Count + Job.ChunkSize - 1) / Job.ChunkSize);
+  Job.NextChunk     = 0;
+  Job.FinishedCount = 0;
+
+  if (NumberOfEnabledProcessors == 1) {
+    MpParallelWorker (&Job);
+    return EFI_SUCCESS;
+  }
+
+  //
+  // The MP services complete a non-blocking request from a TPL_NOTIFY timer,
+  // so the BSP can only work alongside the APs below that TPL. Otherwise
+  // block in StartupAllAPs() and let the APs do all the work.
+  //
+  Tpl = gBS->RaiseTPL (TPL_HIGH_LEVEL);
+  gBS->RestoreTPL (Tpl);
+
+  WaitEvent = NULL;
+  if (Tpl < TPL_NOTIFY) {
+    if (mMpParallelEvent == NULL) {
+      Status = gBS->CreateEvent (0, TPL_CALLBACK, NULL, NULL, &mMpParallelEvent);
+      if (EFI_ERROR (Status)) {
+        mMpParallelEvent = NULL;
+      }
+    }
+    WaitEvent = mMpParallelEvent;
+  }
+
+  Status = MpServices->StartupAllAPs (
+                         MpServices,
+                         MpParallelApWorker,
+                         FALSE,
+                         WaitEvent,
+                         0,
+                         &Job,
+                         NULL
+                         );
+  //
+  // StartupAllAPs() only succeeds when all the enabled APs are idle, and then
+  // starts all of them.
+  //
+  ApCount = (UINT32) (NumberOfEnabledProcessors - 1);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_VERBOSE, "MpParallelFor: APs not started - %r\n", Status));
+    ApCount = 0;
+  }
+
+  //
+  // Whatever the APs have not claimed is run on the BSP. When the dispatch
+  // failed this runs the whole job serially.
+  //
+  MpParallelWorker (&Job);
+
+  //
+  // Wait for the APs to finish their last chunk. The request itself is
+  // completed by the next call to the MP services or by their timer.
+  //
+  while (Job.FinishedCount < ApCount) {
+    CpuPause ();
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Run one entry of the task array passed to MpParallelRunTasks().
+
+  @param[in]  Index       The index of the task.
+  @param[in]  Context     Pointer to the task array.
+**/
+VOID
+EFIAPI
+MpParallelRunTask (
+  IN UINTN                  Index,
+  IN VOID                   *Context
+  )
+{
+  MP_PARALLEL_TASK          *Tasks;
+
+  Tasks = (MP_PARALLEL_TASK *) Context;
+  Tasks[Index].Procedure (Tasks[Index].Argument);
+}
+
+/**
+  Run a list of independent tasks on all enabled logical processors, and
+  return once all of them have completed.
+
+  @param[in]  Tasks       The array of tasks to run.
+  @param[in]  TaskCount   The number of entries in Tasks.
+
+  @retval EFI_SUCCESS            All the tasks have been run.
+  @retval EFI_INVALID_PARAMETER  Tasks is NULL and TaskCount is not 0.
+**/
+EFI_STATUS
+EFIAPI
+MpParallelRunTasks (
+  IN MP_PARALLEL_TASK       *Tasks,
+  IN UINTN                  TaskCount
+  )
+{
+  if ((Tasks == NULL) && (TaskCount != 0)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  return MpParallelFor (TaskCount, MpParallelRunTask, Tasks);
+}